@@ -72,11 +72,15 @@ linux64:
     # when parsing the file system looking for sources exclude this for all or
     # a specific platform
     ADDON_SOURCES_EXCLUDE = libs/libaudiodecoder/%
+    # decomment this if PDSP_USE_JACK is defined in src/flags.h
+    # ADDON_PKG_CONFIG_LIBRARIES = jack
 	
 linux:
     # when parsing the file system looking for sources exclude this for all or
     # a specific platform
     ADDON_SOURCES_EXCLUDE = libs/libaudiodecoder/%
+    # decomment this if PDSP_USE_JACK is defined in src/flags.h
+    # ADDON_PKG_CONFIG_LIBRARIES = jack
 	
 msys2:
 
@@ -0,0 +1,240 @@
+// checks BinauralSpatializer against the direct convolution with the impulse responses of the HRTFSet
+// a source on a measured direction uses only its impulse responses, a source between them mixes the nearest ones with inverse distance weights
+// buffers shorter than the expected size have to be processed too, a NaN azimuth has to be ignored
+// see README.md for building it
+
+#include "DSP/core/Processor.h"
+#include "DSP/core/ExternalInput.h"
+#include "DSP/convolution/BinauralSpatializer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#define SAMPLE_RATE 44100.0
+#define LENGTH 300
+
+struct Direction {
+    float azimuth;
+    float elevation;
+    std::vector<float> left;
+    std::vector<float> right;
+};
+
+// angular distance in radians
+float distance( float azimuthA, float elevationA, float azimuthB, float elevationB ){
+    double a = azimuthA * M_PI_DOUBLE / 180.0;
+    double b = azimuthB * M_PI_DOUBLE / 180.0;
+    double ea = elevationA * M_PI_DOUBLE / 180.0;
+    double eb = elevationB * M_PI_DOUBLE / 180.0;
+    double dot = std::cos(ea)*std::cos(a)*std::cos(eb)*std::cos(b) + std::cos(ea)*std::sin(a)*std::cos(eb)*std::sin(b) + std::sin(ea)*std::sin(eb);
+    return (float) std::acos( std::max( -1.0, std::min( 1.0, dot ) ) );
+}
+
+// the output of the left and right ear, the gains fade in from zero during the first buffer
+void reference( const std::vector<Direction> & directions, float azimuth, float elevation, const std::vector<float> & signal, int bufferSize,
+                std::vector<double> & left, std::vector<double> & right ){
+
+    std::vector<std::pair<float, int>> nearest;
+    for( size_t d=0; d<directions.size(); ++d ){
+        nearest.push_back( std::make_pair( distance( azimuth, elevation, directions[d].azimuth, directions[d].elevation ), (int) d ) );
+    }
+    std::sort( nearest.begin(), nearest.end() );
+
+    // the weights go to zero at the distance of the fourth nearest direction, so they don't jump when it becomes one of the three
+    std::vector<float> weights;
+    if( nearest[0].first < 1.0e-4f ){
+        weights.push_back( 1.0f );
+    }else{
+        float limit = 1.0f / ( nearest[3].first * nearest[3].first );
+        float sum = 0.0f;
+        for( int i=0; i<3; ++i ){
+            weights.push_back( 1.0f / ( nearest[i].first * nearest[i].first ) - limit );
+            sum += weights[i];
+        }
+        for( float & weight : weights ){ weight /= sum; }
+    }
+
+    left.assign( signal.size(), 0.0 );
+    right.assign( signal.size(), 0.0 );
+    for( size_t w=0; w<weights.size(); ++w ){
+        const Direction & direction = directions[ nearest[w].second ];
+        for( size_t n=0; n<signal.size(); ++n ){
+            for( int k=0; k<LENGTH && k<=(int)n; ++k ){
+                int j = (int) n - k;
+                double gain = ( j < bufferSize ) ? weights[w] * ( j + 1 ) / (double) bufferSize : weights[w];
+                left[n] += direction.left[k] * signal[j] * gain;
+                right[n] += direction.right[k] * signal[j] * gain;
+            }
+        }
+    }
+}
+
+// spatializes the signal, the azimuth is changed to NaN at half the signal if nanAt isn't zero
+void spatialize( pdsp::HRTFSet & hrtf, float azimuth, float elevation, const std::vector<float> & signal, int expectedSize, int bufferSize, int nanAt,
+                 std::vector<float> & left, std::vector<float> & right ){
+
+    pdsp::ExternalInput input;
+    pdsp::BinauralSpatializer spatializer( 2 );
+    pdsp::Processor processor;
+    processor.channels.resize( 2 );
+
+    input >> spatializer.in_signal( 0 );
+    azimuth >> spatializer.in_azimuth( 0 );
+    elevation >> spatializer.in_elevation( 0 );
+    spatializer.out_L() >> processor.channels[0];
+    spatializer.out_R() >> processor.channels[1];
+    spatializer.loadHRTF( hrtf );
+    pdsp::prepareAllToPlay( expectedSize, SAMPLE_RATE );
+
+    left.assign( signal.size(), 0.0f );
+    right.assign( signal.size(), 0.0f );
+    for( size_t n=0; n+bufferSize<=signal.size(); n+=bufferSize ){
+        if( nanAt != 0 && (int) n == nanAt ){
+            std::numeric_limits<float>::quiet_NaN() >> spatializer.in_azimuth( 0 );
+        }
+        input.copyInput( const_cast<float*>( signal.data() ) + n, bufferSize );
+        float* buffers[2] = { left.data() + n, right.data() + n };
+        processor.processAndCopyOutput( buffers, 2, bufferSize );
+    }
+
+    pdsp::releaseAll();
+}
+
+int main(){
+
+    bool passed = true;
+    const int bufferSize = 64;
+
+    std::vector<Direction> directions;
+    std::srand( 3 );
+    for( int elevation=-30; elevation<=60; elevation+=30 ){
+        for( int azimuth=0; azimuth<360; azimuth+=30 ){
+            Direction direction;
+            direction.azimuth = (float) azimuth;
+            direction.elevation = (float) elevation;
+            direction.left.resize( LENGTH );
+            direction.right.resize( LENGTH );
+            for( int k=0; k<LENGTH; ++k ){
+                float envelope = expf( -4.0f * k / LENGTH );
+                direction.left[k] = ( std::rand() / (float) RAND_MAX - 0.5f ) * envelope;
+                direction.right[k] = ( std::rand() / (float) RAND_MAX - 0.5f ) * envelope;
+            }
+            directions.push_back( direction );
+        }
+    }
+
+    // the set is loaded from a raw file, as exported from a SOFA file
+    const char* path = "check_binaural.raw";
+    FILE* file = std::fopen( path, "wb" );
+    if( file == nullptr ){
+        std::printf( "can't write %s\n", path );
+        return 1;
+    }
+    for( const Direction & direction : directions ){
+        std::fwrite( &direction.azimuth, sizeof(float), 1, file );
+        std::fwrite( &direction.elevation, sizeof(float), 1, file );
+        std::fwrite( direction.left.data(), sizeof(float), LENGTH, file );
+        std::fwrite( direction.right.data(), sizeof(float), LENGTH, file );
+    }
+    std::fclose( file );
+
+    pdsp::HRTFSet hrtf;
+    bool loaded = hrtf.loadRaw( path, LENGTH, SAMPLE_RATE );
+    std::remove( path );
+    {
+        bool ok = loaded && hrtf.size() == (int) directions.size();
+        for( int d=0; ok && d<hrtf.size(); ++d ){
+            ok = hrtf.getAzimuth( d ) == directions[d].azimuth && hrtf.getElevation( d ) == directions[d].elevation;
+        }
+        passed = passed && ok;
+        std::printf( "HRTFSet raw file: %d directions %s\n", hrtf.size(), ok ? "ok" : "FAILED" );
+        if( !ok ){
+            std::printf( "some checks FAILED\n" );
+            return 1;
+        }
+    }
+
+    // noise with some silent parts, so the spatializer also skips the silent buffers
+    std::vector<float> signal( bufferSize * 200 );
+    std::srand( 1 );
+    for( size_t n=0; n<signal.size(); ++n ){
+        bool silent = ( n / ( bufferSize * 37 ) ) % 3 == 2;
+        signal[n] = silent ? 0.0f : std::rand() / (float) RAND_MAX - 0.5f;
+    }
+
+    // on a measured direction, between directions on the same elevation, between elevations
+    const float positions[][2] = { { 60.0f, 30.0f }, { 45.0f, 0.0f }, { 100.0f, 15.0f }, { 350.0f, -20.0f } };
+
+    for( const auto & position : positions ){
+        std::vector<double> referenceL, referenceR;
+        reference( directions, position[0], position[1], signal, bufferSize, referenceL, referenceR );
+        std::vector<float> left, right;
+        spatialize( hrtf, position[0], position[1], signal, bufferSize, bufferSize, 0, left, right );
+
+        double error = 0.0;
+        double peak = 0.0;
+        for( size_t n=0; n<signal.size(); ++n ){
+            error = std::max( error, std::fabs( left[n] - referenceL[n] ) );
+            error = std::max( error, std::fabs( right[n] - referenceR[n] ) );
+            peak = std::max( peak, std::fabs( referenceL[n] ) );
+        }
+
+        bool ok = error < 1.0e-5 * peak;
+        passed = passed && ok;
+        std::printf( "BinauralSpatializer azimuth %.0f elevation %.0f: max error %.3g (peak %.3g) %s\n",
+                     position[0], position[1], error, peak, ok ? "ok" : "FAILED" );
+    }
+
+    // a slow sine that starts and stops, buffers shorter than the expected size fill the blocks without changing the output
+    // the gains still fade in during the first buffer, so the reference has a shorter ramp
+    std::vector<float> sine( bufferSize * 192 );
+    for( size_t n=0; n<sine.size(); ++n ){
+        sine[n] = sinf( n * 0.05f ) * ( ( n / ( bufferSize * 30 ) ) % 2 );
+    }
+    const int shortSizes[] = { bufferSize / 2, bufferSize * 3 / 4, 1 };
+    for( int shortSize : shortSizes ){
+        std::vector<double> referenceL, referenceR;
+        reference( directions, 30.0f, 10.0f, sine, shortSize, referenceL, referenceR );
+        std::vector<float> left, right;
+        spatialize( hrtf, 30.0f, 10.0f, sine, bufferSize, shortSize, 0, left, right );
+
+        double error = 0.0;
+        double peak = 0.0;
+        int processed = (int) sine.size() / shortSize * shortSize;
+        for( int n=0; n<processed; ++n ){
+            error = std::max( error, std::fabs( left[n] - referenceL[n] ) );
+            error = std::max( error, std::fabs( right[n] - referenceR[n] ) );
+            peak = std::max( peak, std::fabs( referenceL[n] ) );
+        }
+
+        bool ok = error < 1.0e-5 * peak;
+        passed = passed && ok;
+        std::printf( "BinauralSpatializer buffers of %d samples, expected %d: max error %.3g (peak %.3g) %s\n",
+                     shortSize, bufferSize, error, peak, ok ? "ok" : "FAILED" );
+    }
+
+    // the last valid position is kept
+    {
+        std::vector<float> left, right, nanL, nanR;
+        spatialize( hrtf, 30.0f, 10.0f, sine, bufferSize, bufferSize, 0, left, right );
+        spatialize( hrtf, 30.0f, 10.0f, sine, bufferSize, bufferSize, (int) sine.size() / 2, nanL, nanR );
+
+        double difference = 0.0;
+        bool finite = true;
+        for( size_t n=0; n<sine.size(); ++n ){
+            difference = std::max( difference, (double) std::fabs( nanL[n] - left[n] ) );
+            difference = std::max( difference, (double) std::fabs( nanR[n] - right[n] ) );
+            finite = finite && std::isfinite( nanL[n] ) && std::isfinite( nanR[n] );
+        }
+
+        bool ok = finite && difference == 0.0;
+        passed = passed && ok;
+        std::printf( "BinauralSpatializer NaN azimuth: max difference %.3g %s\n", difference, ok ? "ok" : "FAILED" );
+    }
+
+    std::printf( passed ? "all checks passed\n" : "some checks FAILED\n" );
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+// checks the background processing of the FDLConvolver tail against the same partitions processed in the audio thread
+// a second run stalls the worker thread for some buffers, the audio thread has to take the blocks the worker didn't start
+// the buffers are processed four times faster than real time, as an audio callback would do with some headroom
+// see README.md for building it
+
+#include "DSP/core/Processor.h"
+#include "DSP/core/ExternalInput.h"
+#include "DSP/convolution/FDLConvolver.h"
+#include "DSP/convolution/TailWorker.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#define SAMPLE_RATE 44100
+#define BUFFER_SIZE 256
+#define SPEEDUP 4
+
+// while stalled it keeps the worker thread busy, so the convolvers jobs wait
+class WorkerStall : public pdsp::TailProcessor {
+public:
+    WorkerStall(){ stalled = false; }
+    bool processTail() noexcept override {
+        while( stalled.load() ){
+            std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+        }
+        return false;
+    }
+    std::atomic<bool> stalled;
+};
+
+std::vector<float> convolve( const std::vector<float> & signal, std::vector<float> & impulse, bool background, int stallStart, int stallEnd, int & misses ){
+
+    pdsp::SampleBuffer impulseResponse;
+    impulseResponse.load( impulse.data(), SAMPLE_RATE, (int) impulse.size() );
+
+    pdsp::ExternalInput input;
+    pdsp::FDLConvolver convolver;
+    pdsp::Processor processor;
+    processor.channels.resize( 1 );
+    input >> convolver >> processor.channels[0];
+
+    convolver.setNonUniform( true );
+    convolver.setBackgroundTail( background );
+    convolver.loadIR( impulseResponse );
+    pdsp::prepareAllToPlay( BUFFER_SIZE, SAMPLE_RATE );
+
+    WorkerStall stall;
+    pdsp::TailWorker::getInstance().add( &stall );
+
+    std::vector<float> output( signal.size(), 0.0f );
+    auto start = std::chrono::steady_clock::now();
+    for( size_t n=0; n+BUFFER_SIZE<=signal.size(); n+=BUFFER_SIZE ){
+        stall.stalled = ( (int) n >= stallStart && (int) n < stallEnd );
+
+        input.copyInput( const_cast<float*>( signal.data() ) + n, BUFFER_SIZE );
+        float* buffers[1] = { output.data() + n };
+        processor.processAndCopyOutput( buffers, 1, BUFFER_SIZE );
+
+        if( background ){
+            long long elapsed = (long long)( n + BUFFER_SIZE ) * 1000000 / ( SAMPLE_RATE * SPEEDUP );
+            std::this_thread::sleep_until( start + std::chrono::microseconds( elapsed ) );
+        }
+    }
+    stall.stalled = false;
+
+    pdsp::TailWorker::getInstance().remove( &stall );
+    misses = convolver.meter_tail_misses();
+    pdsp::releaseAll();
+    return output;
+}
+
+int main(){
+
+    const int length = SAMPLE_RATE;
+    const int samples = SAMPLE_RATE * 4;
+
+    std::vector<float> impulse( length );
+    std::srand( 7 );
+    for( int n=0; n<length; ++n ){
+        impulse[n] = ( std::rand() / (float) RAND_MAX - 0.5f ) * expf( -3.0f * n / length );
+    }
+
+    std::vector<float> signal( samples );
+    std::srand( 3 );
+    for( int n=0; n<samples; ++n ){
+        signal[n] = std::rand() / (float) RAND_MAX - 0.5f;
+    }
+
+    int misses;
+    std::vector<float> reference = convolve( signal, impulse, false, 0, 0, misses );
+    double peak = 0.0;
+    for( float value : reference ){ peak = std::max( peak, (double) std::fabs(value) ); }
+
+    bool passed = true;
+
+    // with a prompt worker the output is the same
+    {
+        std::vector<float> output = convolve( signal, impulse, true, 0, 0, misses );
+        double error = 0.0;
+        for( int n=0; n<samples; ++n ){
+            error = std::max( error, (double) std::fabs( output[n] - reference[n] ) );
+        }
+        bool ok = ( misses == 0 ) && ( error < 1.0e-5 * peak );
+        passed = passed && ok;
+        std::printf( "background tail: max error %.3g (peak %.3g), %d misses %s\n", error, peak, misses, ok ? "ok" : "FAILED" );
+    }
+
+    // the blocks submitted to a stalled worker are processed by the audio thread when their output is needed, so the output is still the same
+    {
+        int stallStart = SAMPLE_RATE;
+        int stallEnd = SAMPLE_RATE + SAMPLE_RATE / 4;
+
+        std::vector<float> output = convolve( signal, impulse, true, stallStart, stallEnd, misses );
+        double error = 0.0;
+        for( int n=0; n<samples; ++n ){
+            error = std::max( error, (double) std::fabs( output[n] - reference[n] ) );
+        }
+        bool ok = ( misses == 0 ) && ( error < 1.0e-5 * peak );
+        passed = passed && ok;
+        std::printf( "stalled worker: max error %.3g, %d misses %s\n", error, misses, ok ? "ok" : "FAILED" );
+    }
+
+    std::printf( passed ? "all checks passed\n" : "some checks FAILED\n" );
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+// checks FDLConvolver with uniform and non-uniform partitions against the direct convolution
+// the non-uniform layout has partitions from the buffer size up to 8192 samples, so the impulse responses are long enough to use all of them
+// see README.md for building it
+
+#include "DSP/core/Processor.h"
+#include "DSP/core/ExternalInput.h"
+#include "DSP/convolution/FDLConvolver.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+// noise with an exponential decay, like a reverb
+std::vector<float> makeImpulse( int length ){
+    std::vector<float> impulse( length );
+    std::srand( 7 );
+    for( int n=0; n<length; ++n ){
+        impulse[n] = ( std::rand() / (float) RAND_MAX - 0.5f ) * expf( -3.0f * n / length );
+    }
+    return impulse;
+}
+
+// noise with some silent parts, so the convolvers also skip the silent buffers
+std::vector<float> makeSignal( int length, int bufferSize ){
+    std::vector<float> signal( length );
+    std::srand( 3 );
+    for( int n=0; n<length; ++n ){
+        bool silent = ( n / (bufferSize*37) ) % 3 == 2;
+        signal[n] = silent ? 0.0f : std::rand() / (float) RAND_MAX - 0.5f;
+    }
+    return signal;
+}
+
+std::vector<double> directConvolution( const std::vector<float> & signal, const std::vector<float> & impulse ){
+    std::vector<double> output( signal.size(), 0.0 );
+    for( size_t n=0; n<signal.size(); ++n ){
+        double sum = 0.0;
+        for( size_t k=0; k<impulse.size() && k<=n; ++k ){
+            sum += impulse[k] * (double) signal[n-k];
+        }
+        output[n] = sum;
+    }
+    return output;
+}
+
+std::vector<float> convolve( const std::vector<float> & signal, std::vector<float> & impulse, int bufferSize, bool nonUniform ){
+
+    pdsp::SampleBuffer impulseResponse;
+    impulseResponse.load( impulse.data(), 44100.0, (int) impulse.size() );
+
+    pdsp::ExternalInput input;
+    pdsp::FDLConvolver convolver;
+    pdsp::Processor processor;
+    processor.channels.resize( 1 );
+    input >> convolver >> processor.channels[0];
+
+    convolver.setNonUniform( nonUniform );
+    convolver.loadIR( impulseResponse );
+    pdsp::prepareAllToPlay( bufferSize, 44100.0 );
+
+    std::vector<float> output( signal.size(), 0.0f );
+    for( size_t n=0; n+bufferSize<=signal.size(); n+=bufferSize ){
+        input.copyInput( const_cast<float*>( signal.data() ) + n, bufferSize );
+        float* buffers[1] = { output.data() + n };
+        processor.processAndCopyOutput( buffers, 1, bufferSize );
+    }
+
+    pdsp::releaseAll();
+    return output;
+}
+
+int main(){
+
+    bool passed = true;
+
+    const int lengths[] = { 1000, 20000 };
+    // the uniform partitions need a power of two buffer, the non-uniform ones take any buffer size
+    const int bufferSizes[] = { 64, 256, 100 };
+
+    for( int length : lengths ){
+        std::vector<float> impulse = makeImpulse( length );
+        int samples = length * 2 + 8192;
+        std::vector<float> signal = makeSignal( samples, 64 );
+        std::vector<double> reference = directConvolution( signal, impulse );
+
+        double peak = 0.0;
+        for( double value : reference ){ peak = std::max( peak, std::fabs(value) ); }
+
+        for( int bufferSize : bufferSizes ){
+            for( int nonUniform=0; nonUniform<2; ++nonUniform ){
+                bool powerOfTwo = ( bufferSize & (bufferSize-1) ) == 0;
+                if( !nonUniform && !powerOfTwo ){ continue; }
+
+                std::vector<float> output = convolve( signal, impulse, bufferSize, nonUniform );
+
+                // the last partial buffer is not processed
+                int processed = (int) signal.size() / bufferSize * bufferSize;
+                double error = 0.0;
+                for( int n=0; n<processed; ++n ){
+                    error = std::max( error, std::fabs( output[n] - reference[n] ) );
+                }
+
+                bool ok = error < 1.0e-5 * peak;
+                passed = passed && ok;
+                std::printf( "FDLConvolver %s, buffer %d, impulse %d: max error %.3g (peak %.3g) %s\n",
+                             nonUniform ? "non-uniform" : "uniform", bufferSize, length, error, peak, ok ? "ok" : "FAILED" );
+            }
+        }
+    }
+
+    std::printf( passed ? "all checks passed\n" : "some checks FAILED\n" );
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+// checks FIRFilter in direct, hybrid and automatic form against the direct convolution, for buffers that are and aren't a power of two
+// the impulse response is also changed while playing, the output mustn't step more than the crossfade between the old and the new output
+// loading another impulse response during the crossfade has to swap it in when the crossfade is over
+// see README.md for building it
+
+#include "DSP/core/Processor.h"
+#include "DSP/core/ExternalInput.h"
+#include "DSP/convolution/FIRFilter.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+#define SAMPLE_RATE 44100.0
+
+std::vector<double> directConvolution( const std::vector<float> & signal, const std::vector<float> & impulse ){
+    std::vector<double> output( signal.size(), 0.0 );
+    for( size_t n=0; n<signal.size(); ++n ){
+        double sum = 0.0;
+        for( size_t k=0; k<impulse.size() && k<=n; ++k ){
+            sum += impulse[k] * (double) signal[n-k];
+        }
+        output[n] = sum;
+    }
+    return output;
+}
+
+// filters the signal, loading the second impulse response at the given sample if it's not empty, and the third one a buffer later
+std::vector<float> filter( const std::vector<float> & signal, std::vector<float> & impulse, std::vector<float> & swapped, int swapAt, int bufferSize, pdsp::FIRMode_t mode, bool & direct,
+                           std::vector<float> & later ){
+
+    pdsp::SampleBuffer impulseResponse;
+    pdsp::SampleBuffer swappedResponse;
+    pdsp::SampleBuffer laterResponse;
+    impulseResponse.load( impulse.data(), SAMPLE_RATE, (int) impulse.size() );
+    if( !swapped.empty() ){
+        swappedResponse.load( swapped.data(), SAMPLE_RATE, (int) swapped.size() );
+    }
+    if( !later.empty() ){
+        laterResponse.load( later.data(), SAMPLE_RATE, (int) later.size() );
+    }
+
+    pdsp::ExternalInput input;
+    pdsp::FIRFilter fir;
+    pdsp::Processor processor;
+    processor.channels.resize( 1 );
+    input >> fir >> processor.channels[0];
+
+    fir.setMode( mode );
+    fir.loadIR( impulseResponse );
+    pdsp::prepareAllToPlay( bufferSize, SAMPLE_RATE );
+    direct = fir.meter_direct();
+
+    std::vector<float> output( signal.size(), 0.0f );
+    for( size_t n=0; n+bufferSize<=signal.size(); n+=bufferSize ){
+        if( !swapped.empty() && (int) n == swapAt ){
+            fir.loadIR( swappedResponse );
+        }
+        if( !later.empty() && (int) n == swapAt + bufferSize ){
+            fir.loadIR( laterResponse );
+        }
+        input.copyInput( const_cast<float*>( signal.data() ) + n, bufferSize );
+        float* buffers[1] = { output.data() + n };
+        processor.processAndCopyOutput( buffers, 1, bufferSize );
+    }
+
+    pdsp::releaseAll();
+    return output;
+}
+
+int main(){
+
+    bool passed = true;
+
+    const pdsp::FIRMode_t modes[] = { pdsp::DirectFIR, pdsp::PartitionedFIR, pdsp::AutoFIR };
+    const char* modeNames[] = { "direct", "partitioned", "auto" };
+    const int lengths[] = { 40, 300, 2000 };
+    const int bufferSizes[] = { 64, 100, 256 };
+
+    for( int length : lengths ){
+        std::vector<float> impulse( length );
+        std::srand( length );
+        for( int n=0; n<length; ++n ){
+            impulse[n] = ( std::rand() / (float) RAND_MAX - 0.5f ) * expf( -3.0f * n / length );
+        }
+
+        // noise with some silent parts, so the filter also skips the silent buffers
+        std::vector<float> signal( 12800 );
+        std::srand( 1 );
+        for( size_t n=0; n<signal.size(); ++n ){
+            bool silent = ( n / 2500 ) % 3 == 2;
+            signal[n] = silent ? 0.0f : std::rand() / (float) RAND_MAX - 0.5f;
+        }
+        std::vector<double> reference = directConvolution( signal, impulse );
+        double peak = 0.0;
+        for( double value : reference ){ peak = std::max( peak, std::fabs(value) ); }
+
+        for( int bufferSize : bufferSizes ){
+            for( int m=0; m<3; ++m ){
+                std::vector<float> none;
+                bool direct;
+                std::vector<float> output = filter( signal, impulse, none, 0, bufferSize, modes[m], direct, none );
+
+                int processed = (int) signal.size() / bufferSize * bufferSize;
+                double error = 0.0;
+                for( int n=0; n<processed; ++n ){
+                    error = std::max( error, std::fabs( output[n] - reference[n] ) );
+                }
+
+                bool ok = error < 1.0e-5 * peak;
+                passed = passed && ok;
+                std::printf( "FIRFilter %s, buffer %d, impulse %d, %s form: max error %.3g (peak %.3g) %s\n",
+                             modeNames[m], bufferSize, length, direct ? "direct" : "hybrid", error, peak, ok ? "ok" : "FAILED" );
+            }
+        }
+    }
+
+    // smooth impulse responses of opposite sign and a slow sine, so the only steps are the ones of the swap
+    struct Swap { int from; int to; int bufferSize; pdsp::FIRMode_t mode; };
+    const Swap swaps[] = {
+        { 1000, 1000, 64, pdsp::PartitionedFIR },
+        { 1000, 3000, 64, pdsp::PartitionedFIR },
+        { 3000, 500, 64, pdsp::PartitionedFIR },
+        { 40, 2000, 64, pdsp::AutoFIR },
+        { 2000, 40, 64, pdsp::AutoFIR },
+        { 300, 300, 128, pdsp::DirectFIR },
+    };
+
+    for( const Swap & swap : swaps ){
+        std::vector<float> impulse( swap.from );
+        std::vector<float> swapped( swap.to );
+        for( int n=0; n<swap.from; ++n ){ impulse[n] = expf( -4.0f * n / swap.from ) * 2.0f / swap.from; }
+        for( int n=0; n<swap.to; ++n ){ swapped[n] = -expf( -4.0f * n / swap.to ) * 2.0f / swap.to; }
+
+        int samples = swap.bufferSize * 600;
+        int swapAt = swap.bufferSize * 300;
+        std::vector<float> signal( samples );
+        for( int n=0; n<samples; ++n ){ signal[n] = (float) std::sin( n * 0.01 ); }
+
+        bool direct;
+        std::vector<float> none;
+        std::vector<float> output = filter( signal, impulse, swapped, swapAt, swap.bufferSize, swap.mode, direct, none );
+        std::vector<double> before = directConvolution( signal, impulse );
+        std::vector<double> after = directConvolution( signal, swapped );
+
+        // the largest step of both outputs, and the step of crossfading their difference over a block
+        int blockSize = 16;
+        while( blockSize*2 <= swap.bufferSize && blockSize < 1024 ){ blockSize *= 2; }
+        double naturalStep = 0.0;
+        double difference = 0.0;
+        for( int n=swapAt - swap.bufferSize; n<samples; ++n ){
+            naturalStep = std::max( naturalStep, std::fabs( before[n] - before[n-1] ) );
+            naturalStep = std::max( naturalStep, std::fabs( after[n] - after[n-1] ) );
+            difference = std::max( difference, std::fabs( before[n] - after[n] ) );
+        }
+        double limit = 1.5 * ( naturalStep + difference / blockSize );
+
+        double step = 0.0;
+        for( int n=swapAt - swap.bufferSize; n<samples; ++n ){
+            step = std::max( step, (double) std::fabs( output[n] - output[n-1] ) );
+        }
+        double error = 0.0;
+        for( int n=swapAt + swap.to + 8*swap.bufferSize; n<samples; ++n ){
+            error = std::max( error, std::fabs( output[n] - after[n] ) );
+        }
+
+        bool ok = ( step < limit ) && ( error < 1.0e-5 );
+        passed = passed && ok;
+        std::printf( "FIRFilter swap from %d to %d taps, buffer %d: max step %.3g (limit %.3g), error after the swap %.3g %s\n",
+                     swap.from, swap.to, swap.bufferSize, step, limit, error, ok ? "ok" : "FAILED" );
+    }
+
+    // the second impulse response is loaded during the crossfade to the first one, the output has to settle on it
+    {
+        const int bufferSize = 64;
+        std::vector<float> impulse( 1000 );
+        std::vector<float> swapped( 3000 );
+        std::vector<float> later( 500 );
+        for( int n=0; n<1000; ++n ){ impulse[n] = expf( -4.0f * n / 1000 ) * 2.0f / 1000; }
+        for( int n=0; n<3000; ++n ){ swapped[n] = -expf( -4.0f * n / 3000 ) * 2.0f / 3000; }
+        for( int n=0; n<500; ++n ){ later[n] = expf( -4.0f * n / 500 ) * 1.0f / 500; }
+
+        int samples = bufferSize * 700;
+        int swapAt = bufferSize * 200;
+        std::vector<float> signal( samples );
+        for( int n=0; n<samples; ++n ){ signal[n] = (float) std::sin( n * 0.01 ); }
+
+        bool direct;
+        std::vector<float> output = filter( signal, impulse, swapped, swapAt, bufferSize, pdsp::PartitionedFIR, direct, later );
+        std::vector<double> after = directConvolution( signal, later );
+
+        // the first crossfade lasts less than the longest impulse response and a few blocks
+        double error = 0.0;
+        for( int n=swapAt + 3000 + 500 + 8*bufferSize; n<samples; ++n ){
+            error = std::max( error, std::fabs( output[n] - after[n] ) );
+        }
+
+        bool ok = error < 1.0e-5;
+        passed = passed && ok;
+        std::printf( "FIRFilter two swaps a buffer apart, buffer %d: error after the swaps %.3g %s\n", bufferSize, error, ok ? "ok" : "FAILED" );
+    }
+
+    std::printf( passed ? "all checks passed\n" : "some checks FAILED\n" );
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+// checks MultiConvolver against the direct convolution, with two inputs, two outputs and an input-output pair without impulse response
+// the impulse responses are also changed while playing, after the crossfade the output has to be the one of the new ones
+// see README.md for building it
+
+#include "DSP/core/Processor.h"
+#include "DSP/core/ExternalInput.h"
+#include "DSP/convolution/MultiConvolver.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+#define SAMPLE_RATE 44100
+
+std::vector<float> makeImpulse( int length, int seed ){
+    std::vector<float> impulse( length );
+    std::srand( seed );
+    for( int n=0; n<length; ++n ){
+        impulse[n] = ( std::rand() / (float) RAND_MAX - 0.5f ) * expf( -3.0f * n / length );
+    }
+    return impulse;
+}
+
+void addConvolution( std::vector<double> & output, const std::vector<float> & signal, const std::vector<float> & impulse ){
+    for( size_t n=0; n<signal.size(); ++n ){
+        double sum = 0.0;
+        for( size_t k=0; k<impulse.size() && k<=n; ++k ){
+            sum += impulse[k] * (double) signal[n-k];
+        }
+        output[n] += sum;
+    }
+}
+
+int main(){
+
+    const int length = 3000;
+    const int samples = 24576;
+    const int swapAt = samples / 2;
+    const int bufferSizes[] = { 64, 128 };
+
+    // impulse[input][output], the pair 1-0 has no impulse response
+    std::vector<float> impulses[2][2];
+    std::vector<float> swapped[2][2];
+    impulses[0][0] = makeImpulse( length, 1 );
+    impulses[0][1] = makeImpulse( length, 2 );
+    impulses[1][1] = makeImpulse( length / 2, 3 );
+    swapped[0][0] = makeImpulse( length / 3, 4 );
+    swapped[0][1] = makeImpulse( length, 5 );
+    swapped[1][1] = makeImpulse( length * 2, 6 );
+
+    std::vector<float> signals[2];
+    for( int i=0; i<2; ++i ){
+        signals[i].resize( samples );
+        std::srand( 10 + i );
+        for( int n=0; n<samples; ++n ){
+            signals[i][n] = std::rand() / (float) RAND_MAX - 0.5f;
+        }
+    }
+
+    // the outputs of both sets of impulse responses for the whole signal
+    std::vector<double> references[2][2];
+    double peak = 0.0;
+    for( int set=0; set<2; ++set ){
+        for( int o=0; o<2; ++o ){
+            references[set][o].assign( samples, 0.0 );
+            for( int i=0; i<2; ++i ){
+                const std::vector<float> & impulse = ( set == 0 ) ? impulses[i][o] : swapped[i][o];
+                if( !impulse.empty() ){
+                    addConvolution( references[set][o], signals[i], impulse );
+                }
+            }
+            for( double value : references[set][o] ){ peak = std::max( peak, std::fabs(value) ); }
+        }
+    }
+
+    bool passed = true;
+
+    for( int bufferSize : bufferSizes ){
+        for( int nonUniform=0; nonUniform<2; ++nonUniform ){
+
+            pdsp::SampleBuffer buffers[2][2];
+            pdsp::SampleBuffer swappedBuffers[2][2];
+            for( int i=0; i<2; ++i ){
+                for( int o=0; o<2; ++o ){
+                    if( !impulses[i][o].empty() ){ buffers[i][o].load( impulses[i][o].data(), SAMPLE_RATE, (int) impulses[i][o].size() ); }
+                    if( !swapped[i][o].empty() ){ swappedBuffers[i][o].load( swapped[i][o].data(), SAMPLE_RATE, (int) swapped[i][o].size() ); }
+                }
+            }
+
+            pdsp::ExternalInput inputs[2];
+            pdsp::MultiConvolver convolver;
+            pdsp::Processor processor;
+            processor.channels.resize( 2 );
+
+            convolver.resize( 2, 2 );
+            convolver.setNonUniform( nonUniform );
+            inputs[0] >> convolver.in_channel( 0 );
+            inputs[1] >> convolver.in_channel( 1 );
+            convolver.out_channel( 0 ) >> processor.channels[0];
+            convolver.out_channel( 1 ) >> processor.channels[1];
+            for( int i=0; i<2; ++i ){
+                for( int o=0; o<2; ++o ){
+                    if( !impulses[i][o].empty() ){ convolver.setIR( i, o, buffers[i][o] ); }
+                }
+            }
+            convolver.prepareIR();
+            pdsp::prepareAllToPlay( bufferSize, SAMPLE_RATE );
+
+            std::vector<float> outputs[2];
+            outputs[0].assign( samples, 0.0f );
+            outputs[1].assign( samples, 0.0f );
+            for( int n=0; n+bufferSize<=samples; n+=bufferSize ){
+                if( n == swapAt ){
+                    for( int i=0; i<2; ++i ){
+                        for( int o=0; o<2; ++o ){
+                            if( !swapped[i][o].empty() ){ convolver.setIR( i, o, swappedBuffers[i][o] ); }
+                        }
+                    }
+                    convolver.prepareIR();
+                }
+                inputs[0].copyInput( signals[0].data() + n, bufferSize );
+                inputs[1].copyInput( signals[1].data() + n, bufferSize );
+                float* channels[2] = { outputs[0].data() + n, outputs[1].data() + n };
+                processor.processAndCopyOutput( channels, 2, bufferSize );
+            }
+
+            pdsp::releaseAll();
+
+            // the swap is at the start of the next buffer, the new impulse responses start from empty delay lines
+            // so they match the reference after the longest of them, that is also longer than the 50 ms crossfade
+            int settled = swapAt + bufferSize + length * 2;
+            double before = 0.0;
+            double after = 0.0;
+            for( int o=0; o<2; ++o ){
+                for( int n=0; n<samples; ++n ){
+                    if( n < swapAt ){
+                        before = std::max( before, std::fabs( outputs[o][n] - references[0][o][n] ) );
+                    }else if( n >= settled ){
+                        after = std::max( after, std::fabs( outputs[o][n] - references[1][o][n] ) );
+                    }
+                }
+            }
+
+            bool ok = ( before < 1.0e-5 * peak ) && ( after < 1.0e-5 * peak );
+            passed = passed && ok;
+            std::printf( "MultiConvolver %s, buffer %d: max error %.3g, after the swap %.3g (peak %.3g) %s\n",
+                         nonUniform ? "non-uniform" : "uniform", bufferSize, before, after, peak, ok ? "ok" : "FAILED" );
+        }
+    }
+
+    std::printf( passed ? "all checks passed\n" : "some checks FAILED\n" );
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+// checks the FFTWorker backends against a direct DFT for all the power of two sizes from 16 to 8192
+// both backends have to give the same split complex format and scaling, the batch transforms have to give the same results of the single ones
+// see README.md for building it
+
+#include "DSP/helpers/FFTWorker.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+#define SIGNALS 5
+#define BATCH 4
+
+// forward transform without scaling, the inverse one is scaled by 1/size
+void directDFT( const std::vector<float> & signal, std::vector<double> & re, std::vector<double> & im ){
+    int size = (int) signal.size();
+    int complexSize = size/2 + 1;
+    re.assign( complexSize, 0.0 );
+    im.assign( complexSize, 0.0 );
+    for( int k=0; k<complexSize; ++k ){
+        for( int n=0; n<size; ++n ){
+            // the index product is reduced modulo the size, so the angle keeps its precision
+            double angle = M_TAU_DOUBLE * (double) ( ( (long long) k * n ) % size ) / size;
+            re[k] += signal[n] * std::cos( angle );
+            im[k] -= signal[n] * std::sin( angle );
+        }
+    }
+}
+
+int main(){
+
+    bool passed = true;
+
+    const pdsp::FFTBackend_t backends[] = { pdsp::AudioFFTBackend, pdsp::SimdFFTBackend };
+    const char* names[] = { "AudioFFT", "SimdFFT" };
+
+    for( int size=16; size<=8192; size*=2 ){
+
+        int complexSize = size/2 + 1;
+
+        std::vector<float> signals[SIGNALS];
+        std::vector<double> referenceR[SIGNALS];
+        std::vector<double> referenceI[SIGNALS];
+        double peak = 0.0;
+        std::srand( size );
+        for( int s=0; s<SIGNALS; ++s ){
+            signals[s].resize( size );
+            for( int n=0; n<size; ++n ){
+                signals[s][n] = std::rand() / (float) RAND_MAX - 0.5f;
+            }
+            directDFT( signals[s], referenceR[s], referenceI[s] );
+            for( int k=0; k<complexSize; ++k ){
+                peak = std::max( peak, std::hypot( referenceR[s][k], referenceI[s][k] ) );
+            }
+        }
+
+        for( int b=0; b<2; ++b ){
+            pdsp::FFTWorker single;
+            pdsp::FFTWorker batch;
+            single.setBackend( backends[b] );
+            batch.setBackend( backends[b] );
+            // initFFT takes the buffer size, the fft size is the next power of two
+            single.initFFT( size-1 );
+            batch.initFFT( size-1, BATCH );
+
+            bool formatOk = single.getFFTBlockSize() == size && single.getFFTComplexSize() == complexSize;
+
+            std::vector<float> re[SIGNALS];
+            std::vector<float> im[SIGNALS];
+            std::vector<float> batchRe[SIGNALS];
+            std::vector<float> batchIm[SIGNALS];
+            std::vector<float> inverse[SIGNALS];
+            std::vector<float> batchInverse[SIGNALS];
+            const float* inputs[SIGNALS];
+            float* batchReals[SIGNALS];
+            float* batchImags[SIGNALS];
+            float* batchOutputs[SIGNALS];
+            for( int s=0; s<SIGNALS; ++s ){
+                re[s].resize( complexSize );
+                im[s].resize( complexSize );
+                batchRe[s].resize( complexSize );
+                batchIm[s].resize( complexSize );
+                inverse[s].resize( size );
+                batchInverse[s].resize( size );
+                inputs[s] = signals[s].data();
+                batchReals[s] = batchRe[s].data();
+                batchImags[s] = batchIm[s].data();
+                batchOutputs[s] = batchInverse[s].data();
+            }
+
+            // more signals than the batch size, so there is also a partial batch
+            for( int s=0; s<SIGNALS; ++s ){
+                single.FFT( signals[s].data(), re[s].data(), im[s].data() );
+                single.iFFT( inverse[s].data(), re[s].data(), im[s].data() );
+            }
+            batch.FFT( inputs, batchReals, batchImags, SIGNALS );
+            batch.iFFT( batchOutputs, batchReals, batchImags, SIGNALS );
+
+            double forwardError = 0.0;
+            double inverseError = 0.0;
+            double batchError = 0.0;
+            for( int s=0; s<SIGNALS; ++s ){
+                for( int k=0; k<complexSize; ++k ){
+                    forwardError = std::max( forwardError, std::hypot( re[s][k] - referenceR[s][k], im[s][k] - referenceI[s][k] ) );
+                    batchError = std::max( batchError, (double) std::hypot( batchRe[s][k] - re[s][k], batchIm[s][k] - im[s][k] ) );
+                }
+                for( int n=0; n<size; ++n ){
+                    inverseError = std::max( inverseError, (double) std::fabs( inverse[s][n] - signals[s][n] ) );
+                    batchError = std::max( batchError, (double) std::fabs( batchInverse[s][n] - inverse[s][n] ) );
+                }
+            }
+
+            bool ok = formatOk && ( forwardError < 1.0e-5 * peak ) && ( inverseError < 1.0e-5 ) && ( batchError < 1.0e-5 * peak );
+            passed = passed && ok;
+            std::printf( "%s size %d: forward error %.3g (peak %.3g), inverse error %.3g, batch difference %.3g %s\n",
+                         names[b], size, forwardError, peak, inverseError, batchError, ok ? "ok" : "FAILED" );
+        }
+    }
+
+    std::printf( passed ? "all checks passed\n" : "some checks FAILED\n" );
+    return passed ? 0 : 1;
+}
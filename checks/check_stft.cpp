@@ -0,0 +1,132 @@
+// checks the STFT resynthesis and analysis
+// a subclass that scales the spectrum has to output the scaled input delayed by getLatency(), for different frames, hops, windows, zero padding and buffer sizes
+// a sine at the frequency of a bin has to peak at that bin of the analyzed spectra
+// see README.md for building it
+
+#include "DSP/core/Processor.h"
+#include "DSP/core/ExternalInput.h"
+#include "DSP/spectral/STFT.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+#define SAMPLE_RATE 44100.0
+
+// scales the spectrum, and keeps the bin with the greatest magnitude of the last frame
+class ScaledSTFT : public pdsp::STFT {
+public:
+    ScaledSTFT( float gain ){ this->gain = gain; frames = 0; peakBin = -1; }
+
+    float gain;
+    int frames;
+    int peakBin;
+
+protected:
+    void processFrame( float* re, float* im, int complexSize ) noexcept override {
+        float peak = -1.0f;
+        for( int k=0; k<complexSize; ++k ){
+            float magnitude = re[k]*re[k] + im[k]*im[k];
+            if( magnitude > peak ){ peak = magnitude; peakBin = k; }
+            re[k] *= gain;
+            im[k] *= gain;
+        }
+        frames++;
+    }
+};
+
+struct Setup {
+    int frameSize;
+    int hopSize;
+    pdsp::Window_t window;
+    int zeroPadding;
+    int bufferSize;
+    const char* name;
+};
+
+std::vector<float> run( ScaledSTFT & stft, const Setup & setup, const std::vector<float> & signal ){
+
+    pdsp::ExternalInput input;
+    pdsp::Processor processor;
+    processor.channels.resize( 1 );
+    input >> stft >> processor.channels[0];
+
+    stft.setup( setup.frameSize, setup.hopSize, setup.window, setup.zeroPadding );
+    pdsp::prepareAllToPlay( setup.bufferSize, SAMPLE_RATE );
+
+    std::vector<float> output( signal.size(), 0.0f );
+    for( size_t n=0; n+setup.bufferSize<=signal.size(); n+=setup.bufferSize ){
+        input.copyInput( const_cast<float*>( signal.data() ) + n, setup.bufferSize );
+        float* buffers[1] = { output.data() + n };
+        processor.processAndCopyOutput( buffers, 1, setup.bufferSize );
+    }
+
+    pdsp::releaseAll();
+    return output;
+}
+
+int main(){
+
+    bool passed = true;
+
+    // the hop is shorter and longer than the buffer, the Hann window with a hop as long as the frame would have zeros at the frame ends
+    const Setup setups[] = {
+        { 1024, 256, pdsp::Hann,        1, 512,  "hann 1024/256"            },
+        { 1024, 256, pdsp::Hann,        1, 64,   "hann 1024/256"            },
+        { 512,  128, pdsp::Hann,        2, 256,  "hann 512/128 padded x2"   },
+        { 600,  200, pdsp::Hamming,     1, 128,  "hamming 600/200"          },
+        { 256,  256, pdsp::Rectangular, 1, 64,   "rectangular 256/256"      },
+        { 256,  64,  pdsp::Blackman,    4, 32,   "blackman 256/64 padded x4" },
+    };
+
+    for( const Setup & setup : setups ){
+        const int samples = setup.frameSize * 40;
+
+        std::vector<float> signal( samples );
+        std::srand( 1 );
+        for( int n=0; n<samples; ++n ){
+            signal[n] = std::rand() / (float) RAND_MAX - 0.5f;
+        }
+
+        ScaledSTFT stft( 0.5f );
+        std::vector<float> output = run( stft, setup, signal );
+
+        // after the latency all the samples are covered by the overlapping windows
+        int latency = stft.getLatency();
+        int processed = samples / setup.bufferSize * setup.bufferSize;
+        double error = 0.0;
+        for( int n=latency + setup.frameSize; n<processed; ++n ){
+            error = std::max( error, (double) std::fabs( output[n] - 0.5f * signal[n-latency] ) );
+        }
+        int expectedFrames = ( processed - setup.frameSize ) / setup.hopSize;
+
+        bool ok = ( error < 1.0e-5 ) && ( stft.frames >= expectedFrames );
+        passed = passed && ok;
+        std::printf( "STFT %s, buffer %d: latency %d, %d frames, max reconstruction error %.3g %s\n",
+                     setup.name, setup.bufferSize, latency, stft.frames, error, ok ? "ok" : "FAILED" );
+    }
+
+    // the bin k has a frequency of k * sampleRate / fftSize
+    for( int zeroPadding=1; zeroPadding<=4; zeroPadding*=2 ){
+        Setup setup = { 1024, 256, pdsp::Hann, zeroPadding, 256, "sine" };
+        ScaledSTFT stft( 1.0f );
+        // the frame size is a power of two, so it's the fft size without zero padding
+        int fftSize = setup.frameSize * zeroPadding;
+        int bin = 37 * zeroPadding;
+        double frequency = bin * SAMPLE_RATE / fftSize;
+
+        std::vector<float> signal( setup.frameSize * 8 );
+        for( size_t n=0; n<signal.size(); ++n ){
+            signal[n] = (float) std::sin( M_TAU_DOUBLE * frequency * n / SAMPLE_RATE );
+        }
+        run( stft, setup, signal );
+
+        bool ok = ( stft.getFFTSize() == fftSize ) && ( stft.peakBin == bin );
+        passed = passed && ok;
+        std::printf( "STFT analysis, zero padding x%d: sine at %.1f Hz peaks at bin %d, expected %d %s\n",
+                     zeroPadding, frequency, stft.peakBin, bin, ok ? "ok" : "FAILED" );
+    }
+
+    std::printf( passed ? "all checks passed\n" : "some checks FAILED\n" );
+    return passed ? 0 : 1;
+}
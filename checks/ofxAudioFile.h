@@ -0,0 +1,23 @@
+// ofxAudioFile.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_CHECKS_OFXAUDIOFILE_H_INCLUDED
+#define PDSP_CHECKS_OFXAUDIOFILE_H_INCLUDED
+
+#include <string>
+
+// stands in for the ofxAudioFile addon when building the checks, they never load audio files
+class ofxAudioFile {
+public:
+    void load( std::string path ){}
+    bool loaded() const { return false; }
+    double samplerate() const { return 44100.0; }
+    int length() const { return 0; }
+    int channels() const { return 0; }
+    float* data() { return nullptr; }
+    void setVerbose( bool verbose ){}
+    void free(){}
+};
+
+#endif  // PDSP_CHECKS_OFXAUDIOFILE_H_INCLUDED
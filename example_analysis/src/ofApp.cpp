@@ -5,6 +5,7 @@
 
 // you can use filters, detectors and envelope followers to divide the signal in frequencies and meter them
 // most of the work is done inside AudioAnalyzerBand.cpp
+// pdsp::SpectralAnalyzer does the same for many bands at once with an FFT, and also measures some spectral features
 
 //--------------------------------------------------------------
 void ofApp::setup(){
@@ -16,6 +17,9 @@ void ofApp::setup(){
     
     // decomment for a longer scope time window
     //scope.set(512*16); 
+
+    // the spectral analyzer has 16 bands from 40hz to 16000hz by default
+    engine.audio_in(0) >> spectrum >> engine.blackhole();
     
     // setting up analyzer
     gui.setup("", "analyzer.xml", 20, 20);
@@ -46,7 +50,8 @@ void ofApp::setup(){
 
 //--------------------------------------------------------------
 void ofApp::update(){
-
+    // gets all the values of the last analyzed frame together
+    spectrum.meter_snapshot( snapshot );
 }
 
 //--------------------------------------------------------------
@@ -88,6 +93,22 @@ void ofApp::draw(){
     ofDrawBitmapString( "input scope", 0, 35 );
     scope.draw( 0, 50, 220, 100);
 
+    // draws the spectral analyzer bands and features
+    ofDrawBitmapString( "spectrum", 0, 185 );
+    int bandsNum = snapshot.bands.size();
+    for( int i=0; i<bandsNum; ++i ){
+        float h = 100.0f * snapshot.bands[i];
+        h = (h > 100.0f) ? 100.0f : h;
+        ofDrawRectangle( i*220/bandsNum, 300 - h, 220/bandsNum - 2, h );
+    }
+    ofDrawBitmapString( "centroid " + ofToString( snapshot.centroid, 0 ) + " hz", 0, 325 );
+    ofDrawBitmapString( "rolloff  " + ofToString( snapshot.rolloff, 0 ) + " hz", 0, 345 );
+    ofDrawBitmapString( "flux     " + ofToString( snapshot.flux, 3 ), 0, 365 );
+    int onsetWhite = 255 * snapshot.onset;
+    onsetWhite = (onsetWhite > 255) ? 255 : onsetWhite;
+    ofSetColor( onsetWhite );
+    ofDrawRectangle( 0, 380, 220, 20 );
+
 }
 
 
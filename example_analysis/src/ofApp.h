@@ -32,5 +32,8 @@ class ofApp : public ofBaseApp{
         ofxPanel                    gui;
 
         pdsp::Scope                 scope;
+
+        pdsp::SpectralAnalyzer              spectrum;
+        pdsp::SpectralAnalyzer::Snapshot    snapshot;
         
 };
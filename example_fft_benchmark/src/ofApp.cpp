@@ -0,0 +1,128 @@
+#include "ofApp.h"
+
+// compares the FFT backends of pdsp::FFTWorker
+// each measure is a forward and an inverse transform of 8 signals, one at a time or as a batch
+// the results depend on the AudioFFT flags in ofxPDSP/src/flags.h, without flags AudioFFT uses Ooura
+// it also calibrates the crossovers between the direct and the FFT convolution of pdsp::FIRFilter
+
+#define BATCH 8
+
+//--------------------------------------------------------------
+void ofApp::setup(){
+
+    //-------------------GRAPHIC SETUP--------------
+    ofBackground(0);
+    ofSetFrameRate(30);
+
+    runBenchmark();
+}
+
+//--------------------------------------------------------------
+void ofApp::runBenchmark(){
+
+    results = "microseconds for a forward and inverse FFT, average of 8 signals\n\n";
+    results += "size      AudioFFT    SimdFFT    SimdFFT batch\n";
+
+    float maxError = 0.0f;
+
+    for( int size=64; size<=16384; size*=2 ){
+
+        pdsp::FFTWorker audioFFT;
+        pdsp::FFTWorker simdFFT;
+        pdsp::FFTWorker simdBatch;
+        audioFFT.setBackend( pdsp::AudioFFTBackend );
+        simdFFT.setBackend( pdsp::SimdFFTBackend );
+        simdBatch.setBackend( pdsp::SimdFFTBackend );
+
+        // initFFT takes the buffer size, the fft size is the next power of two
+        audioFFT.initFFT( size-1 );
+        simdFFT.initFFT( size-1 );
+        simdBatch.initFFT( size-1, BATCH );
+
+        double tAudio = measure( audioFFT, size, false );
+        double tSimd = measure( simdFFT, size, false );
+        double tBatch = measure( simdBatch, size, true );
+
+        results += ofToString(size) + "\t  " + ofToString(tAudio, 2) + "\t     " + ofToString(tSimd, 2) + "\t   " + ofToString(tBatch, 2) + "\n";
+
+        // the two backends have the same output format
+        int complexSize = audioFFT.getFFTComplexSize();
+        std::vector<float> signal( size );
+        std::vector<float> re1( complexSize ), im1( complexSize ), re2( complexSize ), im2( complexSize );
+        for( float & x : signal ){ x = ofRandom( -1.0f, 1.0f ); }
+        audioFFT.FFT( signal.data(), re1.data(), im1.data() );
+        simdFFT.FFT( signal.data(), re2.data(), im2.data() );
+        for( int k=0; k<complexSize; ++k ){
+            maxError = std::max( maxError, std::abs( re1[k]-re2[k] ) + std::abs( im1[k]-im2[k] ) );
+        }
+    }
+
+    results += "\nmax difference between the backends spectra: " + ofToString( maxError ) + "\n";
+
+    // pdsp::FIRFilter uses the direct form up to a number of taps that depends on the block size
+    pdsp::FIRFilter::calibrate();
+    results += "\nFIRFilter crossovers, taps for the direct form\n";
+    for( int blockSize=16; blockSize<=1024; blockSize*=2 ){
+        results += "block " + ofToString(blockSize) + "\t  " + ofToString( pdsp::FIRFilter::getCrossover(blockSize) ) + "\n";
+    }
+    results += "\npress any key to run again";
+
+    std::cout<<results<<"\n";
+}
+
+//--------------------------------------------------------------
+double ofApp::measure( pdsp::FFTWorker & worker, int size, bool batch ){
+
+    int complexSize = worker.getFFTComplexSize();
+
+    float* signals[BATCH];
+    float* re[BATCH];
+    float* im[BATCH];
+    for( int i=0; i<BATCH; ++i ){
+        ofx_allocate_aligned( signals[i], size );
+        ofx_allocate_aligned( re[i], complexSize );
+        ofx_allocate_aligned( im[i], complexSize );
+        for( int n=0; n<size; ++n ){ signals[i][n] = ofRandom( -1.0f, 1.0f ); }
+    }
+
+    int iterations = 2000000 / size + 10;
+
+    uint64_t start = ofGetElapsedTimeMicros();
+    for( int it=0; it<iterations; ++it ){
+        if( batch ){
+            worker.FFT( signals, re, im, BATCH );
+            worker.iFFT( signals, re, im, BATCH );
+        }else{
+            for( int i=0; i<BATCH; ++i ){
+                worker.FFT( signals[i], re[i], im[i] );
+                worker.iFFT( signals[i], re[i], im[i] );
+            }
+        }
+    }
+    uint64_t elapsed = ofGetElapsedTimeMicros() - start;
+
+    for( int i=0; i<BATCH; ++i ){
+        ofx_deallocate_aligned( signals[i] );
+        ofx_deallocate_aligned( re[i] );
+        ofx_deallocate_aligned( im[i] );
+    }
+
+    return double( elapsed ) / double( iterations * BATCH );
+}
+
+//--------------------------------------------------------------
+void ofApp::update(){
+
+}
+
+//--------------------------------------------------------------
+void ofApp::draw(){
+    ofSetColor( 255 );
+    ofDrawBitmapString( results, 20, 30 );
+}
+
+//--------------------------------------------------------------
+void ofApp::keyPressed(int key){
+    results = "running...";
+    runBenchmark();
+}
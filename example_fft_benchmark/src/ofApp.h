@@ -0,0 +1,19 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxPDSP.h"
+
+class ofApp : public ofBaseApp{
+
+	public:
+		void setup();
+		void update();
+		void draw();
+
+		void keyPressed(int key);
+
+        void runBenchmark();
+        double measure( pdsp::FFTWorker & worker, int size, bool batch );
+
+        std::string results;
+};
@@ -35,7 +35,7 @@ void ofApp::setup(){
 
         // controls a bit the cutoff using the modulation wheel
         // adds up to 36 semitones to the filter cutoff pitch
-        midiCCs.out(1) * 36.0f >> synth.voices[i].in("cutoff");
+        midiCCs.out_cc(1) * 36.0f >> synth.voices[i].in("cutoff");
 
         // connect each voice to chorus
         synth.voices[i] >> chorus.in_L();
@@ -117,7 +117,7 @@ void ofApp::draw(){
     
     xBase+=20;
     ofDrawBitmapString("MW", xBase, 26);
-    drawMeter( midiCCs.out(1).meter_output(), 0.05f, 1.0f, xBase, 30, 20, 200);
+    drawMeter( midiCCs.meter_cc(1), 0.05f, 1.0f, xBase, 30, 20, 200);
     // draw GUI
     gui.draw();
 }
@@ -67,27 +67,32 @@ void pdsp::SequencerGateOutput::process (int bufferSize) noexcept {
                 float* trigBuffer = getOutputBufferToFill( output_trig );
                 ofx_Aeq_Zero(trigBuffer, bufferSize); //clean buffer
                 
+                const int oversample = getOversampleLevel();
+                bool triggered = false;
                 int imax = messageBuffer->size();
                 for( int i=0; i<imax; ++i){
                         ControlMessage &msg = messageBuffer->messages[i];
                         
                         if(msg.value <=0.0f){
-                                trigBuffer[ msg.sample  * getOversampleLevel() ] = pdspTriggerOff;
+                                trigBuffer[ msg.sample * oversample ] = pdspTriggerOff;
                                 gateState = false;
                         }else{
                                 if(!singleTrigger || (singleTrigger && !gateState) ){
                                         //normal trigger or first trigger with legato
-                                        trigBuffer[ msg.sample  * getOversampleLevel() ] =  msg.value;
-                                        meter_ticks = 0;
-                                        
+                                        trigBuffer[ msg.sample * oversample ] =  msg.value;
+                                        triggered = true;
                                 }else{
                                         //legato triggers
-                                        trigBuffer[ msg.sample  * getOversampleLevel() ] = - msg.value;
+                                        trigBuffer[ msg.sample * oversample ] = - msg.value;
                                 }
                                 gateState = true;   
-                                meter_value = msg.value;
+                                meter_value.store( msg.value, std::memory_order_relaxed );
                         }
                 }
+                
+                if( triggered ){
+                        meter_ticks = 0;
+                }
         }
                 
         //}else{
@@ -96,26 +96,32 @@ void pdsp::SequencerValueOutput::process (int bufferSize) noexcept {
                         setControlRateOutput(output, slewLastValue);
                 }
                 
+        } else if( !slewRun && !firstMessage && !valueChanges() ){
+                
+                setControlRateOutput(output, slewLastValue); // repeated values
+                
         } else {
 
                 float* outputBuffer = getOutputBufferToFill(output);
                 
+                const int oversample = getOversampleLevel();
                 int n=0;
                 int k=0;
                 int imax = messageBuffer->size();
                 for( int i=0; i<imax; ++i){
                         ControlMessage &msg = messageBuffer->messages[i];
 
-                        if(firstMessage){
+                        if(firstMessage){
                             slewRun = false;
                             slewLastValue = msg.value;
-                            firstMessage = false;
+                            firstMessage = false;
                         }
 
+                        int stop = msg.sample * oversample;
                         if(slewRun){
-                                 runSlewBlock(outputBuffer, n, msg.sample * getOversampleLevel());
+                                 runSlewBlock(outputBuffer, n, stop);
                         }else{
-                                 ofx_Aeq_S_range(outputBuffer, slewLastValue, n, msg.sample * getOversampleLevel());
+                                 ofx_Aeq_S_range(outputBuffer, slewLastValue, n, stop);
                         }
                         
                         if( slewControl != nullptr && 
@@ -128,7 +134,7 @@ void pdsp::SequencerValueOutput::process (int bufferSize) noexcept {
                         
                         valueChange(msg.value);
                         
-                        n = msg.sample * getOversampleLevel();
+                        n = stop;
                         
                 }
 
@@ -149,6 +155,14 @@ void pdsp::SequencerValueOutput::process (int bufferSize) noexcept {
 
 }
 
-void pdsp::SequencerValueOutput::resetSmoothing(){
-    firstMessage = true;
+bool pdsp::SequencerValueOutput::valueChanges() noexcept {
+        int imax = messageBuffer->size();
+        for( int i=0; i<imax; ++i){
+                if( messageBuffer->messages[i].value != slewLastValue ){ return true; }
+        }
+        return false;
+}
+
+void pdsp::SequencerValueOutput::resetSmoothing(){
+    firstMessage = true;
 }
@@ -80,6 +80,7 @@ private:
         void releaseResources () override;
         void process (int bufferSize) noexcept override;
         void resetMessageBufferSelector() override;
+        bool valueChanges() noexcept;
         
         OutputNode output;
         
@@ -0,0 +1,605 @@
+
+#include "BinauralSpatializer.h"
+#include "PartitionLayout.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+// the position of a new source is always different, so its directions are found in the first buffer
+#define PDSP_BINAURAL_NO_POSITION 1.0e9f
+
+#define PDSP_BINAURAL_DEG_TO_RAD static_cast<float>( M_PI_DOUBLE / 180.0 )
+
+pdsp::BinauralSpatializer::BinauralSpatializer() : BinauralSpatializer(16) {}
+
+pdsp::BinauralSpatializer::BinauralSpatializer( int sources ) : banks( deleteBank ){
+
+        if(sources < 1){ sources = 1; }
+        this->sources = sources;
+
+        // the tags are stored before adding the inputs, addInput() keeps the pointers
+        tags.resize(sources*3);
+        inputSignals.resize(sources);
+        inputAzimuths.resize(sources);
+        inputElevations.resize(sources);
+        for(int i=0; i<sources; ++i){
+                tags[i]             = "signal" + std::to_string(i);
+                tags[sources+i]     = "azimuth" + std::to_string(i);
+                tags[sources*2+i]   = "elevation" + std::to_string(i);
+        }
+        for(int i=0; i<sources; ++i){
+                addInput( tags[i].c_str(), inputSignals[i] );
+        }
+        signals.resize(sources);
+        signalStates.resize(sources);
+        azimuths.resize(sources);
+        elevations.resize(sources);
+        for(int i=0; i<sources; ++i){
+                addInput( tags[sources+i].c_str(), inputAzimuths[i] );
+                addInput( tags[sources*2+i].c_str(), inputElevations[i] );
+        }
+        addOutput("0", outputL);
+        addOutput("1", outputR);
+        updateOutputNodes();
+
+        hrtf = nullptr;
+        sampleRate = 44100.0;
+        blockSize = 0;
+        fftSize = 0;
+        complexSize = 0;
+
+        for(int e=0; e<2; ++e){
+                accR[e] = nullptr;
+                accI[e] = nullptr;
+                results[e] = nullptr;
+                overlap[e] = nullptr;
+        }
+        constantBuffer = nullptr;
+        filled = 0;
+        overlapSilent = true;
+
+        meterDirections = 0;
+
+        if(dynamicConstruction){
+                prepareUnit(globalBufferSize, globalSampleRate);
+        }
+}
+
+pdsp::BinauralSpatializer::~BinauralSpatializer(){
+        deallocateBanks();
+        deallocateBuffers();
+}
+
+pdsp::Patchable& pdsp::BinauralSpatializer::in_signal( int source ){
+    if(source < 0){ source = 0; }
+    if(source >= sources){ source = sources-1; }
+    return in( tags[source].c_str() );
+}
+
+pdsp::Patchable& pdsp::BinauralSpatializer::in_azimuth( int source ){
+    if(source < 0){ source = 0; }
+    if(source >= sources){ source = sources-1; }
+    return in( tags[sources+source].c_str() );
+}
+
+pdsp::Patchable& pdsp::BinauralSpatializer::in_elevation( int source ){
+    if(source < 0){ source = 0; }
+    if(source >= sources){ source = sources-1; }
+    return in( tags[sources*2+source].c_str() );
+}
+
+pdsp::Patchable& pdsp::BinauralSpatializer::out_0(){
+    return out("0");
+}
+
+pdsp::Patchable& pdsp::BinauralSpatializer::out_1(){
+    return out("1");
+}
+
+pdsp::Patchable& pdsp::BinauralSpatializer::out_L(){
+    return out("0");
+}
+
+pdsp::Patchable& pdsp::BinauralSpatializer::out_R(){
+    return out("1");
+}
+
+int pdsp::BinauralSpatializer::getSources() const {
+        return sources;
+}
+
+int pdsp::BinauralSpatializer::meter_directions() const {
+        return meterDirections.load();
+}
+
+void pdsp::BinauralSpatializer::loadHRTF( HRTFSet & hrtf ){
+        this->hrtf = &hrtf;
+
+        if(dynamicConstruction){
+                swapBank( createBank( this->hrtf ) );
+        }
+}
+
+void pdsp::BinauralSpatializer::prepareUnit( int expectedBufferSize, double sampleRate ) {
+
+        deallocateBanks();
+        deallocateBuffers();
+
+        this->sampleRate = sampleRate;
+        blockSize = expectedBufferSize;
+
+        fft.initFFT( blockSize*2 - 1, PDSP_BINAURAL_FFT_BATCH );
+        fftSize = fft.getFFTBlockSize();
+        complexSize = fft.getFFTComplexSize();
+
+        allocateBuffers();
+
+        // not playing, so the bank is set directly
+        banks.set( createBank( hrtf ) );
+}
+
+void pdsp::BinauralSpatializer::releaseResources () {
+        deallocateBanks();
+        deallocateBuffers();
+}
+
+void pdsp::BinauralSpatializer::allocateBuffers(){
+        for(int e=0; e<2; ++e){
+                ofx_allocate_aligned(accR[e], complexSize);
+                ofx_allocate_aligned(accI[e], complexSize);
+                ofx_allocate_aligned(results[e], fftSize);
+                ofx_allocate_aligned(overlap[e], blockSize);
+                ofx_Aeq_Zero(results[e], fftSize);
+                ofx_Aeq_Zero(overlap[e], blockSize);
+        }
+        ofx_allocate_aligned(constantBuffer, blockSize);
+        filled = 0;
+        overlapSilent = true;
+}
+
+void pdsp::BinauralSpatializer::deallocateBuffers(){
+        for(int e=0; e<2; ++e){
+                if(accR[e] != nullptr){ ofx_deallocate_aligned(accR[e]); }
+                if(accI[e] != nullptr){ ofx_deallocate_aligned(accI[e]); }
+                if(results[e] != nullptr){ ofx_deallocate_aligned(results[e]); }
+                if(overlap[e] != nullptr){ ofx_deallocate_aligned(overlap[e]); }
+        }
+        if(constantBuffer != nullptr){ ofx_deallocate_aligned(constantBuffer); }
+}
+
+
+pdsp::BinauralSpatializer::Bank* pdsp::BinauralSpatializer::createBank( HRTFSet* hrtf ){
+
+        Bank* bank = new Bank();
+        bank->loaded = false;
+        bank->memory = nullptr;
+
+        if(hrtf == nullptr || hrtf->size() == 0 || blockSize <= 0){
+                return bank;
+        }
+
+        int directions = hrtf->size();
+
+        // all the delay lines have the same length, so they share the block index
+        int maxLength = 0;
+        for(int d=0; d<directions; ++d){
+                for(int e=0; e<2; ++e){
+                        int length = impulseResponseLength( hrtf->getImpulseResponse(d), e, sampleRate );
+                        if(length > maxLength){ maxLength = length; }
+                }
+        }
+        if(maxLength <= 0){
+                return bank;
+        }
+
+        std::vector<PartitionLayout> layout( 1 );
+        layout[0].size = blockSize;
+        layout[0].partitions = ( maxLength + blockSize - 1 ) / blockSize;
+        layout[0].offset = 0;
+
+        bank->directions = directions;
+        bank->partitions = layout[0].partitions;
+        bank->complexSize = complexSize;
+        bank->stride = ( complexSize + 3 ) / 4 * 4;
+        bank->blockIndex = 0;
+
+        bank->x.resize(directions);
+        bank->y.resize(directions);
+        bank->z.resize(directions);
+        bank->spectra.resize(directions*2);
+        bank->used.resize(directions, 0);
+
+        for(int d=0; d<directions; ++d){
+                float azimuth = hrtf->getAzimuth(d) * PDSP_BINAURAL_DEG_TO_RAD;
+                float elevation = hrtf->getElevation(d) * PDSP_BINAURAL_DEG_TO_RAD;
+                bank->x[d] = cosf(elevation) * cosf(azimuth);
+                bank->y[d] = cosf(elevation) * sinf(azimuth);
+                bank->z[d] = sinf(elevation);
+
+                // silent impulse responses have no spectra and are skipped
+                for(int e=0; e<2; ++e){
+                        std::shared_ptr<const ImpulseSpectra> spectra = SpectrumCache::get( hrtf->getImpulseResponse(d), e, sampleRate, layout );
+                        if(spectra != nullptr && spectra->complexSize(0) == complexSize){
+                                bank->spectra[d*2+e] = spectra;
+                                if(spectra->partitions(0) > bank->used[d]){
+                                        bank->used[d] = spectra->partitions(0);
+                                }
+                        }
+                }
+        }
+
+        size_t perDirection = fftSize + bank->partitions * bank->stride * 2;
+        ofx_allocate_aligned( bank->memory, perDirection * directions );
+        if(bank->memory == nullptr){
+                std::cout<<"[pdsp] warning! not enough memory for the HRTFs delay lines\n";
+                return bank;
+        }
+        ofx_Aeq_Zero( bank->memory, perDirection * directions );
+
+        bank->buses.resize(directions);
+        bank->circularR.resize(directions * bank->partitions);
+        bank->circularI.resize(directions * bank->partitions);
+        for(int d=0; d<directions; ++d){
+                float* memory = bank->memory + perDirection * d;
+                bank->buses[d] = memory;
+                memory += fftSize;
+                for(int p=0; p<bank->partitions; ++p){
+                        bank->circularR[d*bank->partitions + p] = memory;
+                        memory += bank->stride;
+                        bank->circularI[d*bank->partitions + p] = memory;
+                        memory += bank->stride;
+                }
+        }
+
+        bank->live.reserve(directions);
+        bank->inLive.resize(directions, 0);
+        bank->touched.resize(directions, 0);
+        bank->age.resize(directions, 0);
+        bank->valid.resize(directions, 0);
+
+        bank->sources.resize(sources);
+        for(SourceState & state : bank->sources){
+                state.count = 0;
+                state.azimuth = PDSP_BINAURAL_NO_POSITION;
+                state.elevation = PDSP_BINAURAL_NO_POSITION;
+        }
+
+        bank->fftInputs.resize(directions);
+        bank->fftR.resize(directions);
+        bank->fftI.resize(directions);
+
+        bank->loaded = true;
+        return bank;
+}
+
+
+void pdsp::BinauralSpatializer::deleteBank( Bank* bank ){
+        if(bank == nullptr){
+                return;
+        }
+        if(bank->memory != nullptr){
+                ofx_deallocate_aligned(bank->memory);
+        }
+        delete bank;
+}
+
+
+void pdsp::BinauralSpatializer::swapBank( Bank* bank ){
+        banks.post( bank );
+}
+
+
+void pdsp::BinauralSpatializer::deallocateBanks(){
+        banks.clear();
+}
+
+
+void pdsp::BinauralSpatializer::findDirections( const Bank & bank, float azimuth, float elevation, SourceState & state ) const noexcept {
+
+        // a position that is not a number keeps the last directions
+        if(!std::isfinite(azimuth) || !std::isfinite(elevation)){
+                return;
+        }
+
+        float a = azimuth * PDSP_BINAURAL_DEG_TO_RAD;
+        float e = elevation * PDSP_BINAURAL_DEG_TO_RAD;
+        float x = cosf(e) * cosf(a);
+        float y = cosf(e) * sinf(a);
+        float z = sinf(e);
+
+        // the nearest directions have the greatest dot products, the next one after them is kept for the weights
+        const int candidates = PDSP_BINAURAL_NEAREST + 1;
+        int nearest [candidates];
+        float dots [candidates];
+        int found = 0;
+        for(int d=0; d<bank.directions; ++d){
+                float dot = x*bank.x[d] + y*bank.y[d] + z*bank.z[d];
+                if(found < candidates || dot > dots[found-1]){
+                        int i = ( found < candidates ) ? found++ : found-1;
+                        while(i > 0 && dots[i-1] < dot){
+                                dots[i] = dots[i-1];
+                                nearest[i] = nearest[i-1];
+                                i--;
+                        }
+                        dots[i] = dot;
+                        nearest[i] = d;
+                }
+        }
+
+        state.azimuth = azimuth;
+        state.elevation = elevation;
+
+        if(found == 0){
+                state.count = 0;
+                return;
+        }
+
+        float distances [candidates];
+        for(int i=0; i<found; ++i){
+                float dot = dots[i];
+                if(dot > 1.0f){ dot = 1.0f; }
+                if(dot < -1.0f){ dot = -1.0f; }
+                distances[i] = acosf(dot);
+        }
+
+        if(distances[0] < 1.0e-4f){
+                state.count = 1;
+                state.directions[0] = nearest[0];
+                state.gains[0] = 1.0f;
+                return;
+        }
+
+        // inverse distance weights minus the weight of the next direction, so a direction enters and leaves with a zero weight
+        int count = ( found < candidates ) ? found : PDSP_BINAURAL_NEAREST;
+        float limit = ( found < candidates ) ? 0.0f : 1.0f / ( distances[count] * distances[count] );
+        float sum = 0.0f;
+        for(int i=0; i<count; ++i){
+                state.directions[i] = nearest[i];
+                state.gains[i] = 1.0f / ( distances[i] * distances[i] ) - limit;
+                sum += state.gains[i];
+        }
+
+        if(sum <= 0.0f){
+                // equidistant directions
+                for(int i=0; i<count; ++i){
+                        state.gains[i] = 1.0f / (float) count;
+                }
+        }else{
+                for(int i=0; i<count; ++i){
+                        state.gains[i] /= sum;
+                }
+        }
+        state.count = count;
+}
+
+
+void pdsp::BinauralSpatializer::mixToBus( Bank & bank, int direction, const float* input, float startGain, float endGain, int len ) noexcept {
+
+        float* bus = bank.buses[direction];
+
+        if(!bank.touched[direction]){
+                bank.touched[direction] = 1;
+                ofx_Aeq_Zero(bus, blockSize);
+                if(!bank.inLive[direction]){
+                        bank.inLive[direction] = 1;
+                        bank.valid[direction] = 0;
+                        bank.live.push_back(direction);
+                }
+        }
+
+        // the input goes after the samples of the block already processed, the gains reach the new value at its end
+        bus += filled;
+        if(startGain == endGain){
+                ofx_Aeq_Badd_CmulS(bus, bus, input, startGain, len);
+        }else{
+                float step = ( endGain - startGain ) / (float) len;
+                for(int n=0; n<len; ++n){
+                        bus[n] += input[n] * ( startGain + step * (float)(n+1) );
+                }
+        }
+}
+
+
+void pdsp::BinauralSpatializer::mixSource( Bank & bank, int source, const float* input, bool audioRate, float azimuth, float elevation, int len ) noexcept {
+
+        SourceState & state = bank.sources[source];
+        SourceState target = state;
+        if(azimuth != state.azimuth || elevation != state.elevation){
+                findDirections( bank, azimuth, elevation, target );
+        }
+
+        if(!audioRate){
+                if(input[0] == 0.0f){
+                        state = target;
+                        return;
+                }
+                std::fill( constantBuffer, constantBuffer + len, input[0] );
+                input = constantBuffer;
+        }
+
+        // the old directions go to their new gains or fade out, then the new ones fade in
+        for(int i=0; i<state.count; ++i){
+                float endGain = 0.0f;
+                for(int j=0; j<target.count; ++j){
+                        if(target.directions[j] == state.directions[i]){ endGain = target.gains[j]; }
+                }
+                mixToBus( bank, state.directions[i], input, state.gains[i], endGain, len );
+        }
+        for(int j=0; j<target.count; ++j){
+                bool mixed = false;
+                for(int i=0; i<state.count; ++i){
+                        if(state.directions[i] == target.directions[j]){ mixed = true; }
+                }
+                if(!mixed){
+                        mixToBus( bank, target.directions[j], input, 0.0f, target.gains[j], len );
+                }
+        }
+
+        state = target;
+}
+
+
+void pdsp::BinauralSpatializer::processBlock( Bank & bank, int len ) noexcept {
+
+        // a block shorter than the buffer is transformed again with the zeros replaced by the new input, so the delay lines move only at its start
+        bool newBlock = ( filled == 0 );
+        int partitions = bank.partitions;
+        if(newBlock){
+                bank.blockIndex++;
+                if(bank.blockIndex >= partitions){ bank.blockIndex = 0; }
+        }
+
+        // the directions with new input are transformed together, the slots of the others are cleared
+        int transforms = 0;
+        for(int d : bank.live){
+                if(( newBlock || bank.valid[d] == 0 ) && bank.valid[d] < partitions){ bank.valid[d]++; }
+                int slot = d*partitions + bank.blockIndex;
+                if(bank.touched[d]){
+                        bank.age[d] = 0;
+                        bank.fftInputs[transforms] = bank.buses[d];
+                        bank.fftR[transforms] = bank.circularR[slot];
+                        bank.fftI[transforms] = bank.circularI[slot];
+                        transforms++;
+                }else if(newBlock){
+                        bank.age[d]++;
+                        ofx_Aeq_Zero(bank.circularR[slot], bank.complexSize);
+                        ofx_Aeq_Zero(bank.circularI[slot], bank.complexSize);
+                }
+        }
+        if(transforms > 0){
+                fft.FFT( bank.fftInputs.data(), bank.fftR.data(), bank.fftI.data(), transforms );
+        }
+
+        for(int e=0; e<2; ++e){
+                ofx_Aeq_Zero(accR[e], complexSize);
+                ofx_Aeq_Zero(accI[e], complexSize);
+        }
+
+        // the slots after the last input are zero, the slots before entering the live list are not valid
+        for(int d : bank.live){
+                for(int e=0; e<2; ++e){
+                        const ImpulseSpectra* spectra = bank.spectra[d*2+e].get();
+                        if(spectra == nullptr){ continue; }
+                        int last = spectra->partitions(0);
+                        if(last > bank.valid[d]){ last = bank.valid[d]; }
+                        int k = bank.blockIndex - bank.age[d];
+                        if(k < 0){ k += partitions; }
+                        for(int p=bank.age[d]; p<last; ++p){
+                                vect_cmadd( accR[e], accI[e],
+                                            spectra->real(0, p), spectra->imag(0, p),
+                                            bank.circularR[d*partitions + k], bank.circularI[d*partitions + k],
+                                            complexSize );
+                                k--;
+                                if(k < 0){ k = partitions-1; }
+                        }
+                }
+        }
+
+        const float* re [2] = { accR[0], accR[1] };
+        const float* im [2] = { accI[0], accI[1] };
+        fft.iFFT( results, re, im, 2 );
+
+        if(filled + len < blockSize){ return; }
+
+        // the directions without input in the next block leave the live list when all their partitions are over
+        int kept = 0;
+        for(int d : bank.live){
+                bank.touched[d] = 0;
+                if(bank.age[d] + 1 < bank.used[d]){
+                        bank.live[kept++] = d;
+                }else{
+                        bank.inLive[d] = 0;
+                }
+        }
+        bank.live.resize(kept);
+}
+
+
+void pdsp::BinauralSpatializer::process (int bufferSize) noexcept {
+
+        // swaps in the bank prepared by the control thread at the start of a block, the replaced one is freed by the worker thread
+        if( filled == 0 && banks.swap() ){
+                banks.retire();
+        }
+
+        Bank* bank = banks.getCurrent();
+
+        for(int s=0; s<sources; ++s){
+                int azimuthState;
+                int elevationState;
+                signals[s] = processInput(inputSignals[s], signalStates[s]);
+                azimuths[s] = processInput(inputAzimuths[s], azimuthState)[0];
+                elevations[s] = processInput(inputElevations[s], elevationState)[0];
+        }
+
+        if(bank == nullptr || !bank->loaded){
+                meterDirections.store(0, std::memory_order_relaxed);
+                setOutputToZero(outputL);
+                setOutputToZero(outputR);
+                return;
+        }
+
+        // the partitions are as long as the expected buffer, longer buffers are processed in blocks and shorter ones fill the current block
+        float* outputs [2] = { nullptr, nullptr };
+        for(int processed=0; processed<bufferSize; ){
+                int len = blockSize - filled;
+                if(len > bufferSize - processed){ len = bufferSize - processed; }
+
+                for(int s=0; s<sources; ++s){
+                        const float* signal = signals[s];
+                        bool audioRate = ( signalStates[s] == AudioRate );
+                        if(audioRate){ signal += processed; }
+                        mixSource( *bank, s, signal, audioRate, azimuths[s], elevations[s], len );
+                }
+
+                // the live list only grows during a block, so if it's empty now the whole block is silent
+                bool silent = bank->live.empty();
+                if(silent && overlapSilent){
+                        // the outputs are taken only if some block isn't silent
+                        if(outputs[0] != nullptr){
+                                ofx_Aeq_Zero(outputs[0] + processed, len);
+                                ofx_Aeq_Zero(outputs[1] + processed, len);
+                        }
+                }else{
+                        if(silent){
+                                // only the overlap of the last block is left
+                                ofx_Aeq_Zero(results[0], fftSize);
+                                ofx_Aeq_Zero(results[1], fftSize);
+                        }else{
+                                processBlock( *bank, len );
+                        }
+
+                        if(outputs[0] == nullptr){
+                                outputs[0] = getOutputBufferToFill(outputL);
+                                outputs[1] = getOutputBufferToFill(outputR);
+                                ofx_Aeq_Zero(outputs[0], processed);
+                                ofx_Aeq_Zero(outputs[1], processed);
+                        }
+                        for(int e=0; e<2; ++e){
+                                ofx_Aeq_BaddC(outputs[e] + processed, results[e] + filled, overlap[e] + filled, len);
+                        }
+                }
+
+                processed += len;
+                filled += len;
+                if(filled == blockSize){
+                        if(!( silent && overlapSilent )){
+                                for(int e=0; e<2; ++e){
+                                        std::memcpy( overlap[e], results[e] + blockSize, sizeof(float) * blockSize );
+                                }
+                        }
+                        overlapSilent = silent;
+                        filled = 0;
+                }
+        }
+
+        if(outputs[0] == nullptr){
+                meterDirections.store(0, std::memory_order_relaxed);
+                setOutputToZero(outputL);
+                setOutputToZero(outputR);
+                return;
+        }
+
+        meterDirections.store( (int) bank->live.size(), std::memory_order_relaxed );
+}
@@ -0,0 +1,193 @@
+
+// BinauralSpatializer.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_CONVOLUTION_BINAURALSPATIALIZER_H_INCLUDED
+#define PDSP_CONVOLUTION_BINAURALSPATIALIZER_H_INCLUDED
+
+#include "../pdspCore.h"
+#include "../helpers/FFTWorker.h"
+#include "HRTFSet.h"
+#include "SpectrumCache.h"
+#include "KernelSwap.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <string>
+
+// signals transformed together by the batch FFT
+#define PDSP_BINAURAL_FFT_BATCH 4
+// measured directions mixed for each source
+#define PDSP_BINAURAL_NEAREST 3
+
+namespace pdsp{
+/*!
+@brief Places many sources around the listener, convolving them with the head related impulse responses of an HRTFSet. The output is for headphones.
+
+Each source is mixed into the nearest three measured directions of the set, with weights that smoothly follow its position, that is the same as interpolating the impulse responses. Then each direction receiving some signal is convolved with uniform partitions as long as the audio buffer, so there is no added latency: its input block is transformed once with the batch FFT and multiplied with the shared spectra of both ears, and all the directions are accumulated into a single stereo spectrum, so there are only two inverse FFTs. The cost of a source is just mixing it into the directions, and the convolutions are never more than the measured directions, so the cpu grows much less than the number of sources. The spectra are taken from the SpectrumCache and shared by all the spatializers using the same set.
+*/
+
+class BinauralSpatializer : public Unit {
+
+public:
+        BinauralSpatializer();
+
+        /*!
+        @brief constructs a spatializer with the given number of sources, 16 if not given
+        @param[in] sources number of sources
+        */
+        BinauralSpatializer( int sources );
+        ~BinauralSpatializer();
+
+        /*!
+        @brief Sets "signal0", "signal1", etc as selected input and returns this Unit ready to be patched. This is the audio input of the given source, the first one is the default input.
+        @param[in] source source index
+        */
+        Patchable& in_signal( int source );
+
+        /*!
+        @brief Sets "azimuth0", "azimuth1", etc as selected input and returns this Unit ready to be patched. This is the azimuth of the given source in degrees, 0 is in front and 90 on the left. It is read once for each buffer and smoothed.
+        @param[in] source source index
+        */
+        Patchable& in_azimuth( int source );
+
+        /*!
+        @brief Sets "elevation0", "elevation1", etc as selected input and returns this Unit ready to be patched. This is the elevation of the given source in degrees, 90 is above. It is read once for each buffer and smoothed.
+        @param[in] source source index
+        */
+        Patchable& in_elevation( int source );
+
+        /*!
+        @brief Sets "0" as selected output and returns this Unit ready to be patched. This is the default output. This is the left output channel.
+        */
+        Patchable& out_0();
+
+        /*!
+        @brief Sets "1" as selected output and returns this Unit ready to be patched. This is the right output channel.
+        */
+        Patchable& out_1();
+
+        /*!
+        @brief Sets "0" as selected output and returns this Unit ready to be patched. This is the default output. This is the left output channel.
+        */
+        Patchable& out_L();
+
+        /*!
+        @brief Sets "1" as selected output and returns this Unit ready to be patched. This is the right output channel.
+        */
+        Patchable& out_R();
+
+        /*!
+        @brief Sets the HRTFs to use. While playing the spectra are prepared in the calling thread and swapped in by the audio thread at the start of the next buffer, the sources fade in during that buffer and the tails of the old directions are cut.
+        @param[in] hrtf set of HRTFs, it has to be valid while the spatializer uses it
+        */
+        void loadHRTF( HRTFSet & hrtf );
+
+        /*!
+        @brief returns the number of sources
+        */
+        int getSources() const;
+
+        /*!
+        @brief returns the number of directions convolved in the last buffer, including the ones still ringing after their sources moved away. This method is thread-safe.
+        */
+        int meter_directions() const;
+
+private:
+        void prepareUnit( int expectedBufferSize, double sampleRate ) override;
+        void releaseResources () override ;
+        void process (int bufferSize) noexcept override;
+
+        // directions mixed for a source, the gains are ramped from the last buffer ones
+        struct SourceState {
+            int     count;
+            int     directions [PDSP_BINAURAL_NEAREST];
+            float   gains [PDSP_BINAURAL_NEAREST];
+            float   azimuth;
+            float   elevation;
+        };
+
+        // the shared spectra and the delay lines of all the directions of an HRTFSet
+        struct Bank {
+            bool        loaded;
+            int         directions;
+            int         partitions;     // length of the delay lines, the most partitions of all the impulse responses
+            int         complexSize;
+            int         stride;         // aligned complexSize
+            int         blockIndex;
+
+            std::vector<float>  x;      // unit vectors of the directions
+            std::vector<float>  y;
+            std::vector<float>  z;
+            std::vector<std::shared_ptr<const ImpulseSpectra>> spectra;     // left and right for each direction
+            std::vector<int>    used;           // partitions of each direction, for both ears
+
+            float*      memory;
+            std::vector<float*> buses;          // input block of each direction, zero-padded to the FFT size
+            std::vector<float*> circularR;      // partitions slots of each direction
+            std::vector<float*> circularI;
+
+            // directions in the live list are convolved, untouched ones ring out until their partitions are over
+            std::vector<int>    live;
+            std::vector<char>   inLive;
+            std::vector<char>   touched;
+            std::vector<int>    age;            // blocks since the last input
+            std::vector<int>    valid;          // blocks since entering the live list
+
+            std::vector<SourceState> sources;
+
+            std::vector<const float*>   fftInputs;
+            std::vector<float*>         fftR;
+            std::vector<float*>         fftI;
+        };
+
+        Bank* createBank( HRTFSet* hrtf );
+        static void deleteBank( Bank* bank );
+        void swapBank( Bank* bank );
+        void deallocateBanks();
+        void allocateBuffers();
+        void deallocateBuffers();
+
+        void findDirections( const Bank & bank, float azimuth, float elevation, SourceState & state ) const noexcept;
+        void mixSource( Bank & bank, int source, const float* input, bool audioRate, float azimuth, float elevation, int len ) noexcept;
+        void mixToBus( Bank & bank, int direction, const float* input, float startGain, float endGain, int len ) noexcept;
+        void processBlock( Bank & bank, int len ) noexcept;
+
+        int                         sources;
+        std::vector<std::string>    tags;
+        std::vector<InputNode>      inputSignals;
+        std::vector<InputNode>      inputAzimuths;
+        std::vector<InputNode>      inputElevations;
+        OutputNode                  outputL;
+        OutputNode                  outputR;
+
+        // inputs of the sources, read once for each buffer
+        std::vector<const float*>   signals;
+        std::vector<int>            signalStates;
+        std::vector<float>          azimuths;
+        std::vector<float>          elevations;
+
+        HRTFSet*        hrtf;
+        double          sampleRate;
+        int             blockSize;
+        int             fftSize;
+        int             complexSize;
+
+        FFTWorker       fft;
+        float*          accR [2];
+        float*          accI [2];
+        float*          results [2];
+        float*          overlap [2];
+        float*          constantBuffer;
+        int             filled;         // samples of the current block already processed
+        bool            overlapSilent;
+
+        KernelSwap<Bank>    banks;
+        std::atomic<int>    meterDirections;
+
+};
+
+}//END NAMESPACE
+
+#endif  // PDSP_CONVOLUTION_BINAURALSPATIALIZER_H_INCLUDED
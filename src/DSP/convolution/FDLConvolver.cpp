@@ -1,61 +1,72 @@
 
 #include "FDLConvolver.h"
+#include <cstring>
 
 pdsp::FFTWorker pdsp::FDLConvolver::fftWorker = FFTWorker();
 
 
-pdsp::FDLConvolver::FDLConvolver(){
-        
+pdsp::FDLConvolver::FDLConvolver() : kernels( deleteKernel ){
+
         addInput("signal", input);
         addOutput("signal", output);
         updateOutputNodes();
-        
-        signalBlock    = 0;
-        complexSize    = 0;
-        silenceCount   = 30000;
-        processingSize = 0;
-        processingOffset = 0;
-                
+
         impulseResponse = nullptr;
-        IRLoaded = false;
         IRChannel = 0;
-        
-        impulseR    = nullptr;
-        impulseI    = nullptr;
-        circularR   = nullptr;
-        circularI   = nullptr;
-        
-        addR        = nullptr;
-        addI        = nullptr;           
-        paddedInput = nullptr;
-        overlapAdd  = nullptr;
-        
+        sampleRate = 44100.0;
+        expectedBufferSize = 0;
+        nonUniform  = false;
+        backgroundTail = false;
+
+        fadeBuffer = nullptr;
+        crossfadeTime = 50.0f;
+        tailContinuation = false;
+
+        tailRegistered = false;
+        tailMisses = 0;
+
         if(dynamicConstruction){
                 prepareUnit(globalBufferSize, globalSampleRate);
         }
 }
 
+pdsp::FDLConvolver::~FDLConvolver(){
+        deallocateKernels();
+}
+
 pdsp::Patchable& pdsp::FDLConvolver::in_signal(){
-    return in("signal");   
+    return in("signal");
 }
 
 pdsp::Patchable& pdsp::FDLConvolver::out_signal(){
-    return out("signal");   
+    return out("signal");
 }
 
 void pdsp::FDLConvolver::prepareUnit( int expectedBufferSize, double sampleRate ) {
+
+        deallocateKernels();
+
         this->sampleRate=sampleRate;
+        this->expectedBufferSize = expectedBufferSize;
 
         fftWorker.initFFT(expectedBufferSize);
 
-        prepareIR();
+        ofx_allocate_aligned(fadeBuffer, expectedBufferSize);
+
+        // not playing, so the kernel is set directly
+        Kernel* kernel = createKernel();
+        if(kernel->background){
+                TailWorker::getInstance().add(this);
+                tailRegistered = true;
+        }
+        kernels.set(kernel);
 }
 
 void pdsp::FDLConvolver::releaseResources () {
- 
-        deallocateBlocksBuffers(); 
-            
-}       
+
+        deallocateKernels();
+
+}
 
 
 void pdsp::FDLConvolver::loadIR ( SampleBuffer* impulseResponse, int channel){
@@ -65,347 +76,393 @@ void pdsp::FDLConvolver::loadIR ( SampleBuffer* impulseResponse, int channel){
 void pdsp::FDLConvolver::loadIR ( SampleBuffer & impulseResponse, int channel){
     this->IRChannel = channel;
     this->impulseResponse = &impulseResponse;
-    
+
     if(dynamicConstruction){
-        prepareIR();
+        swapKernel( createKernel() );
     }
 }
 
 
-void pdsp::FDLConvolver::prepareIR ( ){
-    
-        IRLoaded = false;
-        deallocateBlocksBuffers();
-        
-        if(impulseResponse!=nullptr ){
-  
-                int impulseLength = impulseResponse->length;
-                
-                //cut out zeroes from tail
-                while(impulseLength>0 && (impulseResponse->buffer[IRChannel][impulseLength-1] == 0.0f )){
-                        impulseLength--;
-                }
-  
-                float inc;
-                int convertedLen;
-                if(sampleRate!=impulseResponse->fileSampleRate){
-                        inc    =  impulseResponse->fileSampleRate / sampleRate;
-                        convertedLen = static_cast<int>( static_cast<float>(impulseLength) / inc ) + 1;
-                }else{
-                        inc    =  1.0f;
-                        convertedLen = (impulseLength);     
-                }
-                
-                signalBlock = fftWorker.getFFTBlockSize();
-                processingSize = signalBlock/2;
-                complexSize = fftWorker.getFFTComplexSize();               
-                numBlocks = (convertedLen / processingSize) + 1;
-                
-                if( allocateBlocksBuffers() && loadImpulseResponseSegments(inc, convertedLen) ){
-                        IRLoaded = true;
-                }else{
-                        IRLoaded = false;
-                }
-                
-                blockIndex = 0;
-                
+void pdsp::FDLConvolver::setNonUniform( bool active ){
+    if( active != nonUniform ){
+        nonUniform = active;
+        if(dynamicConstruction){
+            swapKernel( createKernel() );
         }
+    }
 }
 
 
-bool pdsp::FDLConvolver::allocateBlocksBuffers(){
-
-    if(paddedInput != nullptr){
-        ofx_deallocate_aligned(paddedInput);
-    }
-    ofx_allocate_aligned(paddedInput, signalBlock);    
-    if(paddedInput == nullptr){
-        deallocateBlocksBuffers();
-        return false;
+void pdsp::FDLConvolver::setBackgroundTail( bool active ){
+    if( active != backgroundTail ){
+        backgroundTail = active;
+        if(dynamicConstruction){
+            swapKernel( createKernel() );
+        }
     }
+}
 
-    if(overlapAdd != nullptr){
-        ofx_deallocate_aligned(overlapAdd);
-    }
-    ofx_allocate_aligned(overlapAdd, signalBlock/2);
-    if(overlapAdd == nullptr){
-        deallocateBlocksBuffers();
-        return false;
-    }
-    
-    if(addR != nullptr){
-        ofx_deallocate_aligned(addR);
-    }
-    ofx_allocate_aligned(addR, complexSize);
-    if(addR == nullptr){
-        deallocateBlocksBuffers();
-        return false;
-    }
+int pdsp::FDLConvolver::meter_tail_misses() const {
+    return tailMisses.load();
+}
 
-    if(addI != nullptr){
-        ofx_deallocate_aligned(addI);
-    }
-    ofx_allocate_aligned(addI, complexSize);
-    if(addI == nullptr){
-        deallocateBlocksBuffers();
-        return false;
-    }
+void pdsp::FDLConvolver::setCrossfadeTime( float timeMs ){
+    if(timeMs < 0.0f){ timeMs = 0.0f; }
+    crossfadeTime = timeMs;
+}
 
-    impulseR = new float* [numBlocks];
-    for(int i=0; i<numBlocks; ++i){
-        ofx_allocate_aligned(impulseR[i], complexSize);   
-        if(impulseR[i]==nullptr){
-            for(int j=0; j<i; j++){
-                ofx_deallocate_aligned(impulseR[i]);
-            }
-            delete[] impulseR;
-            deallocateBlocksBuffers();
-            return false;
-        }
-    }
+void pdsp::FDLConvolver::setTailContinuation( bool active ){
+    tailContinuation = active;
+}
 
-    impulseI = new float* [numBlocks];
-    for(int i=0; i<numBlocks; ++i){
-        ofx_allocate_aligned(impulseI[i], complexSize);   
-        if(impulseI[i]==nullptr){
-            for(int j=0; j<i; j++){
-                ofx_deallocate_aligned(impulseI[i]);
-            }
-            delete[] impulseI;
-            deallocateBlocksBuffers();
-            return false;
-        } 
-    }
 
-    circularR = new float* [numBlocks];
-    for(int i=0; i<numBlocks; ++i){
-        ofx_allocate_aligned(circularR[i], complexSize);  
-        if(circularR[i]==nullptr){
-            for(int j=0; j<i; j++){
-                ofx_deallocate_aligned(circularR[i]);
-            }
-            delete[] impulseI;
-            deallocateBlocksBuffers();
-            return false;
-        } 
-          
-    }
+pdsp::FDLConvolver::Kernel* pdsp::FDLConvolver::createKernel(){
 
-    circularI = new float* [numBlocks];
-    for(int i=0; i<numBlocks; ++i){
-        ofx_allocate_aligned(circularI[i], complexSize);
-        if(circularI[i]==nullptr){
-            for(int j=0; j<i; j++){
-                ofx_deallocate_aligned(circularI[i]);
-            }
-            delete[] impulseI;
-            deallocateBlocksBuffers();
-            return false;
-        } 
-    }
+        // value-initialized, all the buffers are nullptr
+        Kernel* kernel = new Kernel();
+        kernel->nonUniform = nonUniform;
+        kernel->silenceCount = 30000;
 
-    return true;
-}
+        if(impulseResponse==nullptr || expectedBufferSize<=0 ){
+                return kernel;
+        }
 
+        int length = impulseResponseLength( *impulseResponse, IRChannel, sampleRate );
+        if(length<=0){
+                return kernel;
+        }
 
-void pdsp::FDLConvolver::deallocateBlocksBuffers(){
-      
-        if(paddedInput != nullptr){
-                ofx_deallocate_aligned(paddedInput);
+        std::vector<PartitionLayout> layout;
+        if(nonUniform){
+                computePartitionLayout( layout, length, expectedBufferSize, true );
+        }else{
+                kernel->signalBlock = fftWorker.getFFTBlockSize();
+                kernel->processingSize = kernel->signalBlock/2;
+                kernel->complexSize = fftWorker.getFFTComplexSize();
+                computePartitionLayout( layout, length, kernel->processingSize, false );
         }
-        if(overlapAdd != nullptr){
-                ofx_deallocate_aligned(overlapAdd);
+
+        // the spectra are resampled and transformed only if they are not cached
+        std::shared_ptr<const ImpulseSpectra> spectra = SpectrumCache::get( *impulseResponse, IRChannel, sampleRate, layout );
+        if(spectra==nullptr){
+                return kernel;
         }
-        
-        if(addR != nullptr){
-                ofx_deallocate_aligned(addR);
+
+        bool loaded;
+        if(nonUniform){
+                kernel->levels = new PartitionLevels();
+                loaded = kernel->levels->allocate(layout, 1, 1, expectedBufferSize, backgroundTail) && kernel->levels->load(0, 0, *spectra);
+                kernel->background = kernel->levels->hasBackground();
+                kernel->silenceLimit = kernel->levels->silenceLimit();
+        }else{
+                kernel->numBlocks = layout[0].partitions;
+                kernel->silenceLimit = kernel->numBlocks + 4;
+                loaded = allocateBlocksBuffers(*kernel) && loadImpulseResponseSegments(*kernel, *spectra);
         }
-        if(addI != nullptr){
-                ofx_deallocate_aligned(addI);
+
+        if(!loaded){
+                // the partially allocated kernel is replaced by a silent one
+                deleteKernel(kernel);
+                kernel = new Kernel();
+                kernel->nonUniform = nonUniform;
+                kernel->silenceCount = 30000;
+                return kernel;
         }
-       
-        if(impulseR != nullptr){
-                for(int i=0; i<numBlocks; ++i){
-                    ofx_deallocate_aligned(impulseR[i]);    
-                }
-                delete[] impulseR;
-                impulseR = nullptr;
+
+        kernel->loaded = true;
+        return kernel;
+}
+
+
+void pdsp::FDLConvolver::swapKernel( Kernel* kernel ){
+
+        // the background tails of the new kernel are processed by the worker thread
+        if(kernel->background && !tailRegistered){
+                TailWorker::getInstance().add(this);
+                tailRegistered = true;
         }
-        
-        if(impulseI != nullptr){
-                for(int i=0; i<numBlocks; ++i){
-                    ofx_deallocate_aligned(impulseI[i]);    
-                }
-                delete[] impulseI;  
-                impulseI = nullptr;
+
+        kernels.post(kernel);
+}
+
+
+void pdsp::FDLConvolver::deallocateKernels(){
+
+        // after this the worker thread doesn't access the kernels anymore
+        if(tailRegistered){
+                TailWorker::getInstance().remove(this);
+                tailRegistered = false;
         }
-        
-        if(circularR != nullptr){
-                for(int i=0; i<numBlocks; ++i){
-                    ofx_deallocate_aligned(circularR[i]);    
-                }
-                delete[] circularR;
-                circularR = nullptr;
+
+        kernels.clear();
+
+        if(fadeBuffer != nullptr){
+                ofx_deallocate_aligned(fadeBuffer);
         }
-        
-        if(circularI != nullptr){
-                for(int i=0; i<numBlocks; ++i){
-                    ofx_deallocate_aligned(circularI[i]);    
+}
+
+
+void pdsp::FDLConvolver::deleteKernel( Kernel* kernel ){
+
+        if(kernel == nullptr){
+                return;
+        }
+
+        if(kernel->paddedInput != nullptr){ ofx_deallocate_aligned(kernel->paddedInput); }
+        if(kernel->overlapAdd != nullptr){ ofx_deallocate_aligned(kernel->overlapAdd); }
+        if(kernel->addR != nullptr){ ofx_deallocate_aligned(kernel->addR); }
+        if(kernel->addI != nullptr){ ofx_deallocate_aligned(kernel->addI); }
+
+        float** blocks[4] = { kernel->impulseR, kernel->impulseI, kernel->circularR, kernel->circularI };
+        for(int d=0; d<4; ++d){
+                if(blocks[d] != nullptr){
+                        for(int i=0; i<kernel->numBlocks; ++i){
+                                if(blocks[d][i] != nullptr){ ofx_deallocate_aligned(blocks[d][i]); }
+                        }
+                        delete[] blocks[d];
                 }
-                delete[] circularI;
-                circularI = nullptr;
         }
+
+        delete kernel->levels;
+        delete kernel;
 }
 
 
-bool pdsp::FDLConvolver::loadImpulseResponseSegments(const float &inc, const int &convertedLen){
-                        
-        float index = 0.0f;
-        
-        float* tempBuffer;
-        
-        try
-        {
-            tempBuffer = new float[signalBlock];
-        }
-        catch (std::bad_alloc& ba)
-        {
-            deallocateBlocksBuffers();
+bool pdsp::FDLConvolver::allocateBlocksBuffers( Kernel & kernel ){
+
+    ofx_allocate_aligned(kernel.paddedInput, kernel.signalBlock);
+    ofx_allocate_aligned(kernel.overlapAdd, kernel.signalBlock/2);
+    ofx_allocate_aligned(kernel.addR, kernel.complexSize);
+    ofx_allocate_aligned(kernel.addI, kernel.complexSize);
+    if(kernel.paddedInput == nullptr || kernel.overlapAdd == nullptr || kernel.addR == nullptr || kernel.addI == nullptr){
+        return false;
+    }
+
+    kernel.impulseR  = new float* [kernel.numBlocks];
+    kernel.impulseI  = new float* [kernel.numBlocks];
+    kernel.circularR = new float* [kernel.numBlocks];
+    kernel.circularI = new float* [kernel.numBlocks];
+    for(int i=0; i<kernel.numBlocks; ++i){
+        kernel.impulseR[i] = kernel.impulseI[i] = kernel.circularR[i] = kernel.circularI[i] = nullptr;
+    }
+    for(int i=0; i<kernel.numBlocks; ++i){
+        ofx_allocate_aligned(kernel.impulseR[i], kernel.complexSize);
+        ofx_allocate_aligned(kernel.impulseI[i], kernel.complexSize);
+        ofx_allocate_aligned(kernel.circularR[i], kernel.complexSize);
+        ofx_allocate_aligned(kernel.circularI[i], kernel.complexSize);
+        if(kernel.impulseR[i]==nullptr || kernel.impulseI[i]==nullptr || kernel.circularR[i]==nullptr || kernel.circularI[i]==nullptr){
             return false;
         }
+        // the delay line starts from silence
+        ofx_Aeq_Zero(kernel.circularR[i], kernel.complexSize);
+        ofx_Aeq_Zero(kernel.circularI[i], kernel.complexSize);
+    }
+
+    ofx_Aeq_Zero(kernel.overlapAdd, kernel.signalBlock/2);
+    kernel.blockIndex = 0;
+
+    return true;
+}
+
+
+bool pdsp::FDLConvolver::loadImpulseResponseSegments( Kernel & kernel, const ImpulseSpectra & spectra ){
+
+        if(spectra.complexSize(0) != kernel.complexSize){
+                return false;
+        }
 
-        
-        for(int i=0; i<numBlocks; ++i){ 
-
-                //load the segment from the wave buffer (a bit ugly but works, and we don't need speed here)
-                if(sampleRate!=impulseResponse->fileSampleRate){
-                        for(int n=0; n<processingSize; ++n){
-                                
-                                if(index < static_cast<float>(convertedLen)){ //check if we are after the IR length
-                                        int index_int = static_cast<int> (index);
-                                        float mu = index - index_int;
-                                        float x1 = impulseResponse->buffer[IRChannel][index_int];
-                                        float x2 = impulseResponse->buffer[IRChannel][index_int+1];
-                                        tempBuffer[n] = interpolate_smooth( x1, x2, mu );
-                                }else{
-                                        tempBuffer[n] = 0.0f;
-                                }
-                                index = (index + inc);
-                        }
+        for(int i=0; i<kernel.numBlocks; ++i){
+                if(i < spectra.partitions(0)){
+                        std::memcpy( kernel.impulseR[i], spectra.real(0, i), kernel.complexSize*sizeof(float) );
+                        std::memcpy( kernel.impulseI[i], spectra.imag(0, i), kernel.complexSize*sizeof(float) );
                 }else{
-                        for(int n=0; n<processingSize; ++n){
-                                
-                                if( ( i*processingSize + n )< convertedLen){ //check if we are after the IR length
-                                        tempBuffer[n] = impulseResponse->buffer[IRChannel][i*processingSize + n];
-                                }else{
-                                        tempBuffer[n] = 0.0f;
-                                }
-                        }
+                        ofx_Aeq_Zero(kernel.impulseR[i], kernel.complexSize);
+                        ofx_Aeq_Zero(kernel.impulseI[i], kernel.complexSize);
                 }
-                
-                //pad with zeroes
-                for(int n=0; n<processingSize; ++n){
-                        tempBuffer[n + processingSize] = 0.0f;
-                }
-                
-                //fft and put into IR block buffer
-                fftWorker.FFT( tempBuffer, impulseR[i], impulseI[i] );
-        } 
-        
-        delete [] tempBuffer;
+        }
+
         return true;
 }
 
 
 void pdsp::FDLConvolver::process (int bufferSize) noexcept {
-                 
+
         int inputState;
         const float* inputBuffer = processInput(input, inputState);
 
-        if( IRLoaded && (inputState==AudioRate || silenceCount <= (numBlocks+4) ) ){
-
-                int stillToProcess = bufferSize;
-                
-                while(stillToProcess>0){
-                        //processing padding for non-power-of-two bufferSizes
-                        int maxPadded;
-                        int minPadded;
-                        
-                        if(stillToProcess <= processingSize ) { 
-                                minPadded = 0;
-                                maxPadded = stillToProcess;
-                                processingOffset = processingSize - stillToProcess;
-                                stillToProcess -= processingSize;
-                                
-                                blockIndex--;
-                                if(blockIndex<0){ blockIndex = numBlocks-1; } 
+        // swaps in the kernel prepared by the control thread
+        if(kernels.swap()){
+                kernels.startCrossfade( static_cast<int>( crossfadeTime.load() * 0.001 * sampleRate ) );
+        }
+
+        Kernel* kernel = kernels.getCurrent();
+        Kernel* old = kernels.getFading();
+
+        if(old == nullptr){
+                if( kernel != nullptr && isActive(*kernel, inputState) ){
+                        processKernel(*kernel, inputBuffer, inputState, getOutputBufferToFill(output), bufferSize);
+                }else{
+                        setOutputToZero(output);
+                }
+                return;
+        }
+
+        // both the kernels are processed until the crossfade or the old tail is over
+        float* outputBuffer = getOutputBufferToFill(output);
+        if( kernel != nullptr && isActive(*kernel, inputState) ){
+                processKernel(*kernel, inputBuffer, inputState, outputBuffer, bufferSize);
+        }else{
+                ofx_Aeq_Zero(outputBuffer, bufferSize);
+        }
+
+        bool finished;
+        if(tailContinuation.load(std::memory_order_relaxed)){
+                // the old kernel doesn't get the input anymore, its tail is added until it's silent
+                finished = !isActive(*old, Unchanged);
+                if(!finished){
+                        processKernel(*old, inputBuffer, Unchanged, fadeBuffer, bufferSize);
+                        ofx_Aeq_BaddC(outputBuffer, outputBuffer, fadeBuffer, bufferSize);
+                }
+        }else{
+                finished = kernels.crossfadeOver();
+                if(!finished){
+                        if( isActive(*old, inputState) ){
+                                processKernel(*old, inputBuffer, inputState, fadeBuffer, bufferSize);
+                                kernels.crossfade(outputBuffer, fadeBuffer, bufferSize);
                         }else{
-                                minPadded = processingOffset;
-                                maxPadded = processingSize;
-                                stillToProcess -= (processingSize-processingOffset);
-                        }
-                        
-                        //ACTUAL IR PARTITIONED CONVOLUTION
-                        //FFT input
-                        switch (inputState){
-                        case AudioRate: //we have input signal for forward FFT
-                        {
-                                int n=0;
-                                for(; n<minPadded; ++n){
-                                        paddedInput[n] = 0.0f;
-                                }
-                                for(; n<maxPadded; ++n){
-                                        paddedInput[n] = inputBuffer[n];
-                                }
-                                for(; n<signalBlock; ++n){
-                                        paddedInput[n] = 0.0f;
-                                }
-                                fftWorker.FFT(paddedInput, circularR[blockIndex], circularI[blockIndex]);
-                                silenceCount=0;
+                                kernels.crossfade(outputBuffer, nullptr, bufferSize);
                         }
-                                break;
-                        default: //silence, we simply set the complex buffer to zero
-                        {
-                                ofx_Aeq_Zero(circularR[blockIndex], complexSize);
-                                ofx_Aeq_Zero(circularI[blockIndex], complexSize);
-                                silenceCount++;
+                        kernels.advance(bufferSize);
+                }
+        }
+
+        if(finished){
+                // if the worker hasn't freed the last retired kernels yet, it's retired in the next buffers
+                kernels.retire();
+        }
+}
+
+
+bool pdsp::FDLConvolver::isActive( const Kernel & kernel, int inputState ) const noexcept {
+        return kernel.loaded && ( inputState==AudioRate || kernel.silenceCount <= kernel.silenceLimit );
+}
+
+
+void pdsp::FDLConvolver::processKernel( Kernel & kernel, const float* inputBuffer, int inputState, float* outputBuffer, int bufferSize ) noexcept {
+        if(kernel.nonUniform){
+                processNonUniform(kernel, inputBuffer, inputState, outputBuffer, bufferSize);
+        }else{
+                processUniform(kernel, inputBuffer, inputState, outputBuffer, bufferSize);
+        }
+}
+
+
+void pdsp::FDLConvolver::processUniform( Kernel & kernel, const float* inputBuffer, int inputState, float* outputBuffer, int bufferSize ) noexcept {
+
+        int stillToProcess = bufferSize;
+
+        while(stillToProcess>0){
+                //processing padding for non-power-of-two bufferSizes
+                int maxPadded;
+                int minPadded;
+
+                if(stillToProcess <= kernel.processingSize ) {
+                        minPadded = 0;
+                        maxPadded = stillToProcess;
+                        kernel.processingOffset = kernel.processingSize - stillToProcess;
+                        stillToProcess -= kernel.processingSize;
+
+                        kernel.blockIndex--;
+                        if(kernel.blockIndex<0){ kernel.blockIndex = kernel.numBlocks-1; }
+                }else{
+                        minPadded = kernel.processingOffset;
+                        maxPadded = kernel.processingSize;
+                        stillToProcess -= (kernel.processingSize-kernel.processingOffset);
+                }
+
+                //ACTUAL IR PARTITIONED CONVOLUTION
+                //FFT input
+                switch (inputState){
+                case AudioRate: //we have input signal for forward FFT
+                {
+                        int n=0;
+                        for(; n<minPadded; ++n){
+                                kernel.paddedInput[n] = 0.0f;
                         }
-                                break;
+                        for(; n<maxPadded; ++n){
+                                kernel.paddedInput[n] = inputBuffer[n];
                         }
-                        
-                        //set add buffer to zero 
-                        ofx_Aeq_Zero(addR, complexSize);
-                        ofx_Aeq_Zero(addI, complexSize);
-                        
-                        //complex multiply and add
-                        int k = blockIndex;
-                        for(int i=0; i<numBlocks; ++i){
-                                vect_cmadd( addR, addI, 
-                                                  impulseR [i], impulseI [i],
-                                                  circularR [k], circularI [k],
-                                                  complexSize);
-                                k++; 
-                                if (k>=numBlocks) { k = 0; }
+                        for(; n<kernel.signalBlock; ++n){
+                                kernel.paddedInput[n] = 0.0f;
                         }
+                        fftWorker.FFT(kernel.paddedInput, kernel.circularR[kernel.blockIndex], kernel.circularI[kernel.blockIndex]);
+                        kernel.silenceCount=0;
+                }
+                        break;
+                default: //silence, we simply set the complex buffer to zero
+                {
+                        ofx_Aeq_Zero(kernel.circularR[kernel.blockIndex], kernel.complexSize);
+                        ofx_Aeq_Zero(kernel.circularI[kernel.blockIndex], kernel.complexSize);
+                        kernel.silenceCount++;
+                }
+                        break;
+                }
 
-                        //inverse FFT
-                        float* outputBuffer = getOutputBufferToFill(output);
-                        
-                        fftWorker.iFFT(paddedInput, addR, addI);  
-                        
-                        
-                        for(int n=0; n<processingSize; ++n){
-                                outputBuffer[n] = paddedInput[n];
-                                outputBuffer[n]+= overlapAdd[n];
-                        }
-                        
-                        for(int n=0; n<processingSize; ++n){
-                                overlapAdd[n] = paddedInput[ processingSize +n ];
-                        }           
+                //set add buffer to zero
+                ofx_Aeq_Zero(kernel.addR, kernel.complexSize);
+                ofx_Aeq_Zero(kernel.addI, kernel.complexSize);
+
+                //complex multiply and add
+                int k = kernel.blockIndex;
+                for(int i=0; i<kernel.numBlocks; ++i){
+                        vect_cmadd( kernel.addR, kernel.addI,
+                                          kernel.impulseR [i], kernel.impulseI [i],
+                                          kernel.circularR [k], kernel.circularI [k],
+                                          kernel.complexSize);
+                        k++;
+                        if (k>=kernel.numBlocks) { k = 0; }
+                }
+
+                //inverse FFT
+                fftWorker.iFFT(kernel.paddedInput, kernel.addR, kernel.addI);
+
+                for(int n=0; n<kernel.processingSize; ++n){
+                        outputBuffer[n] = kernel.paddedInput[n];
+                        outputBuffer[n]+= kernel.overlapAdd[n];
+                }
+
+                for(int n=0; n<kernel.processingSize; ++n){
+                        kernel.overlapAdd[n] = kernel.paddedInput[ kernel.processingSize +n ];
                 }
+        }
+}
+
+
+void pdsp::FDLConvolver::processNonUniform( Kernel & kernel, const float* inputBuffer, int inputState, float* outputBuffer, int bufferSize ) noexcept {
+
+        if(inputState==AudioRate){
+                kernel.silenceCount = 0;
         }else{
-                setOutputToZero(output);  
+                kernel.silenceCount++;
         }
+
+        const float* inputs [1] = { (inputState==AudioRate) ? inputBuffer : nullptr };
+        float* outputs [1] = { outputBuffer };
+        kernel.levels->process(inputs, outputs, bufferSize, tailMisses);
 }
 
 
+bool pdsp::FDLConvolver::processTail() noexcept {
+        bool processed = false;
+
+        Kernel* kernel = kernels.getCurrent();
+        if(kernel != nullptr && kernel->levels != nullptr){
+                processed = kernel->levels->processTail() || processed;
+        }
+        kernel = kernels.getFading();
+        if(kernel != nullptr && kernel->levels != nullptr){
+                processed = kernel->levels->processTail() || processed;
+        }
+        return processed;
+}
+
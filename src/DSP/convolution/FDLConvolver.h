@@ -10,6 +10,12 @@
 #include "../pdspCore.h"
 #include "../helpers/FFTWorker.h"
 #include "../samplers/SampleBuffer.h"
+#include "TailWorker.h"
+#include "KernelSwap.h"
+#include "PartitionLayout.h"
+#include "PartitionLevels.h"
+#include "SpectrumCache.h"
+#include <atomic>
 
 namespace pdsp{
 /*!
@@ -19,10 +25,11 @@ namespace pdsp{
 This Units implement partitioned convolution using a Frequency-Domain Delay Line. Expecially useful if you have some real space impulse response to be used to make a IR Reverb.
 */
 
-class FDLConvolver : public Unit {
+class FDLConvolver : public Unit, private TailProcessor {
 
 public:
         FDLConvolver();
+        ~FDLConvolver();
         
         /*!
         @brief Sets "signal" as selected input and returns this Unit ready to be patched. This is the default input. This input is the audio input of the convolver.
@@ -35,11 +42,40 @@ public:
         Patchable& out_signal();
         
         /*!
-        @brief Sets the impulse response for the convolution.
+        @brief Sets the impulse response for the convolution. While playing the new impulse response is prepared in the calling thread and swapped in by the audio thread without glitches, see setCrossfadeTime() and setTailContinuation().
         @param[in] impulseResponse SampleBuffer to load as Impulse Response for the convolution.
         @param[in] channel select the channel to be if the SampleBuffer has more than one. If omitted the first channel is selected.
         */
         void loadIR ( SampleBuffer & impulseResponse, int channel=0);
+
+        /*!
+        @brief Activates or deactivates the non-uniform partitioning. The first partitions are as long as the audio buffer, so there is no added latency, the next ones double their length up to 8192 samples. The layout is chosen from the impulse response length, long impulse responses take much less cpu with the same output. Changing the partitioning reloads the impulse response.
+        @param[in] active true for non-uniform partitions, false for uniform partitions (default)
+        */
+        void setNonUniform( bool active );
+
+        /*!
+        @brief Activates or deactivates the background processing of the tail. With non-uniform partitions, the longest partitions are computed by a worker thread shared by all the convolvers, and their output is collected some buffers later. This flattens the cpu load of each audio callback. If the worker is late, the partitions are computed in the audio thread or skipped, see meter_tail_misses(). Don't use it for offline rendering. Changing it reloads the impulse response.
+        @param[in] active true for background processing, false for processing everything in the audio thread (default)
+        */
+        void setBackgroundTail( bool active );
+
+        /*!
+        @brief returns the number of tail partitions that the worker thread didn't finish in time, and were lost. This method is thread-safe.
+        */
+        int meter_tail_misses() const;
+
+        /*!
+        @brief Sets the crossfade time from the old impulse response to the new one, when the impulse response or the partitioning are changed while playing. Both are processed during the crossfade. The default is 50 ms.
+        @param[in] timeMs crossfade time in milliseconds
+        */
+        void setCrossfadeTime( float timeMs );
+
+        /*!
+        @brief Activates or deactivates the tail continuation. When active, after changing the impulse response while playing the old one is not crossfaded, it stops receiving the input and its tail rings out while the new one processes the input. Both are processed until the old tail is over.
+        @param[in] active true for tail continuation, false for crossfading (default)
+        */
+        void setTailContinuation( bool active );
        
 /*!
     @cond HIDDEN_SYMBOLS
@@ -55,38 +91,65 @@ private:
         void releaseResources () override ;
         void process (int bufferSize) noexcept override;
 
-        void prepareIR();
-        
-        void deallocateBlocksBuffers();
-        bool allocateBlocksBuffers();
-
-        bool loadImpulseResponseSegments(const float &inc, const int &convertedLen);
+        // all the buffers for convolving with an impulse response, prepared outside of the audio thread and swapped in
+        struct Kernel {
+                bool loaded;
+                bool nonUniform;
+                bool background;
+                int silenceCount;
+                int silenceLimit;
+
+                // uniform partitions
+                int numBlocks;
+                int blockIndex;
+                int complexSize;
+                int signalBlock;
+                int processingSize;
+                int processingOffset;
+                float* addR;
+                float* addI;
+                float* paddedInput;
+                float* overlapAdd;
+                float** impulseR;
+                float** impulseI;
+                float** circularR;
+                float** circularI;
+
+                // non-uniform partitions
+                PartitionLevels* levels;
+        };
+
+        Kernel* createKernel();
+        static void deleteKernel( Kernel* kernel );
+        void swapKernel( Kernel* kernel );
+        void deallocateKernels();
+
+        bool allocateBlocksBuffers( Kernel & kernel );
+        bool loadImpulseResponseSegments( Kernel & kernel, const ImpulseSpectra & spectra );
+
+        bool isActive( const Kernel & kernel, int inputState ) const noexcept;
+        void processKernel( Kernel & kernel, const float* inputBuffer, int inputState, float* outputBuffer, int bufferSize ) noexcept;
+        void processUniform( Kernel & kernel, const float* inputBuffer, int inputState, float* outputBuffer, int bufferSize ) noexcept;
+        void processNonUniform( Kernel & kernel, const float* inputBuffer, int inputState, float* outputBuffer, int bufferSize ) noexcept;
+        bool processTail() noexcept override;
         
         OutputNode output;
         InputNode input;
         
-        int numBlocks;
-        int blockIndex;
-        int complexSize;
-        int signalBlock;
-        int processingSize;
-        int processingOffset;
-        int silenceCount;
-        
-        float* addR;
-        float* addI;
-        float*  paddedInput;
-        float*  overlapAdd;
-        
-        float** impulseR;
-        float** impulseI;
-        float** circularR;
-        float** circularI;      
-        
         int             IRChannel;
         SampleBuffer*   impulseResponse;
-        bool            IRLoaded; 
         double          sampleRate;
+        int             expectedBufferSize;
+        bool            nonUniform;
+        bool            backgroundTail;
+
+        KernelSwap<Kernel>      kernels;
+        float*                  fadeBuffer;
+        std::atomic<float>      crossfadeTime;
+        std::atomic<bool>       tailContinuation;
+
+        bool            tailRegistered;
+        std::atomic<int> tailMisses;
         
         static FFTWorker    fftWorker;
            
@@ -0,0 +1,583 @@
+
+#include "FIRFilter.h"
+#include <cstring>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+// crossovers measured on a x86 cpu with SSE, for blocks from 16 to 1024 samples
+static const int pdspFIRDefaultCrossovers[PDSP_FIRFILTER_CROSSOVERS] = { 512, 256, 256, 256, 384, 512, 1024 };
+
+// zero means the default crossover
+std::atomic<int> pdsp::FIRFilter::crossovers[PDSP_FIRFILTER_CROSSOVERS];
+
+
+pdsp::FIRFilter::FIRFilter() : kernels( deleteKernel ){
+
+        addInput("signal", input);
+        addOutput("signal", output);
+        updateOutputNodes();
+
+        impulseResponse = nullptr;
+        IRChannel = 0;
+        mode = AutoFIR;
+        sampleRate = 44100.0;
+        blockSize = blockSizeFor(0);
+        filled = 0;
+        length = 0;
+
+        direct  = true;
+
+        fadeBuffer = nullptr;
+
+        if(dynamicConstruction){
+                prepareUnit(globalBufferSize, globalSampleRate);
+        }
+}
+
+pdsp::FIRFilter::~FIRFilter(){
+        deallocateKernels();
+}
+
+pdsp::Patchable& pdsp::FIRFilter::in_signal(){
+    return in("signal");
+}
+
+pdsp::Patchable& pdsp::FIRFilter::out_signal(){
+    return out("signal");
+}
+
+void pdsp::FIRFilter::prepareUnit( int expectedBufferSize, double sampleRate ) {
+
+        deallocateKernels();
+
+        this->sampleRate = sampleRate;
+        blockSize = blockSizeFor( expectedBufferSize );
+        filled = 0;
+
+        fft.initFFT( blockSize*2 - 1 );
+
+        ofx_allocate_aligned(fadeBuffer, ( expectedBufferSize > blockSize ) ? expectedBufferSize : blockSize);
+
+        // not playing, so the kernel is set directly
+        Kernel* kernel = createKernel( impulseResponse, IRChannel, sampleRate, blockSize, mode, true );
+        length = kernel->length;
+        direct = ( kernel->partitions == 0 );
+        kernels.set(kernel);
+}
+
+void pdsp::FIRFilter::releaseResources () {
+        deallocateKernels();
+}
+
+void pdsp::FIRFilter::loadIR( SampleBuffer & impulseResponse, int channel ){
+        this->IRChannel = channel;
+        this->impulseResponse = &impulseResponse;
+
+        if(dynamicConstruction){
+                swapKernel( createKernel( this->impulseResponse, IRChannel, sampleRate, blockSize, mode, true ) );
+        }
+}
+
+void pdsp::FIRFilter::setMode( FIRMode_t mode ){
+        if( mode != this->mode ){
+                this->mode = mode;
+                if(dynamicConstruction){
+                        swapKernel( createKernel( impulseResponse, IRChannel, sampleRate, blockSize, mode, true ) );
+                }
+        }
+}
+
+bool pdsp::FIRFilter::meter_direct() const {
+        return direct.load();
+}
+
+int pdsp::FIRFilter::getLength() const {
+        return length;
+}
+
+int pdsp::FIRFilter::blockSizeFor( int bufferSize ){
+        // the largest power of two not greater than the buffer size, so the FFTs are spread over the buffers
+        int size = 1 << PDSP_FIRFILTER_MIN_BLOCK_LOG2;
+        while( size*2 <= bufferSize && size < (1 << PDSP_FIRFILTER_MAX_BLOCK_LOG2) ){
+                size *= 2;
+        }
+        return size;
+}
+
+void pdsp::FIRFilter::setCrossover( int blockSize, int taps ){
+        int index = 0;
+        while( index < PDSP_FIRFILTER_CROSSOVERS-1 && ( 2 << (index + PDSP_FIRFILTER_MIN_BLOCK_LOG2) ) <= blockSize ){
+                index++;
+        }
+        if(taps < 1){ taps = 1; }
+        crossovers[index] = taps;
+}
+
+int pdsp::FIRFilter::getCrossover( int blockSize ){
+        int index = 0;
+        while( index < PDSP_FIRFILTER_CROSSOVERS-1 && ( 2 << (index + PDSP_FIRFILTER_MIN_BLOCK_LOG2) ) <= blockSize ){
+                index++;
+        }
+        int taps = crossovers[index].load();
+        return ( taps > 0 ) ? taps : pdspFIRDefaultCrossovers[index];
+}
+
+
+pdsp::FIRFilter::Kernel* pdsp::FIRFilter::createKernel( SampleBuffer* impulseResponse, int channel, double sampleRate, int blockSize, FIRMode_t mode, bool cached ){
+
+        // value-initialized, all the buffers are nullptr
+        Kernel* kernel = new Kernel();
+        kernel->silenceCount = 30000;
+
+        if(impulseResponse==nullptr || blockSize<=0){
+                return kernel;
+        }
+
+        int length = impulseResponseLength( *impulseResponse, channel, sampleRate );
+        if(length<=0){
+                return kernel;
+        }
+
+        bool directForm;
+        switch(mode){
+        case DirectFIR:       directForm = true;  break;
+        case PartitionedFIR:  directForm = false; break;
+        default:              directForm = ( length <= getCrossover(blockSize) ); break;
+        }
+        if(length <= blockSize){
+                directForm = true;
+        }
+
+        // the hybrid form convolves the first block in direct form, the partitions start after it
+        int directTaps = directForm ? length : blockSize;
+        std::vector<PartitionLayout> layout;
+        if(!directForm){
+                PartitionLayout level;
+                level.size = blockSize;
+                level.partitions = ( length - blockSize + blockSize - 1 ) / blockSize;
+                level.offset = blockSize;
+                layout.push_back( level );
+        }
+
+        if(cached){
+                kernel->taps = SpectrumCache::getTaps( *impulseResponse, channel, sampleRate, directTaps );
+                if(!directForm){
+                        kernel->spectra = SpectrumCache::get( *impulseResponse, channel, sampleRate, layout );
+                }
+        }else{
+                kernel->taps = SpectrumCache::getTapsUncached( *impulseResponse, channel, sampleRate, directTaps );
+                if(!directForm){
+                        kernel->spectra = SpectrumCache::getUncached( *impulseResponse, channel, sampleRate, layout );
+                }
+        }
+
+        bool loaded = ( kernel->taps != nullptr ) && ( directForm || kernel->spectra != nullptr );
+
+        if(loaded){
+                kernel->length = length;
+                kernel->history = kernel->taps->length() - 1;
+                int lineSize = ( kernel->history + blockSize + 8 + 3 ) / 4 * 4;
+                ofx_allocate_aligned(kernel->line, lineSize);
+                ofx_allocate_aligned(kernel->lanes, 16);
+                loaded = ( kernel->line != nullptr && kernel->lanes != nullptr );
+                if(loaded){
+                        ofx_Aeq_Zero(kernel->line, lineSize);
+                }
+        }
+
+        if(loaded && !directForm){
+                kernel->partitions = kernel->spectra->partitions(0);
+                kernel->complexSize = kernel->spectra->complexSize(0);
+                ofx_allocate_aligned(kernel->block, blockSize*2);
+                ofx_allocate_aligned(kernel->addR, kernel->complexSize);
+                ofx_allocate_aligned(kernel->addI, kernel->complexSize);
+                ofx_allocate_aligned(kernel->overlap, blockSize);
+                ofx_allocate_aligned(kernel->tail, blockSize);
+                kernel->circularR = new float* [kernel->partitions];
+                kernel->circularI = new float* [kernel->partitions];
+                loaded = ( kernel->block != nullptr && kernel->addR != nullptr && kernel->addI != nullptr && kernel->overlap != nullptr && kernel->tail != nullptr );
+                for(int i=0; i<kernel->partitions; ++i){
+                        kernel->circularR[i] = nullptr;
+                        kernel->circularI[i] = nullptr;
+                        ofx_allocate_aligned(kernel->circularR[i], kernel->complexSize);
+                        ofx_allocate_aligned(kernel->circularI[i], kernel->complexSize);
+                        if(kernel->circularR[i]==nullptr || kernel->circularI[i]==nullptr){
+                                loaded = false;
+                        }else{
+                                ofx_Aeq_Zero(kernel->circularR[i], kernel->complexSize);
+                                ofx_Aeq_Zero(kernel->circularI[i], kernel->complexSize);
+                        }
+                }
+                if(loaded){
+                        ofx_Aeq_Zero(kernel->block, blockSize*2);
+                        ofx_Aeq_Zero(kernel->overlap, blockSize);
+                        ofx_Aeq_Zero(kernel->tail, blockSize);
+                        kernel->blockIndex = 0;
+                }
+        }
+
+        if(!loaded){
+                // the partially allocated kernel is replaced by a silent one
+                deleteKernel(kernel);
+                kernel = new Kernel();
+                kernel->silenceCount = 30000;
+                return kernel;
+        }
+
+        kernel->loaded = true;
+        return kernel;
+}
+
+
+void pdsp::FIRFilter::deleteKernel( Kernel* kernel ){
+
+        if(kernel == nullptr){
+                return;
+        }
+
+        if(kernel->line != nullptr){ ofx_deallocate_aligned(kernel->line); }
+        if(kernel->lanes != nullptr){ ofx_deallocate_aligned(kernel->lanes); }
+        if(kernel->block != nullptr){ ofx_deallocate_aligned(kernel->block); }
+        if(kernel->addR != nullptr){ ofx_deallocate_aligned(kernel->addR); }
+        if(kernel->addI != nullptr){ ofx_deallocate_aligned(kernel->addI); }
+        if(kernel->overlap != nullptr){ ofx_deallocate_aligned(kernel->overlap); }
+        if(kernel->tail != nullptr){ ofx_deallocate_aligned(kernel->tail); }
+
+        float** delayLines[2] = { kernel->circularR, kernel->circularI };
+        for(int d=0; d<2; ++d){
+                if(delayLines[d] != nullptr){
+                        for(int i=0; i<kernel->partitions; ++i){
+                                if(delayLines[d][i] != nullptr){ ofx_deallocate_aligned(delayLines[d][i]); }
+                        }
+                        delete[] delayLines[d];
+                }
+        }
+
+        delete kernel;
+}
+
+
+void pdsp::FIRFilter::swapKernel( Kernel* kernel ){
+
+        length = kernel->length;
+        direct = ( kernel->partitions == 0 );
+
+        kernels.post(kernel);
+}
+
+
+void pdsp::FIRFilter::deallocateKernels(){
+        kernels.clear();
+
+        if(fadeBuffer != nullptr){
+                ofx_deallocate_aligned(fadeBuffer);
+        }
+}
+
+
+void pdsp::FIRFilter::copyState( Kernel & to, const Kernel & from, int blockSize, int filled ) noexcept {
+
+        // the most recent input samples are at the end of the history
+        int copied = ( to.history < from.history ) ? to.history : from.history;
+        if(copied > 0){
+                std::memcpy( to.line + to.history - copied, from.line + from.history - copied, sizeof(float) * copied );
+        }
+
+        if(to.partitions == 0){
+                to.silenceCount = from.silenceCount;
+                return;
+        }
+
+        if(from.partitions > 0){
+                // the input spectra don't depend on the impulse response, the output of the old partitions fades out with the overlap
+                std::memcpy( to.block, from.block, sizeof(float) * filled );
+                int blocks = ( to.partitions < from.partitions ) ? to.partitions : from.partitions;
+                int t = to.blockIndex;
+                int f = from.blockIndex;
+                for(int i=0; i<blocks; ++i){
+                        std::memcpy( to.circularR[t], from.circularR[f], sizeof(float) * to.complexSize );
+                        std::memcpy( to.circularI[t], from.circularI[f], sizeof(float) * to.complexSize );
+                        t--; if(t<0){ t = to.partitions-1; }
+                        f--; if(f<0){ f = from.partitions-1; }
+                }
+                std::memcpy( to.overlap, from.overlap, sizeof(float) * blockSize );
+                std::memcpy( to.tail, from.tail, sizeof(float) * blockSize );
+        }else{
+                // the samples of the current block are still in the direct form history
+                int available = ( filled < from.history ) ? filled : from.history;
+                std::memcpy( to.block + filled - available, from.line + from.history - available, sizeof(float) * available );
+        }
+
+        to.silenceCount = from.silenceCount;
+}
+
+
+int pdsp::FIRFilter::settlingTime( const Kernel & to, const Kernel & from, int blockSize, int filled ) noexcept {
+
+        // samples after copyState() before the output of the new kernel doesn't depend on the missing or old state
+        // the direct form needs its whole history filled by real input
+        int samples = ( to.history > from.history ) ? to.history - from.history : 0;
+
+        if(to.partitions > 0){
+                // the missing input blocks have to enter the delay line, then the overlap copied from the old kernel is replaced at the next block end
+                int copied = 0;
+                if(from.partitions > 0){
+                        copied = ( to.partitions < from.partitions ) ? to.partitions : from.partitions;
+                }
+                int blockEnds = to.partitions - copied + 2;
+                int partitioned = ( blockSize - filled ) + ( blockEnds - 1 ) * blockSize;
+                if(partitioned > samples){ samples = partitioned; }
+        }
+
+        return samples;
+}
+
+
+void pdsp::FIRFilter::process (int bufferSize) noexcept {
+
+        int inputState;
+        const float* inputBuffer = processInput(input, inputState);
+
+        // swaps in the kernel prepared by the control thread when the last crossfade is over
+        // the new kernel copies the state of the current one, so it can't replace a kernel that is still settling
+        if( kernels.getFading() == nullptr && kernels.swap() ){
+                Kernel* incoming = kernels.getCurrent();
+                Kernel* replaced = kernels.getFading();
+                if(replaced != nullptr && replaced->loaded && incoming->loaded){
+                        copyState(*incoming, *replaced, blockSize, filled);
+                        // the old kernel plays alone until the new one has a complete state, then they are crossfaded for a block
+                        kernels.startCrossfade( blockSize, settlingTime(*incoming, *replaced, blockSize, filled) );
+                }else{
+                        kernels.retire();
+                }
+        }
+
+        Kernel* kernel = kernels.getCurrent();
+        Kernel* old = kernels.getFading();
+
+        bool audioRate = ( inputState == AudioRate );
+
+        if(kernel != nullptr && kernel->loaded){
+                if(audioRate){
+                        kernel->silenceCount = 0;
+                }else if(kernel->silenceCount <= kernel->length + blockSize*2){
+                        kernel->silenceCount += bufferSize;
+                }
+        }
+
+        // after enough silence all the delay lines are zero, so only the block position is updated
+        if( old == nullptr && ( kernel == nullptr || !kernel->loaded || kernel->silenceCount > kernel->length + blockSize*2 ) ){
+                setOutputToZero(output);
+                filled = ( filled + bufferSize ) % blockSize;
+                return;
+        }
+
+        float* outputBuffer = getOutputBufferToFill(output);
+
+        int n = 0;
+        while(n < bufferSize){
+                int chunk = blockSize - filled;
+                if(chunk > bufferSize - n){ chunk = bufferSize - n; }
+
+                processKernel(*kernel, fft, inputBuffer + n, audioRate, outputBuffer + n, chunk, blockSize, filled);
+                if(old != nullptr){
+                        processKernel(*old, fft, inputBuffer + n, audioRate, fadeBuffer + n, chunk, blockSize, filled);
+                }
+
+                filled += chunk;
+                if(filled == blockSize){ filled = 0; }
+                n += chunk;
+        }
+
+        if(old != nullptr){
+                kernels.crossfade(outputBuffer, fadeBuffer, bufferSize);
+                kernels.advance(bufferSize);
+                if(kernels.crossfadeOver()){
+                        // freed by the worker thread, if it hasn't freed the last retired kernels yet it's retired in the next buffers
+                        kernels.retire();
+                }
+        }
+}
+
+
+void pdsp::FIRFilter::processKernel( Kernel & kernel, FFTWorker & fft, const float* input, bool audioRate, float* output, int length, int blockSize, int filled ) noexcept {
+
+        processDirect(kernel, input, audioRate, output, length);
+
+        if(kernel.partitions > 0){
+                // the partitions output for this block has been computed at the end of the last one
+                const float* tail = kernel.tail + filled;
+                for(int n=0; n<length; ++n){
+                        output[n] += tail[n];
+                }
+
+                if(audioRate){
+                        std::memcpy( kernel.block + filled, input, sizeof(float) * length );
+                }else{
+                        std::memset( kernel.block + filled, 0, sizeof(float) * length );
+                }
+
+                if(filled + length == blockSize){
+                        processBlock(kernel, fft, blockSize);
+                }
+        }
+}
+
+
+void pdsp::FIRFilter::processDirect( Kernel & kernel, const float* input, bool audioRate, float* output, int length ) noexcept {
+
+        int history = kernel.history;
+        float* line = kernel.line;
+
+        if(audioRate){
+                std::memcpy( line + history, input, sizeof(float) * length );
+        }else{
+                std::memset( line + history, 0, sizeof(float) * length );
+        }
+
+        const ImpulseTaps & taps = *kernel.taps;
+        const float* h0 = taps.reversed(0);
+        const float* h1 = taps.reversed(1);
+        const float* h2 = taps.reversed(2);
+        const float* h3 = taps.reversed(3);
+        int padded = taps.paddedLength();
+        float* lanes = kernel.lanes;
+
+        // four outputs for each pass, the line is aligned at the first one and each copy of the taps is shifted for the next ones
+        int n = 0;
+        int maxSimd = ROUND_DOWN(length, 4);
+        for(; n<maxSimd; n+=4){
+                const float* x = line + n;
+                ofx::f128 acc0 = ofx::m_set1(0.0f);
+                ofx::f128 acc1 = ofx::m_set1(0.0f);
+                ofx::f128 acc2 = ofx::m_set1(0.0f);
+                ofx::f128 acc3 = ofx::m_set1(0.0f);
+                for(int i=0; i<padded; i+=4){
+                        ofx::f128 xv = ofx::m_load(x + i);
+                        acc0 = ofx::m_add(acc0, ofx::m_mul(xv, ofx::m_load(h0 + i)));
+                        acc1 = ofx::m_add(acc1, ofx::m_mul(xv, ofx::m_load(h1 + i)));
+                        acc2 = ofx::m_add(acc2, ofx::m_mul(xv, ofx::m_load(h2 + i)));
+                        acc3 = ofx::m_add(acc3, ofx::m_mul(xv, ofx::m_load(h3 + i)));
+                }
+                ofx::m_store(lanes,      acc0);
+                ofx::m_store(lanes + 4,  acc1);
+                ofx::m_store(lanes + 8,  acc2);
+                ofx::m_store(lanes + 12, acc3);
+                output[n]   = lanes[0]  + lanes[1]  + lanes[2]  + lanes[3];
+                output[n+1] = lanes[4]  + lanes[5]  + lanes[6]  + lanes[7];
+                output[n+2] = lanes[8]  + lanes[9]  + lanes[10] + lanes[11];
+                output[n+3] = lanes[12] + lanes[13] + lanes[14] + lanes[15];
+        }
+
+        int taps0 = taps.length();
+        for(; n<length; ++n){
+                const float* x = line + n;
+                float sum = 0.0f;
+                for(int j=0; j<taps0; ++j){
+                        sum += h0[j] * x[j];
+                }
+                output[n] = sum;
+        }
+
+        // keeps the last samples as history for the next chunk
+        std::memmove( line, line + length, sizeof(float) * history );
+}
+
+
+void pdsp::FIRFilter::processBlock( Kernel & kernel, FFTWorker & fft, int blockSize ) noexcept {
+
+        kernel.blockIndex++;
+        if(kernel.blockIndex >= kernel.partitions){ kernel.blockIndex = 0; }
+
+        // the second half of the block is always zero
+        fft.FFT(kernel.block, kernel.circularR[kernel.blockIndex], kernel.circularI[kernel.blockIndex]);
+
+        ofx_Aeq_Zero(kernel.addR, kernel.complexSize);
+        ofx_Aeq_Zero(kernel.addI, kernel.complexSize);
+
+        const ImpulseSpectra & spectra = *kernel.spectra;
+        int k = kernel.blockIndex;
+        for(int i=0; i<kernel.partitions; ++i){
+                vect_cmadd( kernel.addR, kernel.addI,
+                            spectra.real(0, i), spectra.imag(0, i),
+                            kernel.circularR[k], kernel.circularI[k],
+                            kernel.complexSize);
+                k--;
+                if(k<0){ k = kernel.partitions-1; }
+        }
+
+        fft.iFFT(kernel.block, kernel.addR, kernel.addI);
+
+        // the partitions start one block into the impulse response, so this is the output for the next block
+        ofx_Aeq_BaddC(kernel.tail, kernel.block, kernel.overlap, blockSize);
+        std::memcpy( kernel.overlap, kernel.block + blockSize, sizeof(float) * blockSize );
+
+        ofx_Aeq_Zero(kernel.block, blockSize*2);
+}
+
+
+double pdsp::FIRFilter::measure( Kernel & kernel, FFTWorker & fft, const float* input, float* output, int samples, int blockSize ){
+
+        double best = 1.0e9;
+        for(int run=0; run<3; ++run){
+                auto start = std::chrono::steady_clock::now();
+                for(int n=0; n<samples; n+=blockSize){
+                        processKernel(kernel, fft, input + n, true, output + n, blockSize, blockSize, 0);
+                }
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                if(elapsed.count() < best){ best = elapsed.count(); }
+        }
+        return best;
+}
+
+
+void pdsp::FIRFilter::calibrate(){
+
+        // impulse response lengths measured for each block size, as multiples of the block size
+        const float ratios[] = { 1.0f, 1.5f, 2.0f, 3.0f, 4.0f, 6.0f, 8.0f, 12.0f, 16.0f, 24.0f, 32.0f, 48.0f, 64.0f };
+        const int numRatios = sizeof(ratios) / sizeof(float);
+        const int maxTaps = 4096;
+        const int samples = 32768;
+
+        std::vector<float> signal( samples );
+        std::vector<float> outputs( samples );
+        std::vector<float> taps( maxTaps );
+        for(int n=0; n<samples; ++n){ signal[n] = (float) std::rand() / (float) RAND_MAX - 0.5f; }
+        for(int n=0; n<maxTaps; ++n){ taps[n] = (float) std::rand() / (float) RAND_MAX - 0.5f; }
+
+        for(int index=0; index<PDSP_FIRFILTER_CROSSOVERS; ++index){
+                int blockSize = 1 << (index + PDSP_FIRFILTER_MIN_BLOCK_LOG2);
+
+                FFTWorker fft;
+                fft.initFFT( blockSize*2 - 1 );
+
+                int crossover = 0;
+                for(int r=0; r<numRatios; ++r){
+                        int length = static_cast<int>( blockSize * ratios[r] );
+                        if(length > maxTaps){ break; }
+
+                        SampleBuffer impulse;
+                        impulse.load( taps.data(), 44100.0, length );
+
+                        Kernel* directKernel = createKernel( &impulse, 0, 44100.0, blockSize, DirectFIR, false );
+                        Kernel* hybridKernel = createKernel( &impulse, 0, 44100.0, blockSize, PartitionedFIR, false );
+
+                        bool directFaster = true;
+                        if(directKernel->loaded && hybridKernel->loaded && hybridKernel->partitions > 0){
+                                double directTime = measure( *directKernel, fft, signal.data(), outputs.data(), samples, blockSize );
+                                double hybridTime = measure( *hybridKernel, fft, signal.data(), outputs.data(), samples, blockSize );
+                                directFaster = directTime <= hybridTime;
+                        }
+
+                        deleteKernel( directKernel );
+                        deleteKernel( hybridKernel );
+
+                        if(!directFaster){ break; }
+                        crossover = length;
+                }
+
+                if(crossover < blockSize){ crossover = blockSize; }
+                crossovers[index] = crossover;
+        }
+}
@@ -0,0 +1,154 @@
+
+// FIRFilter.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_CONVOLUTION_FIRFILTER_H_INCLUDED
+#define PDSP_CONVOLUTION_FIRFILTER_H_INCLUDED
+
+#include "../pdspCore.h"
+#include "../helpers/FFTWorker.h"
+#include "../samplers/SampleBuffer.h"
+#include "SpectrumCache.h"
+#include "KernelSwap.h"
+#include <atomic>
+#include <memory>
+
+// block sizes of the crossover table, from 2^4 to 2^10 samples
+#define PDSP_FIRFILTER_MIN_BLOCK_LOG2 4
+#define PDSP_FIRFILTER_MAX_BLOCK_LOG2 10
+#define PDSP_FIRFILTER_CROSSOVERS (PDSP_FIRFILTER_MAX_BLOCK_LOG2 - PDSP_FIRFILTER_MIN_BLOCK_LOG2 + 1)
+
+namespace pdsp{
+/*!
+@brief Zero-latency convolution for short impulse responses, like cabinets, linear phase equalizers or HRTFs.
+
+Short impulse responses are convolved in direct form, computing four outputs at once with SIMD operations. Longer impulse responses use a hybrid form: the first block of taps is convolved in direct form and the rest with uniformly partitioned FFT convolution, with blocks as long as the audio buffer. By default the form is chosen comparing the impulse response length with a crossover for the block size, see calibrate(). The taps and the spectra are taken from the SpectrumCache and shared by all the FIRFilters with the same impulse response, so you can have hundreds of them, for example one for each voice or source. Each FIRFilter only allocates its delay lines. For long impulse responses use FDLConvolver.
+*/
+
+class FIRFilter : public Unit {
+
+public:
+        FIRFilter();
+        ~FIRFilter();
+
+        /*!
+        @brief Sets "signal" as selected input and returns this Unit ready to be patched. This is the default input. This input is the audio input of the filter.
+        */
+        Patchable& in_signal();
+
+        /*!
+        @brief Sets "signal" as selected output and returns this Unit ready to be patched. This is the default output. This is the filtered output.
+        */
+        Patchable& out_signal();
+
+        /*!
+        @brief Sets the impulse response of the filter. While playing the taps are prepared in the calling thread and swapped in by the audio thread at the start of the next buffer. The new impulse response starts from the delay lines of the old one, the old one keeps playing until the new one has a complete state and then they are crossfaded for a block, so there are no glitches.
+        @param[in] impulseResponse SampleBuffer to load as impulse response
+        @param[in] channel select the channel to be if the SampleBuffer has more than one. If omitted the first channel is selected.
+        */
+        void loadIR( SampleBuffer & impulseResponse, int channel=0 );
+
+        /*!
+        @brief Sets the form of the convolution. AutoFIR chooses the faster one using the crossovers (default), DirectFIR always uses the direct form and PartitionedFIR always uses the hybrid form. Changing it reloads the impulse response.
+        @param[in] mode AutoFIR, DirectFIR or PartitionedFIR
+        */
+        void setMode( FIRMode_t mode );
+
+        /*!
+        @brief returns true if the loaded impulse response is convolved in direct form. This method is thread-safe.
+        */
+        bool meter_direct() const;
+
+        /*!
+        @brief returns the length of the loaded impulse response in samples, after resampling and removing the silent tail
+        */
+        int getLength() const;
+
+        /*!
+        @brief measures the direct and the hybrid form on this machine for all the block sizes, and sets the crossovers to the measured ones. It takes some hundreds of milliseconds, call it once before loading the impulse responses, for example in your setup(). It is thread-safe but it doesn't change the forms of the impulse responses already loaded.
+        */
+        static void calibrate();
+
+        /*!
+        @brief sets the crossover for a block size, the impulse responses longer than the given taps use the hybrid form. The defaults have been measured on a x86 cpu with SSE. This method is thread-safe.
+        @param[in] blockSize block size, rounded down to a power of two between 16 and 1024
+        @param[in] taps impulse response length
+        */
+        static void setCrossover( int blockSize, int taps );
+
+        /*!
+        @brief returns the crossover for a block size. This method is thread-safe.
+        @param[in] blockSize block size, rounded down to a power of two between 16 and 1024
+        */
+        static int getCrossover( int blockSize );
+
+private:
+        void prepareUnit( int expectedBufferSize, double sampleRate ) override;
+        void releaseResources () override ;
+        void process (int bufferSize) noexcept override;
+
+        // the shared coefficients and the delay lines for an impulse response
+        struct Kernel {
+            std::shared_ptr<const ImpulseTaps>      taps;
+            std::shared_ptr<const ImpulseSpectra>   spectra;    // partitions after the first block, nullptr in direct form
+            int         length;
+            int         history;        // past samples needed by the direct form
+            int         partitions;
+            int         complexSize;
+            bool        loaded;
+
+            float*      line;           // history, then the samples of the current chunk
+            float*      lanes;          // sums of the four outputs
+
+            float*      block;          // input block, zero-padded to the FFT size
+            float**     circularR;
+            float**     circularI;
+            int         blockIndex;
+            float*      addR;
+            float*      addI;
+            float*      overlap;
+            float*      tail;           // output of the partitions for the current block
+
+            int         silenceCount;
+        };
+
+        // without the cache the coefficients are not shared, for calibrate()
+        static Kernel* createKernel( SampleBuffer* impulseResponse, int channel, double sampleRate, int blockSize, FIRMode_t mode, bool cached );
+        static void deleteKernel( Kernel* kernel );
+        static void processKernel( Kernel & kernel, FFTWorker & fft, const float* input, bool audioRate, float* output, int length, int blockSize, int filled ) noexcept;
+        static void processDirect( Kernel & kernel, const float* input, bool audioRate, float* output, int length ) noexcept;
+        static void processBlock( Kernel & kernel, FFTWorker & fft, int blockSize ) noexcept;
+        static void copyState( Kernel & to, const Kernel & from, int blockSize, int filled ) noexcept;
+        static int settlingTime( const Kernel & to, const Kernel & from, int blockSize, int filled ) noexcept;
+        static int blockSizeFor( int bufferSize );
+        static double measure( Kernel & kernel, FFTWorker & fft, const float* input, float* output, int samples, int blockSize );
+
+        void swapKernel( Kernel* kernel );
+        void deallocateKernels();
+
+        InputNode   input;
+        OutputNode  output;
+
+        SampleBuffer*   impulseResponse;
+        int             IRChannel;
+        FIRMode_t       mode;
+        double          sampleRate;
+        int             blockSize;
+        int             filled;             // samples of the current block
+        int             length;
+
+        FFTWorker       fft;
+
+        KernelSwap<Kernel>      kernels;
+        std::atomic<bool>       direct;
+
+        float*                  fadeBuffer;
+
+        static std::atomic<int> crossovers[PDSP_FIRFILTER_CROSSOVERS];
+
+};
+
+}//END NAMESPACE
+
+#endif  // PDSP_CONVOLUTION_FIRFILTER_H_INCLUDED
@@ -0,0 +1,87 @@
+
+#include "HRTFSet.h"
+#include "../helpers/MappedFile.h"
+#include <iostream>
+
+pdsp::HRTFSet::HRTFSet(){}
+
+void pdsp::HRTFSet::add( float azimuth, float elevation, const SampleBuffer & impulseResponse ){
+        if(impulseResponse.buffer == nullptr || impulseResponse.channels < 2){
+                std::cout<<"[pdsp] warning! HRTFSet needs a stereo impulse response for each direction, direction not added\n";
+                return;
+        }
+        add( azimuth, elevation, impulseResponse.buffer[0], impulseResponse.buffer[1], impulseResponse.length, impulseResponse.fileSampleRate );
+}
+
+void pdsp::HRTFSet::add( float azimuth, float elevation, const float* left, const float* right, int length, double sampleRate ){
+        if(left == nullptr || right == nullptr || length <= 0){
+                std::cout<<"[pdsp] warning! empty impulse response for HRTFSet, direction not added\n";
+                return;
+        }
+
+        std::vector<float> interleaved( length*2 );
+        for(int n=0; n<length; ++n){
+                interleaved[n*2]   = left[n];
+                interleaved[n*2+1] = right[n];
+        }
+
+        Direction direction;
+        direction.azimuth = azimuth;
+        direction.elevation = elevation;
+        direction.impulseResponse.reset( new SampleBuffer() );
+        direction.impulseResponse->load( interleaved.data(), sampleRate, length, 2 );
+
+        if(direction.impulseResponse->loaded()){
+                directions.push_back( std::move(direction) );
+        }
+}
+
+bool pdsp::HRTFSet::loadRaw( std::string path, int taps, double sampleRate ){
+
+        if(taps <= 0){
+                std::cout<<"[pdsp] warning! wrong taps number for HRTFSet::loadRaw()\n";
+                return false;
+        }
+
+        MappedFile file;
+        if(!file.open( path )){
+                std::cout<<"[pdsp] warning! impossible to read HRTF file "<<path<<"\n";
+                return false;
+        }
+
+        size_t record = sizeof(float) * (2 + taps*2);
+        if(file.size() % record != 0){
+                std::cout<<"[pdsp] warning! the size of "<<path<<" doesn't match "<<taps<<" taps for each impulse response\n";
+                return false;
+        }
+
+        // the mapping is page aligned, so the floats can be read in place
+        const float* data = reinterpret_cast<const float*>( file.data() );
+        size_t records = file.size() / record;
+        for(size_t i=0; i<records; ++i){
+                const float* r = data + i*(2 + taps*2);
+                add( r[0], r[1], r + 2, r + 2 + taps, taps, sampleRate );
+        }
+
+        return true;
+}
+
+void pdsp::HRTFSet::clear(){
+        directions.clear();
+}
+
+int pdsp::HRTFSet::size() const {
+        return (int) directions.size();
+}
+
+float pdsp::HRTFSet::getAzimuth( int index ) const {
+        return directions[index].azimuth;
+}
+
+float pdsp::HRTFSet::getElevation( int index ) const {
+        return directions[index].elevation;
+}
+
+const pdsp::SampleBuffer & pdsp::HRTFSet::getImpulseResponse( int index ) const {
+        return *directions[index].impulseResponse;
+}
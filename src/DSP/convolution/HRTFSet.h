@@ -0,0 +1,99 @@
+
+// HRTFSet.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_CONVOLUTION_HRTFSET_H_INCLUDED
+#define PDSP_CONVOLUTION_HRTFSET_H_INCLUDED
+
+#include "../samplers/SampleBuffer.h"
+#include <vector>
+#include <string>
+#include <memory>
+
+namespace pdsp{
+/*!
+@brief A set of head related impulse responses measured from many directions, to be loaded into a BinauralSpatializer.
+
+The directions are given in degrees as in the SOFA files: azimuth 0 is in front of the listener and 90 is on the left, elevation 90 is above. Each direction has a left and a right impulse response, they can be added from stereo SampleBuffers or from float arrays, or loaded all together from a raw float file, see loadRaw(). SOFA files are HDF5 containers and can't be read directly, export their SourcePosition and Data.IR to a raw float file. The set has to be valid while the spatializers are using it.
+*/
+
+class HRTFSet {
+
+public:
+        HRTFSet();
+        HRTFSet( const HRTFSet & other ) = delete;
+        HRTFSet& operator= ( const HRTFSet & other ) = delete;
+
+        /*!
+        @brief adds a direction with a stereo impulse response, the first channel is the left ear and the second channel the right ear. The data is copied.
+        @param[in] azimuth azimuth in degrees
+        @param[in] elevation elevation in degrees
+        @param[in] impulseResponse SampleBuffer with two channels
+        */
+        void add( float azimuth, float elevation, const SampleBuffer & impulseResponse );
+
+        /*!
+        @brief adds a direction with the given impulse responses. The data is copied.
+        @param[in] azimuth azimuth in degrees
+        @param[in] elevation elevation in degrees
+        @param[in] left impulse response of the left ear
+        @param[in] right impulse response of the right ear
+        @param[in] length length of each impulse response
+        @param[in] sampleRate sample rate of the impulse responses
+        */
+        void add( float azimuth, float elevation, const float* left, const float* right, int length, double sampleRate );
+
+        /*!
+        @brief loads all the directions from a file of 32 bit floats in the machine byte order. For each direction the file has the azimuth, the elevation, then the taps of the left ear and the taps of the right ear. Returns false if the file can't be read or its size doesn't match, the directions already added are kept.
+        @param[in] path path of the file
+        @param[in] taps length of each impulse response
+        @param[in] sampleRate sample rate of the impulse responses
+        */
+        bool loadRaw( std::string path, int taps, double sampleRate );
+
+        /*!
+        @brief removes all the directions
+        */
+        void clear();
+
+        /*!
+        @brief returns the number of directions
+        */
+        int size() const;
+
+        /*!
+        @brief returns the azimuth in degrees of the given direction
+        @param[in] index direction index
+        */
+        float getAzimuth( int index ) const;
+
+        /*!
+        @brief returns the elevation in degrees of the given direction
+        @param[in] index direction index
+        */
+        float getElevation( int index ) const;
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+        // stereo impulse response of the given direction
+        const SampleBuffer & getImpulseResponse( int index ) const;
+/*!
+    @endcond
+*/
+
+private:
+        struct Direction {
+            float azimuth;
+            float elevation;
+            std::unique_ptr<SampleBuffer> impulseResponse;
+        };
+
+        std::vector<Direction> directions;
+
+};
+
+}//END NAMESPACE
+
+#endif  // PDSP_CONVOLUTION_HRTFSET_H_INCLUDED
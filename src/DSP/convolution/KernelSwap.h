@@ -0,0 +1,280 @@
+// KernelSwap.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_CONVOLUTION_KERNELSWAP_H_INCLUDED
+#define PDSP_CONVOLUTION_KERNELSWAP_H_INCLUDED
+
+#include "TailWorker.h"
+#include <atomic>
+
+// kernels waiting to be freed by the worker thread after a swap
+#define PDSP_KERNELSWAP_RETIRED 4
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+
+namespace pdsp{
+
+// hot swap of the kernels of a convolver, used by FDLConvolver, MultiConvolver, FIRFilter and BinauralSpatializer
+// the control thread prepares a kernel and posts it, the audio thread swaps it in, crossfades from the replaced one and retires it
+// the retired kernels are freed by the TailWorker, so a posted kernel is always swapped in without other calls from the control thread
+// the audio thread owns current and fading, the worker thread can read them in the processTail() of the convolver
+template<typename Kernel>
+class KernelSwap : private TailProcessor {
+
+public:
+    typedef void (*Deleter)( Kernel* kernel );
+
+    KernelSwap( Deleter deleter );
+    ~KernelSwap();
+
+    KernelSwap( const KernelSwap & other ) = delete;
+    KernelSwap& operator= ( const KernelSwap & other ) = delete;
+
+    // control thread, while not playing: sets the current kernel, it has to be called after clear()
+    void set( Kernel* kernel );
+
+    // control thread, while playing: the kernel is swapped in by the audio thread, a kernel still waiting for the swap is deleted
+    void post( Kernel* kernel );
+
+    // control thread: deletes all the kernels, after this the worker thread doesn't access them anymore
+    void clear();
+
+    Kernel* getCurrent() const noexcept;
+    Kernel* getFading() const noexcept;
+
+    // audio thread: swaps in the posted kernel, the current one becomes the fading one and a kernel still fading is retired
+    // returns false if there is no posted kernel, or if the worker hasn't freed enough retired kernels yet, then it swaps in the next buffers
+    // after a swap retire() always succeeds, for replacing the current kernel without a crossfade
+    bool swap() noexcept;
+
+    // audio thread: retires the fading kernel, returns false if the worker hasn't freed a retired kernel yet, then retire it in the next buffers
+    bool retire() noexcept;
+
+    // audio thread: the output of the current kernel is silent for wait samples, then it fades in for length samples
+    void startCrossfade( int length, int wait=0 ) noexcept;
+
+    // audio thread: mixes the output of the current kernel in buffer with the output of the fading one, faded is nullptr if it's silent
+    // all the channels are mixed with the same gains, then the crossfade is advanced with advance()
+    void crossfade( float* buffer, const float* faded, int bufferSize ) const noexcept;
+    void advance( int bufferSize ) noexcept;
+    bool crossfadeOver() const noexcept;
+
+private:
+    bool processTail() noexcept override;
+    bool retireKernel( Kernel* kernel ) noexcept;
+    int freeSlots() const noexcept;
+
+    Deleter                 deleter;
+
+    std::atomic<Kernel*>    current;
+    std::atomic<Kernel*>    fading;
+    std::atomic<Kernel*>    next;
+    std::atomic<Kernel*>    retired [PDSP_KERNELSWAP_RETIRED];
+
+    int                     fadeIndex;
+    int                     fadeWait;
+    int                     fadeLength;
+
+    bool                    registered;
+};
+
+
+template<typename Kernel>
+KernelSwap<Kernel>::KernelSwap( Deleter deleter ){
+    this->deleter = deleter;
+    current = nullptr;
+    fading  = nullptr;
+    next    = nullptr;
+    for( int i=0; i<PDSP_KERNELSWAP_RETIRED; ++i ){
+        retired[i] = nullptr;
+    }
+    fadeIndex  = 0;
+    fadeWait   = 0;
+    fadeLength = 1;
+    registered = false;
+}
+
+template<typename Kernel>
+KernelSwap<Kernel>::~KernelSwap(){
+    clear();
+}
+
+template<typename Kernel>
+void KernelSwap<Kernel>::set( Kernel* kernel ){
+    current.store( kernel, std::memory_order_release );
+}
+
+template<typename Kernel>
+void KernelSwap<Kernel>::post( Kernel* kernel ){
+    // the worker thread frees the kernels retired by the audio thread
+    if( !registered ){
+        TailWorker::getInstance().add( this );
+        registered = true;
+    }
+
+    // a kernel still waiting for the swap was never used by the audio thread
+    Kernel* waiting = next.exchange( kernel, std::memory_order_acq_rel );
+    if( waiting != nullptr ){
+        deleter( waiting );
+    }
+}
+
+template<typename Kernel>
+void KernelSwap<Kernel>::clear(){
+    if( registered ){
+        TailWorker::getInstance().remove( this );
+        registered = false;
+    }
+
+    Kernel* kernels [3] = { current.exchange(nullptr), fading.exchange(nullptr), next.exchange(nullptr) };
+    for( Kernel* kernel : kernels ){
+        if( kernel != nullptr ){ deleter( kernel ); }
+    }
+    for( int i=0; i<PDSP_KERNELSWAP_RETIRED; ++i ){
+        Kernel* kernel = retired[i].exchange( nullptr );
+        if( kernel != nullptr ){ deleter( kernel ); }
+    }
+    fadeIndex  = 0;
+    fadeWait   = 0;
+    fadeLength = 1;
+}
+
+template<typename Kernel>
+Kernel* KernelSwap<Kernel>::getCurrent() const noexcept {
+    return current.load( std::memory_order_acquire );
+}
+
+template<typename Kernel>
+Kernel* KernelSwap<Kernel>::getFading() const noexcept {
+    return fading.load( std::memory_order_acquire );
+}
+
+template<typename Kernel>
+bool KernelSwap<Kernel>::swap() noexcept {
+    if( next.load(std::memory_order_acquire) == nullptr ){
+        return false;
+    }
+
+    // only the worker frees the slots, so they are still free when the kernels are retired
+    Kernel* old = fading.load( std::memory_order_relaxed );
+    int needed = ( old != nullptr ) ? 2 : 1;
+    if( freeSlots() < needed ){
+        return false;
+    }
+
+    // a new swap during the crossfade drops the oldest kernel
+    Kernel* replaced = current.load( std::memory_order_relaxed );
+    Kernel* incoming = next.exchange( nullptr, std::memory_order_acq_rel );
+    fading.store( replaced, std::memory_order_release );
+    current.store( incoming, std::memory_order_release );
+    retireKernel( old );
+
+    fadeIndex  = 0;
+    fadeWait   = 0;
+    fadeLength = 1;
+    return true;
+}
+
+template<typename Kernel>
+bool KernelSwap<Kernel>::retire() noexcept {
+    Kernel* old = fading.load( std::memory_order_relaxed );
+    if( old == nullptr ){
+        return true;
+    }
+    if( freeSlots() == 0 ){
+        return false;
+    }
+    // the worker is not using it after this
+    fading.store( nullptr, std::memory_order_release );
+    retireKernel( old );
+    return true;
+}
+
+template<typename Kernel>
+void KernelSwap<Kernel>::startCrossfade( int length, int wait ) noexcept {
+    fadeIndex  = 0;
+    fadeWait   = ( wait > 0 ) ? wait : 0;
+    fadeLength = ( length > 1 ) ? length : 1;
+}
+
+template<typename Kernel>
+void KernelSwap<Kernel>::crossfade( float* buffer, const float* faded, int bufferSize ) const noexcept {
+    float step = 1.0f / fadeLength;
+    int position = fadeIndex - fadeWait;
+    for( int n=0; n<bufferSize; ++n ){
+        float gain;
+        if( position < 0 ){
+            gain = 0.0f;
+        }else{
+            gain = ( position < fadeLength ) ? position * step : 1.0f;
+        }
+        float old = ( faded != nullptr ) ? faded[n] : 0.0f;
+        buffer[n] = buffer[n] * gain + old * ( 1.0f - gain );
+        position++;
+    }
+}
+
+template<typename Kernel>
+void KernelSwap<Kernel>::advance( int bufferSize ) noexcept {
+    if( !crossfadeOver() ){
+        fadeIndex += bufferSize;
+    }
+}
+
+template<typename Kernel>
+bool KernelSwap<Kernel>::crossfadeOver() const noexcept {
+    return fadeIndex >= fadeWait + fadeLength;
+}
+
+template<typename Kernel>
+bool KernelSwap<Kernel>::processTail() noexcept {
+    bool processed = false;
+
+    // the retired kernels are not used anymore by the audio thread
+    for( int i=0; i<PDSP_KERNELSWAP_RETIRED; ++i ){
+        Kernel* kernel = retired[i].load( std::memory_order_acquire );
+        if( kernel != nullptr ){
+            deleter( kernel );
+            retired[i].store( nullptr, std::memory_order_release );
+            processed = true;
+        }
+    }
+    return processed;
+}
+
+template<typename Kernel>
+bool KernelSwap<Kernel>::retireKernel( Kernel* kernel ) noexcept {
+    if( kernel == nullptr ){
+        return true;
+    }
+    for( int i=0; i<PDSP_KERNELSWAP_RETIRED; ++i ){
+        Kernel* expected = nullptr;
+        if( retired[i].compare_exchange_strong( expected, kernel, std::memory_order_acq_rel ) ){
+            TailWorker::getInstance().notify();
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename Kernel>
+int KernelSwap<Kernel>::freeSlots() const noexcept {
+    int free = 0;
+    for( int i=0; i<PDSP_KERNELSWAP_RETIRED; ++i ){
+        if( retired[i].load(std::memory_order_acquire) == nullptr ){
+            free++;
+        }
+    }
+    return free;
+}
+
+}//END NAMESPACE
+
+/*!
+    @endcond
+*/
+
+#endif  // PDSP_CONVOLUTION_KERNELSWAP_H_INCLUDED
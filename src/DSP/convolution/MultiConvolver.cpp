@@ -0,0 +1,377 @@
+#include "MultiConvolver.h"
+#include <cstring>
+
+static const char* multiConvolverTags[PDSP_MULTICONVOLVER_MAX_CHANNELS] = { "0", "1", "2", "3", "4", "5", "6", "7" };
+
+
+pdsp::MultiConvolver::MultiConvolver() : kernels( deleteKernel ){
+
+        for(int c=0; c<PDSP_MULTICONVOLVER_MAX_CHANNELS; ++c){
+                addInput(multiConvolverTags[c], inputs[c]);
+        }
+        for(int c=0; c<PDSP_MULTICONVOLVER_MAX_CHANNELS; ++c){
+                addOutput(multiConvolverTags[c], outputs[c]);
+        }
+        updateOutputNodes();
+
+        sampleRate = 44100.0;
+        expectedBufferSize = 0;
+        nonUniform = false;
+        backgroundTail = false;
+
+        for(int c=0; c<PDSP_MULTICONVOLVER_MAX_CHANNELS; ++c){
+                fadeBuffers[c] = nullptr;
+        }
+        crossfadeTime = 50.0f;
+        tailContinuation = false;
+
+        tailRegistered = false;
+        tailMisses = 0;
+
+        resize(1, 1);
+
+        if(dynamicConstruction){
+                prepareUnit(globalBufferSize, globalSampleRate);
+        }
+}
+
+pdsp::MultiConvolver::~MultiConvolver(){
+        deallocateKernels();
+}
+
+void pdsp::MultiConvolver::resize( int inputs, int outputs ){
+        if(inputs<1){ inputs = 1; }
+        if(inputs>PDSP_MULTICONVOLVER_MAX_CHANNELS){ inputs = PDSP_MULTICONVOLVER_MAX_CHANNELS; }
+        if(outputs<1){ outputs = 1; }
+        if(outputs>PDSP_MULTICONVOLVER_MAX_CHANNELS){ outputs = PDSP_MULTICONVOLVER_MAX_CHANNELS; }
+
+        inputsNumber = inputs;
+        outputsNumber = outputs;
+
+        for(int i=0; i<PDSP_MULTICONVOLVER_MAX_CHANNELS; ++i){
+                for(int o=0; o<PDSP_MULTICONVOLVER_MAX_CHANNELS; ++o){
+                        impulses[i][o] = nullptr;
+                        impulseChannels[i][o] = 0;
+                }
+        }
+
+        prepareIR();
+}
+
+pdsp::Patchable& pdsp::MultiConvolver::in_channel( int channel ){
+        if(channel<0){ channel = 0; }
+        if(channel>=PDSP_MULTICONVOLVER_MAX_CHANNELS){ channel = PDSP_MULTICONVOLVER_MAX_CHANNELS-1; }
+        return in(multiConvolverTags[channel]);
+}
+
+pdsp::Patchable& pdsp::MultiConvolver::out_channel( int channel ){
+        if(channel<0){ channel = 0; }
+        if(channel>=PDSP_MULTICONVOLVER_MAX_CHANNELS){ channel = PDSP_MULTICONVOLVER_MAX_CHANNELS-1; }
+        return out(multiConvolverTags[channel]);
+}
+
+void pdsp::MultiConvolver::loadIR( int input, int output, SampleBuffer & impulseResponse, int channel ){
+        setIR( input, output, impulseResponse, channel );
+        prepareIR();
+}
+
+void pdsp::MultiConvolver::setIR( int input, int output, SampleBuffer & impulseResponse, int channel ){
+        if(input<0 || input>=inputsNumber || output<0 || output>=outputsNumber){
+                std::cout<<"[pdsp] warning! MultiConvolver impulse response out of the "<<inputsNumber<<"x"<<outputsNumber<<" matrix, call resize() first\n";
+                pdsp_trace();
+                return;
+        }
+        impulses[input][output] = &impulseResponse;
+        impulseChannels[input][output] = channel;
+}
+
+void pdsp::MultiConvolver::prepareIR(){
+        if(dynamicConstruction){
+                swapKernel( createKernel() );
+        }
+}
+
+void pdsp::MultiConvolver::setNonUniform( bool active ){
+        if( active != nonUniform ){
+                nonUniform = active;
+                prepareIR();
+        }
+}
+
+void pdsp::MultiConvolver::setBackgroundTail( bool active ){
+        if( active != backgroundTail ){
+                backgroundTail = active;
+                prepareIR();
+        }
+}
+
+int pdsp::MultiConvolver::meter_tail_misses() const {
+        return tailMisses.load();
+}
+
+void pdsp::MultiConvolver::setCrossfadeTime( float timeMs ){
+        if(timeMs < 0.0f){ timeMs = 0.0f; }
+        crossfadeTime = timeMs;
+}
+
+void pdsp::MultiConvolver::setTailContinuation( bool active ){
+        tailContinuation = active;
+}
+
+int pdsp::MultiConvolver::getInputsNumber() const {
+        return inputsNumber;
+}
+
+int pdsp::MultiConvolver::getOutputsNumber() const {
+        return outputsNumber;
+}
+
+void pdsp::MultiConvolver::prepareUnit( int expectedBufferSize, double sampleRate ) {
+
+        deallocateKernels();
+
+        this->sampleRate = sampleRate;
+        this->expectedBufferSize = expectedBufferSize;
+
+        for(int c=0; c<PDSP_MULTICONVOLVER_MAX_CHANNELS; ++c){
+                ofx_allocate_aligned(fadeBuffers[c], expectedBufferSize);
+        }
+
+        // not playing, so the kernel is set directly
+        Kernel* kernel = createKernel();
+        if(kernel->levels.hasBackground()){
+                TailWorker::getInstance().add(this);
+                tailRegistered = true;
+        }
+        kernels.set(kernel);
+}
+
+void pdsp::MultiConvolver::releaseResources () {
+        deallocateKernels();
+}
+
+
+pdsp::MultiConvolver::Kernel* pdsp::MultiConvolver::createKernel(){
+
+        // value-initialized, the levels are empty
+        Kernel* kernel = new Kernel();
+        kernel->inputs = inputsNumber;
+        kernel->outputs = outputsNumber;
+        kernel->silenceCount = 30000;
+
+        if(expectedBufferSize<=0){
+                return kernel;
+        }
+
+        int maxLength = 0;
+        int lengths [PDSP_MULTICONVOLVER_MAX_CHANNELS][PDSP_MULTICONVOLVER_MAX_CHANNELS];
+        for(int i=0; i<inputsNumber; ++i){
+                for(int o=0; o<outputsNumber; ++o){
+                        lengths[i][o] = 0;
+                        if(impulses[i][o]!=nullptr){
+                                lengths[i][o] = impulseResponseLength( *impulses[i][o], impulseChannels[i][o], sampleRate );
+                                if(lengths[i][o] > maxLength){ maxLength = lengths[i][o]; }
+                        }
+                }
+        }
+        if(maxLength==0){
+                return kernel;
+        }
+
+        // all the pairs use the layout of the longest impulse response
+        std::vector<PartitionLayout> layout;
+        computePartitionLayout( layout, maxLength, expectedBufferSize, nonUniform );
+
+        bool loaded = kernel->levels.allocate( layout, inputsNumber, outputsNumber, expectedBufferSize, backgroundTail );
+        for(int i=0; i<inputsNumber && loaded; ++i){
+                for(int o=0; o<outputsNumber && loaded; ++o){
+                        if(lengths[i][o]==0){ continue; }
+                        // the spectra are resampled and transformed only if they are not cached
+                        std::shared_ptr<const ImpulseSpectra> spectra = SpectrumCache::get( *impulses[i][o], impulseChannels[i][o], sampleRate, layout );
+                        if(spectra!=nullptr){
+                                loaded = kernel->levels.load( i, o, *spectra );
+                        }
+                }
+        }
+
+        if(!loaded){
+                // the partially allocated kernel is replaced by a silent one
+                deleteKernel(kernel);
+                kernel = new Kernel();
+                kernel->inputs = inputsNumber;
+                kernel->outputs = outputsNumber;
+                kernel->silenceCount = 30000;
+                return kernel;
+        }
+
+        kernel->loaded = true;
+        kernel->silenceLimit = kernel->levels.silenceLimit();
+        kernel->silenceCount = kernel->silenceLimit + 1;
+        return kernel;
+}
+
+
+void pdsp::MultiConvolver::deleteKernel( Kernel* kernel ){
+        delete kernel;
+}
+
+
+void pdsp::MultiConvolver::swapKernel( Kernel* kernel ){
+
+        // the background tails of the new kernel are processed by the worker thread
+        if(kernel->levels.hasBackground() && !tailRegistered){
+                TailWorker::getInstance().add(this);
+                tailRegistered = true;
+        }
+
+        kernels.post(kernel);
+}
+
+
+void pdsp::MultiConvolver::deallocateKernels(){
+
+        // after this the worker thread doesn't access the kernels anymore
+        if(tailRegistered){
+                TailWorker::getInstance().remove(this);
+                tailRegistered = false;
+        }
+
+        kernels.clear();
+
+        for(int c=0; c<PDSP_MULTICONVOLVER_MAX_CHANNELS; ++c){
+                if(fadeBuffers[c] != nullptr){
+                        ofx_deallocate_aligned(fadeBuffers[c]);
+                }
+        }
+}
+
+
+void pdsp::MultiConvolver::process (int bufferSize) noexcept {
+
+        // swaps in the kernel prepared by the control thread
+        if(kernels.swap()){
+                kernels.startCrossfade( static_cast<int>( crossfadeTime.load() * 0.001 * sampleRate ) );
+        }
+
+        Kernel* kernel = kernels.getCurrent();
+        Kernel* old = kernels.getFading();
+
+        if(kernel == nullptr){
+                for(int o=0; o<PDSP_MULTICONVOLVER_MAX_CHANNELS; ++o){
+                        setOutputToZero(outputs[o]);
+                }
+                return;
+        }
+
+        // the kernels can have a different number of channels after resize(), the silent inputs are nullptr
+        int inputsUsed = kernel->inputs;
+        int outputsUsed = kernel->outputs;
+        if(old != nullptr){
+                if(old->inputs > inputsUsed){ inputsUsed = old->inputs; }
+                if(old->outputs > outputsUsed){ outputsUsed = old->outputs; }
+        }
+
+        const float* inputBuffers [PDSP_MULTICONVOLVER_MAX_CHANNELS];
+        bool anyInput = false;
+        for(int i=0; i<inputsUsed; ++i){
+                int inputState;
+                inputBuffers[i] = processInput(inputs[i], inputState);
+                if(inputState==AudioRate){
+                        anyInput = true;
+                }else{
+                        inputBuffers[i] = nullptr;
+                }
+        }
+
+        if(old == nullptr){
+                if( isActive(*kernel, anyInput) ){
+                        float* outputBuffers [PDSP_MULTICONVOLVER_MAX_CHANNELS];
+                        for(int o=0; o<kernel->outputs; ++o){
+                                outputBuffers[o] = getOutputBufferToFill(outputs[o]);
+                        }
+                        for(int o=kernel->outputs; o<PDSP_MULTICONVOLVER_MAX_CHANNELS; ++o){
+                                setOutputToZero(outputs[o]);
+                        }
+                        processKernel(*kernel, inputBuffers, anyInput, outputBuffers, bufferSize);
+                }else{
+                        for(int o=0; o<PDSP_MULTICONVOLVER_MAX_CHANNELS; ++o){
+                                setOutputToZero(outputs[o]);
+                        }
+                }
+                return;
+        }
+
+        // both the kernels are processed until the crossfade or the old tail is over
+        float* outputBuffers [PDSP_MULTICONVOLVER_MAX_CHANNELS];
+        for(int o=0; o<outputsUsed; ++o){
+                outputBuffers[o] = getOutputBufferToFill(outputs[o]);
+                ofx_Aeq_Zero(outputBuffers[o], bufferSize);
+        }
+        for(int o=outputsUsed; o<PDSP_MULTICONVOLVER_MAX_CHANNELS; ++o){
+                setOutputToZero(outputs[o]);
+        }
+        if( isActive(*kernel, anyInput) ){
+                processKernel(*kernel, inputBuffers, anyInput, outputBuffers, bufferSize);
+        }
+
+        bool finished;
+        if(tailContinuation.load(std::memory_order_relaxed)){
+                // the old kernel doesn't get the input anymore, its tail is added until it's silent
+                finished = !isActive(*old, false);
+                if(!finished){
+                        const float* silence [PDSP_MULTICONVOLVER_MAX_CHANNELS] = { nullptr };
+                        processKernel(*old, silence, false, fadeBuffers, bufferSize);
+                        for(int o=0; o<old->outputs; ++o){
+                                ofx_Aeq_BaddC(outputBuffers[o], outputBuffers[o], fadeBuffers[o], bufferSize);
+                        }
+                }
+        }else{
+                finished = kernels.crossfadeOver();
+                if(!finished){
+                        bool active = isActive(*old, anyInput);
+                        if(active){
+                                processKernel(*old, inputBuffers, anyInput, fadeBuffers, bufferSize);
+                        }
+                        for(int o=0; o<outputsUsed; ++o){
+                                const float* fadeBuffer = (active && o < old->outputs) ? fadeBuffers[o] : nullptr;
+                                kernels.crossfade(outputBuffers[o], fadeBuffer, bufferSize);
+                        }
+                        kernels.advance(bufferSize);
+                }
+        }
+
+        if(finished){
+                // if the worker hasn't freed the last retired kernels yet, it's retired in the next buffers
+                kernels.retire();
+        }
+}
+
+
+bool pdsp::MultiConvolver::isActive( const Kernel & kernel, bool anyInput ) const noexcept {
+        return kernel.loaded && ( anyInput || kernel.silenceCount <= kernel.silenceLimit );
+}
+
+
+void pdsp::MultiConvolver::processKernel( Kernel & kernel, const float* const* inputBuffers, bool anyInput, float* const* outputBuffers, int bufferSize ) noexcept {
+        if(anyInput){
+                kernel.silenceCount = 0;
+        }else{
+                kernel.silenceCount++;
+        }
+        kernel.levels.process(inputBuffers, outputBuffers, bufferSize, tailMisses);
+}
+
+
+bool pdsp::MultiConvolver::processTail() noexcept {
+        bool processed = false;
+
+        Kernel* kernel = kernels.getCurrent();
+        if(kernel != nullptr){
+                processed = kernel->levels.processTail() || processed;
+        }
+        kernel = kernels.getFading();
+        if(kernel != nullptr){
+                processed = kernel->levels.processTail() || processed;
+        }
+        return processed;
+}
@@ -0,0 +1,167 @@
+
+// MultiConvolver.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_CONVOLUTION_MULTICONVOLVER_H_INCLUDED
+#define PDSP_CONVOLUTION_MULTICONVOLVER_H_INCLUDED
+
+#include "../pdspCore.h"
+#include "../helpers/FFTWorker.h"
+#include "../samplers/SampleBuffer.h"
+#include "TailWorker.h"
+#include "KernelSwap.h"
+#include "PartitionLayout.h"
+#include "PartitionLevels.h"
+#include "SpectrumCache.h"
+#include <atomic>
+
+#define PDSP_MULTICONVOLVER_MAX_CHANNELS PDSP_CONVOLUTION_MAX_CHANNELS
+
+namespace pdsp{
+/*!
+
+@brief Convolves many inputs with a matrix of impulse responses, each output is the sum of the convolutions of all the inputs.
+
+Each input is transformed just once into a frequency-domain delay line shared by all its impulse responses, so for example a true stereo reverb with 4 impulse responses takes half the forward FFTs of 4 FDLConvolvers. The partitioning is the same of FDLConvolver, with the same options. It has up to 8 inputs and 8 outputs.
+*/
+
+class MultiConvolver : public Unit, private TailProcessor {
+
+public:
+        MultiConvolver();
+        ~MultiConvolver();
+
+        /*!
+        @brief Sets the number of inputs and outputs and clears all the impulse responses. The default is 1 input and 1 output.
+        @param[in] inputs number of inputs, from 1 to 8
+        @param[in] outputs number of outputs, from 1 to 8
+        */
+        void resize( int inputs, int outputs );
+
+        /*!
+        @brief Sets the given input as selected input and returns this Unit ready to be patched. The first input is the default input.
+        @param[in] channel index of the input
+        */
+        Patchable& in_channel( int channel );
+
+        /*!
+        @brief Sets the given output as selected output and returns this Unit ready to be patched. The first output is the default output.
+        @param[in] channel index of the output
+        */
+        Patchable& out_channel( int channel );
+
+        /*!
+        @brief Sets the impulse response for convolving the given input into the given output. The input-output pairs without an impulse response are not processed. While playing all the impulse responses are prepared in the calling thread and swapped in by the audio thread, to change many of them use setIR() and prepareIR().
+        @param[in] input index of the input
+        @param[in] output index of the output
+        @param[in] impulseResponse SampleBuffer to load as Impulse Response for the convolution. It has to be valid until the next resize().
+        @param[in] channel select the channel to be if the SampleBuffer has more than one. If omitted the first channel is selected.
+        */
+        void loadIR( int input, int output, SampleBuffer & impulseResponse, int channel=0 );
+
+        /*!
+        @brief Sets the impulse response for convolving the given input into the given output as loadIR(), but without preparing it. Call prepareIR() after setting all the impulse responses, so they are prepared just once.
+        @param[in] input index of the input
+        @param[in] output index of the output
+        @param[in] impulseResponse SampleBuffer to load as Impulse Response for the convolution. It has to be valid until the next resize().
+        @param[in] channel select the channel to be if the SampleBuffer has more than one. If omitted the first channel is selected.
+        */
+        void setIR( int input, int output, SampleBuffer & impulseResponse, int channel=0 );
+
+        /*!
+        @brief Prepares the impulse responses set with setIR(). While playing they are prepared in the calling thread and swapped in by the audio thread without glitches, see setCrossfadeTime() and setTailContinuation().
+        */
+        void prepareIR();
+
+        /*!
+        @brief Activates or deactivates the non-uniform partitioning, as in FDLConvolver. Changing the partitioning reloads the impulse responses.
+        @param[in] active true for non-uniform partitions, false for uniform partitions (default)
+        */
+        void setNonUniform( bool active );
+
+        /*!
+        @brief Activates or deactivates the background processing of the tail, as in FDLConvolver. Changing it reloads the impulse responses.
+        @param[in] active true for background processing, false for processing everything in the audio thread (default)
+        */
+        void setBackgroundTail( bool active );
+
+        /*!
+        @brief returns the number of tail partitions that the worker thread didn't finish in time, and were lost. This method is thread-safe.
+        */
+        int meter_tail_misses() const;
+
+        /*!
+        @brief Sets the crossfade time from the old impulse responses to the new ones, when they are changed while playing, as in FDLConvolver. The default is 50 ms.
+        @param[in] timeMs crossfade time in milliseconds
+        */
+        void setCrossfadeTime( float timeMs );
+
+        /*!
+        @brief Activates or deactivates the tail continuation, as in FDLConvolver. When active, after changing the impulse responses while playing the old ones stop receiving the input and their tails ring out, instead of being crossfaded.
+        @param[in] active true for tail continuation, false for crossfading (default)
+        */
+        void setTailContinuation( bool active );
+
+        /*!
+        @brief returns the number of inputs.
+        */
+        int getInputsNumber() const;
+
+        /*!
+        @brief returns the number of outputs.
+        */
+        int getOutputsNumber() const;
+
+private:
+        // all the buffers for convolving with the impulse responses, prepared outside of the audio thread and swapped in
+        struct Kernel {
+                bool loaded;
+                int inputs;
+                int outputs;
+                int silenceCount;
+                int silenceLimit;
+                PartitionLevels levels;
+        };
+
+        void prepareUnit( int expectedBufferSize, double sampleRate ) override;
+        void releaseResources () override ;
+        void process (int bufferSize) noexcept override;
+
+        Kernel* createKernel();
+        static void deleteKernel( Kernel* kernel );
+        void swapKernel( Kernel* kernel );
+        void deallocateKernels();
+
+        bool isActive( const Kernel & kernel, bool anyInput ) const noexcept;
+        void processKernel( Kernel & kernel, const float* const* inputBuffers, bool anyInput, float* const* outputBuffers, int bufferSize ) noexcept;
+        bool processTail() noexcept override;
+
+        InputNode  inputs  [PDSP_MULTICONVOLVER_MAX_CHANNELS];
+        OutputNode outputs [PDSP_MULTICONVOLVER_MAX_CHANNELS];
+        int inputsNumber;
+        int outputsNumber;
+
+        SampleBuffer*   impulses [PDSP_MULTICONVOLVER_MAX_CHANNELS][PDSP_MULTICONVOLVER_MAX_CHANNELS];
+        int             impulseChannels [PDSP_MULTICONVOLVER_MAX_CHANNELS][PDSP_MULTICONVOLVER_MAX_CHANNELS];
+        double          sampleRate;
+        int             expectedBufferSize;
+        bool            nonUniform;
+        bool            backgroundTail;
+
+        KernelSwap<Kernel>      kernels;
+        float*                  fadeBuffers [PDSP_MULTICONVOLVER_MAX_CHANNELS];
+        std::atomic<float>      crossfadeTime;
+        std::atomic<bool>       tailContinuation;
+
+        bool            tailRegistered;
+        std::atomic<int> tailMisses;
+
+};
+
+
+}//END NAMESPACE
+
+
+
+#endif  // PDSP_CONVOLUTION_MULTICONVOLVER_H_INCLUDED
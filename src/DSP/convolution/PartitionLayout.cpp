@@ -0,0 +1,102 @@
+
+#include "PartitionLayout.h"
+#include "../pdspCore.h"
+#include <new>
+
+void pdsp::computePartitionLayout( std::vector<PartitionLayout> & layout, int length, int bufferSize, bool nonUniform ){
+
+    layout.clear();
+    
+    PartitionLayout level;
+    level.size = bufferSize;
+    level.offset = 0;
+    
+    if(!nonUniform){
+        level.partitions = (length + bufferSize - 1) / bufferSize;
+        if(level.partitions<1){ level.partitions = 1; }
+        layout.push_back(level);
+        return;
+    }
+    
+    int remaining = length;
+    do{
+        bool last = ( level.size*2 > PDSP_CONVOLUTION_MAX_PARTITION ) || ( remaining <= level.size * PDSP_CONVOLUTION_LEVEL_PARTITIONS * 2 );
+        level.partitions = last ? (remaining + level.size - 1) / level.size : PDSP_CONVOLUTION_LEVEL_PARTITIONS;
+        if(level.partitions<1){ level.partitions = 1; }
+        layout.push_back(level);
+        
+        level.offset += level.partitions * level.size;
+        remaining -= level.partitions * level.size;
+        level.size *= 2;
+    }while(remaining>0);
+}
+
+// length of the impulse response without the silent tail
+static int trimmedImpulseLength( const pdsp::SampleBuffer & impulseResponse, int channel ){
+    if(impulseResponse.buffer==nullptr || channel<0 || channel>=impulseResponse.channels){
+        return 0;
+    }
+    const float* source = impulseResponse.buffer[channel];
+    int impulseLength = impulseResponse.length;
+    while(impulseLength>0 && (source[impulseLength-1] == 0.0f )){
+        impulseLength--;
+    }
+    return impulseLength;
+}
+
+int pdsp::impulseResponseLength( const SampleBuffer & impulseResponse, int channel, double sampleRate ){
+    int impulseLength = trimmedImpulseLength( impulseResponse, channel );
+    if(impulseLength>0 && sampleRate!=impulseResponse.fileSampleRate){
+        float inc = impulseResponse.fileSampleRate / sampleRate;
+        return static_cast<int>( static_cast<float>(impulseLength) / inc ) + 1;
+    }
+    return impulseLength;
+}
+
+float* pdsp::convertImpulseResponse( const SampleBuffer & impulseResponse, int channel, double sampleRate, int & length ){
+
+    length = 0;
+    if(impulseResponse.buffer==nullptr || channel<0 || channel>=impulseResponse.channels){
+        return nullptr;
+    }
+    const float* source = impulseResponse.buffer[channel];
+
+    //cut out zeroes from tail
+    int impulseLength = trimmedImpulseLength( impulseResponse, channel );
+    length = impulseResponseLength( impulseResponse, channel, sampleRate );
+    float inc = impulseResponse.fileSampleRate / sampleRate;
+
+    float* converted;
+    try
+    {
+        converted = new float[length > 0 ? length : 1];
+    }
+    catch (std::bad_alloc& ba)
+    {
+        length = 0;
+        return nullptr;
+    }
+    
+    //load the IR from the wave buffer, resampling it if needed
+    if(sampleRate!=impulseResponse.fileSampleRate){
+        float index = 0.0f;
+        for(int n=0; n<length; ++n){
+            int index_int = static_cast<int> (index);
+            if(index_int < impulseLength){ //check if we are after the IR length
+                float mu = index - index_int;
+                float x1 = source[index_int];
+                float x2 = (index_int+1 < impulseLength) ? source[index_int+1] : 0.0f;
+                converted[n] = interpolate_smooth( x1, x2, mu );
+            }else{
+                converted[n] = 0.0f;
+            }
+            index = (index + inc);
+        }
+    }else{
+        for(int n=0; n<length; ++n){
+            converted[n] = source[n];
+        }
+    }
+    
+    return converted;
+}
@@ -0,0 +1,50 @@
+
+// PartitionLayout.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_CONVOLUTION_PARTITIONLAYOUT_H_INCLUDED
+#define PDSP_CONVOLUTION_PARTITIONLAYOUT_H_INCLUDED
+
+#include <vector>
+#include "../samplers/SampleBuffer.h"
+
+// non-uniform partitioning: partitions for each level before doubling, and max partition size
+#define PDSP_CONVOLUTION_LEVEL_PARTITIONS 2
+#define PDSP_CONVOLUTION_MAX_PARTITION 8192
+// min buffers between the completion of a partition block and its output, for processing it in background
+#define PDSP_CONVOLUTION_BACKGROUND_BUFFERS 4
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+
+namespace pdsp{
+
+// a level of partitions of the same size, starting at offset samples into the impulse response
+struct PartitionLayout {
+    int size;
+    int partitions;
+    int offset;
+};
+
+// computes the levels for an impulse response of the given length
+// with non-uniform partitions the first level has partitions as long as the buffer and the next ones double their length,
+// each level starts at least one partition minus one buffer into the IR, so its output is ready when its input block is complete
+// with uniform partitions there is a single level of partitions as long as the buffer
+void computePartitionLayout( std::vector<PartitionLayout> & layout, int length, int bufferSize, bool nonUniform );
+
+// returns the length of the impulse response after convertImpulseResponse(), without converting it
+int impulseResponseLength( const SampleBuffer & impulseResponse, int channel, double sampleRate );
+
+// returns a new array with the impulse response without the silent tail and resampled to the given sample rate, or nullptr
+// the caller has to delete[] it
+float* convertImpulseResponse( const SampleBuffer & impulseResponse, int channel, double sampleRate, int & length );
+
+}//END NAMESPACE
+
+/*!
+    @endcond
+*/
+
+#endif  // PDSP_CONVOLUTION_PARTITIONLAYOUT_H_INCLUDED
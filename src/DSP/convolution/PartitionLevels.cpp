@@ -0,0 +1,421 @@
+#include "PartitionLevels.h"
+#include "TailWorker.h"
+#include <cstring>
+
+
+pdsp::PartitionLevels::PartitionLevels(){
+        levels = nullptr;
+        numLevels = 0;
+        inputs = 0;
+        outputs = 0;
+        bufferSize = 0;
+        background = false;
+
+        for(int c=0; c<PDSP_CONVOLUTION_MAX_CHANNELS; ++c){
+                rings[c] = nullptr;
+        }
+        ringSize = 0;
+        ringIndex = 0;
+        limit = 0;
+}
+
+pdsp::PartitionLevels::~PartitionLevels(){
+        deallocate();
+}
+
+
+bool pdsp::PartitionLevels::allocate( const std::vector<PartitionLayout> & layout, int inputs, int outputs, int bufferSize, bool backgroundTail ){
+
+        deallocate();
+
+        this->inputs = inputs;
+        this->outputs = outputs;
+        this->bufferSize = bufferSize;
+        background = false;
+
+        // value-initialized, all the buffers are nullptr and all the jobs are free
+        numLevels = layout.size();
+        levels = new Level [numLevels]();
+
+        int maxSize = bufferSize;
+        int end = 0;
+        ringSize = 0;
+        for(int l=0; l<numLevels; ++l){
+                Level & level = levels[l];
+                level.size = layout[l].size;
+                level.partitions = layout[l].partitions;
+                level.offset = layout[l].offset;
+                level.filled = 0;
+                level.index = 0;
+
+                level.fftWorker.initFFT( level.size*2 - 1 ); // fft block of at least two partitions
+                int signalSize = level.fftWorker.getFFTBlockSize();
+                level.complexSize = level.fftWorker.getFFTComplexSize();
+
+                ofx_allocate_aligned(level.padded, signalSize);
+                ofx_allocate_aligned(level.addR, level.complexSize);
+                ofx_allocate_aligned(level.addI, level.complexSize);
+                if(level.padded==nullptr || level.addR==nullptr || level.addI==nullptr){
+                        return false;
+                }
+
+                // the output of a level is due (offset - size + buffer) samples after its input block is complete
+                int slack = (level.offset - level.size) / bufferSize + 1;
+                level.background = backgroundTail && slack >= PDSP_CONVOLUTION_BACKGROUND_BUFFERS;
+                background = background || level.background;
+
+                for(int i=0; i<inputs; ++i){
+                        ofx_allocate_aligned(level.blocks[i], level.size);
+                        if(level.blocks[i]==nullptr){
+                                return false;
+                        }
+                        ofx_Aeq_Zero(level.blocks[i], level.size);
+
+                        if(level.background){
+                                ofx_allocate_aligned(level.jobInputs[i], level.size);
+                                if(level.jobInputs[i]==nullptr){
+                                        return false;
+                                }
+                        }
+
+                        level.circularR[i] = new float* [level.partitions]();
+                        level.circularI[i] = new float* [level.partitions]();
+                        for(int p=0; p<level.partitions; ++p){
+                                ofx_allocate_aligned(level.circularR[i][p], level.complexSize);
+                                ofx_allocate_aligned(level.circularI[i][p], level.complexSize);
+                                if(level.circularR[i][p]==nullptr || level.circularI[i][p]==nullptr){
+                                        return false;
+                                }
+                                // the delay line starts from silence
+                                ofx_Aeq_Zero(level.circularR[i][p], level.complexSize);
+                                ofx_Aeq_Zero(level.circularI[i][p], level.complexSize);
+                        }
+                }
+
+                for(int o=0; o<outputs; ++o){
+                        ofx_allocate_aligned(level.results[o], signalSize);
+                        if(level.results[o]==nullptr){
+                                return false;
+                        }
+                        ofx_Aeq_Zero(level.results[o], signalSize);
+                }
+
+                // the output of a level is added to the ring from (offset - size + buffer) to (offset + size + buffer)
+                if(level.offset + level.size + bufferSize > ringSize){
+                        ringSize = level.offset + level.size + bufferSize;
+                }
+                if(level.size > maxSize){ maxSize = level.size; }
+                end = level.offset + level.partitions * level.size;
+        }
+
+        for(int o=0; o<outputs; ++o){
+                ofx_allocate_aligned(rings[o], ringSize);
+                if(rings[o]==nullptr){
+                        return false;
+                }
+                ofx_Aeq_Zero(rings[o], ringSize);
+        }
+        ringIndex = 0;
+
+        // after this many silent buffers all the delay lines and the rings are empty
+        limit = ( ringSize + end + 2*maxSize ) / bufferSize + 4;
+
+        return true;
+}
+
+
+bool pdsp::PartitionLevels::load( int input, int output, const ImpulseSpectra & spectra ){
+
+        if(input<0 || input>=inputs || output<0 || output>=outputs || spectra.levels() != numLevels){
+                return false;
+        }
+
+        for(int l=0; l<numLevels; ++l){
+                Level & level = levels[l];
+                if(spectra.complexSize(l) != level.complexSize){
+                        return false;
+                }
+
+                // only the partitions inside the impulse response are allocated and processed
+                int partitions = spectra.partitions(l);
+                if(partitions > level.partitions){ partitions = level.partitions; }
+                if(partitions <= 0 || level.impulseR[input][output] != nullptr){ continue; }
+
+                level.impulseR[input][output] = new float* [partitions]();
+                level.impulseI[input][output] = new float* [partitions]();
+                level.impulsePartitions[input][output] = partitions;
+                for(int p=0; p<partitions; ++p){
+                        ofx_allocate_aligned(level.impulseR[input][output][p], level.complexSize);
+                        ofx_allocate_aligned(level.impulseI[input][output][p], level.complexSize);
+                        if(level.impulseR[input][output][p]==nullptr || level.impulseI[input][output][p]==nullptr){
+                                return false;
+                        }
+                        std::memcpy( level.impulseR[input][output][p], spectra.real(l, p), level.complexSize*sizeof(float) );
+                        std::memcpy( level.impulseI[input][output][p], spectra.imag(l, p), level.complexSize*sizeof(float) );
+                }
+        }
+
+        return true;
+}
+
+
+bool pdsp::PartitionLevels::hasBackground() const {
+        return background;
+}
+
+
+int pdsp::PartitionLevels::silenceLimit() const {
+        return limit;
+}
+
+
+void pdsp::PartitionLevels::deallocate(){
+
+        if(levels != nullptr){
+                for(int l=0; l<numLevels; ++l){
+                        Level & level = levels[l];
+                        if(level.padded != nullptr){ ofx_deallocate_aligned(level.padded); }
+                        if(level.addR != nullptr){ ofx_deallocate_aligned(level.addR); }
+                        if(level.addI != nullptr){ ofx_deallocate_aligned(level.addI); }
+
+                        for(int c=0; c<PDSP_CONVOLUTION_MAX_CHANNELS; ++c){
+                                if(level.blocks[c] != nullptr){ ofx_deallocate_aligned(level.blocks[c]); }
+                                if(level.results[c] != nullptr){ ofx_deallocate_aligned(level.results[c]); }
+                                if(level.jobInputs[c] != nullptr){ ofx_deallocate_aligned(level.jobInputs[c]); }
+
+                                float** delayLines[2] = { level.circularR[c], level.circularI[c] };
+                                for(int d=0; d<2; ++d){
+                                        if(delayLines[d] != nullptr){
+                                                for(int p=0; p<level.partitions; ++p){
+                                                        if(delayLines[d][p] != nullptr){ ofx_deallocate_aligned(delayLines[d][p]); }
+                                                }
+                                                delete[] delayLines[d];
+                                        }
+                                }
+
+                                for(int o=0; o<PDSP_CONVOLUTION_MAX_CHANNELS; ++o){
+                                        float** impulseLines[2] = { level.impulseR[c][o], level.impulseI[c][o] };
+                                        for(int d=0; d<2; ++d){
+                                                if(impulseLines[d] != nullptr){
+                                                        for(int p=0; p<level.impulsePartitions[c][o]; ++p){
+                                                                if(impulseLines[d][p] != nullptr){ ofx_deallocate_aligned(impulseLines[d][p]); }
+                                                        }
+                                                        delete[] impulseLines[d];
+                                                }
+                                        }
+                                }
+                        }
+                }
+                delete[] levels;
+                levels = nullptr;
+        }
+        numLevels = 0;
+
+        for(int c=0; c<PDSP_CONVOLUTION_MAX_CHANNELS; ++c){
+                if(rings[c] != nullptr){
+                        ofx_deallocate_aligned(rings[c]);
+                        rings[c] = nullptr;
+                }
+        }
+}
+
+
+void pdsp::PartitionLevels::process( const float* const* inputBuffers, float* const* outputBuffers, int bufferSize, std::atomic<int> & misses ) noexcept {
+
+        for(int processed=0; processed<bufferSize; processed+=this->bufferSize){
+                int len = bufferSize - processed;
+                if(len > this->bufferSize){ len = this->bufferSize; }
+
+                for(int l=0; l<numLevels; ++l){
+                        if(levels[l].pending){
+                                collectTail(levels[l], misses);
+                        }
+                }
+
+                for(int l=0; l<numLevels; ++l){
+                        Level & level = levels[l];
+
+                        for(int i=0; i<inputs; ++i){
+                                float* block = level.blocks[i] + level.filled;
+                                int n=0;
+                                if(inputBuffers[i] != nullptr){
+                                        for(; n<len; ++n){
+                                                block[n] = inputBuffers[i][processed + n];
+                                        }
+                                }
+                                for(; n<this->bufferSize; ++n){
+                                        block[n] = 0.0f;
+                                }
+                        }
+                        level.filled += this->bufferSize;
+
+                        if(level.filled == level.size){
+                                level.filled = 0;
+                                if(level.background){
+                                        submitTail(level, misses);
+                                }else{
+                                        processLevel(level, level.blocks);
+                                        addLevelToRing(level, ringIndex + level.offset - level.size + this->bufferSize);
+                                }
+                        }
+                }
+
+                for(int o=0; o<outputs; ++o){
+                        float* ring = rings[o];
+                        int r = ringIndex;
+                        int n=0;
+                        for(; n<len; ++n){
+                                outputBuffers[o][processed + n] = ring[r];
+                                ring[r] = 0.0f;
+                                r++;
+                                if(r==ringSize){ r = 0; }
+                        }
+                        for(; n<this->bufferSize; ++n){
+                                ring[r] = 0.0f;
+                                r++;
+                                if(r==ringSize){ r = 0; }
+                        }
+                }
+                ringIndex += this->bufferSize;
+                if(ringIndex>=ringSize){ ringIndex -= ringSize; }
+        }
+}
+
+
+void pdsp::PartitionLevels::processLevel( Level & level, float* const* blocks ) noexcept {
+
+        // the blocks lost by the background processing are silent
+        for( ; level.skip>0; level.skip--){
+                level.index--;
+                if(level.index<0){ level.index = level.partitions-1; }
+                for(int i=0; i<inputs; ++i){
+                        ofx_Aeq_Zero(level.circularR[i][level.index], level.complexSize);
+                        ofx_Aeq_Zero(level.circularI[i][level.index], level.complexSize);
+                }
+        }
+
+        level.index--;
+        if(level.index<0){ level.index = level.partitions-1; }
+
+        //FFT each input block just once
+        int signalSize = level.fftWorker.getFFTBlockSize();
+        for(int i=0; i<inputs; ++i){
+                int n=0;
+                for(; n<level.size; ++n){
+                        level.padded[n] = blocks[i][n];
+                }
+                for(; n<signalSize; ++n){
+                        level.padded[n] = 0.0f;
+                }
+                level.fftWorker.FFT(level.padded, level.circularR[i][level.index], level.circularI[i][level.index]);
+        }
+
+        //complex multiply and add all the inputs for each output
+        for(int o=0; o<outputs; ++o){
+                ofx_Aeq_Zero(level.addR, level.complexSize);
+                ofx_Aeq_Zero(level.addI, level.complexSize);
+
+                for(int i=0; i<inputs; ++i){
+                        float** impulseR = level.impulseR[i][o];
+                        float** impulseI = level.impulseI[i][o];
+                        if(impulseR==nullptr){ continue; }
+
+                        int k = level.index;
+                        for(int p=0; p<level.impulsePartitions[i][o]; ++p){
+                                vect_cmadd( level.addR, level.addI,
+                                                  impulseR[p], impulseI[p],
+                                                  level.circularR[i][k], level.circularI[i][k],
+                                                  level.complexSize);
+                                k++;
+                                if (k>=level.partitions) { k = 0; }
+                        }
+                }
+
+                level.fftWorker.iFFT(level.results[o], level.addR, level.addI);
+        }
+}
+
+
+void pdsp::PartitionLevels::addLevelToRing( Level & level, int position ) noexcept {
+        if(position>=ringSize){ position -= ringSize; }
+        for(int o=0; o<outputs; ++o){
+                float* ring = rings[o];
+                const float* result = level.results[o];
+                int r = position;
+                for(int n=0; n<level.size*2; ++n){
+                        ring[r] += result[n];
+                        r++;
+                        if(r==ringSize){ r = 0; }
+                }
+        }
+}
+
+
+void pdsp::PartitionLevels::submitTail( Level & level, std::atomic<int> & misses ) noexcept {
+
+        int state = level.job.load(std::memory_order_acquire);
+        if(state == JobDone){
+                // late result of the last block, already counted as miss
+                level.job.store(JobFree, std::memory_order_relaxed);
+                state = JobFree;
+        }
+        if(state != JobFree){
+                // the worker is still busy with the last block, this one is lost
+                level.lost++;
+                misses++;
+                return;
+        }
+
+        for(int i=0; i<inputs; ++i){
+                for(int n=0; n<level.size; ++n){
+                        level.jobInputs[i][n] = level.blocks[i][n];
+                }
+        }
+        level.ringPosition = ringIndex + level.offset - level.size + bufferSize;
+        level.countdown = (level.offset - level.size) / bufferSize + 1;
+        level.skip = level.lost;
+        level.lost = 0;
+        level.pending = true;
+        level.job.store(JobSubmitted, std::memory_order_release);
+
+        TailWorker::getInstance().notify();
+}
+
+
+void pdsp::PartitionLevels::collectTail( Level & level, std::atomic<int> & misses ) noexcept {
+
+        level.countdown--;
+
+        if(level.job.load(std::memory_order_acquire) == JobDone){
+                addLevelToRing(level, level.ringPosition);
+                level.job.store(JobFree, std::memory_order_release);
+                level.pending = false;
+        }else if(level.countdown <= 0){
+                // the output is due in this buffer
+                int expected = JobSubmitted;
+                if(level.job.compare_exchange_strong(expected, JobRunning, std::memory_order_acq_rel)){
+                        // the worker has not started it yet, so it's computed here
+                        processLevel(level, level.jobInputs);
+                        addLevelToRing(level, level.ringPosition);
+                        level.job.store(JobFree, std::memory_order_release);
+                }else{
+                        misses++;
+                }
+                level.pending = false;
+        }
+}
+
+
+bool pdsp::PartitionLevels::processTail() noexcept {
+        bool processed = false;
+        for(int l=0; l<numLevels; ++l){
+                Level & level = levels[l];
+                int expected = JobSubmitted;
+                if(level.background && level.job.compare_exchange_strong(expected, JobRunning, std::memory_order_acq_rel)){
+                        processLevel(level, level.jobInputs);
+                        level.job.store(JobDone, std::memory_order_release);
+                        processed = true;
+                }
+        }
+        return processed;
+}
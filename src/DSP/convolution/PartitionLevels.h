@@ -0,0 +1,119 @@
+// PartitionLevels.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_CONVOLUTION_PARTITIONLEVELS_H_INCLUDED
+#define PDSP_CONVOLUTION_PARTITIONLEVELS_H_INCLUDED
+
+#include "../pdspCore.h"
+#include "../helpers/FFTWorker.h"
+#include "PartitionLayout.h"
+#include "SpectrumCache.h"
+#include <atomic>
+#include <vector>
+
+#define PDSP_CONVOLUTION_MAX_CHANNELS 8
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+
+namespace pdsp{
+
+// frequency-domain delay lines with the partitions of a PartitionLayout, for many inputs and outputs
+// each input is transformed once for all its impulse responses, the output of each level is added to a ring for each output
+// it's used by FDLConvolver for the non-uniform partitions and by MultiConvolver
+// it's prepared outside of the audio thread, then process() is called by the audio thread and processTail() by the TailWorker
+class PartitionLevels {
+
+public:
+    PartitionLevels();
+    ~PartitionLevels();
+
+    PartitionLevels( const PartitionLevels & other ) = delete;
+    PartitionLevels& operator= ( const PartitionLevels & other ) = delete;
+
+    // allocates the delay lines of the inputs and the rings of the outputs, returns false if the allocation failed
+    // with backgroundTail the levels with enough buffers before their output are processed by the TailWorker
+    bool allocate( const std::vector<PartitionLayout> & layout, int inputs, int outputs, int bufferSize, bool backgroundTail );
+
+    // allocates and copies the partitions of the impulse response convolving the given input into the given output
+    // the pairs without an impulse response are not processed, returns false if the spectra don't match the layout
+    bool load( int input, int output, const ImpulseSpectra & spectra );
+
+    // true if any level is processed in background
+    bool hasBackground() const;
+
+    // silent buffers after which all the delay lines and the rings are empty
+    int silenceLimit() const;
+
+    // audio thread, nullptr is a silent input, the partitions are multiples of the buffer size so a shorter buffer is padded with silence
+    // the tail blocks lost or not ready in time are counted into misses
+    void process( const float* const* inputBuffers, float* const* outputBuffers, int bufferSize, std::atomic<int> & misses ) noexcept;
+
+    // worker thread, processes the submitted tail blocks, returns true if there was any
+    bool processTail() noexcept;
+
+private:
+    enum TailJobState { JobFree = 0, JobSubmitted, JobRunning, JobDone };
+
+    // a frequency-domain delay line for each input, with partitions of the same size
+    struct Level {
+        FFTWorker fftWorker;
+        int size;
+        int partitions;
+        int offset;
+        int complexSize;
+        int filled;
+        int index;
+        float* blocks [PDSP_CONVOLUTION_MAX_CHANNELS];
+        float* results [PDSP_CONVOLUTION_MAX_CHANNELS];
+        float* padded;
+        float* addR;
+        float* addI;
+        float** circularR [PDSP_CONVOLUTION_MAX_CHANNELS];
+        float** circularI [PDSP_CONVOLUTION_MAX_CHANNELS];
+        // partitions of each input-output pair, nullptr if the pair has no IR in this level
+        float** impulseR [PDSP_CONVOLUTION_MAX_CHANNELS][PDSP_CONVOLUTION_MAX_CHANNELS];
+        float** impulseI [PDSP_CONVOLUTION_MAX_CHANNELS][PDSP_CONVOLUTION_MAX_CHANNELS];
+        int impulsePartitions [PDSP_CONVOLUTION_MAX_CHANNELS][PDSP_CONVOLUTION_MAX_CHANNELS];
+
+        // background processing, the job state is the only data shared with the worker
+        // the blocks lost while the worker was busy become silent slots before the next block, so the delay line stays in time
+        bool background;
+        bool pending;
+        int lost;
+        int skip;
+        float* jobInputs [PDSP_CONVOLUTION_MAX_CHANNELS];
+        int ringPosition;
+        int countdown;
+        std::atomic<int> job;
+    };
+
+    void deallocate();
+
+    void processLevel( Level & level, float* const* blocks ) noexcept;
+    void addLevelToRing( Level & level, int position ) noexcept;
+    void submitTail( Level & level, std::atomic<int> & misses ) noexcept;
+    void collectTail( Level & level, std::atomic<int> & misses ) noexcept;
+
+    Level*  levels;
+    int     numLevels;
+    int     inputs;
+    int     outputs;
+    int     bufferSize;
+    bool    background;
+
+    float*  rings [PDSP_CONVOLUTION_MAX_CHANNELS];
+    int     ringSize;
+    int     ringIndex;
+    int     limit;
+};
+
+}//END NAMESPACE
+
+/*!
+    @endcond
+*/
+
+#endif  // PDSP_CONVOLUTION_PARTITIONLEVELS_H_INCLUDED
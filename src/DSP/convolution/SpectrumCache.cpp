@@ -0,0 +1,531 @@
+
+#include "SpectrumCache.h"
+#include "../helpers/FFTWorker.h"
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+
+#define PDSP_SPECTRUMCACHE_VERSION 1
+#define PDSP_SPECTRUMCACHE_BYTEORDER 0x01020304
+// the arrays in the files and in memory start at multiples of 16 floats
+#define PDSP_SPECTRUMCACHE_ALIGNMENT 16
+
+namespace pdsp{
+    // file layout: header, level entries, then the real and imaginary part of each stored partition (64 bytes aligned)
+    struct SpectrumCacheHeader {
+        char        magic[8];
+        uint32_t    version;
+        uint32_t    byteOrder;
+        uint64_t    content;
+        double      sampleRate;
+        int32_t     channel;
+        int32_t     levels;
+        int32_t     length;
+        int32_t     reserved;
+        uint64_t    floats;
+        uint64_t    dataOffset;
+    };
+
+    struct SpectrumCacheLevel {
+        int32_t     size;
+        int32_t     partitions;
+        int32_t     offset;
+        int32_t     stored;
+        int32_t     complexSize;
+        int32_t     reserved;
+    };
+
+    struct SpectrumCacheState {
+        std::mutex  mutex;
+        bool        inMemory;
+        bool        verbose;
+        std::string directory;
+        std::map<uint64_t, std::shared_ptr<const ImpulseSpectra>> entries;
+        std::map<uint64_t, std::shared_ptr<const ImpulseTaps>> taps;
+    };
+}
+
+static const char pdspSpectrumCacheMagic[8] = { 'P', 'D', 'S', 'P', 'S', 'P', 'E', 'C' };
+
+// never destroyed, so it's still valid when the static convolvers are destroyed
+static pdsp::SpectrumCacheState & spectrumCacheState(){
+    static pdsp::SpectrumCacheState* state = nullptr;
+    static std::once_flag initialized;
+    std::call_once( initialized, [](){
+        state = new pdsp::SpectrumCacheState();
+        state->inMemory = true;
+        state->verbose = false;
+    });
+    return *state;
+}
+
+// FNV-1a
+static uint64_t spectrumHash( uint64_t hash, const void* data, size_t bytes ){
+    const uint8_t* b = static_cast<const uint8_t*>( data );
+    for( size_t i=0; i<bytes; ++i ){
+        hash ^= b[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// FNV-1a on 32 bit words, for hashing the impulse responses faster
+static uint64_t spectrumHashSamples( uint64_t hash, const float* samples, int length ){
+    const uint32_t* words = reinterpret_cast<const uint32_t*>( samples );
+    for( int i=0; i<length; ++i ){
+        hash ^= words[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t spectrumDataOffset( size_t levels ){
+    uint64_t offset = sizeof(pdsp::SpectrumCacheHeader) + levels * sizeof(pdsp::SpectrumCacheLevel);
+    uint64_t alignment = PDSP_SPECTRUMCACHE_ALIGNMENT * sizeof(float);
+    return ( offset + alignment - 1 ) / alignment * alignment;
+}
+
+
+pdsp::ImpulseSpectra::ImpulseSpectra( uint64_t content, int channel, double sampleRate, const std::vector<PartitionLayout> & layout ){
+    this->content = content;
+    this->channel = channel;
+    this->sampleRate = sampleRate;
+    this->layouts = layout;
+    this->data = nullptr;
+    setLength( 0 );
+}
+
+void pdsp::ImpulseSpectra::setLength( int length ){
+    this->length = length;
+    stored.clear();
+    complexSizes.clear();
+    strides.clear();
+    offsets.clear();
+
+    floats = 0;
+    for( const PartitionLayout & level : layouts ){
+        int partitions = ( length - level.offset + level.size - 1 ) / level.size;
+        if( partitions > level.partitions ){ partitions = level.partitions; }
+        if( partitions < 0 ){ partitions = 0; }
+        // the convolvers init their FFTWorker with size*2 - 1
+        int complexSize = FFTWorker::getFFTComplexSize( level.size*2 - 1 );
+        int stride = ( complexSize + PDSP_SPECTRUMCACHE_ALIGNMENT - 1 ) / PDSP_SPECTRUMCACHE_ALIGNMENT * PDSP_SPECTRUMCACHE_ALIGNMENT;
+
+        stored.push_back( partitions );
+        complexSizes.push_back( complexSize );
+        strides.push_back( stride );
+        offsets.push_back( floats );
+        floats += (size_t) partitions * stride * 2;
+    }
+}
+
+bool pdsp::ImpulseSpectra::matches( uint64_t content, int channel, double sampleRate, const std::vector<PartitionLayout> & layout ) const {
+    if( content != this->content || channel != this->channel || sampleRate != this->sampleRate || layout.size() != layouts.size() ){
+        return false;
+    }
+    for( size_t l=0; l<layouts.size(); ++l ){
+        if( layout[l].size != layouts[l].size || layout[l].partitions != layouts[l].partitions || layout[l].offset != layouts[l].offset ){
+            return false;
+        }
+    }
+    return true;
+}
+
+int pdsp::ImpulseSpectra::levels() const {
+    return layouts.size();
+}
+
+const pdsp::PartitionLayout & pdsp::ImpulseSpectra::layout( int level ) const {
+    return layouts[level];
+}
+
+int pdsp::ImpulseSpectra::partitions( int level ) const {
+    return stored[level];
+}
+
+int pdsp::ImpulseSpectra::complexSize( int level ) const {
+    return complexSizes[level];
+}
+
+const float* pdsp::ImpulseSpectra::real( int level, int partition ) const {
+    return data + offsets[level] + (size_t) partition * strides[level] * 2;
+}
+
+const float* pdsp::ImpulseSpectra::imag( int level, int partition ) const {
+    return data + offsets[level] + (size_t) partition * strides[level] * 2 + strides[level];
+}
+
+
+pdsp::ImpulseTaps::ImpulseTaps( uint64_t content, int channel, double sampleRate, int maxTaps ){
+    this->content = content;
+    this->channel = channel;
+    this->sampleRate = sampleRate;
+    this->maxTaps = maxTaps;
+    this->taps = 0;
+    this->padded = 0;
+    this->data = nullptr;
+}
+
+pdsp::ImpulseTaps::~ImpulseTaps(){
+    if( data != nullptr ){
+        ofx_deallocate_aligned( data );
+    }
+}
+
+bool pdsp::ImpulseTaps::matches( uint64_t content, int channel, double sampleRate, int maxTaps ) const {
+    return content == this->content && channel == this->channel && sampleRate == this->sampleRate && maxTaps == this->maxTaps;
+}
+
+int pdsp::ImpulseTaps::length() const {
+    return taps;
+}
+
+int pdsp::ImpulseTaps::paddedLength() const {
+    return padded;
+}
+
+const float* pdsp::ImpulseTaps::reversed( int shift ) const {
+    return data + shift * padded;
+}
+
+
+void pdsp::SpectrumCache::setInMemory( bool active ){
+    SpectrumCacheState & state = spectrumCacheState();
+    std::lock_guard<std::mutex> lock( state.mutex );
+    state.inMemory = active;
+    if( !active ){
+        state.entries.clear();
+        state.taps.clear();
+    }
+}
+
+void pdsp::SpectrumCache::setDirectory( std::string path ){
+    SpectrumCacheState & state = spectrumCacheState();
+    std::lock_guard<std::mutex> lock( state.mutex );
+    while( path.size() > 1 && ( path.back() == '/' || path.back() == '\\' ) ){
+        path.pop_back();
+    }
+    state.directory = path;
+}
+
+void pdsp::SpectrumCache::clear(){
+    SpectrumCacheState & state = spectrumCacheState();
+    std::lock_guard<std::mutex> lock( state.mutex );
+    state.entries.clear();
+    state.taps.clear();
+}
+
+int pdsp::SpectrumCache::size(){
+    SpectrumCacheState & state = spectrumCacheState();
+    std::lock_guard<std::mutex> lock( state.mutex );
+    return state.entries.size() + state.taps.size();
+}
+
+void pdsp::SpectrumCache::setVerbose( bool verbose ){
+    SpectrumCacheState & state = spectrumCacheState();
+    std::lock_guard<std::mutex> lock( state.mutex );
+    state.verbose = verbose;
+}
+
+
+std::shared_ptr<const pdsp::ImpulseSpectra> pdsp::SpectrumCache::get( const SampleBuffer & impulseResponse, int channel, double sampleRate, const std::vector<PartitionLayout> & layout ){
+
+    if( impulseResponse.buffer==nullptr || channel<0 || channel>=impulseResponse.channels ){
+        return nullptr;
+    }
+
+    uint64_t content = contentHash( impulseResponse, channel );
+
+    uint64_t key = spectrumHash( content, &channel, sizeof(int) );
+    key = spectrumHash( key, &sampleRate, sizeof(double) );
+    for( const PartitionLayout & level : layout ){
+        key = spectrumHash( key, &level.size, sizeof(int) );
+        key = spectrumHash( key, &level.partitions, sizeof(int) );
+        key = spectrumHash( key, &level.offset, sizeof(int) );
+    }
+
+    SpectrumCacheState & state = spectrumCacheState();
+    bool inMemory;
+    bool verbose;
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock( state.mutex );
+        inMemory = state.inMemory;
+        verbose = state.verbose;
+        if( inMemory ){
+            auto found = state.entries.find( key );
+            if( found != state.entries.end() && found->second->matches( content, channel, sampleRate, layout ) ){
+                if(verbose) std::cout<<"[pdsp] impulse response "<<impulseResponse.filePath<<" channel "<<channel<<" found in memory cache\n";
+                return found->second;
+            }
+        }
+        if( !state.directory.empty() ){
+            char name[32];
+            std::snprintf( name, sizeof(name), "%016llx.pdspir", (unsigned long long) key );
+            path = state.directory + "/" + name;
+        }
+    }
+
+    std::shared_ptr<ImpulseSpectra> spectra;
+
+    if( !path.empty() ){
+        spectra = load( path, channel, sampleRate, layout, content );
+        if( spectra && verbose ){
+            std::cout<<"[pdsp] impulse response "<<impulseResponse.filePath<<" channel "<<channel<<" mapped from "<<path<<"\n";
+        }
+    }
+
+    if( !spectra ){
+        spectra = prepare( impulseResponse, channel, sampleRate, layout, content );
+        if( !spectra ){
+            return nullptr;
+        }
+        if(verbose) std::cout<<"[pdsp] impulse response "<<impulseResponse.filePath<<" channel "<<channel<<" prepared\n";
+        if( !path.empty() && save( path, *spectra ) && verbose ){
+            std::cout<<"[pdsp] impulse response "<<impulseResponse.filePath<<" channel "<<channel<<" saved to "<<path<<"\n";
+        }
+    }
+
+    if( inMemory ){
+        std::lock_guard<std::mutex> lock( state.mutex );
+        state.entries[key] = spectra;
+    }
+
+    return spectra;
+}
+
+
+uint64_t pdsp::SpectrumCache::contentHash( const SampleBuffer & impulseResponse, int channel ){
+    // the channel data identifies the impulse response, also if the file changes or it isn't loaded from a file
+    uint64_t content = 14695981039346656037ULL;
+    content = spectrumHash( content, &impulseResponse.length, sizeof(int) );
+    content = spectrumHash( content, &impulseResponse.fileSampleRate, sizeof(impulseResponse.fileSampleRate) );
+    content = spectrumHashSamples( content, impulseResponse.buffer[channel], impulseResponse.length );
+    return content;
+}
+
+
+std::shared_ptr<const pdsp::ImpulseTaps> pdsp::SpectrumCache::getTaps( const SampleBuffer & impulseResponse, int channel, double sampleRate, int maxTaps ){
+
+    if( impulseResponse.buffer==nullptr || channel<0 || channel>=impulseResponse.channels || maxTaps<1 ){
+        return nullptr;
+    }
+
+    uint64_t content = contentHash( impulseResponse, channel );
+
+    uint64_t key = spectrumHash( content, &channel, sizeof(int) );
+    key = spectrumHash( key, &sampleRate, sizeof(double) );
+    key = spectrumHash( key, &maxTaps, sizeof(int) );
+
+    SpectrumCacheState & state = spectrumCacheState();
+    bool inMemory;
+    bool verbose;
+    {
+        std::lock_guard<std::mutex> lock( state.mutex );
+        inMemory = state.inMemory;
+        verbose = state.verbose;
+        if( inMemory ){
+            auto found = state.taps.find( key );
+            if( found != state.taps.end() && found->second->matches( content, channel, sampleRate, maxTaps ) ){
+                if(verbose) std::cout<<"[pdsp] impulse response "<<impulseResponse.filePath<<" channel "<<channel<<" taps found in memory cache\n";
+                return found->second;
+            }
+        }
+    }
+
+    std::shared_ptr<ImpulseTaps> taps = prepareTaps( impulseResponse, channel, sampleRate, maxTaps, content );
+    if( !taps ){
+        return nullptr;
+    }
+    if(verbose) std::cout<<"[pdsp] impulse response "<<impulseResponse.filePath<<" channel "<<channel<<" taps prepared\n";
+
+    if( inMemory ){
+        std::lock_guard<std::mutex> lock( state.mutex );
+        state.taps[key] = taps;
+    }
+
+    return taps;
+}
+
+
+std::shared_ptr<const pdsp::ImpulseSpectra> pdsp::SpectrumCache::getUncached( const SampleBuffer & impulseResponse, int channel, double sampleRate, const std::vector<PartitionLayout> & layout ){
+    if( impulseResponse.buffer==nullptr || channel<0 || channel>=impulseResponse.channels ){
+        return nullptr;
+    }
+    return prepare( impulseResponse, channel, sampleRate, layout, 0 );
+}
+
+std::shared_ptr<const pdsp::ImpulseTaps> pdsp::SpectrumCache::getTapsUncached( const SampleBuffer & impulseResponse, int channel, double sampleRate, int maxTaps ){
+    if( impulseResponse.buffer==nullptr || channel<0 || channel>=impulseResponse.channels || maxTaps<1 ){
+        return nullptr;
+    }
+    return prepareTaps( impulseResponse, channel, sampleRate, maxTaps, 0 );
+}
+
+
+std::shared_ptr<pdsp::ImpulseTaps> pdsp::SpectrumCache::prepareTaps( const SampleBuffer & impulseResponse, int channel, double sampleRate, int maxTaps, uint64_t content ){
+
+    int length;
+    float* converted = convertImpulseResponse( impulseResponse, channel, sampleRate, length );
+    if( converted == nullptr ){
+        return nullptr;
+    }
+
+    std::shared_ptr<ImpulseTaps> taps( new ImpulseTaps( content, channel, sampleRate, maxTaps ) );
+    taps->taps = ( length < maxTaps ) ? length : maxTaps;
+    if( taps->taps < 1 ){ taps->taps = 1; }
+    taps->padded = ( taps->taps + 3 + 3 ) / 4 * 4;
+
+    ofx_allocate_aligned( taps->data, taps->padded * 4 );
+    if( taps->data == nullptr ){
+        delete [] converted;
+        return nullptr;
+    }
+    ofx_Aeq_Zero( taps->data, taps->padded * 4 );
+
+    for( int shift=0; shift<4; ++shift ){
+        float* copy = taps->data + shift * taps->padded;
+        for( int j=0; j<taps->taps; ++j ){
+            int k = taps->taps - 1 - j;
+            copy[shift + j] = ( k < length ) ? converted[k] : 0.0f;
+        }
+    }
+
+    delete [] converted;
+    return taps;
+}
+
+
+std::shared_ptr<pdsp::ImpulseSpectra> pdsp::SpectrumCache::prepare( const SampleBuffer & impulseResponse, int channel, double sampleRate, const std::vector<PartitionLayout> & layout, uint64_t content ){
+
+    int length;
+    float* converted = convertImpulseResponse( impulseResponse, channel, sampleRate, length );
+    if( converted == nullptr ){
+        return nullptr;
+    }
+
+    std::shared_ptr<ImpulseSpectra> spectra( new ImpulseSpectra( content, channel, sampleRate, layout ) );
+    spectra->setLength( length );
+    // aligned like the mapped files, the convolvers can use the spectra without copying them
+    spectra->owned.assign( spectra->floats + PDSP_SPECTRUMCACHE_ALIGNMENT, 0.0f );
+    uintptr_t address = reinterpret_cast<uintptr_t>( spectra->owned.data() );
+    uintptr_t alignment = PDSP_SPECTRUMCACHE_ALIGNMENT * sizeof(float);
+    float* aligned = reinterpret_cast<float*>( ( address + alignment - 1 ) / alignment * alignment );
+    spectra->data = aligned;
+
+    FFTWorker fftWorker;
+    std::vector<float> padded;
+    for( int l=0; l<spectra->levels(); ++l ){
+        const PartitionLayout & level = layout[l];
+        fftWorker.initFFT( level.size*2 - 1 );
+        padded.assign( fftWorker.getFFTBlockSize(), 0.0f );
+
+        for( int p=0; p<spectra->partitions(l); ++p ){
+            int start = level.offset + p*level.size;
+            for( int n=0; n<level.size; ++n ){
+                padded[n] = ( start + n < length ) ? converted[start + n] : 0.0f;
+            }
+            float* real = aligned + spectra->offsets[l] + (size_t) p * spectra->strides[l] * 2;
+            fftWorker.FFT( padded.data(), real, real + spectra->strides[l] );
+        }
+    }
+
+    delete [] converted;
+    return spectra;
+}
+
+
+std::shared_ptr<pdsp::ImpulseSpectra> pdsp::SpectrumCache::load( std::string path, int channel, double sampleRate, const std::vector<PartitionLayout> & layout, uint64_t content ){
+
+    std::shared_ptr<ImpulseSpectra> spectra( new ImpulseSpectra( content, channel, sampleRate, layout ) );
+    if( !spectra->file.open( path ) ){
+        return nullptr; // not cached yet
+    }
+
+    const uint8_t* mapped = spectra->file.data();
+    size_t fileSize = spectra->file.size();
+    const SpectrumCacheHeader* header = reinterpret_cast<const SpectrumCacheHeader*>( mapped );
+
+    if( fileSize < sizeof(SpectrumCacheHeader)
+        || std::memcmp( header->magic, pdspSpectrumCacheMagic, 8 )!=0
+        || header->version != PDSP_SPECTRUMCACHE_VERSION
+        || header->byteOrder != PDSP_SPECTRUMCACHE_BYTEORDER
+        || header->content != content || header->channel != channel || header->sampleRate != sampleRate
+        || header->levels != (int32_t) layout.size()
+        || header->dataOffset != spectrumDataOffset( layout.size() ) ){
+        std::cout<<"[pdsp] warning! "<<path<<" is not a valid impulse response cache file for this impulse response, it will be overwritten\n";
+        return nullptr;
+    }
+
+    spectra->setLength( header->length );
+    const SpectrumCacheLevel* levels = reinterpret_cast<const SpectrumCacheLevel*>( mapped + sizeof(SpectrumCacheHeader) );
+    bool valid = header->floats == spectra->floats && header->dataOffset + header->floats * sizeof(float) <= fileSize;
+    for( int l=0; valid && l<spectra->levels(); ++l ){
+        valid = levels[l].size == layout[l].size && levels[l].partitions == layout[l].partitions && levels[l].offset == layout[l].offset
+                && levels[l].stored == spectra->stored[l] && levels[l].complexSize == spectra->complexSizes[l];
+    }
+    if( !valid ){
+        std::cout<<"[pdsp] warning! impulse response cache file "<<path<<" is corrupted, it will be overwritten\n";
+        return nullptr;
+    }
+
+    spectra->data = reinterpret_cast<const float*>( mapped + header->dataOffset );
+    return spectra;
+}
+
+
+bool pdsp::SpectrumCache::save( std::string path, const ImpulseSpectra & spectra ){
+
+    // written to a temporary file and then renamed, so a partial file is never mapped
+    std::string temporary = path + ".tmp";
+    std::ofstream file( temporary, std::ios::out | std::ios::binary | std::ios::trunc );
+    if( !file.is_open() ){
+        std::cout<<"[pdsp] error opening "<<temporary<<" for writing impulse response cache\n";
+        pdsp_trace();
+        return false;
+    }
+
+    SpectrumCacheHeader header;
+    std::memcpy( header.magic, pdspSpectrumCacheMagic, 8 );
+    header.version = PDSP_SPECTRUMCACHE_VERSION;
+    header.byteOrder = PDSP_SPECTRUMCACHE_BYTEORDER;
+    header.content = spectra.content;
+    header.sampleRate = spectra.sampleRate;
+    header.channel = spectra.channel;
+    header.levels = spectra.levels();
+    header.length = spectra.length;
+    header.reserved = 0;
+    header.floats = spectra.floats;
+    header.dataOffset = spectrumDataOffset( spectra.levels() );
+    file.write( reinterpret_cast<const char*>( &header ), sizeof(SpectrumCacheHeader) );
+
+    for( int l=0; l<spectra.levels(); ++l ){
+        SpectrumCacheLevel level;
+        level.size = spectra.layouts[l].size;
+        level.partitions = spectra.layouts[l].partitions;
+        level.offset = spectra.layouts[l].offset;
+        level.stored = spectra.stored[l];
+        level.complexSize = spectra.complexSizes[l];
+        level.reserved = 0;
+        file.write( reinterpret_cast<const char*>( &level ), sizeof(SpectrumCacheLevel) );
+    }
+
+    static const char zeros[PDSP_SPECTRUMCACHE_ALIGNMENT * sizeof(float)] = { 0 };
+    file.write( zeros, header.dataOffset - file.tellp() );
+    file.write( reinterpret_cast<const char*>( spectra.data ), spectra.floats * sizeof(float) );
+
+    bool success = file.good();
+    file.close();
+
+    std::remove( path.c_str() );
+    if( !success || std::rename( temporary.c_str(), path.c_str() ) != 0 ){
+        std::cout<<"[pdsp] error writing impulse response cache "<<path<<"\n";
+        pdsp_trace();
+        std::remove( temporary.c_str() );
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,163 @@
+
+// SpectrumCache.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_CONVOLUTION_SPECTRUMCACHE_H_INCLUDED
+#define PDSP_CONVOLUTION_SPECTRUMCACHE_H_INCLUDED
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <memory>
+#include "../samplers/SampleBuffer.h"
+#include "../helpers/MappedFile.h"
+#include "PartitionLayout.h"
+
+namespace pdsp{
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+
+// spectra of the partitions of an impulse response channel, for a given sample rate and partition layout
+// the data is owned or mapped from a cache file, it is never modified after being prepared
+class ImpulseSpectra {
+
+public:
+    ImpulseSpectra( const ImpulseSpectra & other ) = delete;
+    ImpulseSpectra& operator= ( const ImpulseSpectra & other ) = delete;
+
+    int levels() const;
+    const PartitionLayout & layout( int level ) const;
+
+    // partitions of the level containing the impulse response, the next ones are silent
+    int partitions( int level ) const;
+    int complexSize( int level ) const;
+
+    const float* real( int level, int partition ) const;
+    const float* imag( int level, int partition ) const;
+
+private:
+    friend class SpectrumCache;
+    ImpulseSpectra( uint64_t content, int channel, double sampleRate, const std::vector<PartitionLayout> & layout );
+
+    // sets the stored partitions and the data layout for the given impulse response length
+    void setLength( int length );
+
+    bool matches( uint64_t content, int channel, double sampleRate, const std::vector<PartitionLayout> & layout ) const;
+
+    uint64_t                        content;
+    int                             channel;
+    double                          sampleRate;
+    std::vector<PartitionLayout>    layouts;
+    int                             length;
+    std::vector<int>                stored;
+    std::vector<int>                complexSizes;
+    std::vector<int>                strides;
+    std::vector<size_t>             offsets;
+    size_t                          floats;
+
+    const float*                    data;
+    std::vector<float>              owned;
+    MappedFile                      file;
+};
+
+// time-domain taps of an impulse response channel for direct form convolution, resampled to the given sample rate
+// the taps are reversed and stored four times, each copy shifted by 0 to 3 zeros, so four consecutive outputs
+// are computed loading aligned vectors from the same input position
+class ImpulseTaps {
+public:
+    ImpulseTaps( const ImpulseTaps & other ) = delete;
+    ImpulseTaps& operator= ( const ImpulseTaps & other ) = delete;
+    ~ImpulseTaps();
+
+    int length() const;
+    // length of each copy, a multiple of 4
+    int paddedLength() const;
+    const float* reversed( int shift ) const;
+
+private:
+    friend class SpectrumCache;
+    ImpulseTaps( uint64_t content, int channel, double sampleRate, int maxTaps );
+
+    bool matches( uint64_t content, int channel, double sampleRate, int maxTaps ) const;
+
+    uint64_t    content;
+    int         channel;
+    double      sampleRate;
+    int         maxTaps;
+    int         taps;
+    int         padded;
+    float*      data;
+};
+
+/*!
+    @endcond
+*/
+
+
+/*!
+@brief Cache of the impulse responses prepared for the convolution.
+
+FDLConvolver, MultiConvolver, FIRFilter and IRVerb resample each impulse response and take the FFT of all its partitions when it is loaded. The results are kept in this cache, keyed by the impulse response channel data, the sample rate and the partition layout, so loading again the same impulse response (for example switching presets) skips all that work. The cache can also save the results to files in a directory, that are memory-mapped when needed, so they are reused also after restarting the app. The instances loading the same impulse response share the same data, FIRFilter also keeps here the time-domain taps for its direct form convolution. The memory cache never evicts anything: the prepared impulse responses stay in memory, also when no convolver uses them anymore, until clear() or setInMemory(false) are called. All the methods are static and thread-safe.
+*/
+class SpectrumCache {
+
+public:
+    /*!
+    @brief activates or deactivates the memory cache. It is active by default. Deactivating it also clears it.
+    @param[in] active true for keeping the prepared impulse responses in memory
+    */
+    static void setInMemory( bool active );
+
+    /*!
+    @brief sets a directory for saving the prepared impulse responses, and for mapping them from the saved files. The directory has to exist. An empty string disables the files, as by default.
+    @param[in] path path of the directory
+    */
+    static void setDirectory( std::string path );
+
+    /*!
+    @brief removes all the prepared impulse responses from memory, the files are kept. The convolvers that have already loaded them are not affected.
+    */
+    static void clear();
+
+    /*!
+    @brief returns the number of prepared impulse responses in memory.
+    */
+    static int size();
+
+    /*!
+    @brief activate logging of cache hits, misses and file operations
+    @param[in] verbose
+    */
+    static void setVerbose( bool verbose );
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+    // returns the spectra from memory or from the cache directory, or prepares them, nullptr if the channel is not valid
+    static std::shared_ptr<const ImpulseSpectra> get( const SampleBuffer & impulseResponse, int channel, double sampleRate, const std::vector<PartitionLayout> & layout );
+
+    // returns the first maxTaps taps for direct form convolution, they are kept only in memory, nullptr if the channel is not valid
+    static std::shared_ptr<const ImpulseTaps> getTaps( const SampleBuffer & impulseResponse, int channel, double sampleRate, int maxTaps );
+
+    // as get() and getTaps(), but always prepared and never kept, for the measurements of FIRFilter::calibrate()
+    static std::shared_ptr<const ImpulseSpectra> getUncached( const SampleBuffer & impulseResponse, int channel, double sampleRate, const std::vector<PartitionLayout> & layout );
+    static std::shared_ptr<const ImpulseTaps> getTapsUncached( const SampleBuffer & impulseResponse, int channel, double sampleRate, int maxTaps );
+/*!
+    @endcond
+*/
+
+private:
+    static std::shared_ptr<ImpulseSpectra> prepare( const SampleBuffer & impulseResponse, int channel, double sampleRate, const std::vector<PartitionLayout> & layout, uint64_t content );
+    static std::shared_ptr<ImpulseSpectra> load( std::string path, int channel, double sampleRate, const std::vector<PartitionLayout> & layout, uint64_t content );
+    static bool save( std::string path, const ImpulseSpectra & spectra );
+    static std::shared_ptr<ImpulseTaps> prepareTaps( const SampleBuffer & impulseResponse, int channel, double sampleRate, int maxTaps, uint64_t content );
+    static uint64_t contentHash( const SampleBuffer & impulseResponse, int channel );
+};
+
+
+}//END NAMESPACE
+
+#endif  // PDSP_CONVOLUTION_SPECTRUMCACHE_H_INCLUDED
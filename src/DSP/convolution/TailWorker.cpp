@@ -0,0 +1,74 @@
+
+#include "TailWorker.h"
+#include <algorithm>
+#include <chrono>
+
+pdsp::TailWorker & pdsp::TailWorker::getInstance(){
+    // never destroyed, the convolvers could be released after the static destruction
+    static TailWorker* instance = new TailWorker();
+    return *instance;
+}
+
+pdsp::TailWorker::TailWorker(){
+    runWorker = false;
+}
+
+pdsp::TailWorker::~TailWorker(){
+    stop();
+}
+
+void pdsp::TailWorker::add( TailProcessor* convolver ){
+    std::lock_guard<std::mutex> lock( workerMutex );
+    convolvers.push_back( convolver );
+    if( !worker.joinable() ){
+        runWorker = true;
+        worker = std::thread( workerFunctionWrapper, this );
+    }
+}
+
+void pdsp::TailWorker::remove( TailProcessor* convolver ){
+    bool empty;
+    {
+        // the worker holds the mutex while processing, so after this the convolver is not used
+        std::lock_guard<std::mutex> lock( workerMutex );
+        convolvers.erase( std::remove( convolvers.begin(), convolvers.end(), convolver ), convolvers.end() );
+        empty = convolvers.empty();
+    }
+    if( empty ){
+        stop();
+    }
+}
+
+void pdsp::TailWorker::stop(){
+    if( worker.joinable() ){
+        {
+            std::lock_guard<std::mutex> lock( workerMutex );
+            runWorker = false;
+        }
+        workerCondition.notify_one();
+        worker.join();
+    }
+}
+
+void pdsp::TailWorker::notify() noexcept{
+    workerCondition.notify_one();
+}
+
+void pdsp::TailWorker::workerFunctionWrapper( TailWorker* parent ){
+    parent->workerFunction();
+}
+
+void pdsp::TailWorker::workerFunction(){
+
+    // the audio thread doesn't lock the mutex, so the wait has a timeout for the missed notifications
+    std::unique_lock<std::mutex> lock( workerMutex );
+    while( runWorker ){
+        bool processed = false;
+        for( TailProcessor* convolver : convolvers ){
+            processed = convolver->processTail() || processed;
+        }
+        if( !processed && runWorker ){
+            workerCondition.wait_for( lock, std::chrono::milliseconds(1) );
+        }
+    }
+}
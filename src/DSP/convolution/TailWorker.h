@@ -0,0 +1,63 @@
+
+// TailWorker.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_CONVOLUTION_TAILWORKER_H_INCLUDED
+#define PDSP_CONVOLUTION_TAILWORKER_H_INCLUDED
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+
+namespace pdsp{
+
+// interface of the convolvers with partitions processed in background
+// processTail() processes the submitted partitions and frees the retired buffers, it returns true if there was any work
+class TailProcessor {
+public:
+    virtual ~TailProcessor(){}
+    virtual bool processTail() noexcept = 0;
+};
+
+// thread shared by all the convolvers for processing their tail partitions in background
+// the convolvers are added and removed from the main thread, the audio thread only notifies new jobs
+// it runs with the default priority, lower than the audio thread
+class TailWorker {
+
+public:
+    static TailWorker & getInstance();
+    ~TailWorker();
+
+    void add( TailProcessor* convolver );
+    void remove( TailProcessor* convolver );
+    void notify() noexcept;
+
+private:
+    TailWorker();
+    
+    static void workerFunctionWrapper( TailWorker* parent );
+    void workerFunction();
+    void stop();
+
+    std::vector<TailProcessor*> convolvers;
+    
+    std::thread                 worker;
+    bool                        runWorker;
+    std::mutex                  workerMutex;
+    std::condition_variable     workerCondition;
+
+};
+
+}//END NAMESPACE
+
+/*!
+    @endcond
+*/
+
+#endif  // PDSP_CONVOLUTION_TAILWORKER_H_INCLUDED
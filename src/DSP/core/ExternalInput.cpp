@@ -2,8 +2,14 @@
 #include "ExternalInput.h"
 #include <iostream>
 
+// the output buffers are read with aligned SIMD loads
+#define PDSP_EXTERNALINPUT_ALIGNMENT 16
+// frames deinterleaved together, so the interleaved block stays in cache while all the channels are read
+#define PDSP_EXTERNALINPUT_TILE 32
+
 pdsp::ExternalInput::ExternalInput(){
     buffer = nullptr;
+    inputUpdated = false;
     output.buffer = nullptr;
     output.state = AudioRate;
     addOutput("signal", output);
@@ -34,6 +40,7 @@ void pdsp::ExternalInput::copyInput(float* input, const int & bufferSize) noexce
     for(int n=0; n<bufferSize; ++n){
         buffer[n] = input[n];
     }
+    output.buffer = buffer;
     inputUpdated = true;
 }
 
@@ -42,10 +49,50 @@ void pdsp::ExternalInput::copyInterleavedInput(float* input, int index, int chan
     for(int n=0; n<bufferSize; ++n){
         buffer[n] = input[n*channels + index];
     }
+    output.buffer = buffer;
     inputUpdated = true;
     
 }
 
+void pdsp::ExternalInput::setInput(float* input, const int & bufferSize) noexcept{
+    if( reinterpret_cast<uintptr_t>(input) % PDSP_EXTERNALINPUT_ALIGNMENT == 0 ){
+        output.buffer = input; // restored to the internal buffer by process() when no input is given
+        inputUpdated = true;
+    }else{
+        copyInput( input, bufferSize );
+    }
+}
+
+void pdsp::ExternalInput::deinterleave(std::vector<ExternalInput> & inputs, const float* interleaved, int channels, const int & bufferSize) noexcept{
+    
+    int copied = ( (int) inputs.size() < channels ) ? inputs.size() : channels;
+    
+    if( channels == 2 && copied == 2 ){
+        float* left = inputs[0].buffer;
+        float* right = inputs[1].buffer;
+        for(int n=0; n<bufferSize; ++n){
+            left[n] = interleaved[2*n];
+            right[n] = interleaved[2*n + 1];
+        }
+    }else{
+        for(int start=0; start<bufferSize; start+=PDSP_EXTERNALINPUT_TILE){
+            int stop = start + PDSP_EXTERNALINPUT_TILE;
+            if( stop > bufferSize ){ stop = bufferSize; }
+            for(int c=0; c<copied; ++c){
+                float* dest = inputs[c].buffer;
+                for(int n=start; n<stop; ++n){
+                    dest[n] = interleaved[n*channels + c];
+                }
+            }
+        }
+    }
+    
+    for(int c=0; c<copied; ++c){
+        inputs[c].output.buffer = inputs[c].buffer;
+        inputs[c].inputUpdated = true;
+    }
+}
+
 void pdsp::ExternalInput::prepareUnit( int expectedBufferSize, double sampleRate ) {
     if(buffer != nullptr){
         ofx_deallocate_aligned(buffer);
@@ -57,6 +104,8 @@ void pdsp::ExternalInput::prepareUnit( int expectedBufferSize, double sampleRate
 void pdsp::ExternalInput::releaseResources() {
     if(buffer != nullptr){
         ofx_deallocate_aligned(buffer);
+        buffer = nullptr;
+        output.buffer = nullptr;
     }
 }
 
@@ -66,6 +115,7 @@ void pdsp::ExternalInput::process(int bufferSize) noexcept {
         output.state = AudioRate;
         inputUpdated = false;
     }else{
+        output.buffer = buffer;
         buffer[0] = 0.0f;
         output.state = Changed;
     }
@@ -8,6 +8,7 @@
 
 #include "BasicNodes.h"
 #include "PatchNode.h"
+#include <vector>
 
 
 namespace pdsp{
@@ -41,6 +42,22 @@ public:
         */    
         void copyInterleavedInput(float* input, int index, int channels, const int & bufferSize) noexcept;
         
+        /*!
+        @brief uses a non-interleaved array as output without copying it, if the array is aligned to 16 bytes, otherwise it is copied. The array has to be valid until the processing of the actual buffer is finished.
+        @param[in] input a pointer to the array to use
+        @param[in] bufferSize number of samples in the array
+        */    
+        void setInput(float* input, const int & bufferSize) noexcept;
+        
+        /*!
+        @brief copies all the channels from an interleaved array to the given inputs, reading the array just once
+        @param[in] inputs the inputs to fill, the first input gets the first channel and so on
+        @param[in] interleaved a pointer to the interleaved array
+        @param[in] channels number of channels interleaved into the array
+        @param[in] bufferSize number of samples to copy for each channel
+        */    
+        static void deinterleave(std::vector<ExternalInput> & inputs, const float* interleaved, int channels, const int & bufferSize) noexcept;
+        
         /*!
         @brief Sets "signal" as selected output and return this Unit ready to be patched. This is the default output. This output contains the copied values, and if values have not been copied yet or the copy callback stopped it is set to a constant rate 0.0f.
         */ 
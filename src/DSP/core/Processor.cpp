@@ -27,12 +27,19 @@ void pdsp::Processor::resize( int channelsNum ){
     }    
 }
 
-void pdsp::Processor::processAndCopyOutput(float** bufferToFill, const int &channelsNum, const int &bufferSize) noexcept{
-     
+void pdsp::Processor::nextTurn( int bufferSize ) noexcept{
         OutputNode::nextTurn();
         Preparable::setTurnBufferSize(bufferSize);
-        
-        for(int i=0; i<channels.size(); ++i){
+}
+
+void pdsp::Processor::processAndCopyOutput(float** bufferToFill, const int &channelsNum, const int &bufferSize) noexcept{
+        nextTurn(bufferSize);
+        processTurnAndCopyOutput(bufferToFill, channelsNum, bufferSize);
+}
+
+void pdsp::Processor::processTurnAndCopyOutput(float** bufferToFill, const int &channelsNum, const int &bufferSize) noexcept{
+
+        for(int i=0; i<(int)channels.size(); ++i){
                 
                 channels[i].process(bufferSize);
                 
@@ -46,6 +46,18 @@ public:
     @param[in] bufferSize number of samples to render
     */  
     void processAndCopyInterleaved(float* bufferToFill, const int &channelsNum, const int &bufferSize) noexcept;  
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+    // starts a new processing turn, processors used in the same turn can be processed from different threads if they don't share Units
+    static void nextTurn( int bufferSize ) noexcept;
+    
+    // like processAndCopyOutput() but without starting a new turn
+    void processTurnAndCopyOutput(float** bufferToFill, const int &channelsNum, const int &bufferSize) noexcept;
+/*!
+    @endcond
+*/
     
     /*!
     @brief an array of channels. Patch your Units and modules to this channels thinking to them as your system final output
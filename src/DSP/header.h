@@ -94,6 +94,14 @@
 #include "utility/SamplesDelay.h"
 
 #include "convolution/FDLConvolver.h"
+#include "convolution/MultiConvolver.h"
+#include "convolution/FIRFilter.h"
+#include "convolution/HRTFSet.h"
+#include "convolution/BinauralSpatializer.h"
+#include "convolution/SpectrumCache.h"
+
+#include "spectral/STFT.h"
+#include "spectral/SpectralAnalyzer.h"
 
 #include "resamplers/resamplers.h"
 
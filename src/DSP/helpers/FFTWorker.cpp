@@ -1,40 +1,107 @@
 
 #include "FFTWorker.h"
 
+// SimdFFTBackend is opt-in, with setDefaultBackend() or setBackend()
+std::atomic<int> pdsp::FFTWorker::defaultBackend( pdsp::AudioFFTBackend );
 
 
 pdsp::FFTWorker::FFTWorker(){
     lastBufferSize = -1;
+    lastBatchSize = 1;
     complexSize = 0;
     blockSize = 0;
-    fftImplementation = new audiofft::AudioFFT();
+    fftImplementation = nullptr;
+    simdImplementation = nullptr;
+    selectedBackend = -1;
+    backend = AudioFFTBackend;
 }
 
 pdsp::FFTWorker::~FFTWorker(){
 
     delete fftImplementation;     
     fftImplementation = nullptr;   
+    delete simdImplementation;     
+    simdImplementation = nullptr;   
 
 }
 
-void pdsp::FFTWorker::initFFT(int bufferSize){
+void pdsp::FFTWorker::setDefaultBackend(FFTBackend_t backend){
+    defaultBackend = backend;
+}
+
+pdsp::FFTBackend_t pdsp::FFTWorker::getDefaultBackend(){
+    return static_cast<FFTBackend_t>( defaultBackend.load() );
+}
+
+void pdsp::FFTWorker::setBackend(FFTBackend_t backend){
+    selectedBackend = backend;
+    if(lastBufferSize != -1){
+        initFFT(lastBufferSize, lastBatchSize);
+    }
+}
+
+pdsp::FFTBackend_t pdsp::FFTWorker::getBackend() const{
+    if(selectedBackend == -1 && lastBufferSize == -1){
+        return getDefaultBackend(); // not initialized yet
+    }
+    return (selectedBackend == -1) ? backend : static_cast<FFTBackend_t>(selectedBackend);
+}
+
+void pdsp::FFTWorker::initFFT(int bufferSize, int batchSize){
+
+    FFTBackend_t wanted = (selectedBackend == -1) ? getDefaultBackend() : static_cast<FFTBackend_t>(selectedBackend);
+    if(batchSize < 1){ batchSize = 1; }
+
+    bool changed = (wanted != backend) || (fftImplementation == nullptr && simdImplementation == nullptr);
     
-    if(fftImplementation != nullptr && bufferSize!=lastBufferSize){
+    if( changed || bufferSize!=lastBufferSize || batchSize!=lastBatchSize ){
         
         lastBufferSize = bufferSize;
+        lastBatchSize = batchSize;
 
-        int signalBlockSize = 4;
-        while(signalBlockSize<=lastBufferSize){
-            signalBlockSize *=2;
+        int signalBlockSize = getFFTBlockSize(lastBufferSize);
+
+        if(changed){
+            backend = wanted;
+            createImplementation();
         }
 
-        fftImplementation->init(signalBlockSize);
-        complexSize = audiofft::AudioFFT::ComplexSize(signalBlockSize);
+        if(backend == SimdFFTBackend){
+            simdImplementation->init(signalBlockSize, batchSize);
+        }else{
+            fftImplementation->init(signalBlockSize);
+        }
+        complexSize = getFFTComplexSize(lastBufferSize);
         blockSize = signalBlockSize;
     }
 
 }
 
+void pdsp::FFTWorker::createImplementation(){
+    delete fftImplementation;     
+    fftImplementation = nullptr;   
+    delete simdImplementation;     
+    simdImplementation = nullptr;   
+
+    if(backend == SimdFFTBackend){
+        simdImplementation = new SimdFFT();
+    }else{
+        fftImplementation = new audiofft::AudioFFT();
+    }
+}
+
+int pdsp::FFTWorker::getFFTBlockSize(int bufferSize){
+        int signalBlockSize = 4;
+        while(signalBlockSize<=bufferSize){
+            signalBlockSize *=2;
+        }
+        return signalBlockSize;
+}
+
+int pdsp::FFTWorker::getFFTComplexSize(int bufferSize){
+        return audiofft::AudioFFT::ComplexSize(getFFTBlockSize(bufferSize));
+}
+
 int pdsp::FFTWorker::getFFTComplexSize() const{
         return complexSize;
 }
@@ -45,9 +112,37 @@ int pdsp::FFTWorker::getFFTBlockSize() const{
 
 
 void pdsp::FFTWorker::FFT (const float* inSignal, float* re, float* im){
-        fftImplementation->fft(inSignal, re, im);
+        if(simdImplementation != nullptr){
+                simdImplementation->fft(inSignal, re, im);
+        }else{
+                fftImplementation->fft(inSignal, re, im);
+        }
 }
 
 void pdsp::FFTWorker::iFFT (float* outSignal, const float* re, const float* im){
-        fftImplementation->ifft(outSignal, re, im);
+        if(simdImplementation != nullptr){
+                simdImplementation->ifft(outSignal, re, im);
+        }else{
+                fftImplementation->ifft(outSignal, re, im);
+        }
+}
+
+void pdsp::FFTWorker::FFT (const float* const* inSignals, float* const* re, float* const* im, int count){
+        if(simdImplementation != nullptr){
+                simdImplementation->fft(inSignals, re, im, count);
+        }else{
+                for(int i=0; i<count; ++i){
+                        fftImplementation->fft(inSignals[i], re[i], im[i]);
+                }
+        }
+}
+
+void pdsp::FFTWorker::iFFT (float* const* outSignals, const float* const* re, const float* const* im, int count){
+        if(simdImplementation != nullptr){
+                simdImplementation->ifft(outSignals, re, im, count);
+        }else{
+                for(int i=0; i<count; ++i){
+                        fftImplementation->ifft(outSignals[i], re[i], im[i]);
+                }
+        }
 }
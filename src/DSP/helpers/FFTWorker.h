@@ -8,13 +8,15 @@
 
 #include "../pdspConstants.h"
 #include "../../math/header.h"
+#include "SimdFFT.h"
+#include <atomic>
 
 namespace pdsp{
         
     /*!
     @brief Class to use an FFT Implementation 
     
-    This manage the instantiation and initialization of an FFT algorithm to be used into subclasses. It use the AudioFFT library so the implementation is chosen at compile time setting the right flag. 
+    This manage the instantiation and initialization of an FFT algorithm to be used into subclasses. There are two backends, selectable at runtime: AudioFFTBackend uses the AudioFFT library, so the implementation is chosen at compile time setting the right flag (Ooura if no flag is set), SimdFFTBackend is a built-in real FFT vectorized with ofxSIMDFloats. Both use the same split complex format and scaling. The default is AudioFFTBackend, SimdFFTBackend has to be selected with setDefaultBackend() or setBackend(). 
     */        
 
 class FFTWorker {
@@ -24,8 +26,32 @@ public:
     
     /*!
     @brief inits the fft
+    @param[in] bufferSize the fft block size is the first power of 2 greater than this
+    @param[in] batchSize number of signals transformed together by the batch FFT() and iFFT(), 1 if not given
     */    
-    void initFFT(int bufferSize);
+    void initFFT(int bufferSize, int batchSize=1);
+
+    /*!
+    @brief sets the backend of this FFTWorker, overriding the default one. Takes effect immediately if the fft is already initialized.
+    @param[in] backend AudioFFTBackend or SimdFFTBackend
+    */    
+    void setBackend(FFTBackend_t backend);
+
+    /*!
+    @brief returns the backend used by this FFTWorker
+    */    
+    FFTBackend_t getBackend() const;
+
+    /*!
+    @brief sets the default backend. It is used by all the FFTWorkers without a backend set with setBackend() the next time they are initialized, so call it before preparing the engine to play. This method is thread-safe.
+    @param[in] backend AudioFFTBackend or SimdFFTBackend
+    */    
+    static void setDefaultBackend(FFTBackend_t backend);
+
+    /*!
+    @brief returns the default backend. This method is thread-safe.
+    */    
+    static FFTBackend_t getDefaultBackend();
  
     /*!
     @brief returns the fft block size, usually the first power of 2 greater than the audio buffer size.
@@ -36,6 +62,18 @@ public:
     @brief returns the fft block size == half the block size
     */      
     int getFFTComplexSize() const;
+
+    /*!
+    @brief returns the fft block size that initFFT() would choose for the given buffer size, without initializing anything
+    @param[in] bufferSize buffer size as given to initFFT()
+    */      
+    static int getFFTBlockSize(int bufferSize);
+
+    /*!
+    @brief returns the complex size that initFFT() would choose for the given buffer size, without initializing anything
+    @param[in] bufferSize buffer size as given to initFFT()
+    */      
+    static int getFFTComplexSize(int bufferSize);
     
     /*!
     @brief performs FFT
@@ -53,11 +91,38 @@ public:
     */       
     void    iFFT (float* outSignal, const float* re, const float* im);
 
+    /*!
+    @brief performs the FFT of many signals, for example one for each channel. With SimdFFTBackend the signals are transformed together, batchSize at a time, sharing the twiddle factors.
+    @param[in] inSignals signals to process (time domain)
+    @param[out] re real part outputs (frequency domain)
+    @param[out] im imaginary part outputs (frequency domain)
+    @param[in] count number of signals
+    */        
+    void    FFT  (const float* const* inSignals, float* const* re, float* const* im, int count);
+    
+    /*!
+    @brief performs the iFFT of many signals, see the batch FFT()
+    @param[out] outSignals signal outputs (time domain)
+    @param[in] re real part inputs (frequency domain)
+    @param[in] im imaginary part inputs (frequency domain)
+    @param[in] count number of signals
+    */       
+    void    iFFT (float* const* outSignals, const float* const* re, const float* const* im, int count);
+
 private:
+    void createImplementation();
+
     int blockSize;
     int complexSize;
     audiofft::AudioFFTBase* fftImplementation;
+    SimdFFT* simdImplementation;
     int lastBufferSize;
+    int lastBatchSize;
+
+    int selectedBackend; // -1 for the default one
+    FFTBackend_t backend;
+
+    static std::atomic<int> defaultBackend;
 
 };
     
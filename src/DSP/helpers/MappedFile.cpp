@@ -0,0 +1,121 @@
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+pdsp::MappedFile::MappedFile(){
+    mapped = nullptr;
+    length = 0;
+#ifdef _WIN32
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+#else
+    fileDescriptor = -1;
+#endif
+}
+
+pdsp::MappedFile::~MappedFile(){
+    close();
+}
+
+bool pdsp::MappedFile::isOpen() const {
+    return mapped != nullptr;
+}
+
+const uint8_t* pdsp::MappedFile::data() const {
+    return mapped;
+}
+
+size_t pdsp::MappedFile::size() const {
+    return length;
+}
+
+#ifdef _WIN32
+
+bool pdsp::MappedFile::open( std::string path ){
+    close();
+
+    HANDLE file = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    if( file == INVALID_HANDLE_VALUE ){ return false; }
+
+    LARGE_INTEGER fileSize;
+    if( !GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart == 0 ){
+        CloseHandle( file );
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+    if( mapping == NULL ){
+        CloseHandle( file );
+        return false;
+    }
+
+    void* view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+    if( view == NULL ){
+        CloseHandle( mapping );
+        CloseHandle( file );
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    mapped = static_cast<const uint8_t*>( view );
+    length = static_cast<size_t>( fileSize.QuadPart );
+    return true;
+}
+
+void pdsp::MappedFile::close(){
+    if( mapped != nullptr ){ UnmapViewOfFile( mapped ); }
+    if( mappingHandle != nullptr ){ CloseHandle( (HANDLE) mappingHandle ); }
+    if( fileHandle != nullptr ){ CloseHandle( (HANDLE) fileHandle ); }
+    mapped = nullptr;
+    length = 0;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+}
+
+#else
+
+bool pdsp::MappedFile::open( std::string path ){
+    close();
+
+    int fd = ::open( path.c_str(), O_RDONLY );
+    if( fd < 0 ){ return false; }
+
+    struct stat info;
+    if( fstat( fd, &info ) != 0 || info.st_size == 0 ){
+        ::close( fd );
+        return false;
+    }
+
+    void* view = mmap( nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if( view == MAP_FAILED ){
+        ::close( fd );
+        return false;
+    }
+
+    fileDescriptor = fd;
+    mapped = static_cast<const uint8_t*>( view );
+    length = static_cast<size_t>( info.st_size );
+    return true;
+}
+
+void pdsp::MappedFile::close(){
+    if( mapped != nullptr ){ munmap( const_cast<uint8_t*>( mapped ), length ); }
+    if( fileDescriptor >= 0 ){ ::close( fileDescriptor ); }
+    mapped = nullptr;
+    length = 0;
+    fileDescriptor = -1;
+}
+
+#endif
@@ -0,0 +1,54 @@
+
+// MappedFile.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_HELPERS_MAPPEDFILE_H_INCLUDED
+#define PDSP_HELPERS_MAPPEDFILE_H_INCLUDED
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+
+namespace pdsp{
+
+// read-only memory mapping of a whole file (mmap, or a file mapping on Windows)
+class MappedFile {
+
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile( const MappedFile & other ) = delete;
+    MappedFile& operator= ( const MappedFile & other ) = delete;
+
+    // maps the file, returns false if it doesn't exist or it is empty
+    bool open( std::string path );
+    void close();
+
+    bool isOpen() const;
+    const uint8_t* data() const;
+    size_t size() const;
+
+private:
+    const uint8_t*  mapped;
+    size_t          length;
+
+#ifdef _WIN32
+    void*           fileHandle;
+    void*           mappingHandle;
+#else
+    int             fileDescriptor;
+#endif
+};
+
+}//END NAMESPACE
+
+/*!
+    @endcond
+*/
+
+#endif  // PDSP_HELPERS_MAPPEDFILE_H_INCLUDED
@@ -0,0 +1,392 @@
+
+#include "SimdFFT.h"
+#include <cmath>
+#include <utility>
+
+pdsp::SimdFFT::SimdFFT(){
+    size = 0;
+    half = 0;
+    batchSize = 0;
+    twiddleR = nullptr;
+    twiddleI = nullptr;
+    splitR = nullptr;
+    splitI = nullptr;
+    workR = nullptr;
+    workI = nullptr;
+    tempR = nullptr;
+    tempI = nullptr;
+    srcR = nullptr;
+    srcI = nullptr;
+    dstR = nullptr;
+    dstI = nullptr;
+}
+
+pdsp::SimdFFT::~SimdFFT(){
+    deallocate();
+}
+
+void pdsp::SimdFFT::deallocate(){
+
+    if(twiddleR != nullptr){ ofx_deallocate_aligned(twiddleR); }
+    if(twiddleI != nullptr){ ofx_deallocate_aligned(twiddleI); }
+    if(splitR != nullptr){ ofx_deallocate_aligned(splitR); }
+    if(splitI != nullptr){ ofx_deallocate_aligned(splitI); }
+
+    float** buffers[4] = { workR, workI, tempR, tempI };
+    for(int d=0; d<4; ++d){
+        if(buffers[d] != nullptr){
+            for(int b=0; b<batchSize; ++b){
+                if(buffers[d][b] != nullptr){ ofx_deallocate_aligned(buffers[d][b]); }
+            }
+            delete[] buffers[d];
+        }
+    }
+    workR = workI = tempR = tempI = nullptr;
+
+    delete[] srcR;
+    delete[] srcI;
+    delete[] dstR;
+    delete[] dstI;
+    srcR = srcI = dstR = dstI = nullptr;
+
+    size = 0;
+    half = 0;
+    batchSize = 0;
+}
+
+void pdsp::SimdFFT::init( int size, int batchSize ){
+
+    if(batchSize < 1){ batchSize = 1; }
+    if(size == this->size && batchSize == this->batchSize){
+        return;
+    }
+
+    deallocate();
+
+    this->size = size;
+    this->batchSize = batchSize;
+    half = size / 2;
+
+    const double pi = 3.14159265358979323846;
+
+    ofx_allocate_aligned(twiddleR, half);
+    ofx_allocate_aligned(twiddleI, half);
+    for(int k=0; k<half; ++k){
+        double phase = -2.0 * pi * k / half;
+        twiddleR[k] = (float) cos(phase);
+        twiddleI[k] = (float) sin(phase);
+    }
+
+    ofx_allocate_aligned(splitR, half/2 + 1);
+    ofx_allocate_aligned(splitI, half/2 + 1);
+    for(int k=0; k<=half/2; ++k){
+        double phase = -2.0 * pi * k / size;
+        splitR[k] = (float) cos(phase);
+        splitI[k] = (float) sin(phase);
+    }
+
+    workR = new float* [batchSize];
+    workI = new float* [batchSize];
+    tempR = new float* [batchSize];
+    tempI = new float* [batchSize];
+    for(int b=0; b<batchSize; ++b){
+        ofx_allocate_aligned(workR[b], half);
+        ofx_allocate_aligned(workI[b], half);
+        ofx_allocate_aligned(tempR[b], half);
+        ofx_allocate_aligned(tempI[b], half);
+    }
+
+    srcR = new float* [batchSize];
+    srcI = new float* [batchSize];
+    dstR = new float* [batchSize];
+    dstI = new float* [batchSize];
+}
+
+
+void pdsp::SimdFFT::fft( const float* data, float* re, float* im ) noexcept {
+    fftBatch( &data, &re, &im, 1 );
+}
+
+void pdsp::SimdFFT::ifft( float* data, const float* re, const float* im ) noexcept {
+    ifftBatch( &data, &re, &im, 1 );
+}
+
+void pdsp::SimdFFT::fft( const float* const* data, float* const* re, float* const* im, int count ) noexcept {
+    for(int i=0; i<count; i+=batchSize){
+        int n = count - i;
+        if(n > batchSize){ n = batchSize; }
+        fftBatch( data + i, re + i, im + i, n );
+    }
+}
+
+void pdsp::SimdFFT::ifft( float* const* data, const float* const* re, const float* const* im, int count ) noexcept {
+    for(int i=0; i<count; i+=batchSize){
+        int n = count - i;
+        if(n > batchSize){ n = batchSize; }
+        ifftBatch( data + i, re + i, im + i, n );
+    }
+}
+
+
+void pdsp::SimdFFT::fftBatch( const float* const* data, float* const* re, float* const* im, int count ) noexcept {
+
+    // even samples to the real part and odd samples to the imaginary part
+    for(int b=0; b<count; ++b){
+        const float* x = data[b];
+        float* zr = workR[b];
+        float* zi = workI[b];
+        for(int n=0; n<half; ++n){
+            zr[n] = x[2*n];
+            zi[n] = x[2*n+1];
+        }
+    }
+
+    bool inWork = transform(count);
+
+    // splits the spectrum of the packed signal into the spectrum of the real signal
+    for(int b=0; b<count; ++b){
+        const float* zr = inWork ? workR[b] : tempR[b];
+        const float* zi = inWork ? workI[b] : tempI[b];
+        float* xr = re[b];
+        float* xi = im[b];
+
+        xr[0] = zr[0] + zi[0];
+        xi[0] = 0.0f;
+        xr[half] = zr[0] - zi[0];
+        xi[half] = 0.0f;
+
+        for(int k=1; k<=half/2; ++k){
+            int j = half - k;
+            float evenR = 0.5f * (zr[k] + zr[j]);
+            float evenI = 0.5f * (zi[k] - zi[j]);
+            float oddR  = 0.5f * (zi[k] + zi[j]);
+            float oddI  = 0.5f * (zr[j] - zr[k]);
+            float tr = splitR[k] * oddR - splitI[k] * oddI;
+            float ti = splitR[k] * oddI + splitI[k] * oddR;
+            xr[k] = evenR + tr;
+            xi[k] = evenI + ti;
+            xr[j] = evenR - tr;
+            xi[j] = ti - evenI;
+        }
+    }
+}
+
+
+void pdsp::SimdFFT::ifftBatch( float* const* data, const float* const* re, const float* const* im, int count ) noexcept {
+
+    // packs the spectrum of the real signal as the spectrum of a half size complex signal
+    // real and imaginary parts are swapped, so the forward transform gives the inverse one
+    float scale = 0.5f / half;
+    for(int b=0; b<count; ++b){
+        const float* xr = re[b];
+        const float* xi = im[b];
+        float* zr = workI[b];
+        float* zi = workR[b];
+
+        zr[0] = scale * (xr[0] + xr[half]);
+        zi[0] = scale * (xr[0] - xr[half]);
+
+        for(int k=1; k<=half/2; ++k){
+            int j = half - k;
+            float evenR = xr[k] + xr[j];
+            float evenI = xi[k] - xi[j];
+            float diffR = xr[k] - xr[j];
+            float diffI = xi[k] + xi[j];
+            float oddR  = diffR * splitR[k] + diffI * splitI[k];
+            float oddI  = diffI * splitR[k] - diffR * splitI[k];
+            zr[k] = scale * (evenR - oddI);
+            zi[k] = scale * (evenI + oddR);
+            zr[j] = scale * (evenR + oddI);
+            zi[j] = scale * (oddR - evenI);
+        }
+    }
+
+    bool inWork = transform(count);
+
+    for(int b=0; b<count; ++b){
+        const float* zr = inWork ? workI[b] : tempI[b];
+        const float* zi = inWork ? workR[b] : tempR[b];
+        float* x = data[b];
+        for(int n=0; n<half; ++n){
+            x[2*n]   = zr[n];
+            x[2*n+1] = zi[n];
+        }
+    }
+}
+
+
+bool pdsp::SimdFFT::transform( int count ) noexcept {
+
+    float** xr = srcR;
+    float** xi = srcI;
+    float** yr = dstR;
+    float** yi = dstI;
+    for(int b=0; b<count; ++b){
+        xr[b] = workR[b];
+        xi[b] = workI[b];
+        yr[b] = tempR[b];
+        yi[b] = tempI[b];
+    }
+
+    bool inWork = true;
+    int n = half;
+    int s = 1;
+    while(n >= 4){
+        radix4( n, s, xr, xi, yr, yi, count );
+        n /= 4;
+        s *= 4;
+        std::swap(xr, yr);
+        std::swap(xi, yi);
+        inWork = !inWork;
+    }
+    if(n == 2){
+        radix2( s, xr, xi, yr, yi, count );
+        inWork = !inWork;
+    }
+
+    return inWork;
+}
+
+
+void pdsp::SimdFFT::radix4( int n, int s, float** xr, float** xi, float** yr, float** yi, int count ) noexcept {
+
+    int m = n / 4;
+
+    for(int p=0; p<m; ++p){
+        // the twiddles are shared by all the signals of the batch
+        float w1r = twiddleR[p*s];
+        float w1i = twiddleI[p*s];
+        float w2r = twiddleR[2*p*s];
+        float w2i = twiddleI[2*p*s];
+        float w3r = twiddleR[3*p*s];
+        float w3i = twiddleI[3*p*s];
+
+        int a = s*p;
+        int y = s*4*p;
+
+        for(int b=0; b<count; ++b){
+            const float* ar = xr[b] + a;         const float* ai = xi[b] + a;
+            const float* br = ar + s*m;          const float* bi = ai + s*m;
+            const float* cr = br + s*m;          const float* ci = bi + s*m;
+            const float* dr = cr + s*m;          const float* di = ci + s*m;
+            float* y0r = yr[b] + y;              float* y0i = yi[b] + y;
+            float* y1r = y0r + s;                float* y1i = y0i + s;
+            float* y2r = y1r + s;                float* y2i = y1i + s;
+            float* y3r = y2r + s;                float* y3i = y2i + s;
+
+            int q=0;
+            if(s >= 4){
+                ofx::f128 w1r_v = ofx::m_set1(w1r);
+                ofx::f128 w1i_v = ofx::m_set1(w1i);
+                ofx::f128 w2r_v = ofx::m_set1(w2r);
+                ofx::f128 w2i_v = ofx::m_set1(w2i);
+                ofx::f128 w3r_v = ofx::m_set1(w3r);
+                ofx::f128 w3i_v = ofx::m_set1(w3i);
+
+                for(; q<s; q+=4){
+                    ofx::f128 ar_v = ofx::m_load(ar + q);
+                    ofx::f128 ai_v = ofx::m_load(ai + q);
+                    ofx::f128 br_v = ofx::m_load(br + q);
+                    ofx::f128 bi_v = ofx::m_load(bi + q);
+                    ofx::f128 cr_v = ofx::m_load(cr + q);
+                    ofx::f128 ci_v = ofx::m_load(ci + q);
+                    ofx::f128 dr_v = ofx::m_load(dr + q);
+                    ofx::f128 di_v = ofx::m_load(di + q);
+
+                    ofx::f128 apcR = ofx::m_add(ar_v, cr_v);
+                    ofx::f128 apcI = ofx::m_add(ai_v, ci_v);
+                    ofx::f128 amcR = ofx::m_sub(ar_v, cr_v);
+                    ofx::f128 amcI = ofx::m_sub(ai_v, ci_v);
+                    ofx::f128 bpdR = ofx::m_add(br_v, dr_v);
+                    ofx::f128 bpdI = ofx::m_add(bi_v, di_v);
+                    ofx::f128 bmdR = ofx::m_sub(br_v, dr_v);
+                    ofx::f128 bmdI = ofx::m_sub(bi_v, di_v);
+
+                    ofx::m_store(y0r + q, ofx::m_add(apcR, bpdR));
+                    ofx::m_store(y0i + q, ofx::m_add(apcI, bpdI));
+
+                    // (a - c) - i (b - d)
+                    ofx::f128 ur = ofx::m_add(amcR, bmdI);
+                    ofx::f128 ui = ofx::m_sub(amcI, bmdR);
+                    ofx::m_store(y1r + q, ofx::m_sub(ofx::m_mul(ur, w1r_v), ofx::m_mul(ui, w1i_v)));
+                    ofx::m_store(y1i + q, ofx::m_add(ofx::m_mul(ur, w1i_v), ofx::m_mul(ui, w1r_v)));
+
+                    // (a + c) - (b + d)
+                    ur = ofx::m_sub(apcR, bpdR);
+                    ui = ofx::m_sub(apcI, bpdI);
+                    ofx::m_store(y2r + q, ofx::m_sub(ofx::m_mul(ur, w2r_v), ofx::m_mul(ui, w2i_v)));
+                    ofx::m_store(y2i + q, ofx::m_add(ofx::m_mul(ur, w2i_v), ofx::m_mul(ui, w2r_v)));
+
+                    // (a - c) + i (b - d)
+                    ur = ofx::m_sub(amcR, bmdI);
+                    ui = ofx::m_add(amcI, bmdR);
+                    ofx::m_store(y3r + q, ofx::m_sub(ofx::m_mul(ur, w3r_v), ofx::m_mul(ui, w3i_v)));
+                    ofx::m_store(y3i + q, ofx::m_add(ofx::m_mul(ur, w3i_v), ofx::m_mul(ui, w3r_v)));
+                }
+            }
+
+            for(; q<s; ++q){
+                float apcR = ar[q] + cr[q];
+                float apcI = ai[q] + ci[q];
+                float amcR = ar[q] - cr[q];
+                float amcI = ai[q] - ci[q];
+                float bpdR = br[q] + dr[q];
+                float bpdI = bi[q] + di[q];
+                float bmdR = br[q] - dr[q];
+                float bmdI = bi[q] - di[q];
+
+                y0r[q] = apcR + bpdR;
+                y0i[q] = apcI + bpdI;
+
+                float ur = amcR + bmdI;
+                float ui = amcI - bmdR;
+                y1r[q] = ur * w1r - ui * w1i;
+                y1i[q] = ur * w1i + ui * w1r;
+
+                ur = apcR - bpdR;
+                ui = apcI - bpdI;
+                y2r[q] = ur * w2r - ui * w2i;
+                y2i[q] = ur * w2i + ui * w2r;
+
+                ur = amcR - bmdI;
+                ui = amcI + bmdR;
+                y3r[q] = ur * w3r - ui * w3i;
+                y3i[q] = ur * w3i + ui * w3r;
+            }
+        }
+    }
+}
+
+
+void pdsp::SimdFFT::radix2( int s, float** xr, float** xi, float** yr, float** yi, int count ) noexcept {
+
+    // last stage, only the unit twiddle
+    for(int b=0; b<count; ++b){
+        const float* ar = xr[b];        const float* ai = xi[b];
+        const float* br = ar + s;       const float* bi = ai + s;
+        float* y0r = yr[b];             float* y0i = yi[b];
+        float* y1r = y0r + s;           float* y1i = y0i + s;
+
+        int q=0;
+        if(s >= 4){
+            for(; q<s; q+=4){
+                ofx::f128 ar_v = ofx::m_load(ar + q);
+                ofx::f128 ai_v = ofx::m_load(ai + q);
+                ofx::f128 br_v = ofx::m_load(br + q);
+                ofx::f128 bi_v = ofx::m_load(bi + q);
+                ofx::m_store(y0r + q, ofx::m_add(ar_v, br_v));
+                ofx::m_store(y0i + q, ofx::m_add(ai_v, bi_v));
+                ofx::m_store(y1r + q, ofx::m_sub(ar_v, br_v));
+                ofx::m_store(y1i + q, ofx::m_sub(ai_v, bi_v));
+            }
+        }
+        for(; q<s; ++q){
+            float r0 = ar[q];
+            float i0 = ai[q];
+            y0r[q] = r0 + br[q];
+            y0i[q] = i0 + bi[q];
+            y1r[q] = r0 - br[q];
+            y1i[q] = i0 - bi[q];
+        }
+    }
+}
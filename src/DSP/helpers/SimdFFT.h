@@ -0,0 +1,76 @@
+
+// SimdFFT.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_HELPERS_SIMDFFT_H_INCLUDED
+#define PDSP_HELPERS_SIMDFFT_H_INCLUDED
+
+#include "../pdspConstants.h"
+#include "../../math/header.h"
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+
+namespace pdsp{
+
+// real FFT for power of two sizes, with the same split complex layout and scaling of audiofft::AudioFFT
+// the real signal is packed in a complex signal of half size, transformed with radix-4 Stockham stages
+// the stages with a stride of at least 4 are vectorized with ofx::f128, inputs and outputs don't need to be aligned
+class SimdFFT {
+
+public:
+    SimdFFT();
+    ~SimdFFT();
+    SimdFFT( const SimdFFT & other ) = delete;
+    SimdFFT& operator= ( const SimdFFT & other ) = delete;
+
+    // size is the real signal size, batchSize is the number of signals transformed together by the batch methods
+    void init( int size, int batchSize );
+
+    void fft( const float* data, float* re, float* im ) noexcept;
+    void ifft( float* data, const float* re, const float* im ) noexcept;
+
+    // more than batchSize signals are transformed in more batches
+    void fft( const float* const* data, float* const* re, float* const* im, int count ) noexcept;
+    void ifft( float* const* data, const float* const* re, const float* const* im, int count ) noexcept;
+
+private:
+    void deallocate();
+
+    void fftBatch( const float* const* data, float* const* re, float* const* im, int count ) noexcept;
+    void ifftBatch( float* const* data, const float* const* re, const float* const* im, int count ) noexcept;
+
+    // forward complex FFT of the first count work buffers, returns true if the result is in workR/workI
+    bool transform( int count ) noexcept;
+    void radix4( int n, int s, float** xr, float** xi, float** yr, float** yi, int count ) noexcept;
+    void radix2( int s, float** xr, float** xi, float** yr, float** yi, int count ) noexcept;
+
+    int         size;
+    int         half;       // size of the packed complex signal
+    int         batchSize;
+
+    float*      twiddleR;   // exp( -i 2 pi k / half ), k in [0, half)
+    float*      twiddleI;
+    float*      splitR;     // exp( -i 2 pi k / size ), k in [0, half/2]
+    float*      splitI;
+
+    // two ping-pong complex buffers for each signal of the batch
+    float**     workR;
+    float**     workI;
+    float**     tempR;
+    float**     tempI;
+    float**     srcR;
+    float**     srcI;
+    float**     dstR;
+    float**     dstI;
+};
+
+}//END NAMESPACE
+
+/*!
+    @endcond
+*/
+
+#endif  // PDSP_HELPERS_SIMDFFT_H_INCLUDED
@@ -47,6 +47,10 @@ void pdsp::UsesSlew::setSlewRateModeReference(float valueReference){
 
 void pdsp::UsesSlew::valueChange( const float &slewValueDest ) noexcept{
     
+    if( !slewRun && slewValueDest == slewLastValue ){ 
+        return; // already there, the output can stay at control rate
+    }
+    
     if(slewTimeMod <=0.0f){
         slewLastValue = slewValueDest;
         slewRun = false;
@@ -74,27 +78,36 @@ void pdsp::UsesSlew::valueChange( const float &slewValueDest ) noexcept{
 }
 
 
+// the accumulator converges exponentially to 1.0f + slewTCO, so each segment is computed in closed form
 void pdsp::UsesSlew::runSlewBlock(float* &buffer, const int &start, const int &stopExclusive) noexcept{
     
-	int n = start;
-    
-	for( ; n<stopExclusive; ++n){
-		buffer[n] = slewValueStart + slewAccumulator * slewValueInterval;
-		slewAccumulator = slewOffset + (slewAccumulator * slewCoeff);
-		if(slewAccumulator>=1.0f){
-			slewAccumulator = 1.0f;
-			slewRun = false;
-			break;
-		}
-	}
-	        
-	if( !slewRun && n<stopExclusive){
-        n++; //as the break stops the increments
-		ofx_Aeq_S_range(buffer, slewValueDest, n, stopExclusive);
-        slewLastValue = slewValueDest;
-                
-	}else if(start!=stopExclusive) {
+    if( start >= stopExclusive ){ return; }
+
+    float converge = 1.0f + slewTCO;
+    float distance = converge - slewAccumulator;
+
+    // samples before the accumulator reaches 1.0f
+    int remaining = 1;
+    if( slewCoeff > 0.0f && distance > slewTCO ){
+        remaining = (int) std::ceil( std::log( slewTCO / distance ) / std::log( slewCoeff ) );
+        if( remaining < 1 ){ remaining = 1; }
+    }
+
+    int stopRamp = stopExclusive;
+    if( remaining <= stopExclusive - start ){
+        stopRamp = start + remaining;
+        slewRun = false;
+    }
+
+    genExpRamp( buffer, start, stopRamp, slewValueStart + converge * slewValueInterval, distance * slewValueInterval, slewCoeff );
+
+    if( slewRun ){
+        slewAccumulator = converge - distance * std::pow( slewCoeff, (float)( stopExclusive - start ) );
         slewLastValue = buffer[stopExclusive-1];
+    }else{
+        slewAccumulator = 1.0f;
+        ofx_Aeq_S_range(buffer, slewValueDest, stopRamp, stopExclusive);
+        slewLastValue = slewValueDest;
     }
         
 }
@@ -0,0 +1,227 @@
+
+#include "STFT.h"
+#include <cstring>
+#include <algorithm>
+
+pdsp::STFT::STFT(){
+
+        addInput("signal", input);
+        addOutput("signal", output);
+        updateOutputNodes();
+
+        frameSize = 1024;
+        hopSize = 256;
+        zeroPadding = 1;
+        windowType = Hann;
+        resynthesis = true;
+        sampleRate = 44100.0;
+
+        fftSize = 0;
+        complexSize = 0;
+        filled = 0;
+
+        frame = nullptr;
+        fftBuffer = nullptr;
+        re = nullptr;
+        im = nullptr;
+        analysisWindow = nullptr;
+        synthesisWindow = nullptr;
+        accumulator = nullptr;
+        hop = nullptr;
+
+        if(dynamicConstruction){
+                prepareUnit(globalBufferSize, globalSampleRate);
+        }
+}
+
+pdsp::STFT::~STFT(){
+        deallocate();
+}
+
+pdsp::Patchable& pdsp::STFT::in_signal(){
+    return in("signal");
+}
+
+pdsp::Patchable& pdsp::STFT::out_signal(){
+    return out("signal");
+}
+
+void pdsp::STFT::setup( int frameSize, int hopSize, Window_t window, int zeroPadding ){
+        if(frameSize < 4){ frameSize = 4; }
+        if(hopSize < 1){ hopSize = 1; }
+        if(hopSize > frameSize){ hopSize = frameSize; }
+        if(zeroPadding < 1){ zeroPadding = 1; }
+
+        this->frameSize = frameSize;
+        this->hopSize = hopSize;
+        this->windowType = window;
+        this->zeroPadding = zeroPadding;
+
+        if(dynamicConstruction){
+                allocate();
+        }
+}
+
+int pdsp::STFT::getLatency() const {
+        return frameSize;
+}
+
+int pdsp::STFT::getFrameSize() const {
+        return frameSize;
+}
+
+int pdsp::STFT::getHopSize() const {
+        return hopSize;
+}
+
+int pdsp::STFT::getFFTSize() const {
+        return fftSize;
+}
+
+int pdsp::STFT::getComplexSize() const {
+        return complexSize;
+}
+
+void pdsp::STFT::setResynthesis( bool active ){
+        resynthesis = active;
+}
+
+double pdsp::STFT::getSampleRate() const {
+        return sampleRate;
+}
+
+const float* pdsp::STFT::getAnalysisWindow() const {
+        return analysisWindow;
+}
+
+void pdsp::STFT::prepareUnit( int expectedBufferSize, double sampleRate ) {
+        this->sampleRate = sampleRate;
+        allocate();
+}
+
+void pdsp::STFT::releaseResources () {
+        deallocate();
+}
+
+void pdsp::STFT::allocate(){
+
+        deallocate();
+
+        // initFFT takes the first power of 2 greater than the given size
+        fft.initFFT( frameSize * zeroPadding - 1 );
+        fftSize = fft.getFFTBlockSize();
+        complexSize = fft.getFFTComplexSize();
+
+        ofx_allocate_aligned(frame, frameSize);
+        ofx_allocate_aligned(fftBuffer, fftSize);
+        ofx_allocate_aligned(re, complexSize);
+        ofx_allocate_aligned(im, complexSize);
+        ofx_allocate_aligned(accumulator, frameSize);
+        ofx_allocate_aligned(hop, hopSize);
+        ofx_allocate_aligned(synthesisWindow, frameSize);
+
+        ofx_Aeq_Zero(frame, frameSize);
+        ofx_Aeq_Zero(fftBuffer, fftSize);
+        ofx_Aeq_Zero(re, complexSize);
+        ofx_Aeq_Zero(im, complexSize);
+        ofx_Aeq_Zero(accumulator, frameSize);
+        ofx_Aeq_Zero(hop, hopSize);
+
+        // the table is the symmetric window of frameSize values, its last value is a copy of the first one
+        // the symmetric Hann window is zero at both the ends of the frame
+        analysisWindow = window( windowType, frameSize );
+
+        // overlap-adding the frames windowed two times sums the squared windows of the overlapping frames,
+        // dividing the synthesis window by this sum gives perfect reconstruction wherever the sum is not zero
+        // the samples where all the overlapping windows are zero are lost, e.g. the ends of Hann frames with hop == frameSize
+        for(int n=0; n<frameSize; ++n){
+                double sum = 0.0;
+                for(int k = n % hopSize; k<frameSize; k+=hopSize){
+                        sum += analysisWindow[k] * analysisWindow[k];
+                }
+                synthesisWindow[n] = (sum > 1.0e-9) ? (float)( analysisWindow[n] / sum ) : 0.0f;
+        }
+
+        // the first frame is processed when the latency is over
+        filled = frameSize - hopSize;
+
+        prepareSTFT();
+}
+
+void pdsp::STFT::deallocate(){
+        ofx_deallocate_aligned(frame);
+        ofx_deallocate_aligned(fftBuffer);
+        ofx_deallocate_aligned(re);
+        ofx_deallocate_aligned(im);
+        ofx_deallocate_aligned(analysisWindow);
+        ofx_deallocate_aligned(synthesisWindow);
+        ofx_deallocate_aligned(accumulator);
+        ofx_deallocate_aligned(hop);
+}
+
+void pdsp::STFT::process (int bufferSize) noexcept {
+
+        int inputState;
+        const float* inputBuffer = processInput(input, inputState);
+
+        float* outputBuffer = nullptr;
+        if(resynthesis){
+                outputBuffer = getOutputBufferToFill(output);
+        }
+
+        // the buffers are processed in chunks up to the end of the current hop
+        int n = 0;
+        while(n < bufferSize){
+                int len = std::min( bufferSize - n, frameSize - filled );
+                int hopIndex = filled - (frameSize - hopSize);
+
+                if(inputState==AudioRate){
+                        std::memcpy( frame + filled, inputBuffer + n, sizeof(float) * len );
+                }else{
+                        std::fill( frame + filled, frame + filled + len, inputBuffer[0] );
+                }
+                if(resynthesis){
+                        std::memcpy( outputBuffer + n, hop + hopIndex, sizeof(float) * len );
+                }
+
+                filled += len;
+                n += len;
+
+                if(filled == frameSize){
+                        processHop();
+                        filled = frameSize - hopSize;
+                }
+        }
+
+        if(!resynthesis){
+                setOutputToZero(output);
+        }
+}
+
+void pdsp::STFT::processHop() noexcept {
+
+        int overlap = frameSize - hopSize;
+
+        ofx_Aeq_BmulC(fftBuffer, frame, analysisWindow, frameSize);
+        if(fftSize > frameSize){
+                std::fill( fftBuffer + frameSize, fftBuffer + fftSize, 0.0f );
+        }
+        fft.FFT(fftBuffer, re, im);
+
+        processFrame(re, im, complexSize);
+
+        if(resynthesis){
+                fft.iFFT(fftBuffer, re, im);
+
+                // the zero-padded part of the resynthesized frame is discarded
+                ofx_Aeq_BmulC(fftBuffer, fftBuffer, synthesisWindow, frameSize);
+                ofx_Aeq_BaddC(accumulator, accumulator, fftBuffer, frameSize);
+
+                // the first hopSize samples are complete, they are the output of the next hop
+                std::memcpy( hop, accumulator, sizeof(float) * hopSize );
+                std::memmove( accumulator, accumulator + hopSize, sizeof(float) * overlap );
+                std::fill( accumulator + overlap, accumulator + frameSize, 0.0f );
+        }
+
+        std::memmove( frame, frame + hopSize, sizeof(float) * overlap );
+}
@@ -0,0 +1,139 @@
+
+// STFT.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_SPECTRAL_STFT_H_INCLUDED
+#define PDSP_SPECTRAL_STFT_H_INCLUDED
+
+#include "../pdspCore.h"
+#include "../helpers/FFTWorker.h"
+
+namespace pdsp{
+/*!
+@brief Base class for the Units that process the signal in the frequency domain with a Short-Time Fourier Transform.
+
+The input is split in overlapping frames, each one is windowed, zero-padded and transformed, then processFrame() is called with the spectrum. If the resynthesis is active the modified spectrum is transformed back and overlap-added to the output, with the synthesis window normalized for perfect reconstruction, so a subclass that doesn't change the spectrum outputs the input delayed by getLatency() samples. The only exception are the samples where all the overlapping windows are zero, they are output as silence: the Hann window is zero at both the ends of the frame, so with a hop as long as the frame use a window that is not zero there, or a shorter hop. All the buffers are allocated when the Unit is prepared or setup, nothing is allocated while processing. To make a spectral processor inherit from this class and implement processFrame(), the subclass can add more inputs and outputs calling addInput(), addOutput() and updateOutputNodes() in its constructor.
+*/
+
+class STFT : public Unit {
+
+public:
+        STFT();
+        ~STFT();
+
+        /*!
+        @brief Sets "signal" as selected input and returns this Unit ready to be patched. This is the default input. This is the audio input of the analysis.
+        */
+        Patchable& in_signal();
+
+        /*!
+        @brief Sets "signal" as selected output and returns this Unit ready to be patched. This is the default output. This is the resynthesized output, delayed by getLatency() samples.
+        */
+        Patchable& out_signal();
+
+        /*!
+        @brief Sets the frames of the STFT. If the Unit is already playing the buffers are reallocated in the calling thread, so don't call it while the audio thread is processing this Unit. The default is frames of 1024 samples with an hop of 256 samples and an Hann window.
+        @param[in] frameSize length of the analysis frames in samples
+        @param[in] hopSize distance between the start of two frames in samples, clamped to frameSize
+        @param[in] window window applied to the frames before the analysis and after the resynthesis, Hann if not given
+        @param[in] zeroPadding the frames are zero-padded to an fft size of at least frameSize*zeroPadding, rounded up to a power of two. 1 if not given.
+        */
+        void setup( int frameSize, int hopSize, Window_t window = Hann, int zeroPadding = 1 );
+
+        /*!
+        @brief returns the latency of the resynthesized output in samples, it is equal to the frame size.
+        */
+        int getLatency() const;
+
+        /*!
+        @brief returns the length of the frames in samples
+        */
+        int getFrameSize() const;
+
+        /*!
+        @brief returns the distance between two frames in samples
+        */
+        int getHopSize() const;
+
+        /*!
+        @brief returns the size of the fft, the frame size with the zero padding
+        */
+        int getFFTSize() const;
+
+        /*!
+        @brief returns the number of bins of the spectra passed to processFrame(), half the fft size plus one
+        */
+        int getComplexSize() const;
+
+protected:
+        /*!
+        @brief called by the audio thread for each frame, after the analysis. re and im are the spectrum of the windowed frame, the bin k has a frequency of k * sampleRate / getFFTSize(). If the resynthesis is active the spectrum left in re and im is transformed back to the output, the imaginary parts of the first and last bin are ignored. The buffers are aligned for ofxSIMDFloats operations.
+        @param[in] re real parts of the spectrum
+        @param[in] im imaginary parts of the spectrum
+        @param[in] complexSize number of bins
+        */
+        virtual void processFrame( float* re, float* im, int complexSize ) noexcept = 0;
+
+        /*!
+        @brief activates or deactivates the resynthesis, the subclasses that only analyze the signal can deactivate it to skip the inverse transforms, the output is silent. The default is active.
+        @param[in] active true to resynthesize the output
+        */
+        void setResynthesis( bool active );
+
+        /*!
+        @brief returns the sample rate of the last preparation
+        */
+        double getSampleRate() const;
+
+        /*!
+        @brief returns the analysis window, frameSize values
+        */
+        const float* getAnalysisWindow() const;
+
+        /*!
+        @brief called after the STFT buffers are allocated, when the Unit is prepared or setup() is called. The subclasses can override it to allocate their buffers that depend on getComplexSize() or getSampleRate(). It is never called by the audio thread.
+        */
+        virtual void prepareSTFT() {};
+
+        // the subclasses overriding these methods have to call the STFT ones
+        void prepareUnit( int expectedBufferSize, double sampleRate ) override;
+        void releaseResources () override ;
+        void process (int bufferSize) noexcept override;
+
+private:
+        void allocate();
+        void deallocate();
+        void processHop() noexcept;
+
+        InputNode       input;
+        OutputNode      output;
+
+        int             frameSize;
+        int             hopSize;
+        int             fftSize;
+        int             complexSize;
+        int             zeroPadding;
+        Window_t        windowType;
+        bool            resynthesis;
+        double          sampleRate;
+
+        // samples of the next frame collected until now
+        int             filled;
+
+        FFTWorker       fft;
+
+        float*          frame;              // input samples of the next frame
+        float*          fftBuffer;
+        float*          re;
+        float*          im;
+        float*          analysisWindow;
+        float*          synthesisWindow;    // window divided by the overlapped squared windows
+        float*          accumulator;        // overlap-add of the resynthesized frames
+        float*          hop;                // resynthesized output of the current hop
+
+};
+
+}//END NAMESPACE
+
+#endif  // PDSP_SPECTRAL_STFT_H_INCLUDED
@@ -0,0 +1,328 @@
+
+#include "SpectralAnalyzer.h"
+#include <cmath>
+
+pdsp::SpectralAnalyzer::SpectralAnalyzer() : SpectralAnalyzer(16) {}
+
+pdsp::SpectralAnalyzer::SpectralAnalyzer( int bands ){
+
+        if(bands < 1){ bands = 1; }
+        this->bands = bands;
+
+        // the tags are stored before adding the outputs, addOutput() keeps the pointers
+        tags.resize(bands);
+        outputBands.resize(bands);
+        for(int i=0; i<bands; ++i){
+                tags[i] = "band" + std::to_string(i);
+        }
+        for(int i=0; i<bands; ++i){
+                addOutput( tags[i].c_str(), outputBands[i] );
+        }
+        addOutput("centroid", outputCentroid);
+        addOutput("flux", outputFlux);
+        addOutput("rolloff", outputRolloff);
+        addOutput("onset", outputOnset);
+        updateOutputNodes();
+
+        loFreq = 40.0f;
+        hiFreq = 16000.0f;
+        rolloffRatio = 0.85f;
+        onsetTime = 250.0f;
+
+        complexSize = 0;
+        magnitude = nullptr;
+        power = nullptr;
+        lastMagnitude = nullptr;
+        binFreqs = nullptr;
+        bandBins.resize(bands+1, 0);
+        powerToRMS = 0.0f;
+        magToAmp = 0.0f;
+        fluxAverage = 0.0f;
+        fluxCoeff = 1.0f;
+
+        values.resize(bands+4, 0.0f);
+        for(int i=0; i<3; ++i){
+                snapshots[i].resize(bands+4, 0.0f);
+        }
+        back = 0;
+        middle = 1;
+        front = 2;
+
+        meterBands = new std::atomic<float>[bands];
+        for(int i=0; i<bands; ++i){
+                meterBands[i] = 0.0f;
+        }
+        meterCentroid = 0.0f;
+        meterFlux = 0.0f;
+        meterRolloff = 0.0f;
+        meterOnset = 0.0f;
+
+        setResynthesis(false);
+
+        // reallocates the STFT, prepareSTFT() is called for this class
+        setup(2048, 512, Hann);
+}
+
+pdsp::SpectralAnalyzer::~SpectralAnalyzer(){
+        deallocate();
+        delete[] meterBands;
+}
+
+pdsp::Patchable& pdsp::SpectralAnalyzer::out_band( int index ){
+    if(index < 0){ index = 0; }
+    if(index >= bands){ index = bands-1; }
+    return out( tags[index].c_str() );
+}
+
+pdsp::Patchable& pdsp::SpectralAnalyzer::out_centroid(){
+    return out("centroid");
+}
+
+pdsp::Patchable& pdsp::SpectralAnalyzer::out_flux(){
+    return out("flux");
+}
+
+pdsp::Patchable& pdsp::SpectralAnalyzer::out_rolloff(){
+    return out("rolloff");
+}
+
+pdsp::Patchable& pdsp::SpectralAnalyzer::out_onset(){
+    return out("onset");
+}
+
+void pdsp::SpectralAnalyzer::setBandsRange( float loFreq, float hiFreq ){
+        if(loFreq < 1.0f){ loFreq = 1.0f; }
+        if(hiFreq <= loFreq){ hiFreq = loFreq * 2.0f; }
+        this->loFreq = loFreq;
+        this->hiFreq = hiFreq;
+        updateBands();
+}
+
+void pdsp::SpectralAnalyzer::setRolloff( float ratio ){
+        if(ratio < 0.0f){ ratio = 0.0f; }
+        if(ratio > 1.0f){ ratio = 1.0f; }
+        rolloffRatio = ratio;
+}
+
+void pdsp::SpectralAnalyzer::setOnsetTime( float timeMs ){
+        if(timeMs < 1.0f){ timeMs = 1.0f; }
+        onsetTime = timeMs;
+        updateOnsetCoeff();
+}
+
+int pdsp::SpectralAnalyzer::getBands() const {
+        return bands;
+}
+
+float pdsp::SpectralAnalyzer::meter_band( int index ) const {
+        if(index < 0 || index >= bands){ return 0.0f; }
+        return meterBands[index].load();
+}
+
+float pdsp::SpectralAnalyzer::meter_centroid() const {
+        return meterCentroid.load();
+}
+
+float pdsp::SpectralAnalyzer::meter_flux() const {
+        return meterFlux.load();
+}
+
+float pdsp::SpectralAnalyzer::meter_rolloff() const {
+        return meterRolloff.load();
+}
+
+float pdsp::SpectralAnalyzer::meter_onset() const {
+        return meterOnset.load();
+}
+
+bool pdsp::SpectralAnalyzer::meter_snapshot( Snapshot & snapshot ){
+
+        bool fresh = (middle.load() & 4) != 0;
+        if(fresh){
+                front = middle.exchange(front) & 3;
+        }
+
+        const std::vector<float> & data = snapshots[front];
+        snapshot.bands.resize(bands);
+        for(int i=0; i<bands; ++i){
+                snapshot.bands[i] = data[i];
+        }
+        snapshot.centroid = data[bands];
+        snapshot.flux = data[bands+1];
+        snapshot.rolloff = data[bands+2];
+        snapshot.onset = data[bands+3];
+
+        return fresh;
+}
+
+void pdsp::SpectralAnalyzer::prepareSTFT(){
+
+        deallocate();
+
+        complexSize = getComplexSize();
+
+        ofx_allocate_aligned(magnitude, complexSize);
+        ofx_allocate_aligned(power, complexSize);
+        ofx_allocate_aligned(lastMagnitude, complexSize);
+        ofx_allocate_aligned(binFreqs, complexSize);
+        ofx_Aeq_Zero(magnitude, complexSize);
+        ofx_Aeq_Zero(power, complexSize);
+        ofx_Aeq_Zero(lastMagnitude, complexSize);
+
+        float binWidth = (float)( getSampleRate() / (double) getFFTSize() );
+        for(int k=0; k<complexSize; ++k){
+                binFreqs[k] = k * binWidth;
+        }
+
+        // a sinewave of amplitude A has a peak bin magnitude of A * sum(w) / 2
+        // and the bins around the peak sum to N * A^2 * sum(w^2) / 4 in power, that is N * rms^2 * sum(w^2) / 2
+        const float* window = getAnalysisWindow();
+        double windowSum = 0.0;
+        double windowSquaredSum = 0.0;
+        for(int n=0; n<getFrameSize(); ++n){
+                windowSum += window[n];
+                windowSquaredSum += window[n] * window[n];
+        }
+        magToAmp = (windowSum > 0.0) ? (float)( 2.0 / windowSum ) : 0.0f;
+        powerToRMS = (windowSquaredSum > 0.0) ? (float)( 2.0 / ( getFFTSize() * windowSquaredSum ) ) : 0.0f;
+
+        fluxAverage = 0.0f;
+
+        updateBands();
+        updateOnsetCoeff();
+}
+
+void pdsp::SpectralAnalyzer::releaseResources () {
+        STFT::releaseResources();
+        deallocate();
+}
+
+void pdsp::SpectralAnalyzer::deallocate(){
+        ofx_deallocate_aligned(magnitude);
+        ofx_deallocate_aligned(power);
+        ofx_deallocate_aligned(lastMagnitude);
+        ofx_deallocate_aligned(binFreqs);
+        complexSize = 0;
+}
+
+void pdsp::SpectralAnalyzer::updateBands(){
+
+        if(complexSize == 0){ return; }
+
+        double binWidth = getSampleRate() / (double) getFFTSize();
+        double ratio = (double)hiFreq / (double)loFreq;
+
+        for(int b=0; b<=bands; ++b){
+                double edge = loFreq * std::pow( ratio, (double)b / (double)bands );
+                int bin = (int) std::round( edge / binWidth );
+                if(bin < 1){ bin = 1; }
+                if(bin > complexSize){ bin = complexSize; }
+                bandBins[b] = bin;
+        }
+}
+
+void pdsp::SpectralAnalyzer::updateOnsetCoeff(){
+        // one pole averaging, updated once for each hop
+        double hops = onsetTime * 0.001 * getSampleRate() / (double) getHopSize();
+        fluxCoeff = (float)( 1.0 - std::exp( -1.0 / hops ) );
+}
+
+void pdsp::SpectralAnalyzer::processFrame( float* re, float* im, int complexSize ) noexcept {
+
+        // power and amplitude spectrum
+        ofx_Aeq_BmulC(power, re, re, complexSize);
+        ofx_Aeq_BmulC(magnitude, im, im, complexSize);
+        ofx_Aeq_BaddC(power, power, magnitude, complexSize);
+        ofx_Aeq_sqrtB(magnitude, power, complexSize);
+        ofx_Aeq_BmulS(magnitude, magnitude, magToAmp, complexSize);
+
+        // bands, the bands narrower than a bin take the power of their first bin
+        for(int b=0; b<bands; ++b){
+                int start = bandBins[b];
+                int end = bandBins[b+1];
+                if(end <= start){ end = start + 1; }
+                if(end > complexSize){ end = complexSize; }
+                float sum = 0.0f;
+                for(int k=start; k<end; ++k){
+                        sum += power[k];
+                }
+                values[b] = std::sqrt( sum * powerToRMS );
+        }
+
+        float totalPower = 0.0f;
+        float totalMagnitude = 0.0f;
+        for(int k=0; k<complexSize; ++k){
+                totalPower += power[k];
+                totalMagnitude += magnitude[k];
+        }
+
+        // the flux is computed in lastMagnitude, then the magnitudes are saved for the next frame
+        ofx_Aeq_Badd_CmulS(lastMagnitude, magnitude, lastMagnitude, -1.0f, complexSize);
+        ofx_Aeq_maxBS(lastMagnitude, lastMagnitude, 0.0f, complexSize);
+        float flux = 0.0f;
+        for(int k=0; k<complexSize; ++k){
+                flux += lastMagnitude[k];
+        }
+        ofx_Aeq_B(lastMagnitude, magnitude, complexSize);
+
+        // centroid and rolloff, magnitude is multiplied by the bin frequencies
+        float centroid = 0.0f;
+        float rolloff = 0.0f;
+        if(totalMagnitude > 1.0e-9f){
+                ofx_Aeq_BmulC(magnitude, magnitude, binFreqs, complexSize);
+                float weighted = 0.0f;
+                for(int k=0; k<complexSize; ++k){
+                        weighted += magnitude[k];
+                }
+                centroid = weighted / totalMagnitude;
+
+                float threshold = totalPower * rolloffRatio;
+                float cumulated = 0.0f;
+                int k = 0;
+                for( ; k<complexSize-1; ++k){
+                        cumulated += power[k];
+                        if(cumulated >= threshold){ break; }
+                }
+                rolloff = binFreqs[k];
+        }
+
+        float onset = flux - fluxAverage;
+        if(onset < 0.0f){ onset = 0.0f; }
+        fluxAverage += (flux - fluxAverage) * fluxCoeff;
+
+        values[bands] = centroid;
+        values[bands+1] = flux;
+        values[bands+2] = rolloff;
+        values[bands+3] = onset;
+
+        publish();
+}
+
+void pdsp::SpectralAnalyzer::publish() noexcept {
+
+        for(int i=0; i<bands+4; ++i){
+                snapshots[back][i] = values[i];
+        }
+        back = middle.exchange( back | 4 ) & 3;
+
+        for(int i=0; i<bands; ++i){
+                meterBands[i].store( values[i], std::memory_order_relaxed );
+        }
+        meterCentroid.store( values[bands], std::memory_order_relaxed );
+        meterFlux.store( values[bands+1], std::memory_order_relaxed );
+        meterRolloff.store( values[bands+2], std::memory_order_relaxed );
+        meterOnset.store( values[bands+3], std::memory_order_relaxed );
+}
+
+void pdsp::SpectralAnalyzer::process (int bufferSize) noexcept {
+
+        STFT::process(bufferSize);
+
+        for(int b=0; b<bands; ++b){
+                setControlRateOutput(outputBands[b], values[b]);
+        }
+        setControlRateOutput(outputCentroid, values[bands]);
+        setControlRateOutput(outputFlux, values[bands+1]);
+        setControlRateOutput(outputRolloff, values[bands+2]);
+        setControlRateOutput(outputOnset, values[bands+3]);
+}
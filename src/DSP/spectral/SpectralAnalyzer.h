@@ -0,0 +1,183 @@
+
+// SpectralAnalyzer.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_SPECTRAL_SPECTRALANALYZER_H_INCLUDED
+#define PDSP_SPECTRAL_SPECTRALANALYZER_H_INCLUDED
+
+#include "STFT.h"
+#include <atomic>
+#include <vector>
+#include <string>
+
+namespace pdsp{
+/*!
+@brief Extracts the band levels and some spectral features of the input with an FFT for each hop.
+
+The band levels are the rms values of the input in logarithmically spaced frequency bands, they replace a chain of filters and detectors for each band. The features are the spectral centroid in hertz, the spectral flux, the rolloff frequency in hertz and an onset strength, that is the amount of flux over its recent average. All of them are control-rate outputs updated each hop, and are also available to the other threads with the meter_ methods and meter_snapshot(). By default the frames are 2048 samples long with an hop of 512 samples, you can change them with setup(). The "signal" output is silent, patch this Unit to the engine blackhole() to process it.
+*/
+
+class SpectralAnalyzer : public STFT {
+
+public:
+        /*!
+        @brief the values published for the other threads, see meter_snapshot()
+        */
+        struct Snapshot {
+            std::vector<float> bands;
+            float centroid;
+            float flux;
+            float rolloff;
+            float onset;
+        };
+
+        SpectralAnalyzer();
+
+        /*!
+        @brief constructs an analyzer with the given number of bands, 16 if not given
+        @param[in] bands number of bands
+        */
+        SpectralAnalyzer( int bands );
+        ~SpectralAnalyzer();
+
+        /*!
+        @brief Sets "band0", "band1", etc as selected output and returns this Unit ready to be patched. This is the rms level of the given band, bands are ordered from the lowest to the highest.
+        @param[in] index band index
+        */
+        Patchable& out_band( int index );
+
+        /*!
+        @brief Sets "centroid" as selected output and returns this Unit ready to be patched. This is the spectral centroid in hertz.
+        */
+        Patchable& out_centroid();
+
+        /*!
+        @brief Sets "flux" as selected output and returns this Unit ready to be patched. This is the sum of the increases of the bins amplitudes from the last frame.
+        */
+        Patchable& out_flux();
+
+        /*!
+        @brief Sets "rolloff" as selected output and returns this Unit ready to be patched. This is the frequency in hertz under which there is the rolloff ratio of the spectral energy.
+        */
+        Patchable& out_rolloff();
+
+        /*!
+        @brief Sets "onset" as selected output and returns this Unit ready to be patched. This is the amount of flux over its average in the onset time, it is greater than 0.0f only on the note onsets and transients.
+        */
+        Patchable& out_onset();
+
+        /*!
+        @brief sets the range of the bands, they are logarithmically spaced from the low to the high frequency. The default range is from 40hz to 16000hz.
+        @param[in] loFreq lowest frequency of the first band
+        @param[in] hiFreq highest frequency of the last band
+        */
+        void setBandsRange( float loFreq, float hiFreq );
+
+        /*!
+        @brief sets the ratio of the spectral energy under the rolloff frequency, the default is 0.85f
+        @param[in] ratio value between 0.0f and 1.0f
+        */
+        void setRolloff( float ratio );
+
+        /*!
+        @brief sets the averaging time of the flux for the onset strength, the default is 250 ms
+        @param[in] timeMs time in milliseconds
+        */
+        void setOnsetTime( float timeMs );
+
+        /*!
+        @brief returns the number of bands
+        */
+        int getBands() const;
+
+        /*!
+        @brief returns the last rms level of the given band. This method is thread-safe.
+        @param[in] index band index
+        */
+        float meter_band( int index ) const;
+
+        /*!
+        @brief returns the last spectral centroid in hertz. This method is thread-safe.
+        */
+        float meter_centroid() const;
+
+        /*!
+        @brief returns the last spectral flux. This method is thread-safe.
+        */
+        float meter_flux() const;
+
+        /*!
+        @brief returns the last rolloff frequency in hertz. This method is thread-safe.
+        */
+        float meter_rolloff() const;
+
+        /*!
+        @brief returns the last onset strength. This method is thread-safe.
+        */
+        float meter_onset() const;
+
+        /*!
+        @brief copies all the values of the last analyzed frame to the given snapshot, they are always from the same frame. It is lock-free and the audio thread never waits, but it should be called always from the same thread, usually the main one. Returns true if a new frame was analyzed since the last call.
+        @param[out] snapshot snapshot to fill, its bands vector is resized if needed
+        */
+        bool meter_snapshot( Snapshot & snapshot );
+
+protected:
+        void processFrame( float* re, float* im, int complexSize ) noexcept override;
+        void prepareSTFT() override;
+        void releaseResources () override;
+        void process (int bufferSize) noexcept override;
+
+private:
+        void deallocate();
+        void updateBands();
+        void updateOnsetCoeff();
+        void publish() noexcept;
+
+        int                     bands;
+        float                   loFreq;
+        float                   hiFreq;
+        float                   rolloffRatio;
+        float                   onsetTime;
+
+        std::vector<std::string>    tags;
+        std::vector<OutputNode>     outputBands;
+        OutputNode              outputCentroid;
+        OutputNode              outputFlux;
+        OutputNode              outputRolloff;
+        OutputNode              outputOnset;
+
+        int                     complexSize;
+        float*                  magnitude;
+        float*                  power;
+        float*                  lastMagnitude;
+        float*                  binFreqs;
+        std::vector<int>        bandBins;   // first bin of each band, plus the end of the last one
+        float                   powerToRMS;
+        float                   magToAmp;
+
+        float                   fluxAverage;
+        float                   fluxCoeff;
+
+        // the values of the last frame, 4 features after the bands
+        std::vector<float>      values;
+
+        // triple buffer for the snapshots, the audio thread writes to the back one and swaps it with
+        // the middle one, the reader swaps the middle one with the front one if it has a new frame
+        std::vector<float>      snapshots[3];
+        int                     back;
+        int                     front;
+        std::atomic<int>        middle;     // index of the middle buffer, plus 4 when it has a new frame
+
+        std::atomic<float>*     meterBands;
+        std::atomic<float>      meterCentroid;
+        std::atomic<float>      meterFlux;
+        std::atomic<float>      meterRolloff;
+        std::atomic<float>      meterOnset;
+
+};
+
+}//END NAMESPACE
+
+#endif  // PDSP_SPECTRAL_SPECTRALANALYZER_H_INCLUDED
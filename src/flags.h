@@ -29,6 +29,9 @@
 //if you can use FFTW for your project, link it and decomment this for faster FFT
 //#define AUDIOFFT_FFTW3
 
+//if you are on linux and want to use the JACK backend with Engine::setupJack(), link libjack and decomment this
+//#define PDSP_USE_JACK
+
 
 // some internally used values
 #define PDSP_NODE_POINTERS_RESERVE 16
@@ -0,0 +1,56 @@
+// genExpRamp.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+
+#ifndef PDSP_MATH_GENEXPRAMP_H_INCLUDED
+#define PDSP_MATH_GENEXPRAMP_H_INCLUDED
+
+#include "../functions.h"
+
+namespace pdsp {
+
+    // fills buffer[start, stop) with target - distance * coeff^i, buffer should be aligned
+    inline_f void genExpRamp(float* buffer, int start, int stop, float target, float distance, float coeff){
+
+        int n = start;
+
+#ifdef OFX_SIMD_USE_SIMD
+        for ( ; (n & 3) && n<stop; ++n) { // scalar until aligned
+            buffer[n] = target - distance;
+            distance *= coeff;
+        }
+
+        int maxSimd = n + ROUND_DOWN(stop - n, 4);
+
+        if( n < maxSimd ){
+            ALIGNPRE float lanes [4] ALIGNPOST;
+            lanes[0] = distance;
+            lanes[1] = lanes[0] * coeff;
+            lanes[2] = lanes[1] * coeff;
+            lanes[3] = lanes[2] * coeff;
+            float coeff4 = coeff * coeff;
+            coeff4 *= coeff4;
+
+            ofx::f128 distance_v = ofx::m_load(lanes);
+            ofx::f128 target_v = ofx::m_set1(target);
+
+            for ( ; n<maxSimd; n+=4) {
+                ofx::m_store( buffer + n, ofx::m_sub(target_v, distance_v) );
+                distance_v = ofx::m_mul1(distance_v, coeff4);
+            }
+
+            ofx::m_store(lanes, distance_v);
+            distance = lanes[0];
+        }
+#endif
+
+        for ( ; n<stop; ++n) {
+            buffer[n] = target - distance;
+            distance *= coeff;
+        }
+    }
+
+}
+
+#endif  // PDSP_MATH_GENEXPRAMP_H_INCLUDED
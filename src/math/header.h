@@ -29,6 +29,7 @@
 #include "dsphelpers/genPulse.h"
 #include "dsphelpers/genSaw.h"
 #include "dsphelpers/genTriangle.h"
+#include "dsphelpers/genExpRamp.h"
 #include "dsphelpers/calculateGainReduction.h"
 
 #include "tables/dsp_windows.h"
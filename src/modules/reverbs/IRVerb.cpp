@@ -15,8 +15,10 @@ void pdsp::IRVerb::patch(){
     addModuleInput( "L",  input_L );
     addModuleInput( "R",  input_R );
 
-    addModuleOutput("L", reverbL);
-    addModuleOutput("R", reverbR);
+    reverb.resize( 1, 2 );
+
+    addModuleOutput("L", reverb.out_channel(0) );
+    addModuleOutput("R", reverb.out_channel(1) );
 
 }
 
@@ -66,32 +68,77 @@ pdsp::Patchable& pdsp::IRVerb::out_R(){
 
 void pdsp::IRVerb::checkMono() {
     if(!monoConnected){
-        input_mono >> reverbL;
-        input_mono >> reverbR;
+        input_mono >> reverb.in_channel(0);
+        if(stereoConnected){
+            input_mono >> reverb.in_channel(1);
+        }
         monoConnected = true;
     }    
 }
 
 void pdsp::IRVerb::checkStereo() {
     if(!stereoConnected){
-        input_L >> reverbL;
-        input_R >> reverbR;
+        reverb.resize( 2, 2 );
+        input_L >> reverb.in_channel(0);
+        input_R >> reverb.in_channel(1);
+        if(monoConnected){
+            input_mono >> reverb.in_channel(1);
+        }
         stereoConnected = true;
+        loadImpulses();
     }       
 }
 
 void pdsp::IRVerb::loadIR ( std::string path ) {
-    
     impulse.load( path );
+    loadImpulses();
+}
+
+void pdsp::IRVerb::loadImpulses() {
     
-    if (impulse.channels == 1 ){
-        reverbL.loadIR( impulse );
-        reverbR.loadIR( impulse );
-    }else if (impulse.channels>1){
-        reverbL.loadIR( impulse, 0 );
-        reverbR.loadIR( impulse, 1 );        
+    if( impulse.channels == 1 ){
+        reverb.setIR( 0, 0, impulse, 0 );
+        if( stereoConnected ){
+            reverb.setIR( 1, 1, impulse, 0 );
+        }else{
+            reverb.setIR( 0, 1, impulse, 0 );
+        }
+    }else if( impulse.channels > 1 ){
+        reverb.setIR( 0, 0, impulse, 0 );
+        if( stereoConnected ){
+            reverb.setIR( 1, 1, impulse, (impulse.channels >= 4) ? 3 : 1 );
+            if( impulse.channels >= 4 ){
+                // true stereo impulse response
+                reverb.setIR( 0, 1, impulse, 1 );
+                reverb.setIR( 1, 0, impulse, 2 );
+            }
+        }else{
+            reverb.setIR( 0, 1, impulse, 1 );
+        }
     }
-    
+
+    // all the impulse responses are prepared together
+    reverb.prepareIR();
+}
+
+void pdsp::IRVerb::setNonUniform( bool active ) {
+    reverb.setNonUniform( active );
+}
+
+void pdsp::IRVerb::setBackgroundTail( bool active ) {
+    reverb.setBackgroundTail( active );
+}
+
+int pdsp::IRVerb::meter_tail_misses() const {
+    return reverb.meter_tail_misses();
+}
+
+void pdsp::IRVerb::setCrossfadeTime( float timeMs ) {
+    reverb.setCrossfadeTime( timeMs );
+}
+
+void pdsp::IRVerb::setTailContinuation( bool active ) {
+    reverb.setTailContinuation( active );
 }
 
 void pdsp::IRVerb::prepareToPlay(int expectedBufferSize, double sampleRate){
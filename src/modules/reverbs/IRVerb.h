@@ -7,14 +7,16 @@
 #define PDSP_MODULE_IRVERB_H_INCLUDED
 
 #include "../../DSP/pdspCore.h"
-#include "../../DSP/convolution/FDLConvolver.h"
+#include "../../DSP/convolution/MultiConvolver.h"
 #include "../../DSP/samplers/SampleBuffer.h"
 
 
 namespace pdsp{
     
 /*!
-@brief Impulse Response based reverb, with stereo or mono input and stereo output.
+@brief Impulse Response based reverb, with stereo or mono input and stereo output. The mono input is transformed just once for both the output channels.
+
+A mono impulse response is used for both the channels, a stereo one has a channel for each side. A 4 channels impulse response is a true stereo one, with the channels in the order L to L, L to R, R to L, R to R.
 */       
 
 class IRVerb : public Patchable, public Preparable {
@@ -75,11 +77,40 @@ public:
     Patchable& out_R();
 
     /*!
-    @brief sets the impulse response for the reverb
+    @brief sets the impulse response for the reverb. The impulse responses prepared for the convolution are kept in the SpectrumCache, so loading again the same file is faster. While playing the new impulse response is prepared in the calling thread and crossfaded by the audio thread, see setCrossfadeTime() and setTailContinuation().
     @param[in] path path of the impulse response file
     */  
     void loadIR ( std::string path );
 
+    /*!
+    @brief activates or deactivates the non-uniform partitioned convolution, long impulse responses take much less cpu with the same output and no added latency. Changing it reloads the impulse response.
+    @param[in] active true for non-uniform partitions, false for uniform partitions (default)
+    */  
+    void setNonUniform( bool active );
+
+    /*!
+    @brief activates or deactivates the background processing of the reverb tail, it works only with non-uniform partitions. The longest partitions are computed by a worker thread, so the cpu load of each audio callback is flatter. Don't use it for offline rendering.
+    @param[in] active true for background processing, false for processing everything in the audio thread (default)
+    */  
+    void setBackgroundTail( bool active );
+
+    /*!
+    @brief returns the number of tail partitions that the worker thread didn't finish in time. This method is thread-safe.
+    */  
+    int meter_tail_misses() const;
+
+    /*!
+    @brief sets the crossfade time from the old impulse response to the new one, when it is changed while playing. The default is 50 ms.
+    @param[in] timeMs crossfade time in milliseconds
+    */  
+    void setCrossfadeTime( float timeMs );
+
+    /*!
+    @brief activates or deactivates the tail continuation. When active, after changing the impulse response while playing the old reverb tail rings out instead of being crossfaded.
+    @param[in] active true for tail continuation, false for crossfading (default)
+    */  
+    void setTailContinuation( bool active );
+
     
 private:
     void prepareToPlay(int expectedBufferSize, double sampleRate);
@@ -92,8 +123,7 @@ private:
     PatchNode       input_R;
     PatchNode       input_mono;
 
-    FDLConvolver    reverbL;
-    FDLConvolver    reverbR;
+    MultiConvolver  reverb;
     
     SampleBuffer    impulse;
 
@@ -102,6 +132,7 @@ private:
     
     void checkMono();
     void checkStereo();
+    void loadImpulses();
 
 };
     
@@ -28,7 +28,11 @@ pdsp::Engine::Engine() : score( sequencer ){
 #endif
 
     bBackgroundAudio = false;
+#ifdef PDSP_USE_JACK
+    jackActive = false;
+#endif
     graphics.setParent( score );
+    graphics.setLoadMonitor( monitor );
 
     ofAddListener( ofEvents().exit, this, &pdsp::Engine::onExit );
 }
@@ -116,27 +120,32 @@ void pdsp::Engine::setChannels( int inputChannels, int outputChannels ){
 
 }
 
-void pdsp::Engine::setup( int sampleRate, int bufferSize, int nBuffers){
- 
-    ofLogNotice()<<"[pdsp] engine: starting with parameters: buffer size = "<<bufferSize<<" | sample rate = "<<sampleRate<<" | "<<inputChannels<<" inputs | "<<outputChannels<<" outputs\n";
-   
-    if ( nBuffers < 1 ) nBuffers = 1;
-    
-    // close if engine is already running with another settings
+void pdsp::Engine::closeActiveSetup(){
     if(state!=closedState){ 
         ofLogNotice()<<"[pdsp] engine: changing setup, shutting down stream";
         stop();
         if( inStreamActive ){
             inputStream.close();
+            inStreamActive = false;
         }
         if( outStreamActive ){
             outputStream.close();
+            outStreamActive = false;
         }
         
         #ifdef TARGET_OF_IOS
         ofSoundStreamClose();
         #endif  
         
+        #ifdef PDSP_USE_JACK
+        if( jackActive ){
+            jack.close();
+            jackActive = false;
+        }
+        #endif
+        
+        renderAhead.stop();
+        
         ofLogNotice()<<"[pdsp] engine: changing setup, releasing resources...";
         pdsp::releaseAll();
         
@@ -144,9 +153,20 @@ void pdsp::Engine::setup( int sampleRate, int bufferSize, int nBuffers){
         ofSleepMillis( 20 );
         ofLogNotice()<<"...done";
     }
+}
+
+void pdsp::Engine::setup( int sampleRate, int bufferSize, int nBuffers){
+ 
+    ofLogNotice()<<"[pdsp] engine: starting with parameters: buffer size = "<<bufferSize<<" | sample rate = "<<sampleRate<<" | "<<inputChannels<<" inputs | "<<outputChannels<<" outputs\n";
+   
+    if ( nBuffers < 1 ) nBuffers = 1;
+    
+    // close if engine is already running with another settings
+    closeActiveSetup();
     
     // prepare all the units / modules
     pdsp::prepareAllToPlay(bufferSize, static_cast<double>(sampleRate) );
+    renderAhead.start( this, bufferSize, inputChannels, outputChannels, static_cast<double>(sampleRate) );
 
 
     // starts engine
@@ -248,6 +268,45 @@ void pdsp::Engine::setup( int sampleRate, int bufferSize, int nBuffers){
     
 }
 
+#ifdef PDSP_USE_JACK
+void pdsp::Engine::setupJack( const std::string & clientName, int bufferSize, bool autoConnect ){
+
+    ofLogNotice()<<"[pdsp] engine: starting JACK client \""<<clientName<<"\" | "<<inputChannels<<" inputs | "<<outputChannels<<" outputs\n";
+
+    // close if engine is already running with another settings
+    closeActiveSetup();
+
+    if( !jack.open( this, clientName, inputChannels, outputChannels, bufferSize ) ){
+        return;
+    }
+    jackActive = true;
+
+    // prepare all the units / modules
+    pdsp::prepareAllToPlay( jack.getBufferSize(), static_cast<double>( jack.getSampleRate() ) );
+    renderAhead.start( this, jack.getBufferSize(), inputChannels, outputChannels, static_cast<double>( jack.getSampleRate() ) );
+
+    if( outputChannels > 0 ){
+        84.0f >> testOscillator.in_pitch();
+        testOscillator >> testAmp >> processor.channels[0];
+    }
+
+    state = stoppedState;
+    start();
+    if( state != startedState ){
+        return;
+    }
+    if( autoConnect ){
+        jack.connectPhysicalPorts();
+    }
+
+    ofLogNotice()<<"[pdsp] engine: started | buffer size = "<<jack.getBufferSize()<<" | sample rate = "<<jack.getSampleRate()<<" | "<<inputChannels<<" inputs | "<<outputChannels<<" outputs\n";
+}
+
+int pdsp::Engine::meter_xruns() const {
+    return jack.meter_xruns();
+}
+#endif
+
 void pdsp::Engine::start(){
     if(inStreamActive && state < startedState){
         inputStream.start();
@@ -258,6 +317,13 @@ void pdsp::Engine::start(){
     #ifdef TARGET_OF_IOS
     ofSoundStreamStart();
     #endif    
+    #ifdef PDSP_USE_JACK
+    if( jackActive && state < startedState ){
+        if( !jack.start() ){
+            return;
+        }
+    }
+    #endif
     state = startedState;
 }
 
@@ -272,6 +338,11 @@ void pdsp::Engine::stop(){
         #ifdef TARGET_OF_IOS
         ofSoundStreamStop();	
         #endif    
+        #ifdef PDSP_USE_JACK
+        if( jackActive ){
+            jack.stop();
+        }
+        #endif
         state = stoppedState;
     }
 }
@@ -311,6 +382,13 @@ void pdsp::Engine::close(){
     #ifdef TARGET_OF_IOS
     ofSoundStreamClose();
     #endif  
+    #ifdef PDSP_USE_JACK
+    if( jackActive ){
+        jack.close();
+        jackActive = false;
+    }
+    #endif
+    renderAhead.stop();
     pdsp::releaseAll();
     
     state = closedState;
@@ -319,10 +397,51 @@ void pdsp::Engine::close(){
 }
 
 void pdsp::Engine::audioOut(ofSoundBuffer &outBuffer) {
-    
-    int bufferSize =  outBuffer.getNumFrames() ;
+    if( renderAhead.isActive() ){
+        renderAhead.pullInterleaved( outBuffer.getBuffer().data(), outBuffer.getNumChannels(), outBuffer.getNumFrames() );
+        return;
+    }
+    monitor.begin( outBuffer.getNumFrames() );
+    processControls( outBuffer.getNumFrames() );
+    //DSP processing
+    processor.processAndCopyInterleaved(outBuffer.getBuffer().data(), outBuffer.getNumChannels(), outBuffer.getNumFrames());    
+    monitor.stamp( helper::LoadMonitor::DSP );
+    monitor.end();
+}
+
+void pdsp::Engine::audioProcess( float** inBuffers, float** outBuffers, int bufferSize ) noexcept {
+    if( renderAhead.isActive() ){
+        renderAhead.pushInput( inBuffers, inputChannels, bufferSize );
+        renderAhead.pullOutput( outBuffers, outputChannels, bufferSize );
+    }else{
+        renderBlock( inBuffers, outBuffers, bufferSize );
+    }
+}
+
+void pdsp::Engine::audioBufferSizeChanged( int bufferSize, double sampleRate ){
+    // the render ahead fifos are prepared again for the new block size, with the latency primed with silence
+    renderAhead.stop();
+    pdsp::releaseAll();
+    pdsp::prepareAllToPlay( bufferSize, sampleRate );
+    renderAhead.start( this, bufferSize, inputChannels, outputChannels, sampleRate );
+}
+
+void pdsp::Engine::renderBlock( float** inBuffers, float** outBuffers, int bufferSize ) noexcept {
+    monitor.begin( bufferSize );
+    for( int i=0; i<inputChannels; i++){
+        inputs[i].setInput( inBuffers[i], bufferSize ); // no copy if the buffer is aligned
+    }
+    processControls( bufferSize );
+    //DSP processing
+    processor.processAndCopyOutput( outBuffers, outputChannels, bufferSize );
+    monitor.stamp( helper::LoadMonitor::DSP );
+    monitor.end();
+}
+
+void pdsp::Engine::processControls( int bufferSize ) noexcept {
     // score and playhead processing
     score.process( bufferSize );
+    monitor.stamp( helper::LoadMonitor::Sequencer );
 
 #ifndef __ANDROID__
     // midi input processing
@@ -335,12 +454,14 @@ void pdsp::Engine::audioOut(ofSoundBuffer &outBuffer) {
         }
     }
 #endif
+    monitor.stamp( helper::LoadMonitor::Midi );
 
     if(hasOscIn){
         for( pdsp::osc::Input * &in : oscIns){
             in->processOsc( bufferSize );
         } 
     }
+    monitor.stamp( helper::LoadMonitor::Osc );
     
     // external outputs processing
     if(hasExternalOut){
@@ -348,14 +469,15 @@ void pdsp::Engine::audioOut(ofSoundBuffer &outBuffer) {
             out->process( bufferSize );
         }
     }
-    //DSP processing
-    processor.processAndCopyInterleaved(outBuffer.getBuffer().data(), outBuffer.getNumChannels(), outBuffer.getNumFrames());    
+    monitor.stamp( helper::LoadMonitor::Outputs );
 }
 
 void pdsp::Engine::audioIn (ofSoundBuffer &inBuffer) {
-    for( int i=0; i<inputChannels; i++){
-        inputs[i].copyInterleavedInput( inBuffer.getBuffer().data(), i,  inBuffer.getNumChannels(), inBuffer.getNumFrames());
+    if( renderAhead.isActive() ){
+        renderAhead.pushInterleaved( inBuffer.getBuffer().data(), inBuffer.getNumChannels(), inBuffer.getNumFrames() );
+        return;
     }
+    pdsp::ExternalInput::deinterleave( inputs, inBuffer.getBuffer().data(), inBuffer.getNumChannels(), inBuffer.getNumFrames() );
 }
 
 #ifndef __ANDROID__
@@ -445,6 +567,25 @@ pdsp::Patchable & pdsp::Engine::out_bar_ms(){
     return barTime.out_signal();
 }
 
+void pdsp::Engine::setRenderAhead( int buffers ){
+    if( state != closedState ){
+        std::cout<<"[pdsp] warning! render ahead will be activated at the next engine setup\n";
+    }
+    renderAhead.setBuffers( buffers );
+}
+
+float pdsp::Engine::getRenderAheadLatencyMs() const {
+    return renderAhead.getLatencyMs();
+}
+
+float pdsp::Engine::meter_render_ahead() const {
+    return renderAhead.meter_fill();
+}
+
+int pdsp::Engine::meter_underruns() const {
+    return renderAhead.meter_underruns();
+}
+
 void pdsp::Engine::setBackgroundAudio( bool active ){
     bBackgroundAudio = active;
 }
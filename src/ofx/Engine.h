@@ -17,6 +17,8 @@
 #include "OscInput.h"
 
 #include "helper/EngineGraphics.h"
+#include "helper/JackBackend.h"
+#include "helper/RenderAhead.h"
 
 #ifndef __ANDROID__
 #include "helper/Controller.h"
@@ -35,6 +37,7 @@
 namespace pdsp{
 
 class Engine : public ofBaseSoundInput, public ofBaseSoundOutput{
+    friend class helper::RenderAhead;
     
 public:
     Engine();
@@ -47,6 +50,21 @@ public:
     @param[in] nBuffers number of buffers in the audioQueue
     */
     void setup(int sampleRate, int bufferSize, int nBuffers);
+
+#ifdef PDSP_USE_JACK
+    /*!
+    @brief prepares all the module and units and starts the engine as a JACK client, bypassing ofSoundStream. The ports buffers are rendered directly from the JACK process callback, the sample rate is the one of the JACK server. Available only when compiled with PDSP_USE_JACK defined and linked to libjack.
+    @param[in] clientName name of the JACK client
+    @param[in] bufferSize if greater than 0 the server period is changed to this value (for example 32 for live use), otherwise the actual server period is used
+    @param[in] autoConnect if true the ports are connected to the physical inputs and outputs
+    */
+    void setupJack( const std::string & clientName = "ofxPDSP", int bufferSize = 0, bool autoConnect = true );
+
+    /*!
+    @brief returns the number of JACK xruns since setupJack() was called. Thread-safe.
+    */
+    int meter_xruns() const;
+#endif
     
     /*!
     @brief starts the audio streams again if they were stopped.
@@ -93,6 +111,27 @@ public:
     */
     void setOutputDeviceID(int deviceID);
 
+    /*!
+    @brief activates the render ahead mode, to be called before setup(). A worker thread renders the DSP the given number of buffers ahead of the audio callback, that just copies the rendered audio out, so the momentary cpu spikes are absorbed at the cost of latency. Useful for heavy and not interactive content like installations and song playback. The sequencer is rendered together with the audio and the midi, osc and serial outputs schedule their messages later by the audio waiting to be played, so they stay aligned to the audio, the inputs are delayed by the added latency. The output starts with the added latency of silence. 
+    @param[in] buffers number of buffers to render ahead, 0 deactivates the render ahead mode (default)
+    */
+    void setRenderAhead( int buffers );
+
+    /*!
+    @brief returns the latency added by the render ahead mode, in milliseconds.
+    */
+    float getRenderAheadLatencyMs() const;
+
+    /*!
+    @brief returns the audio already rendered ahead and waiting for the audio callback, in buffers. Thread-safe.
+    */
+    float meter_render_ahead() const;
+
+    /*!
+    @brief returns the number of audio callbacks that found not enough audio rendered ahead, each of them is a dropout. Thread-safe.
+    */
+    int meter_underruns() const;
+
     /*!
     @brief adds an OSC input to the engine, making it active.
     @param[in] oscInput osc input object to activate
@@ -156,6 +195,11 @@ public:
     @brief manages a class to graphically monitor sequences
     */    
     helper::EngineGraphics graphics;
+
+    /*!
+    @brief measures the time taken by each stage of the audio callback ( sequencer, midi, osc, external outputs and DSP ) against the buffer time, with the mean and peak loads, a load histogram and the near misses. Look LoadMonitor page for knowing more.
+    */    
+    helper::LoadMonitor monitor;
    
     /*!
     @brief returns a module that outputs the time of a musical bar in milliseconds
@@ -181,6 +225,13 @@ public:
     void audioOut(ofSoundBuffer &outBuffer);
     void audioIn (ofSoundBuffer &outBuffer);
     
+    // renders non-interleaved input and output buffers, used by the backends not based on ofSoundStream
+    void audioProcess( float** inBuffers, float** outBuffers, int bufferSize ) noexcept;
+    
+    // called by the backends when the device buffer size changes, while the audio callback is not running
+    // the sample rate is the one of the device, as it could be different from the global one
+    void audioBufferSizeChanged( int bufferSize, double sampleRate );
+    
     pdsp::SequencerProcessor & score; // this is an alias for the sequencer, legacy reasons
 
 /*!
@@ -225,12 +276,22 @@ private:
 
 
     void onExit( ofEventArgs &args);
+    void closeActiveSetup();
+    void processControls( int bufferSize ) noexcept;
+    void renderBlock( float** inBuffers, float** outBuffers, int bufferSize ) noexcept;
     
     pdsp::FMOperator testOscillator;
     pdsp::Amp        testAmp;
     pdsp::OneBarTimeMs barTime;
     
     bool bBackgroundAudio;
+
+    helper::RenderAhead renderAhead;
+
+#ifdef PDSP_USE_JACK
+    helper::JackBackend jack;
+    bool jackActive;
+#endif
         
 };
 
@@ -4,25 +4,29 @@
 #ifndef __ANDROID__
 
 pdsp::midi::Controls::Controls(){
+    slewTime = 50.0f;
     setMaxCCNum(midiCC.getCCSize());
     setCCSlew(50.0f);   
 }
 
 
 pdsp::midi::Controls::Controls(int maxCC){
+    slewTime = 50.0f;
     setMaxCCNum(maxCC);
     setCCSlew(50.0f);   
 }
 
 void pdsp::midi::Controls::processMidi(const pdsp::midi::Input &midiInProcessor, const int &bufferSize ) noexcept{
     midiCC.processMidi(midiInProcessor.getMessageVector(), bufferSize);
+    ccOutputs.render( midiCC.ccMessages, bufferSize );
 }
 
 
 void pdsp::midi::Controls::setCCSlew(float slewTimeMs){
     this->slewTime = slewTimeMs;
+    ccOutputs.setSlewTime( slewTimeMs );
     
-    for(int i=0; i<midiCC.getCCSize(); ++i){
+    for(int i=0; i<(int)outs_cc.size(); ++i){
         outs_cc[i].setSlewRateModeReference(1.0f);
         outs_cc[i].setSlewTime(slewTimeMs, pdsp::Rate);
     }
@@ -30,11 +34,17 @@ void pdsp::midi::Controls::setCCSlew(float slewTimeMs){
 
 
 void pdsp::midi::Controls::setMaxCCNum(int ccNum){
+    if( ccNum >= OFXPDSP_MIDICCOUTPUTS_LANES ){ ccNum = OFXPDSP_MIDICCOUTPUTS_LANES - 1; }
     midiCC.setMaxCCNum(ccNum);
+    ccOutputs.setLanes(midiCC.getCCSize());
     outs_cc.resize(midiCC.getCCSize());
+    linkedCC.resize(midiCC.getCCSize(), false);
     setCCSlew(slewTime);
+    // the deprecated outputs are processed only after being requested with out(), the resizes can move them
     for(int i=0; i<midiCC.getCCSize(); ++i){
-        midiCC.ccMessages[i] >> outs_cc[i];
+        if(linkedCC[i]){
+            midiCC.ccMessages[i] >> outs_cc[i];
+        }
     }
     midiCC.clearAll();
 }
@@ -44,14 +54,32 @@ int pdsp::midi::Controls::getMaxCCNum(){
 }
 
 
+pdsp::Patchable & pdsp::midi::Controls::out_cc( int cc ) {
+    if( cc < 0 ){
+        cc = - cc;
+    }
+    if( cc >= getMaxCCNum() ){
+        setMaxCCNum(cc);
+    }
+    return ccOutputs.out_lane( cc );
+}
+
 pdsp::SequencerValueOutput & pdsp::midi::Controls::out( int cc ) {
     if( cc < 0 ){
         cc = - cc;
     }
-    if( cc > getMaxCCNum() ){
+    if( cc >= getMaxCCNum() ){
         setMaxCCNum(cc);
     }
+    if( !linkedCC[cc] ){
+        linkedCC[cc] = true;
+        midiCC.ccMessages[cc] >> outs_cc[cc];
+    }
     return outs_cc[cc];
 }
+
+float pdsp::midi::Controls::meter_cc( int cc ) const {
+    return ccOutputs.meter_lane( cc );
+}
     
 #endif
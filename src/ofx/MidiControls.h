@@ -12,6 +12,7 @@
 #include "../DSP/control/SequencerValueOutput.h"
 #include <chrono>
 #include "helper/MidiCCBuffers.h"
+#include "helper/MidiCCOutputs.h"
 #include "helper/Controller.h"
 #include "MidiIn.h"
 
@@ -46,15 +47,27 @@ public:
     int  getMaxCCNum();
 
     /*!
-    @brief returns a control value corrisponding to the given cc number, the output is mapped to the 0.0f-1.0f range.
+    @brief returns a control value corrisponding to the given cc number ready to be patched, the output is mapped to the 0.0f-1.0f range. All the CCs are rendered by a single Unit, the CCs that are not changing run at control rate.
+    @param[in] cc the cc number for the output, from 0 to 127
+    */    
+    pdsp::Patchable & out_cc( int cc );
+
+    /*!
+    @brief returns a control value corrisponding to the given cc number, the output is mapped to the 0.0f-1.0f range. Each CC returned by this method is a separate Unit, deprecated, use out_cc() instead.
     @param[in] cc the cc number for the output
     */    
     pdsp::SequencerValueOutput & out( int cc );
+
+    /*!
+    @brief returns the actual value of the given cc. Thread-safe.
+    @param[in] cc the cc number
+    */    
+    float meter_cc( int cc ) const;
     
 /*!
     @cond HIDDEN_SYMBOLS
 */
-    std::vector<pdsp::SequencerValueOutput>    outs_cc; // this has to become private in later versions
+    std::vector<pdsp::SequencerValueOutput>    outs_cc; // deprecated, use out_cc(), an output is updated only after it is returned by out()
     
     void processMidi(const pdsp::midi::Input &midiInProcessor, const int &bufferSize ) noexcept override;   
 /*!
@@ -63,6 +76,8 @@ public:
 private: 
     float slewTime;
     pdsp::helper::MidiCCBuffers midiCC;
+    pdsp::helper::MidiCCOutputs ccOutputs;
+    std::vector<bool>           linkedCC;
         
 };
 
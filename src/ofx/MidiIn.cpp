@@ -5,6 +5,9 @@
 
 #define OFXPDSP_MIDIREADVECTOR_MESSAGERESERVE 128
 #define OFXPDSP_MIDICIRCULARBUFFER_SIZE 4096
+#define OFXPDSP_MIDIIN_MAXSTAMPDRIFT 10000 // microseconds
+#define OFXPDSP_MIDIIN_DLLBANDWIDTH 1.0
+#define OFXPDSP_MIDIIN_DLLRESET 2.0
 
 pdsp::midi::Input::Input(){
 
@@ -13,8 +16,15 @@ pdsp::midi::Input::Input(){
     readVector.reserve(OFXPDSP_MIDIREADVECTOR_MESSAGERESERVE);
     circularBuffer.resize( OFXPDSP_MIDICIRCULARBUFFER_SIZE );
     
-    lastread = 0;
-    index = 0;
+    driverTimestamps = true;
+    stampStarted = false;
+    
+    clockOrigin = std::chrono::high_resolution_clock::now();
+    sampleRate = 44100.0;
+    dllStarted = false;
+    dllBufferSize = 0;
+    dllT0 = dllT1 = blockStart = 0.0;
+    dllPeriod = dllB = dllC = 0.0;
 }
 
 pdsp::midi::Input::~Input(){
@@ -27,6 +37,8 @@ void pdsp::midi::Input::linkToMidiIn(ofxMidiIn &midiInput){
     }
     
     midiIn_p = &midiInput;
+    stampStarted = false;
+    dllStarted = false;
     midiIn_p->addListener(this); // add ofApp as a listener
     connected = true;
 }
@@ -41,9 +53,10 @@ void pdsp::midi::Input::openPort(int index){
     
     if(midiIn.isOpen()){
         midiIn_p = &midiIn;
+        stampStarted = false;
+        dllStarted = false;
         midiIn_p->addListener(this); // add ofApp as a listener
         connected = true;
-        bufferChrono = std::chrono::high_resolution_clock::now();
     }
 }
 
@@ -62,9 +75,14 @@ void pdsp::midi::Input::listPorts(){
     midiIn.listPorts(); // print input ports to console
 }
 
+void pdsp::midi::Input::setDriverTimestamps( bool active ){
+    driverTimestamps = active;
+}
+
 
 void pdsp::midi::Input::prepareToPlay( int expectedBufferSize, double sampleRate ){
-    oneSlashMicrosecForSample = 1.0 / (1000000.0 / sampleRate);
+    this->sampleRate = sampleRate;
+    dllStarted = false;
 }
 
 void pdsp::midi::Input::releaseResources(){}
@@ -76,50 +94,97 @@ const std::vector<pdsp::_PositionedMidiMessage> & pdsp::midi::Input::getMessageV
 
 
 void pdsp::midi::Input::newMidiMessage(ofxMidiMessage& eventArgs) noexcept{
-    	
-    // calculate the right offset inside the bufferSize
-    int write = index +1;
-    if(write>=(int)circularBuffer.size()){ write = 0; } 
     
-    circularBuffer[write].message = eventArgs;
-    circularBuffer[write].timepoint = std::chrono::high_resolution_clock::now();
+    std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
+    std::chrono::time_point<std::chrono::high_resolution_clock> stamp = now;
+    
+    // the driver delta times are anchored to the arrival time of the first message
+    // the stamp is taken back to the arrival time if it runs ahead or drifts too far behind
+    if( driverTimestamps && stampStarted ){
+        std::chrono::duration<double, std::milli> delta( eventArgs.deltatime );
+        stamp = lastStamp + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>( delta );
+        if( stamp > now || now - stamp > std::chrono::microseconds( OFXPDSP_MIDIIN_MAXSTAMPDRIFT ) ){
+            stamp = now;
+        }
+    }
+    lastStamp = stamp;
+    stampStarted = true;
     
-    index = write;    
+    // copies only the parsed data, so the audio thread never allocates copying the message
+    MidiRecord record;
+    record.status   = eventArgs.status;
+    record.channel  = eventArgs.channel;
+    record.pitch    = eventArgs.pitch;
+    record.velocity = eventArgs.velocity;
+    record.control  = eventArgs.control;
+    record.value    = eventArgs.value;
+    record.deltatime = eventArgs.deltatime;
+    record.timepoint = stamp;
+    
+    circularBuffer.push( record );
+}
+
+double pdsp::midi::Input::seconds( const std::chrono::time_point<std::chrono::high_resolution_clock> & time ) const noexcept{
+    return std::chrono::duration<double>( time - clockOrigin ).count();
 }
 
-void pdsp::midi::Input::pushToReadVector( pdsp::_PositionedMidiMessage & message ){
-        std::chrono::duration<double> offset = message.timepoint - bufferChrono; 
-        message.sample = static_cast<int>( static_cast <double>( std::chrono::duration_cast<std::chrono::microseconds>(offset).count()) * oneSlashMicrosecForSample);
-        readVector.push_back( message );    
+void pdsp::midi::Input::updateClock( double now, int bufferSize ) noexcept{
+    
+    double period = static_cast<double>( bufferSize ) / sampleRate;
+    
+    if( !dllStarted || bufferSize != dllBufferSize || std::abs( now - dllT1 ) > period * OFXPDSP_MIDIIN_DLLRESET ){
+        // first callback, buffer size changed or callbacks stopped for a while
+        double omega = M_TAU_DOUBLE * OFXPDSP_MIDIIN_DLLBANDWIDTH * period;
+        dllB = std::sqrt( 2.0 ) * omega;
+        dllC = omega * omega;
+        dllPeriod = period;
+        blockStart = now - period;
+        dllT0 = now;
+        dllT1 = now + period;
+        dllBufferSize = bufferSize;
+        dllStarted = true;
+    }else{
+        double error = now - dllT1;
+        blockStart = dllT0;
+        dllT0 = dllT1;
+        dllT1 += dllB * error + dllPeriod;
+        dllPeriod += dllC * error;
+    }
 }
 
 void pdsp::midi::Input::processMidi( const int &bufferSize ) noexcept{
     if(connected){
         
         readVector.clear();
-        int read = index;
-
-        if(read<lastread){ // two segments
-            for(int i=lastread+1; i<(int)circularBuffer.size(); ++i){
-                pushToReadVector( circularBuffer[i] );
-            }            
-            for( int i=0; i<=read; ++i){
-                pushToReadVector( circularBuffer[i] );
-            }            
-        }else{
-            for(int i=lastread+1; i<=read; ++i){
-                pushToReadVector( circularBuffer[i] );
-            }
-        }
         
-        lastread = read;
-        bufferChrono = std::chrono::high_resolution_clock::now();
+        updateClock( seconds( std::chrono::high_resolution_clock::now() ), bufferSize );
+        
+        // messages received between the last two callbacks, positioned with the smoothed callback times
+        double samplesPerSecond = static_cast<double>( bufferSize ) / ( dllT0 - blockStart );
         
-        //now sanitize messages to bufferSize
-        for(_PositionedMidiMessage &msg : readVector){
+        MidiRecord record;
+        size_t available = circularBuffer.available();
+        for( size_t n=0; n<available && circularBuffer.peek( record ); ++n ){
+            double time = seconds( record.timepoint );
+            if( time >= dllT0 ){ break; } // belongs to the next buffer
+            if( readVector.size() == readVector.capacity() ){ break; } // the others wait the next buffer, no allocations
+            circularBuffer.pop( record );
+            
+            readVector.emplace_back();
+            _PositionedMidiMessage & msg = readVector.back();
+            msg.message.status   = record.status;
+            msg.message.channel  = record.channel;
+            msg.message.pitch    = record.pitch;
+            msg.message.velocity = record.velocity;
+            msg.message.control  = record.control;
+            msg.message.value    = record.value;
+            msg.message.deltatime = record.deltatime;
+            msg.timepoint = record.timepoint;
+            
+            msg.sample = static_cast<int>( ( time - blockStart ) * samplesPerSecond );
             if(msg.sample >= bufferSize){ msg.sample = bufferSize-1; } else 
             if(msg.sample < 0 ) { msg.sample = 0; }
-        }       
+        }
     }
 }
 
@@ -10,7 +10,9 @@
 
 #include "ofxMidi.h"
 #include <chrono>
+#include <atomic>
 #include "helper/PositionedMidiMessage.h"
+#include "helper/SpscRing.h"
 #include "../DSP/pdspCore.h"
 
 /*!
@@ -47,6 +49,12 @@ public:
     @param[in] midiInput ofxMidiIn object
     */    
     void linkToMidiIn(ofxMidiIn &midiInput);
+
+    /*!
+    @brief if active the messages are timed with the delta times given by the midi driver instead of the time they reach the application, removing the jitter of the midi thread. Default is active.
+    @param[in] active true for using the driver timestamps
+    */    
+    void setDriverTimestamps( bool active );
        
        
 /*!
@@ -70,15 +78,40 @@ private:
     ofxMidiIn   midiIn;
     ofxMidiIn*  midiIn_p;
     
-    std::atomic<int> index;
-    int lastread;
-    std::vector<_PositionedMidiMessage>    circularBuffer;
-    std::vector<_PositionedMidiMessage>    readVector;
-
-    double                                                      oneSlashMicrosecForSample;
-    std::chrono::time_point<std::chrono::high_resolution_clock> bufferChrono;
+    // parsed data of a received message, plain data so the ring never allocates
+    struct MidiRecord {
+        MidiStatus  status;
+        int         channel;
+        int         pitch;
+        int         velocity;
+        int         control;
+        int         value;
+        double      deltatime;
+        std::chrono::time_point<std::chrono::high_resolution_clock> timepoint;
+    };
+
+    pdsp::SpscRing<MidiRecord>              circularBuffer;
+    std::vector<_PositionedMidiMessage>     readVector;
+
+    // midi thread timestamps
+    std::atomic<bool>                                           driverTimestamps;
+    bool                                                        stampStarted;
+    std::chrono::time_point<std::chrono::high_resolution_clock> lastStamp;
+
+    // delay locked loop modeling the time of the audio callbacks, in seconds from clockOrigin
+    void updateClock( double now, int bufferSize ) noexcept;
+    double seconds( const std::chrono::time_point<std::chrono::high_resolution_clock> & time ) const noexcept;
     
-    void pushToReadVector( _PositionedMidiMessage & message );
+    std::chrono::time_point<std::chrono::high_resolution_clock> clockOrigin;
+    double  sampleRate;
+    bool    dllStarted;
+    int     dllBufferSize;
+    double  dllT0;
+    double  dllT1;
+    double  dllPeriod;
+    double  dllB;
+    double  dllC;
+    double  blockStart;
     
     bool connected;
         
@@ -65,6 +65,31 @@ int pdsp::midi::Keys::getVoicesNumber() const {
         return maxVoices;
 }
 
+void pdsp::midi::Keys::setVoiceSteal( VoiceSteal mode ){
+    midiConverter.setVoiceSteal( mode );
+}
+
+bool pdsp::midi::Keys::meter_voice_active( int voice ) const {
+    if( voice < 0 || voice >= maxVoices ){ return false; }
+    if( monoMode ){ 
+        return midiConverter.meter_voice_mask( 0 ) != 0; // any key pressed
+    }
+    return midiConverter.meter_voice_active( voice % maxNotes ); // unison voices follow their note
+}
+
+uint64_t pdsp::midi::Keys::meter_voice_mask( int offset ) const {
+    if( !monoMode && maxVoices == maxNotes ){
+        return midiConverter.meter_voice_mask( offset );
+    }
+    uint64_t mask = 0;
+    for( int i=0; i<64 && offset + i < maxVoices; ++i ){
+        if( meter_voice_active( offset + i ) ){
+            mask |= uint64_t(1) << i;
+        }
+    }
+    return mask;
+}
+
 void pdsp::midi::Keys::setNoteRange(int lowNote, int highNote){
     midiConverter.setNoteRange( lowNote, highNote );
     
@@ -78,6 +103,7 @@ void pdsp::midi::Keys::setPolyMode(int maxNotes, int unisonVoices ){
         }
         out_singletrigger.unLink();
         this->maxNotes = maxNotes;
+        monoMode = false;
         
         midiConverter.setVoiceMode(Poly);
         midiConverter.setMaxNotes(maxNotes);
@@ -149,6 +175,7 @@ void pdsp::midi::Keys::setMonoMode(int unisonVoices, bool legato, MonoPriority p
         }
         out_singletrigger.unLink();
         
+        monoMode = true;
         midiConverter.setVoiceMode(Mono);
         midiConverter.setMonoPriority(priority);
         
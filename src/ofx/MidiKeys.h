@@ -86,10 +86,28 @@ public:
     */
     void setMidiChannel( int channel );  
     
+    /*!
+    @brief sets how a voice is chosen for a new note
+    @param[in] mode Oldest (default) takes the least recently released voice and when all the voices are playing steals the oldest note that is not the highest or the lowest, RoundRobin cycles the voices in order, Quietest steals the note with the lowest velocity
+    */
+    void setVoiceSteal( VoiceSteal mode );
+    
     /*!
     @brief returns the actual voice number 
     */
     int getVoicesNumber() const;
+
+    /*!
+    @brief returns true if the given voice has its key pressed. A released voice can still be in the release stage of its envelope. Thread-safe.
+    @param[in] voice voice number
+    */
+    bool meter_voice_active( int voice ) const;
+
+    /*!
+    @brief returns a bit mask of the active voices, the lowest bit is the given voice and the others follow. Use it to skip the processing of idle voices. Thread-safe.
+    @param[in] offset index of the first voice of the mask, 0 if not given
+    */
+    uint64_t meter_voice_mask( int offset = 0 ) const;
     
 
     /*!
@@ -159,6 +177,7 @@ private:
 
     int                 maxNotes;
     int                 maxVoices;
+    bool                monoMode;
 
     PortamentoMode      portamentoMode;
     float               portamentoTime;
@@ -6,23 +6,6 @@
 #define OFXPDSP_MIDIOUTPUTCIRCULARBUFFERSIZE 4096
 
 
-pdsp::midi::Output::ScheduledMidiMessage::ScheduledMidiMessage(){  };
-
-pdsp::midi::Output::ScheduledMidiMessage::ScheduledMidiMessage(ofxMidiMessage message, std::chrono::high_resolution_clock::time_point schedule)
-                : midi(message), scheduledTime(schedule){};
-
-pdsp::midi::Output::ScheduledMidiMessage::ScheduledMidiMessage(const pdsp::midi::Output::ScheduledMidiMessage &other)
-                : pdsp::midi::Output::ScheduledMidiMessage(other.midi, other.scheduledTime){}
-
-pdsp::midi::Output::ScheduledMidiMessage& pdsp::midi::Output::ScheduledMidiMessage::operator= (const pdsp::midi::Output::ScheduledMidiMessage &other){
-    this->midi          = other.midi;
-    this->scheduledTime = other.scheduledTime;
-    return *this;
-}
-
-pdsp::midi::Output::ScheduledMidiMessage::~ScheduledMidiMessage(){}
-
-
 bool pdsp::midi::Output::scheduledMidiSort(const ScheduledMidiMessage &lhs, const ScheduledMidiMessage &rhs ){
     return (lhs.scheduledTime < rhs.scheduledTime);
 }
@@ -45,15 +28,9 @@ pdsp::midi::Output::Output(){
     connected = false;
     
     //midi daemon init
-    runMidiDaemon = false;
-    chronoStarted = false;
     
     //processing init
-
-    circularBuffer.resize(OFXPDSP_MIDIOUTPUTCIRCULARBUFFERSIZE);
-   
-    writeindex = 0;
-    send = 0;
+    daemon.resize(OFXPDSP_MIDIOUTPUTCIRCULARBUFFERSIZE);
     
     //testing
     messageCount = 0;
@@ -195,7 +172,7 @@ void pdsp::midi::Output::unlinkMessageBuffer(pdsp::MessageBuffer &messageBuffer)
 }
 
 void pdsp::midi::Output::prepareToPlay( int expectedBufferSize, double sampleRate ){
-    usecPerSample = 1000000.0 / sampleRate;
+    outputClock.prepare( sampleRate );
     
 }
 
@@ -206,13 +183,7 @@ void pdsp::midi::Output::process( int bufferSize ) noexcept{
     
     if(connected){
         
-        if(chronoStarted){
-            std::chrono::nanoseconds bufferOffset = std::chrono::nanoseconds (static_cast<long> ( bufferSize * usecPerSample ));
-            bufferChrono = bufferChrono + bufferOffset;
-        }else{
-            bufferChrono = std::chrono::high_resolution_clock::now();
-            chronoStarted = true;
-        }
+        outputClock.advance( bufferSize );
         
         //clear messages
         messagesToSend.clear();
@@ -229,10 +200,6 @@ void pdsp::midi::Output::process( int bufferSize ) noexcept{
             int noteMax;
             if( noteBufferI == nullptr ){ noteMax = 0; } //this deactivates the search for pitch
             else{ noteMax = noteBufferI->size(); }
-          
-            /* // OLD WAY
-            bufferChrono = std::chrono::high_resolution_clock::now();
-            */
             for(int gateIndex=0; gateIndex<gateMax; ++gateIndex){
                 //check if we have to change the pitch
                 if(  noteIndex<noteMax && 
@@ -247,10 +214,9 @@ void pdsp::midi::Output::process( int bufferSize ) noexcept{
                 int sample = gateBufferI->messages[gateIndex].sample;
                 
 
-                std::chrono::nanoseconds offset = std::chrono::nanoseconds (static_cast<long> ( sample * usecPerSample ));
-                std::chrono::high_resolution_clock::time_point scheduleTime = bufferChrono + offset;
+                std::chrono::high_resolution_clock::time_point scheduleTime = outputClock.at( sample );
                 
-                ofxMidiMessage midi;
+                ScheduledMidiMessage midi;
                 if(gateValue == 0.0f){
                     midi.status = MIDI_NOTE_OFF;
                     midi.velocity = 64;
@@ -262,9 +228,10 @@ void pdsp::midi::Output::process( int bufferSize ) noexcept{
                 midi.pitch = defaultNote[i];
                 midi.channel = midiChannelsNote[i];
                 midi.control = 0;
+                midi.value = 0;
+                midi.scheduledTime = scheduleTime;
                 
-                //todo:: correct nanosec time
-                messagesToSend.push_back( ScheduledMidiMessage(midi, scheduleTime) );
+                messagesToSend.push_back( midi );
             }
         }
         
@@ -275,17 +242,21 @@ void pdsp::midi::Output::process( int bufferSize ) noexcept{
             int ccMax = ccBufferI->size();
             for(int ccIndex=0; ccIndex<ccMax; ++ccIndex){
                 
-                ofxMidiMessage midi;
+                ScheduledMidiMessage midi;
                 midi.status = MIDI_CONTROL_CHANGE;
                 midi.channel = midiChannelsCC[i];
                 midi.control = ccBufferI->messages[ccIndex].value;
+                midi.pitch = 0;
+                midi.velocity = 0;
+                midi.value = 0;
                 
                 int sample = ccBufferI->messages[ccIndex].sample;
                 
-                std::chrono::nanoseconds offset = std::chrono::nanoseconds ( static_cast<long>(sample * usecPerSample) );
-                std::chrono::high_resolution_clock::time_point scheduleTime = bufferChrono + offset;
+                std::chrono::high_resolution_clock::time_point scheduleTime = outputClock.at( sample );
+                
+                midi.scheduledTime = scheduleTime;
                 
-                messagesToSend.push_back( ScheduledMidiMessage(midi, scheduleTime) );
+                messagesToSend.push_back( midi );
             }   
         }
             
@@ -294,10 +265,11 @@ void pdsp::midi::Output::process( int bufferSize ) noexcept{
         
         //send to daemon
         for(ScheduledMidiMessage &msg : messagesToSend){
-            circularBuffer[writeindex] = msg;
-            int write = writeindex+1;
-            if( write >= (int)circularBuffer.size() ){ write = 0; };
-            writeindex = write;
+            daemon.push( msg );
+        }
+        
+        if( !messagesToSend.empty() ){ 
+            daemon.wake(); // never locks the audio thread
         }
 
 
@@ -306,53 +278,46 @@ void pdsp::midi::Output::process( int bufferSize ) noexcept{
 
 void pdsp::midi::Output::startMidiDaemon(){
     
-    runMidiDaemon = true;
-    midiDaemonThread = std::thread( midiDaemonFunctionWrapper, this );   
+    meter.reset();
+    daemon.start( [this]( std::chrono::high_resolution_clock::time_point now ){ sendDueMessages( now ); } );
     
 }
     
-void pdsp::midi::Output::midiDaemonFunctionWrapper(pdsp::midi::Output* parent){
-    parent->midiDaemonFunction();
-}
-   
-    
-void pdsp::midi::Output::midiDaemonFunction() noexcept{
+void pdsp::midi::Output::sendDueMessages( std::chrono::high_resolution_clock::time_point now ) noexcept{
     
-    while (runMidiDaemon){
-
-        while( send!=writeindex && circularBuffer[send].scheduledTime < std::chrono::high_resolution_clock::now() ){
-           
-            // SEND MESSAGES HERE
-            ScheduledMidiMessage& nextMessage = circularBuffer[send];
-            
-            switch(nextMessage.midi.status){
-            case MIDI_NOTE_ON:
-                midiOut_p->sendNoteOn(nextMessage.midi.channel, nextMessage.midi.pitch, nextMessage.midi.velocity);
-                break;
-            case MIDI_NOTE_OFF:
-                midiOut_p->sendNoteOff(nextMessage.midi.channel, nextMessage.midi.pitch, nextMessage.midi.velocity);
-                break;
-            case MIDI_CONTROL_CHANGE:
-                midiOut_p->sendNoteOff(nextMessage.midi.channel, nextMessage.midi.control, nextMessage.midi.value);
-                break;
-            default: break;
-            }
-
-            send++;
+    ScheduledMidiMessage nextMessage;
+    while( daemon.popDue( nextMessage, now ) ){
+        // SEND MESSAGES HERE
+        switch(nextMessage.status){
+        case MIDI_NOTE_ON:
+            midiOut_p->sendNoteOn(nextMessage.channel, nextMessage.pitch, nextMessage.velocity);
+            break;
+        case MIDI_NOTE_OFF:
+            midiOut_p->sendNoteOff(nextMessage.channel, nextMessage.pitch, nextMessage.velocity);
+            break;
+        case MIDI_CONTROL_CHANGE:
+            midiOut_p->sendNoteOff(nextMessage.channel, nextMessage.control, nextMessage.value);
+            break;
+        default: break;
         }
 
-        std::this_thread::sleep_for(std::chrono::microseconds(500));
-
-    }    
-
-    if(verbose) std::cout<<"[pdsp] closing midi out daemon thread\n";
+        std::chrono::duration<double, std::micro> delay = std::chrono::high_resolution_clock::now() - nextMessage.scheduledTime;
+        meter.add( delay.count() );
+    }
 }
     
- 
-    
 void pdsp::midi::Output::closeMidiDaemon(){
-    runMidiDaemon = false;
-    midiDaemonThread.detach();
+    daemon.stop();
+    if(verbose) std::cout<<"[pdsp] closing midi out daemon thread\n";
+}
+
+float pdsp::midi::Output::meter_latency() const {
+    return meter.getLatency();
+}
+
+float pdsp::midi::Output::meter_jitter() const {
+    return meter.getJitter();
 }
+
     
 #endif
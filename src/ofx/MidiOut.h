@@ -12,12 +12,11 @@
 #include <chrono>
 #include "helper/PositionedMidiMessage.h"
 #include <algorithm>
-#include <thread>
-#include <mutex>
-#include <condition_variable>
-#include <atomic>
 #include "../DSP/pdspCore.h"
 #include "../sequencer/SequencerSection.h"
+#include "helper/DaemonMeter.h"
+#include "helper/OutputDaemon.h"
+#include "helper/OutputClock.h"
 
 /*!
 @brief utility class manage midi output ports and send midi messages from the internal generative music system
@@ -29,16 +28,15 @@ class Output : public pdsp::ExtSequencer, public pdsp::Preparable {
 
 private:
 
-    class ScheduledMidiMessage{
-    public:
-        ScheduledMidiMessage();
-        ScheduledMidiMessage(ofxMidiMessage message, std::chrono::high_resolution_clock::time_point schedule);
-        ScheduledMidiMessage(const ScheduledMidiMessage &other);
-        ScheduledMidiMessage& operator= (const ScheduledMidiMessage &other);
-        ~ScheduledMidiMessage();
-        
-        ofxMidiMessage                              midi;
-        std::chrono::high_resolution_clock::time_point   scheduledTime;
+    // plain data, so the queue to the daemon never allocates
+    struct ScheduledMidiMessage{
+        MidiStatus                                      status;
+        int                                             channel;
+        int                                             pitch;
+        int                                             velocity;
+        int                                             control;
+        int                                             value;
+        std::chrono::high_resolution_clock::time_point  scheduledTime;
     };
     
     
@@ -82,6 +80,16 @@ public:
     */   
     void setVerbose( bool verbose );
 
+    /*!
+    @brief returns the mean delay of the sent messages from their scheduled time, in microseconds. Thread-safe.
+    */   
+    float meter_latency() const;
+
+    /*!
+    @brief returns the mean deviation of the sent messages delay from meter_latency(), in microseconds. Thread-safe.
+    */   
+    float meter_jitter() const;
+
     /*!
     @brief patch a pdsp::ScoreSection::out_message() method to the result of this method for sending midi note message out
     
@@ -145,20 +153,13 @@ private:
     //MIDI DAEMON MEMBERS---------------------------------------------------------------
     void                                                startMidiDaemon();
     void                                                closeMidiDaemon();
-    void                                                midiDaemonFunction() noexcept;
-    static void                                         midiDaemonFunctionWrapper(Output* parent);
-    
-    std::thread                 midiDaemonThread;
-    std::atomic<bool>           runMidiDaemon;
+    void                                                sendDueMessages( std::chrono::high_resolution_clock::time_point now ) noexcept;
     
     //midi output processing members
-    bool                                                        chronoStarted;
-    std::chrono::time_point<std::chrono::high_resolution_clock> bufferChrono;     
-    double                                                  usecPerSample;
-    std::vector<ScheduledMidiMessage>                    circularBuffer;
-   
-    std::atomic<int>                                        writeindex;
-    int                                                     send;
+    pdsp::OutputClock                                   outputClock;
+
+    pdsp::OutputDaemon<ScheduledMidiMessage>                daemon;
+    pdsp::DaemonMeter                                       meter;
 
 
     //TESTING
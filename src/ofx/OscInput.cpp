@@ -2,7 +2,7 @@
 #include "OscInput.h"
 
 #define OFXPDSP_OSCINPUT_MESSAGERESERVE 128
-#define OFXPDSP_OSCCIRCULARBUFFER_SIZE 10000
+#define OFXPDSP_OSCCIRCULARBUFFER_SIZE 16384
 
 pdsp::osc::Input::OscChannel::OscChannel(){
     
@@ -30,16 +30,16 @@ pdsp::osc::Input::Input() {
     
     oscChannels.clear();
     
-    readVector.reserve(OFXPDSP_OSCINPUT_MESSAGERESERVE);
-    circularBuffer.resize( OFXPDSP_OSCCIRCULARBUFFER_SIZE );
-    
-    lastread = 0;
-    index = 0;
+    records.resize( OFXPDSP_OSCCIRCULARBUFFER_SIZE );
+    dropped = 0;
     
     connected = false;
+    verbose = false;
+    sendClearMessages = false;
     
     runDaemon = false;
-    daemonRefreshRate = 500;
+    socket = nullptr;
+    listener.input = this;
 }   
 
 
@@ -65,7 +65,14 @@ void pdsp::osc::Input::openPort( int port ) {
         close();
     }
     
-    receiver.setup( port );
+    try{
+        socket = new UdpListeningReceiveSocket( IpEndpointName( IpEndpointName::ANY_ADDRESS, port ), &listener );
+    }catch( std::exception & e ){
+        cout<<"[pdsp] error opening OSC input on port "<<port<<" : "<<e.what()<<"\n";
+        pdsp::pdsp_trace();
+        socket = nullptr;
+        return;
+    }
     
     startDaemon();
     
@@ -102,13 +109,14 @@ pdsp::SequencerGateOutput& pdsp::osc::Input::out_trig( string oscAddress ) {
     }
     
     // not found
-    OscChannel* osc = new OscChannel();
-    osc->key = oscAddress;
+    int channel = addChannel( oscAddress );
+    OscChannel* osc = oscChannels[channel];
     //osc->mode = Gate;
-    osc->messageBuffer = new pdsp::MessageBuffer();
     osc->gate_out = new pdsp::SequencerGateOutput();
     osc->gate_out->link( *(osc->messageBuffer) );
-    oscChannels.push_back(osc);
+    
+    std::lock_guard<std::mutex> lock( addressMutex );
+    addressTable[ oscAddress ] = channel; // now the daemon can use it
 
     return *(osc->gate_out);
 
@@ -130,22 +138,44 @@ pdsp::SequencerValueOutput& pdsp::osc::Input::out_value( string oscAddress ) {
     }
 
     // not found
-    OscChannel* osc = new OscChannel();
-    osc->key = oscAddress;
+    int channel = addChannel( oscAddress );
+    OscChannel* osc = oscChannels[channel];
     //osc->mode = Value;
-    osc->messageBuffer = new pdsp::MessageBuffer();
     osc->value_out = new pdsp::SequencerValueOutput();
     osc->value_out->link( *(osc->messageBuffer) );
-    oscChannels.push_back(osc);
+    
+    std::lock_guard<std::mutex> lock( addressMutex );
+    addressTable[ oscAddress ] = channel; // now the daemon can use it
 
     return *(osc->value_out);    
 
 }
 
+int pdsp::osc::Input::addChannel( string oscAddress ) {
+    OscChannel* osc = new OscChannel();
+    osc->key = oscAddress;
+    osc->messageBuffer = new pdsp::MessageBuffer();
+    osc->messageBuffer->reserve( OFXPDSP_OSCINPUT_MESSAGERESERVE );
+    oscChannels.push_back(osc);
+    return oscChannels.size() - 1;
+}
+
 void pdsp::osc::Input::clearAll(){
     sendClearMessages = true;
 }
 
+int pdsp::osc::Input::meter_dropped() const {
+    return dropped.load();
+}
+
+float pdsp::osc::Input::meter_latency() const {
+    return meter.getLatency();
+}
+
+float pdsp::osc::Input::meter_jitter() const {
+    return meter.getJitter();
+}
+
 void pdsp::osc::Input::prepareToPlay( int expectedBufferSize, double sampleRate ){
     oneSlashMicrosecForSample = 1.0 / (1000000.0 / sampleRate);
 }
@@ -156,67 +186,60 @@ void pdsp::osc::Input::releaseResources(){}
 
 void pdsp::osc::Input::daemonFunction() noexcept{
     
-    while (runDaemon){
-        
-        while(receiver.hasWaitingMessages()){
-            
-            ofxOscMessage osc;
-            receiver.getNextMessage(osc);
-            
-            // calculate the right offset inside the bufferSize
-            int write = index +1;
-            if(write>=(int)circularBuffer.size()){ write = 0; } 
-
-            circularBuffer[write].message = osc;
-            circularBuffer[write].timepoint = std::chrono::high_resolution_clock::now();
-
-            index = write;    
+    socket->Run(); // blocks on the socket until AsynchronousBreak() is called
+   
+    if(verbose) cout<<"[pdsp] closing OSC input daemon thread\n";
+}
 
-        }
+void pdsp::osc::Input::PacketListener::ProcessPacket( const char *data, int size, const IpEndpointName& remoteEndpoint ){
+    try{
+        ::osc::OscPacketListener::ProcessPacket( data, size, remoteEndpoint );
+    }catch( ::osc::Exception & e ){
+        if(input->verbose) cout<<"[pdsp] malformed OSC packet received : "<<e.what()<<"\n";
+    }
+}
 
-        this_thread::sleep_for(std::chrono::microseconds(daemonRefreshRate));
+void pdsp::osc::Input::PacketListener::ProcessMessage( const ::osc::ReceivedMessage& m, const IpEndpointName& remoteEndpoint ){
+    input->receive( m );
+}
 
+void pdsp::osc::Input::receive( const ::osc::ReceivedMessage& m ) noexcept{
+    
+    if( m.ArgumentCount() == 0 ){ return; }
+
+    _OscRecord record;
+    {
+        std::lock_guard<std::mutex> lock( addressMutex );
+        addressKey.assign( m.AddressPattern() );
+        auto it = addressTable.find( addressKey );
+        if( it == addressTable.end() ){ return; } // address not used
+        record.channel = it->second;
     }
-   
-    if(verbose) cout<<"[pdsp] closing OSC input daemon thread\n";
-}
     
+    // only the first arg of each osc message is read, as float
+    ::osc::ReceivedMessageArgumentIterator arg = m.ArgumentsBegin();
+    if( arg->IsFloat() ){
+        record.value = arg->AsFloatUnchecked();
+    }else if( arg->IsInt32() ){
+        record.value = static_cast<float>( arg->AsInt32Unchecked() );
+    }else if( arg->IsDouble() ){
+        record.value = static_cast<float>( arg->AsDoubleUnchecked() );
+    }else if( arg->IsInt64() ){
+        record.value = static_cast<float>( arg->AsInt64Unchecked() );
+    }else if( arg->IsBool() ){
+        record.value = arg->AsBoolUnchecked() ? 1.0f : 0.0f;
+    }else{
+        return;
+    }
+    record.timepoint = std::chrono::high_resolution_clock::now();
 
-void pdsp::osc::Input::pushToReadVector( pdsp::osc::Input::_PositionedOscMessage & message ){
-        std::chrono::duration<double> offset = message.timepoint - bufferChrono; 
-        message.sample = static_cast<int>( static_cast <double>( std::chrono::duration_cast<std::chrono::microseconds>(offset).count()) * oneSlashMicrosecForSample);
-        readVector.push_back( message );    
+    if( !records.push( record ) ){ dropped++; }
 }
 
 void pdsp::osc::Input::processOsc( int bufferSize ) noexcept {
     
     if(connected){
         
-        readVector.clear();
-        int read = index;
-
-        if(read<lastread){ // two segments
-            for(int i=lastread+1; i<(int)circularBuffer.size(); ++i){
-                pushToReadVector( circularBuffer[i] );
-            }            
-            for( int i=0; i<=read; ++i){
-                pushToReadVector( circularBuffer[i] );
-            }            
-        }else{
-            for(int i=lastread+1; i<=read; ++i){
-                pushToReadVector( circularBuffer[i] );
-            }
-        }
-        
-        lastread = read;
-        bufferChrono = std::chrono::high_resolution_clock::now();
-        
-        //now sanitize messages to bufferSize
-        for(_PositionedOscMessage &msg : readVector){
-            if(msg.sample >= bufferSize){ msg.sample = bufferSize-1; } else
-            if(msg.sample < 0 ) { msg.sample = 0; }
-        }
-        
         // clean the message buffers
         for (size_t i = 0; i < oscChannels.size(); ++i){
             oscChannels[i]->messageBuffer->clearMessages();
@@ -225,16 +248,26 @@ void pdsp::osc::Input::processOsc( int bufferSize ) noexcept {
                 oscChannels[i]->messageBuffer->addMessage(0.0f, 0);
             }
         }
+        sendClearMessages = false;
         
-        // adds the messages to the buffers, only the first arg of each osc message is read, as float
-        for(_PositionedOscMessage &osc : readVector){
-            for (size_t i = 0; i < oscChannels.size(); ++i){
-                if(osc.message.getAddress() == oscChannels[i]->key){
-                    oscChannels[i]->messageBuffer->addMessage( osc.message.getArgAsFloat(0), osc.sample );
-                }
-            }
+        // adds the messages received since the last buffer to the buffers
+        std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
+        size_t available = records.available();
+        _OscRecord record;
+        for( size_t n=0; n<available && records.pop( record ); ++n ){
+            std::chrono::duration<double> offset = record.timepoint - bufferChrono; 
+            int sample = static_cast<int>( static_cast <double>( std::chrono::duration_cast<std::chrono::microseconds>(offset).count()) * oneSlashMicrosecForSample);
+            if( sample >= bufferSize ){ sample = bufferSize-1; } else
+            if( sample < 0 ) { sample = 0; }
+            
+            oscChannels[record.channel]->messageBuffer->addMessage( record.value, sample );
+            
+            std::chrono::duration<double, std::micro> delay = now - record.timepoint;
+            meter.add( delay.count() );
         }
         
+        bufferChrono = now;
+        
         // now process all the linked sequencers
         for (size_t i = 0; i < oscChannels.size(); ++i){
             oscChannels[i]->messageBuffer->processDestination(bufferSize);
@@ -247,6 +280,7 @@ void pdsp::osc::Input::processOsc( int bufferSize ) noexcept {
 
 void pdsp::osc::Input::startDaemon(){ // OK
     if(verbose) cout<<"[pdsp] starting OSC input daemon\n";
+    meter.reset();
     runDaemon = true;
     daemonThread = thread( daemonFunctionWrapper, this );   
     
@@ -256,7 +290,12 @@ void pdsp::osc::Input::startDaemon(){ // OK
 void pdsp::osc::Input::closeDaemon(){
  
     runDaemon = false;
-    daemonThread.detach();
+    socket->AsynchronousBreak();
+    if( daemonThread.joinable() ){
+        daemonThread.join();
+    }
+    delete socket;
+    socket = nullptr;
 
 }
         
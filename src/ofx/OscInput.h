@@ -13,9 +13,14 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <unordered_map>
 #include "../DSP/pdspCore.h"
 #include "../sequencer/SequencerSection.h"
 #include "ofxOsc.h"
+#include "OscPacketListener.h"
+#include "UdpSocket.h"
+#include "helper/SpscRing.h"
+#include "helper/DaemonMeter.h"
 
 /*!
 @brief utility class manage OSC input to the DSP
@@ -43,15 +48,23 @@ private:
         
     };
     
-    class _PositionedOscMessage {
+    // message parsed by the daemon, plain data so it can be passed to the audio thread without allocations
+    class _OscRecord {
     public:
-        _PositionedOscMessage(){ sample = -1; };
-        _PositionedOscMessage(ofxOscMessage message, int sample) : message(message), sample(sample){};
-        
+        _OscRecord(){ channel = -1; value = 0.0f; };
         
         std::chrono::time_point<std::chrono::high_resolution_clock> timepoint;
-        ofxOscMessage message;
-        int sample;
+        int channel;
+        float value;
+    };
+    
+    // receives the packets from the socket in the daemon thread
+    class PacketListener : public ::osc::OscPacketListener {
+    public:
+        Input* input;
+        void ProcessPacket( const char *data, int size, const IpEndpointName& remoteEndpoint ) override;
+    protected:
+        void ProcessMessage( const ::osc::ReceivedMessage& m, const IpEndpointName& remoteEndpoint ) override;
     };
 
 
@@ -102,6 +115,21 @@ public:
     */   
     void clearAll();
 
+    /*!
+    @brief returns the number of received messages that were dropped because the audio thread was too late to read them. Thread-safe.
+    */   
+    int meter_dropped() const;
+
+    /*!
+    @brief returns the mean time the received messages wait before being processed by the audio thread, in microseconds. Thread-safe.
+    */   
+    float meter_latency() const;
+
+    /*!
+    @brief returns the mean deviation of the received messages latency from meter_latency(), in microseconds. Thread-safe.
+    */   
+    float meter_jitter() const;
+
 /*!
     @cond HIDDEN_SYMBOLS
 */  
@@ -115,7 +143,8 @@ protected:
     void releaseResources() override;    
 
 private:
-    ofxOscReceiver  receiver;
+    PacketListener              listener;
+    UdpListeningReceiveSocket*  socket;
         
     vector<OscChannel*> oscChannels;    
     
@@ -125,11 +154,14 @@ private:
     bool    sendClearMessages; 
 
     
-    std::atomic<int> index;
-    int lastread;
-    std::vector<_PositionedOscMessage>    circularBuffer;
-    std::vector<_PositionedOscMessage>    readVector;
+    std::unordered_map<std::string, int>    addressTable;
+    std::mutex                              addressMutex;
+    pdsp::SpscRing<_OscRecord>              records;
+    std::atomic<int>                        dropped;
+    std::string                             addressKey;
+    pdsp::DaemonMeter                       meter;
 
+    int addChannel( string oscAddress );
 
     double                                              oneSlashMicrosecForSample;
 
@@ -142,12 +174,10 @@ private:
     void                                                startDaemon();
     void                                                closeDaemon();
     void                                                daemonFunction() noexcept;
+    void                                                receive( const ::osc::ReceivedMessage& m ) noexcept;
     static void                                         daemonFunctionWrapper(Input* parent);
     thread                                              daemonThread;
     atomic<bool>                                        runDaemon;
-    int                                                 daemonRefreshRate;
-
-    void pushToReadVector( _PositionedOscMessage & message );
     
 };
 
@@ -2,33 +2,39 @@
 #include "OscOutput.h"
 
 #define OFXPDSP_OSCOUTPUTCIRCULARBUFFERSIZE 4096
+#define OFXPDSP_OSCOUTPUTPACKETSIZE 8192
 
 
-pdsp::osc::Output::ScheduledOscMessage::ScheduledOscMessage(){  };
+pdsp::osc::Output::ScheduledOscMessage::ScheduledOscMessage(){
+    slot = nullptr;
+    value = 0.0f;
+};
 
-pdsp::osc::Output::ScheduledOscMessage::ScheduledOscMessage(ofxOscMessage message,  chrono::high_resolution_clock::time_point schedule) {
+pdsp::osc::Output::ScheduledOscMessage::ScheduledOscMessage( const AddressSlot* slot, float value, chrono::high_resolution_clock::time_point schedule ) {
 
-    this->message = message;
+    this->slot = slot;
+    this->value = value;
     this->scheduledTime = schedule;
                     
 };
 
-pdsp::osc::Output::ScheduledOscMessage::ScheduledOscMessage(const pdsp::osc::Output::ScheduledOscMessage &other){
-    this->message          = other.message;
-    this->scheduledTime = other.scheduledTime;
-}
 
-pdsp::osc::Output::ScheduledOscMessage& pdsp::osc::Output::ScheduledOscMessage::operator= (const pdsp::osc::Output::ScheduledOscMessage &other){
-    this->message          = other.message;
-    this->scheduledTime = other.scheduledTime;
-    return *this;
+bool pdsp::osc::Output::scheduledSort(const ScheduledOscMessage &lhs, const ScheduledOscMessage &rhs ){
+    return (lhs.scheduledTime < rhs.scheduledTime);
 }
 
-pdsp::osc::Output::ScheduledOscMessage::~ScheduledOscMessage(){}
-
+uint64_t pdsp::osc::Output::timetag( chrono::high_resolution_clock::time_point time, chrono::high_resolution_clock::time_point now ){
+    // OSC timetags are NTP timestamps: seconds from 1900 in the high 32 bits, fraction of second in the low 32 bits
+    chrono::system_clock::time_point system = chrono::system_clock::now() + chrono::duration_cast<chrono::system_clock::duration>( time - now );
+    uint64_t nanoseconds = static_cast<uint64_t>( chrono::duration_cast<chrono::nanoseconds>( system.time_since_epoch() ).count() );
+    uint64_t seconds = nanoseconds / 1000000000ULL + 2208988800ULL;
+    uint64_t fraction = ( ( nanoseconds % 1000000000ULL ) << 32 ) / 1000000000ULL;
+    return ( seconds << 32 ) | fraction;
+}
 
-bool pdsp::osc::Output::scheduledSort(const ScheduledOscMessage &lhs, const ScheduledOscMessage &rhs ){
-    return (lhs.scheduledTime < rhs.scheduledTime);
+size_t pdsp::osc::Output::messageSize( const std::string & address ){
+    // bundle element size + padded address + ",f" type tags + float argument
+    return 4 + ( ( address.size() + 4 ) & ~((size_t)3) ) + 4 + 4;
 }
 
 
@@ -36,22 +42,21 @@ bool pdsp::osc::Output::scheduledSort(const ScheduledOscMessage &lhs, const Sche
 
 pdsp::osc::Output::Output(){
     inputs.reserve(128);
-    messagesToSend.reserve(128);
+    messagesToSend.reserve(OFXPDSP_OSCOUTPUTCIRCULARBUFFERSIZE);
     messagesToSend.clear();
     verbose = false;
     selectedAddress = "uninitialized";
     
-    connected = false;
-    
-    chronoStarted = false;
+    socket = nullptr;
+    bundling = false;
+    bundleWindowMs = 0.0f;
+    filterRepeated = false;
+    packetBuffer.resize(OFXPDSP_OSCOUTPUTPACKETSIZE);
     
-    //midi daemon init
-    runDaemon = false;
+    connected = false;
     
     //processing init
-    circularBuffer.resize(OFXPDSP_OSCOUTPUTCIRCULARBUFFERSIZE);
-    writeindex = 0;
-    send = 0;
+    daemon.resize(OFXPDSP_OSCOUTPUTCIRCULARBUFFERSIZE);
     
     //testing
     messageCount = 0;
@@ -61,19 +66,40 @@ pdsp::osc::Output::~Output(){
     if(connected){
         close();
     }
+    for( AddressSlot* & slot : slots ){
+        delete slot;
+        slot = nullptr;
+    }
 }
 
 void pdsp::osc::Output::setVerbose( bool verbose ){
     this->verbose = verbose;
 }
 
+void pdsp::osc::Output::setBundling( bool active, float windowMs ){
+    if( windowMs < 0.0f ){ windowMs = 0.0f; }
+    bundleWindowMs = windowMs;
+    bundling = active;
+}
+
+void pdsp::osc::Output::setFilterRepeated( bool active ){
+    filterRepeated = active;
+}
+
 
 void pdsp::osc::Output::openPort(const std::string &hostname, int port ) {
     if(connected){
         close();
     }
     
-    sender.setup( hostname, port );
+    try{
+        socket = new UdpTransmitSocket( IpEndpointName( hostname.c_str(), port ) );
+    }catch( std::exception & e ){
+        cout<<"[pdsp] error opening OSC output to "<<hostname<<":"<<port<<" : "<<e.what()<<"\n";
+        pdsp::pdsp_trace();
+        socket = nullptr;
+        return;
+    }
     
     startDaemon();
     
@@ -88,6 +114,8 @@ void pdsp::osc::Output:: close(){
         if(verbose) cout<<"[pdsp] shutting down OSC out\n";
         //stop the daemon before
         closeDaemon();
+        delete socket;
+        socket = nullptr;
 
         connected = false;        
     }
@@ -103,7 +131,15 @@ void pdsp::osc::Output::linkToMessageBuffer(pdsp::MessageBuffer &messageBuffer)
     cout<<"[pdsp] linking message buffer\n";
 #endif
     inputs.push_back(&messageBuffer);
-    addresses.push_back(selectedAddress);
+    
+    for( AddressSlot* slot : slots ){
+        if( slot->address == selectedAddress ){
+            addresses.push_back( slot );
+            return;
+        }
+    }
+    slots.push_back( new AddressSlot( selectedAddress ) );
+    addresses.push_back( slots.back() );
 }
 
 void pdsp::osc::Output::unlinkMessageBuffer(pdsp::MessageBuffer &messageBuffer) {
@@ -112,7 +148,7 @@ void pdsp::osc::Output::unlinkMessageBuffer(pdsp::MessageBuffer &messageBuffer)
     for (std::vector<pdsp::MessageBuffer*>::iterator it = inputs.begin(); it != inputs.end(); ++it){
         if (*it == &messageBuffer){
             inputs.erase(it);
-            std::vector<std::string>::iterator linkedAddress = addresses.begin() + i;
+            std::vector<AddressSlot*>::iterator linkedAddress = addresses.begin() + i;
             addresses.erase(linkedAddress);
             return;
         }
@@ -122,7 +158,7 @@ void pdsp::osc::Output::unlinkMessageBuffer(pdsp::MessageBuffer &messageBuffer)
 }
 
 void pdsp::osc::Output::prepareToPlay( int expectedBufferSize, double sampleRate ){
-    usecPerSample = 1000000.0 / sampleRate;
+    outputClock.prepare( sampleRate );
 }
 
 void pdsp::osc::Output::releaseResources() {}
@@ -136,32 +172,25 @@ void pdsp::osc::Output::process( int bufferSize ) noexcept{
         messagesToSend.clear();
         
         //add note messages
-        if(chronoStarted){
-            chrono::nanoseconds bufferOffset = chrono::nanoseconds (static_cast<long> ( bufferSize * usecPerSample ));
-            bufferChrono = bufferChrono + bufferOffset;
-        }else{
-            bufferChrono = chrono::high_resolution_clock::now();
-            chronoStarted = true;
-        }
+        outputClock.advance( bufferSize );
         
         for( int i=0; i<(int)inputs.size(); ++i ){
             
             pdsp::MessageBuffer* messageBuffer = inputs[i];
-            //std::string msg_address = addresses[i];
+            AddressSlot* slot = addresses[i];
             
             for(int n=0; n<(int)messageBuffer->size(); ++n){                
                 //format message to sent
                 float msg_value = messageBuffer->messages[n].value;
                 int msg_sample = messageBuffer->messages[n].sample;
                 
-                chrono::nanoseconds offset = chrono::nanoseconds (static_cast<long> ( msg_sample * usecPerSample ));
-                chrono::high_resolution_clock::time_point scheduleTime = bufferChrono + offset;
+                if( filterRepeated && slot->sent && slot->lastValue == msg_value ){ continue; }
+                slot->lastValue = msg_value;
+                slot->sent = true;
                 
-                ofxOscMessage osc;
-                osc.setAddress( addresses[i] );
-                osc.addFloatArg( msg_value );
+                std::chrono::high_resolution_clock::time_point scheduleTime = outputClock.at( msg_sample );
             
-                messagesToSend.push_back( ScheduledOscMessage(osc, scheduleTime) );
+                messagesToSend.push_back( ScheduledOscMessage( slot, msg_value, scheduleTime ) );
             }
         }
         
@@ -169,12 +198,11 @@ void pdsp::osc::Output::process( int bufferSize ) noexcept{
         sort(messagesToSend.begin(), messagesToSend.end(), scheduledSort);
 
         for(ScheduledOscMessage &msg : messagesToSend){
-
-            circularBuffer[writeindex] = msg;
-            int write = writeindex+1;
-            if( write >= (int)circularBuffer.size() ){ write = 0; };
-            writeindex = write;
-
+            daemon.push( msg );
+        }
+        
+        if( !messagesToSend.empty() ){ 
+            daemon.wake(); // never locks the audio thread
         }
         
         
@@ -183,46 +211,81 @@ void pdsp::osc::Output::process( int bufferSize ) noexcept{
 
 void pdsp::osc::Output::startDaemon(){ // OK
     
-    runDaemon = true;
-    daemonThread = thread( daemonFunctionWrapper, this );   
+    meter.reset();
+    daemon.start( [this]( std::chrono::high_resolution_clock::time_point now ){ sendDueMessages( now ); } );
     
 }
-   
     
-void pdsp::osc::Output::daemonFunctionWrapper(pdsp::osc::Output* parent){
-    parent->daemonFunction();
-}
-   
+void pdsp::osc::Output::sendDueMessages( std::chrono::high_resolution_clock::time_point now ) noexcept{
     
-void pdsp::osc::Output::daemonFunction() noexcept{
+    ::osc::OutboundPacketStream packet( packetBuffer.data(), packetBuffer.size() );
+    ScheduledOscMessage msg;
     
-    while (runDaemon){
-
-        while( send!=writeindex && circularBuffer[send].scheduledTime < chrono::high_resolution_clock::now() ){
-           
-            // SEND MESSAGES HERE
-            sender.sendMessage( circularBuffer[send].message, false );
+    try{
+        if( bundling ){
+            std::chrono::nanoseconds window = std::chrono::nanoseconds( static_cast<long long>( bundleWindowMs * 1000000.0f ) );
             
-            #ifndef NDEBUG
-                if(verbose) cout << "[pdsp] OSC message: address = "<< circularBuffer[send].message.getAddress() << " | value = "<<(int)circularBuffer[send].message.getArgAsFloat(0)<<"\n";
-            #endif
+            while( daemon.peekDue( msg, now ) ){
+                std::chrono::high_resolution_clock::time_point bundleTime = msg.scheduledTime;
+                
+                packet.Clear();
+                packet << ::osc::BeginBundle( timetag( bundleTime, now ) );
+                int bundled = 0;
+                while( daemon.peekDue( msg, bundleTime + window ) ){
+                    // the bundle is full, the other messages go into the next one
+                    if( bundled>0 && packet.Size() + messageSize( msg.slot->address ) > packet.Capacity() ){ break; }
+                    
+                    packet << ::osc::BeginMessage( msg.slot->address.c_str() ) << msg.value << ::osc::EndMessage;
+                    bundled++;
+                    
+                    daemon.popDue( msg, bundleTime + window );
+                }
+                packet << ::osc::EndBundle;
+                socket->Send( packet.Data(), packet.Size() );
+                
+                #ifndef NDEBUG
+                    if(verbose) cout << "[pdsp] OSC bundle: messages = "<< bundled << " | bytes = "<<packet.Size()<<"\n";
+                #endif
+                
+                std::chrono::duration<double, std::micro> delay = std::chrono::high_resolution_clock::now() - bundleTime;
+                meter.add( delay.count() );
+            }
             
-            send++;
-        }
-
-        std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }else{
+            
+            while( daemon.popDue( msg, now ) ){
+                packet.Clear();
+                packet << ::osc::BeginMessage( msg.slot->address.c_str() ) << msg.value << ::osc::EndMessage;
+                socket->Send( packet.Data(), packet.Size() );
+                
+                #ifndef NDEBUG
+                    if(verbose) cout << "[pdsp] OSC message: address = "<< msg.slot->address << " | value = "<<msg.value<<"\n";
+                #endif
 
+                std::chrono::duration<double, std::micro> delay = std::chrono::high_resolution_clock::now() - msg.scheduledTime;
+                meter.add( delay.count() );
+            }
+        }
+    }catch( std::exception & e ){
+        // address too long for the packet buffer or socket error, the message is dropped
+        if(verbose) cout<<"[pdsp] error sending OSC message : "<<e.what()<<"\n";
+        daemon.popDue( msg, now );
     }
-   
-    if(verbose) cout<<"[pdsp] closing OSC out daemon thread\n";
 }
     
- 
-    
 void pdsp::osc::Output::closeDaemon(){
-    runDaemon = false;
-    daemonThread.detach();
+    daemon.stop();
+    if(verbose) cout<<"[pdsp] closing OSC out daemon thread\n";
+}
+
+float pdsp::osc::Output::meter_latency() const {
+    return meter.getLatency();
 }
+
+float pdsp::osc::Output::meter_jitter() const {
+    return meter.getJitter();
+}
+
     
     
     
@@ -9,13 +9,14 @@
 #include "ofMain.h"
 #include <chrono>
 #include <algorithm>
-#include <thread>
-#include <mutex>
-#include <condition_variable>
-#include <atomic>
 #include "../DSP/pdspCore.h"
 #include "../sequencer/SequencerSection.h"
+#include "helper/DaemonMeter.h"
+#include "helper/OutputDaemon.h"
+#include "helper/OutputClock.h"
 #include "ofxOsc.h"
+#include "OscOutboundPacketStream.h"
+#include "UdpSocket.h"
 
 /*!
 @brief utility class manage OSC output from the sequencer
@@ -32,20 +33,31 @@ private:
     */
 
     
+    // one for each address, never deallocated until the Output is destroyed so the daemon can always read it
+    class AddressSlot{
+    public:
+        AddressSlot( const std::string & address ) : address(address), lastValue(0.0f), sent(false) {};
+        
+        std::string address;
+        float       lastValue;
+        bool        sent;
+    };
+    
+    // plain data, so it can be passed to the daemon without allocations
     class ScheduledOscMessage{
     public:
         ScheduledOscMessage();
-        ScheduledOscMessage(ofxOscMessage message, chrono::high_resolution_clock::time_point schedule);
-        ScheduledOscMessage(const ScheduledOscMessage &other);
-        ScheduledOscMessage& operator= (const ScheduledOscMessage &other);
-        ~ScheduledOscMessage();
+        ScheduledOscMessage( const AddressSlot* slot, float value, chrono::high_resolution_clock::time_point schedule );
         
-        ofxOscMessage message;
+        const AddressSlot*                          slot;
+        float                                       value;
         chrono::high_resolution_clock::time_point   scheduledTime;
     };
     
     
     static bool scheduledSort(const ScheduledOscMessage &lhs, const ScheduledOscMessage &rhs );
+    static uint64_t timetag( chrono::high_resolution_clock::time_point time, chrono::high_resolution_clock::time_point now );
+    static size_t messageSize( const std::string & address );
 
     /*!
         @endcond
@@ -82,6 +94,29 @@ public:
     */   
     void setVerbose( bool verbose );
 
+    /*!
+    @brief returns the mean delay of the sent messages from their scheduled time, in microseconds. Thread-safe.
+    */   
+    float meter_latency() const;
+
+    /*!
+    @brief returns the mean deviation of the sent messages delay from meter_latency(), in microseconds. Thread-safe.
+    */   
+    float meter_jitter() const;
+
+    /*!
+    @brief enables sending the messages as timetagged OSC bundles instead of one datagram for each message. All the messages scheduled within the given window from the first one are sent together in a bundle, timetagged with the time of the first message. Default is disabled.
+    @param[in] active true for enabling bundles, false for sending each message on its own
+    @param[in] windowMs coalescing window in milliseconds, if 0.0 or not given only the messages with the same time are bundled together
+    */   
+    void setBundling( bool active, float windowMs = 0.0f );
+
+    /*!
+    @brief if active a message is not sent when its value is the same of the last value sent to its address. Default is disabled.
+    @param[in] active true for dropping the repeated values
+    */   
+    void setFilterRepeated( bool active );
+
 
     /*!
     @brief patch a pdsp::ScoreSection::out_message() method to the result of this method for message to the serial out
@@ -105,10 +140,16 @@ protected:
 
 private:
 
-    ofxOscSender	sender;
-    std::vector<std::string>    addresses;
+    UdpTransmitSocket*          socket;
+    std::vector<AddressSlot*>   slots;
+    std::vector<AddressSlot*>   addresses;
     std::string                 selectedAddress;
     
+    std::atomic<bool>           bundling;
+    std::atomic<float>          bundleWindowMs;
+    std::atomic<bool>           filterRepeated;
+    std::vector<char>           packetBuffer;
+    
         
     bool            connected;
     bool            verbose;
@@ -123,20 +164,13 @@ private:
     //MIDI DAEMON MEMBERS---------------------------------------------------------------
     void                                                startDaemon();
     void                                                closeDaemon();
-    void                                                daemonFunction() noexcept;
-    static void                                         daemonFunctionWrapper(Output* parent);
-    
-    thread                                              daemonThread;
-    std::atomic<bool>                                   runDaemon;
+    void                                                sendDueMessages( std::chrono::high_resolution_clock::time_point now ) noexcept;
     
     //serial output processing members
-    std::chrono::time_point<std::chrono::high_resolution_clock>   bufferChrono;   
-    bool                                                chronoStarted;
-    double                                              usecPerSample;
-    std::vector<ScheduledOscMessage>                    circularBuffer;
-   
-    std::atomic<int>                                    writeindex;
-    int                                                 send;
+    pdsp::OutputClock                                   outputClock;
+
+    pdsp::OutputDaemon<ScheduledOscMessage>             daemon;
+    pdsp::DaemonMeter                                   meter;
 
 };
 
@@ -56,16 +56,8 @@ pdsp::serial::Output::Output(){
     
     connected = false;
     
-    chronoStarted = false;
-    
-    //midi daemon init
-    runDaemon = false;
-    
     //processing init
-
-    circularBuffer.resize(OFXPDSP_SERIALOUTPUTCIRCULARBUFFERSIZE);   
-    writeindex = 0;
-    send = 0;
+    daemon.resize(OFXPDSP_SERIALOUTPUTCIRCULARBUFFERSIZE);   
     
     //testing
     messageCount = 0;
@@ -163,7 +155,7 @@ void pdsp::serial::Output::unlinkMessageBuffer(pdsp::MessageBuffer &messageBuffe
 }
 
 void pdsp::serial::Output::prepareToPlay( int expectedBufferSize, double sampleRate ){
-    usecPerSample = 1000000.0 / sampleRate;
+    outputClock.prepare( sampleRate );
     
 }
 
@@ -180,23 +172,13 @@ void pdsp::serial::Output::process( int bufferSize ) noexcept{
         //add note messages
         int maxBuffer = inputs.size();
         
-        if(chronoStarted){
-            chrono::nanoseconds bufferOffset = chrono::nanoseconds (static_cast<long> ( bufferSize * usecPerSample ));
-            bufferChrono = bufferChrono + bufferOffset;
-        }else{
-            bufferChrono = chrono::high_resolution_clock::now();
-            chronoStarted = true;
-        }
+        outputClock.advance( bufferSize );
         
         for( int i=0; i<maxBuffer; ++i ){
             
             pdsp::MessageBuffer* messageBuffer = inputs[i];
             int msg_channel = channels[i];
             
-            /* // OLD WAY
-            bufferChrono = chrono::high_resolution_clock::now();
-            */
-            
             int bufferMax = messageBuffer->size();
 
             for(int n=0; n<bufferMax; ++n){                
@@ -204,8 +186,7 @@ void pdsp::serial::Output::process( int bufferSize ) noexcept{
                 float msg_value = messageBuffer->messages[n].value;
                 int msg_sample = messageBuffer->messages[n].sample;
                 
-                chrono::nanoseconds offset = chrono::nanoseconds (static_cast<long> ( msg_sample * usecPerSample ));
-                chrono::high_resolution_clock::time_point scheduleTime = bufferChrono + offset;
+                std::chrono::high_resolution_clock::time_point scheduleTime = outputClock.at( msg_sample );
                 
                 messagesToSend.push_back( ScheduledSerialMessage(msg_channel, msg_value, scheduleTime) );
             }
@@ -216,57 +197,53 @@ void pdsp::serial::Output::process( int bufferSize ) noexcept{
         
         //send to daemon
         for(ScheduledSerialMessage &msg : messagesToSend){
-            circularBuffer[writeindex] = msg;
-            int write = writeindex+1;
-            if( write >= (int)circularBuffer.size() ){ write = 0; };
-            writeindex = write;
+            daemon.push( msg );
+        }
+        
+        if( !messagesToSend.empty() ){ 
+            daemon.wake(); // never locks the audio thread
         }
     }//end checking connected
 }
 
 void pdsp::serial::Output::startDaemon(){ // OK
     
-    runDaemon = true;
-    daemonThread = thread( daemonFunctionWrapper, this );   
-    
-}
+    meter.reset();
+    daemon.start( [this]( std::chrono::high_resolution_clock::time_point now ){ sendDueMessages( now ); } );
     
-void pdsp::serial::Output::daemonFunctionWrapper(pdsp::serial::Output* parent){
-    parent->daemonFunction();
 }
        
-void pdsp::serial::Output::daemonFunction() noexcept{
-    while (runDaemon){
-
-        while( send!=writeindex && circularBuffer[send].scheduledTime < std::chrono::high_resolution_clock::now() ){
-           
-            // SEND MESSAGES HERE
-            ScheduledSerialMessage& nextMessage = circularBuffer[send];
-                           
-            // SEND MESSAGES HERE
-            serial.writeByte( (char)nextMessage.channel );
-            serial.writeByte( (char)nextMessage.message );
-            
-            #ifndef NDEBUG
-                if(verbose) cout << "[pdsp] serial message: channel = "<< (- (int)nextMessage.channel)<< " | value = "<<(int)nextMessage.message<<"\n";
-            #endif
-
-            send++;
-        }
-
-        std::this_thread::sleep_for(std::chrono::microseconds(500));
-    }    
+void pdsp::serial::Output::sendDueMessages( std::chrono::high_resolution_clock::time_point now ) noexcept{
     
-    if(verbose) cout<<"[pdsp] closing serial out daemon thread\n";
+    ScheduledSerialMessage nextMessage;
+    while( daemon.popDue( nextMessage, now ) ){
+        // SEND MESSAGES HERE
+        serial.writeByte( (char)nextMessage.channel );
+        serial.writeByte( (char)nextMessage.message );
+        
+        #ifndef NDEBUG
+            if(verbose) cout << "[pdsp] serial message: channel = "<< (- (int)nextMessage.channel)<< " | value = "<<(int)nextMessage.message<<"\n";
+        #endif
+
+        std::chrono::duration<double, std::micro> delay = std::chrono::high_resolution_clock::now() - nextMessage.scheduledTime;
+        meter.add( delay.count() );
+    }
 }
     
- 
-    
 void pdsp::serial::Output::closeDaemon(){
-    runDaemon = false;
-    daemonThread.detach();
+    daemon.stop();
+    if(verbose) cout<<"[pdsp] closing serial out daemon thread\n";
+}
+
+float pdsp::serial::Output::meter_latency() const {
+    return meter.getLatency();
 }
 
+float pdsp::serial::Output::meter_jitter() const {
+    return meter.getJitter();
+}
+
+
 #endif // __ANDROID__
 #endif // TARGET_OF_IOS
     
@@ -13,12 +13,11 @@
 
 #include <chrono>
 #include <algorithm>
-#include <thread>
-#include <mutex>
-#include <condition_variable>
-#include <atomic>
 #include "../DSP/pdspCore.h"
 #include "../sequencer/SequencerSection.h"
+#include "helper/DaemonMeter.h"
+#include "helper/OutputDaemon.h"
+#include "helper/OutputClock.h"
 
 /*!
 @brief utility class manage serial output ports and send bytes from the internal generative music system
@@ -95,6 +94,16 @@ public:
     */   
     void setVerbose( bool verbose );
 
+    /*!
+    @brief returns the mean delay of the sent messages from their scheduled time, in microseconds. Thread-safe.
+    */   
+    float meter_latency() const;
+
+    /*!
+    @brief returns the mean deviation of the sent messages delay from meter_latency(), in microseconds. Thread-safe.
+    */   
+    float meter_jitter() const;
+
 
     /*!
     @brief patch a pdsp::ScoreSection::out_message() method to the result of this method for message to the serial out
@@ -135,20 +144,13 @@ private:
     //MIDI DAEMON MEMBERS---------------------------------------------------------------
     void                                                startDaemon();
     void                                                closeDaemon();
-    void                                                daemonFunction() noexcept;
-    static void                                         daemonFunctionWrapper(Output* parent);
-    
-    std::thread                                         daemonThread;
-    std::atomic<bool>                                   runDaemon;
+    void                                                sendDueMessages( std::chrono::high_resolution_clock::time_point now ) noexcept;
     
     //serial output processing members
-    std::chrono::time_point<chrono::high_resolution_clock>   bufferChrono;     
-    bool                                                chronoStarted;
-    double                                              usecPerSample;
-    std::vector<ScheduledSerialMessage>                 circularBuffer;
-   
-    std::atomic<int>                                    writeindex;
-    int                                                 send;
+    pdsp::OutputClock                                   outputClock;
+
+    pdsp::OutputDaemon<ScheduledSerialMessage>          daemon;
+    pdsp::DaemonMeter                                   meter;
 
 };
 
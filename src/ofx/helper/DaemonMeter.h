@@ -0,0 +1,72 @@
+// DaemonMeter.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef OFXPDSP_DAEMONMETER_H_INCLUDED
+#define OFXPDSP_DAEMONMETER_H_INCLUDED
+
+#include <atomic>
+#include <cmath>
+
+#define OFXPDSP_DAEMONMETER_SMOOTHING 0.01
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+
+namespace pdsp{
+
+// latency and jitter statistics of the messages handled by a daemon
+// add() is called from just one thread, the meters can be read from any thread
+class DaemonMeter{
+public:
+    DaemonMeter(){ reset(); };
+
+    // not thread-safe, call it when the daemon is stopped
+    void reset(){
+        meanLatency = 0.0;
+        meanJitter = 0.0;
+        first = true;
+        latency.store( 0.0f );
+        jitter.store( 0.0f );
+        maxLatency.store( 0.0f );
+    }
+
+    // delay of a message from the time it should have been handled, in microseconds
+    void add( double delayUs ) noexcept {
+        if( first ){
+            meanLatency = delayUs;
+            first = false;
+        }
+        double deviation = std::abs( delayUs - meanLatency );
+        meanLatency += OFXPDSP_DAEMONMETER_SMOOTHING * ( delayUs - meanLatency );
+        meanJitter += OFXPDSP_DAEMONMETER_SMOOTHING * ( deviation - meanJitter );
+
+        latency.store( static_cast<float>( meanLatency ), std::memory_order_relaxed );
+        jitter.store( static_cast<float>( meanJitter ), std::memory_order_relaxed );
+        if( delayUs > maxLatency.load( std::memory_order_relaxed ) ){
+            maxLatency.store( static_cast<float>( delayUs ), std::memory_order_relaxed );
+        }
+    }
+
+    float getLatency() const { return latency.load( std::memory_order_relaxed ); }
+    float getJitter() const { return jitter.load( std::memory_order_relaxed ); }
+    float getMaxLatency() const { return maxLatency.load( std::memory_order_relaxed ); }
+
+private:
+    double  meanLatency;
+    double  meanJitter;
+    bool    first;
+
+    std::atomic<float> latency;
+    std::atomic<float> jitter;
+    std::atomic<float> maxLatency;
+};
+
+}
+
+/*!
+    @endcond
+*/
+
+#endif // OFXPDSP_DAEMONMETER_H_INCLUDED
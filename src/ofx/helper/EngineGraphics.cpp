@@ -7,6 +7,10 @@ void pdsp::helper::EngineGraphics::setParent ( pdsp::SequencerProcessor & score
     posY = 0;
 }
 
+void pdsp::helper::EngineGraphics::setLoadMonitor ( LoadMonitor & monitor ){
+    this->monitor = &monitor;
+}
+
 void pdsp::helper::EngineGraphics::setup( int w, int hFold, std::initializer_list<int> sectionsH, std::initializer_list<int> sectionsOuts ) {
     
     // init plotters
@@ -144,6 +148,53 @@ void pdsp::helper::EngineGraphics::draw( ) {
 }
 
 
+void pdsp::helper::EngineGraphics::drawLoad( int x, int y, int w, int h ) {
+    
+    ofPushStyle();
+    ofPushMatrix();
+    ofTranslate( x, y );
+    
+    ofSetColor( color );
+    
+    int barH = ( h - 20 ) / LoadMonitor::StagesNumber;
+    int labelW = 80;
+    float barW = w - labelW;
+    
+    for( int s=0; s<LoadMonitor::StagesNumber; ++s ){
+        LoadMonitor::Stage stage = static_cast<LoadMonitor::Stage>( s );
+        float mean = monitor->meter_stage( stage );
+        float peak = monitor->meter_stage_peak( stage );
+        if( mean > 1.0f ) mean = 1.0f;
+        if( peak > 1.0f ) peak = 1.0f;
+        
+        int barY = s * barH;
+        ofDrawBitmapString( LoadMonitor::getStageName( s ), 0, barY + barH - 2 );
+        ofFill();
+        ofDrawRectangle( labelW, barY + 1, barW * mean, barH - 2 );
+        ofNoFill();
+        ofDrawRectangle( labelW, barY + 1, barW, barH - 2 );
+        ofDrawLine( labelW + barW * peak, barY + 1, labelW + barW * peak, barY + barH - 1 );
+    }
+    
+    string label = "load ";
+    label += ofToString( (int) ( monitor->meter_load() * 100.0f ) );
+    label += "% | peak ";
+    label += ofToString( (int) ( monitor->meter_peak() * 100.0f ) );
+    label += "% | near misses ";
+    label += ofToString( monitor->meter_near_misses() );
+    if( monitor->meter_near_miss_stage() >= 0 ){
+        label += " (";
+        label += LoadMonitor::getStageName( monitor->meter_near_miss_stage() );
+        label += ")";
+    }
+    label += " | misses ";
+    label += ofToString( monitor->meter_misses() );
+    ofDrawBitmapString( label, 0, h - 4 );
+    
+    ofPopMatrix();
+    ofPopStyle();
+}
+
 void pdsp::helper::EngineGraphics::keys( std::initializer_list<std::initializer_list<char>> initArray, int stopAndPlayKey, bool quantize, double quantizeTime ) {
     
     int s = 0;
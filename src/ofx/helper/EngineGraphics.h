@@ -7,6 +7,7 @@
 #include "../sequencer/SequencerProcessor.h"
 #include "../sequencer/Sequence.h"
 #include "SequencerSectionPlotter.h"
+#include "LoadMonitor.h"
 
 
 /*!
@@ -58,6 +59,15 @@ public:
     */
     void draw( int x, int y );
 
+    /*!
+    @brief displays the DSP load of each stage of the audio callback, with the mean load as filled bar and the peak as line, and the near misses and misses counters
+    @param[in] x x coordinate
+    @param[in] y y coordinate
+    @param[in] w width of the graphics
+    @param[in] h height of the graphics
+    */
+    void drawLoad( int x, int y, int w, int h );
+
     /*!
     @brief set the range of the displayed values for the given output
     @param[in] section section of the values to set
@@ -96,6 +106,7 @@ private:
     void drawGraphics();
     
     void setParent ( pdsp::SequencerProcessor & score );    
+    void setLoadMonitor ( LoadMonitor & monitor );
     void updateGraphics( const pdsp::Sequence & seq );
     void clearGraphics ();
 
@@ -108,6 +119,7 @@ private:
     int width;
     
     pdsp::SequencerProcessor * score;
+    LoadMonitor * monitor;
     
     std::vector<std::vector<int>> assignedKeys;
     
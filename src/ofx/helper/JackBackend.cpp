@@ -0,0 +1,199 @@
+
+#include "JackBackend.h"
+
+#ifdef PDSP_USE_JACK
+
+#include "../Engine.h"
+
+pdsp::helper::JackBackend::JackBackend(){
+    engine = nullptr;
+    client = nullptr;
+    active = false;
+    bufferSize = 0;
+    sampleRate = 0;
+    xruns = 0;
+    xrunDelay = 0.0f;
+    serverShutdown = false;
+}
+
+pdsp::helper::JackBackend::~JackBackend(){
+    close();
+}
+
+bool pdsp::helper::JackBackend::open( Engine* engine, const std::string & clientName, int inputs, int outputs, int bufferSize ){
+    close();
+
+    this->engine = engine;
+
+    jack_status_t status;
+    client = jack_client_open( clientName.c_str(), JackNoStartServer, &status );
+    if( client == nullptr ){
+        std::cout<<"[pdsp] error! impossible to connect to the JACK server, status = "<<status<<"\n";
+        pdsp_trace();
+        return false;
+    }
+
+    if( bufferSize > 0 && (int) jack_get_buffer_size( client ) != bufferSize ){
+        if( jack_set_buffer_size( client, bufferSize ) != 0 ){
+            std::cout<<"[pdsp] warning! JACK server refused a period of "<<bufferSize<<" frames, using "<<jack_get_buffer_size( client )<<"\n";
+        }
+    }
+    this->bufferSize = jack_get_buffer_size( client );
+    this->sampleRate = jack_get_sample_rate( client );
+
+    inPorts.resize( inputs );
+    outPorts.resize( outputs );
+    inBuffers.resize( inputs, nullptr );
+    outBuffers.resize( outputs, nullptr );
+
+    for( int i=0; i<inputs; ++i ){
+        std::string name = "in_" + std::to_string( i+1 );
+        inPorts[i] = jack_port_register( client, name.c_str(), JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0 );
+    }
+    for( int i=0; i<outputs; ++i ){
+        std::string name = "out_" + std::to_string( i+1 );
+        outPorts[i] = jack_port_register( client, name.c_str(), JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0 );
+    }
+    for( jack_port_t* port : inPorts ){
+        if( port == nullptr ){ std::cout<<"[pdsp] error! impossible to register JACK input ports\n"; close(); return false; }
+    }
+    for( jack_port_t* port : outPorts ){
+        if( port == nullptr ){ std::cout<<"[pdsp] error! impossible to register JACK output ports\n"; close(); return false; }
+    }
+
+    jack_set_process_callback( client, processCallback, this );
+    jack_set_buffer_size_callback( client, bufferSizeCallback, this );
+    jack_set_xrun_callback( client, xrunCallback, this );
+    jack_on_shutdown( client, shutdownCallback, this );
+
+    xruns = 0;
+    xrunDelay = 0.0f;
+    serverShutdown = false;
+
+    return true;
+}
+
+bool pdsp::helper::JackBackend::start(){
+    if( client == nullptr ){ return false; }
+    if( active ){ return true; }
+
+    if( jack_activate( client ) != 0 ){
+        std::cout<<"[pdsp] error! impossible to activate the JACK client\n";
+        pdsp_trace();
+        return false;
+    }
+    active = true;
+
+    if( jack_is_realtime( client ) ){
+        std::cout<<"[pdsp] JACK process thread running with realtime priority "<<jack_client_real_time_priority( client )<<"\n";
+    }else{
+        std::cout<<"[pdsp] warning! JACK server is not running in realtime mode, start jackd with -R for low latency\n";
+    }
+
+    return true;
+}
+
+void pdsp::helper::JackBackend::connectPhysicalPorts(){
+    if( !active ){ return; }
+    const char** playback = jack_get_ports( client, nullptr, JACK_DEFAULT_AUDIO_TYPE, JackPortIsPhysical | JackPortIsInput );
+    if( playback != nullptr ){
+        for( size_t i=0; i<outPorts.size() && playback[i] != nullptr; ++i ){
+            jack_connect( client, jack_port_name( outPorts[i] ), playback[i] );
+        }
+        jack_free( playback );
+    }
+
+    const char** capture = jack_get_ports( client, nullptr, JACK_DEFAULT_AUDIO_TYPE, JackPortIsPhysical | JackPortIsOutput );
+    if( capture != nullptr ){
+        for( size_t i=0; i<inPorts.size() && capture[i] != nullptr; ++i ){
+            jack_connect( client, capture[i], jack_port_name( inPorts[i] ) );
+        }
+        jack_free( capture );
+    }
+}
+
+void pdsp::helper::JackBackend::stop(){
+    if( client != nullptr && active ){
+        if( !serverShutdown ){
+            jack_deactivate( client );
+        }
+        active = false;
+    }
+}
+
+void pdsp::helper::JackBackend::close(){
+    if( client != nullptr ){
+        stop();
+        jack_client_close( client ); // frees the client also after a server shutdown
+        client = nullptr;
+        inPorts.clear();
+        outPorts.clear();
+        inBuffers.clear();
+        outBuffers.clear();
+
+        if( xruns > 0 ){
+            std::cout<<"[pdsp] JACK client closed, xruns = "<<xruns<<"\n";
+        }
+    }
+}
+
+bool pdsp::helper::JackBackend::isOpen() const {
+    return ( client != nullptr && !serverShutdown );
+}
+
+int pdsp::helper::JackBackend::getBufferSize() const {
+    return bufferSize;
+}
+
+int pdsp::helper::JackBackend::getSampleRate() const {
+    return sampleRate;
+}
+
+int pdsp::helper::JackBackend::meter_xruns() const {
+    return xruns.load();
+}
+
+float pdsp::helper::JackBackend::meter_xrun_delay() const {
+    return xrunDelay.load();
+}
+
+int pdsp::helper::JackBackend::processCallback( jack_nframes_t nframes, void* arg ){
+    JackBackend* backend = static_cast<JackBackend*>( arg );
+
+    // the port buffers are used directly, without interleaving
+    for( size_t i=0; i<backend->inPorts.size(); ++i ){
+        backend->inBuffers[i] = static_cast<float*>( jack_port_get_buffer( backend->inPorts[i], nframes ) );
+    }
+    for( size_t i=0; i<backend->outPorts.size(); ++i ){
+        backend->outBuffers[i] = static_cast<float*>( jack_port_get_buffer( backend->outPorts[i], nframes ) );
+    }
+
+    backend->engine->audioProcess( backend->inBuffers.data(), backend->outBuffers.data(), nframes );
+    return 0;
+}
+
+int pdsp::helper::JackBackend::bufferSizeCallback( jack_nframes_t nframes, void* arg ){
+    JackBackend* backend = static_cast<JackBackend*>( arg );
+
+    // JACK doesn't run the process callback while this is called, so the units can be prepared again
+    if( (int) nframes != backend->bufferSize ){
+        backend->bufferSize = nframes;
+        backend->engine->audioBufferSizeChanged( nframes, static_cast<double>( backend->sampleRate ) );
+    }
+    return 0;
+}
+
+int pdsp::helper::JackBackend::xrunCallback( void* arg ){
+    JackBackend* backend = static_cast<JackBackend*>( arg );
+    backend->xruns++;
+    backend->xrunDelay = jack_get_xrun_delayed_usecs( backend->client );
+    return 0;
+}
+
+void pdsp::helper::JackBackend::shutdownCallback( void* arg ){
+    JackBackend* backend = static_cast<JackBackend*>( arg );
+    backend->serverShutdown = true;
+    std::cout<<"[pdsp] warning! JACK server shut down, audio stopped\n";
+}
+
+#endif // PDSP_USE_JACK
@@ -0,0 +1,85 @@
+
+// JackBackend.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef OFXPDSP_JACKBACKEND_H_INCLUDED
+#define OFXPDSP_JACKBACKEND_H_INCLUDED
+
+#include "../../flags.h"
+
+#ifdef PDSP_USE_JACK
+
+#include <jack/jack.h>
+#include <string>
+#include <vector>
+#include <atomic>
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+
+namespace pdsp{
+
+class Engine;
+
+namespace helper{
+
+// JACK client that runs the Engine directly from the JACK process callback, with non-interleaved port buffers
+class JackBackend {
+
+public:
+    JackBackend();
+    ~JackBackend();
+
+    // opens the client and registers the ports, if bufferSize > 0 the server period is changed to it
+    bool open( Engine* engine, const std::string & clientName, int inputs, int outputs, int bufferSize );
+
+    // activates the client, the process callback starts running
+    bool start();
+
+    // connects the ports to the physical inputs and outputs, the client must be active
+    void connectPhysicalPorts();
+
+    void stop();
+    void close();
+
+    bool isOpen() const;
+    int getBufferSize() const;
+    int getSampleRate() const;
+
+    int meter_xruns() const;
+    float meter_xrun_delay() const;
+
+private:
+    static int  processCallback( jack_nframes_t nframes, void* arg );
+    static int  bufferSizeCallback( jack_nframes_t nframes, void* arg );
+    static int  xrunCallback( void* arg );
+    static void shutdownCallback( void* arg );
+
+    Engine*                     engine;
+    jack_client_t*              client;
+    std::vector<jack_port_t*>   inPorts;
+    std::vector<jack_port_t*>   outPorts;
+    std::vector<float*>         inBuffers;
+    std::vector<float*>         outBuffers;
+
+    bool                        active;
+    std::atomic<int>            bufferSize;
+    int                         sampleRate;
+
+    std::atomic<int>            xruns;
+    std::atomic<float>          xrunDelay;
+    std::atomic<bool>           serverShutdown;
+
+};
+
+}}
+
+/*!
+    @endcond
+*/
+
+#endif // PDSP_USE_JACK
+
+#endif // OFXPDSP_JACKBACKEND_H_INCLUDED
@@ -0,0 +1,162 @@
+
+#include "LoadMonitor.h"
+
+// time constant of the mean loads, in seconds
+#define OFXPDSP_LOADMONITOR_SMOOTHING_TIME 0.5
+
+pdsp::helper::LoadMonitor::LoadMonitor(){
+    sampleRate = 44100.0;
+    bufferTime = 512.0 / sampleRate;
+    nearMissThreshold = 0.8f;
+    resetRequest = false;
+    load = 0.0f;
+    meanLoad = 0.0;
+    for( int s=0; s<StagesNumber; ++s ){
+        stages[s] = 0.0f;
+        meanStages[s] = 0.0;
+        stageTimes[s] = 0.0;
+    }
+    resetMeters();
+}
+
+void pdsp::helper::LoadMonitor::prepareToPlay( int expectedBufferSize, double sampleRate ){
+    this->sampleRate = sampleRate;
+    bufferTime = expectedBufferSize / sampleRate;
+    resetRequest = true;
+}
+
+void pdsp::helper::LoadMonitor::releaseResources(){}
+
+void pdsp::helper::LoadMonitor::resetMeters() noexcept{
+    peak.store( 0.0f );
+    for( int s=0; s<StagesNumber; ++s ){
+        stagePeaks[s].store( 0.0f );
+    }
+    for( int i=0; i<OFXPDSP_LOADMONITOR_BINS; ++i ){
+        histogram[i].store( 0 );
+    }
+    nearMisses.store( 0 );
+    misses.store( 0 );
+    nearMissStage.store( -1 );
+    callbacks.store( 0 );
+}
+
+void pdsp::helper::LoadMonitor::begin( int bufferSize ) noexcept{
+    if( resetRequest ){
+        resetMeters();
+        resetRequest = false;
+    }
+    bufferTime = bufferSize / sampleRate;
+    start = std::chrono::steady_clock::now();
+    last = start;
+    for( int s=0; s<StagesNumber; ++s ){
+        stageTimes[s] = 0.0;
+    }
+}
+
+void pdsp::helper::LoadMonitor::stamp( Stage stage ) noexcept{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    stageTimes[stage] += std::chrono::duration<double>( now - last ).count();
+    last = now;
+}
+
+void pdsp::helper::LoadMonitor::end() noexcept{
+    if( bufferTime <= 0.0 ){ return; }
+
+    double total = std::chrono::duration<double>( last - start ).count() / bufferTime;
+    double alpha = 1.0 - exp( - bufferTime / OFXPDSP_LOADMONITOR_SMOOTHING_TIME );
+
+    meanLoad += alpha * ( total - meanLoad );
+    load.store( static_cast<float>( meanLoad ), std::memory_order_relaxed );
+    if( total > peak.load( std::memory_order_relaxed ) ){
+        peak.store( static_cast<float>( total ), std::memory_order_relaxed );
+    }
+
+    int heaviest = 0;
+    for( int s=0; s<StagesNumber; ++s ){
+        double stageLoad = stageTimes[s] / bufferTime;
+        meanStages[s] += alpha * ( stageLoad - meanStages[s] );
+        stages[s].store( static_cast<float>( meanStages[s] ), std::memory_order_relaxed );
+        if( stageLoad > stagePeaks[s].load( std::memory_order_relaxed ) ){
+            stagePeaks[s].store( static_cast<float>( stageLoad ), std::memory_order_relaxed );
+        }
+        if( stageTimes[s] > stageTimes[heaviest] ){ heaviest = s; }
+    }
+
+    int bin = static_cast<int>( total * ( OFXPDSP_LOADMONITOR_BINS - 1 ) );
+    if( bin >= OFXPDSP_LOADMONITOR_BINS ){ bin = OFXPDSP_LOADMONITOR_BINS - 1; }
+    histogram[bin].fetch_add( 1, std::memory_order_relaxed );
+
+    if( total >= 1.0 ){
+        misses.fetch_add( 1, std::memory_order_relaxed );
+    }
+    if( total >= nearMissThreshold.load( std::memory_order_relaxed ) ){
+        nearMisses.fetch_add( 1, std::memory_order_relaxed );
+        nearMissStage.store( heaviest, std::memory_order_relaxed );
+    }
+    callbacks.fetch_add( 1, std::memory_order_relaxed );
+}
+
+float pdsp::helper::LoadMonitor::meter_load() const {
+    return load.load( std::memory_order_relaxed );
+}
+
+float pdsp::helper::LoadMonitor::meter_peak() const {
+    return peak.load( std::memory_order_relaxed );
+}
+
+float pdsp::helper::LoadMonitor::meter_stage( Stage stage ) const {
+    if( stage < 0 || stage >= StagesNumber ){ return 0.0f; }
+    return stages[stage].load( std::memory_order_relaxed );
+}
+
+float pdsp::helper::LoadMonitor::meter_stage_peak( Stage stage ) const {
+    if( stage < 0 || stage >= StagesNumber ){ return 0.0f; }
+    return stagePeaks[stage].load( std::memory_order_relaxed );
+}
+
+int pdsp::helper::LoadMonitor::meter_near_misses() const {
+    return nearMisses.load( std::memory_order_relaxed );
+}
+
+int pdsp::helper::LoadMonitor::meter_misses() const {
+    return misses.load( std::memory_order_relaxed );
+}
+
+int pdsp::helper::LoadMonitor::meter_near_miss_stage() const {
+    return nearMissStage.load( std::memory_order_relaxed );
+}
+
+int pdsp::helper::LoadMonitor::meter_callbacks() const {
+    return callbacks.load( std::memory_order_relaxed );
+}
+
+int pdsp::helper::LoadMonitor::meter_histogram( int bin ) const {
+    if( bin < 0 || bin >= OFXPDSP_LOADMONITOR_BINS ){ return 0; }
+    return histogram[bin].load( std::memory_order_relaxed );
+}
+
+int pdsp::helper::LoadMonitor::getHistogramBins() const {
+    return OFXPDSP_LOADMONITOR_BINS;
+}
+
+void pdsp::helper::LoadMonitor::setNearMissThreshold( float fraction ){
+    if( fraction < 0.0f ){ fraction = 0.0f; }
+    if( fraction > 1.0f ){ fraction = 1.0f; }
+    nearMissThreshold = fraction;
+}
+
+void pdsp::helper::LoadMonitor::reset(){
+    resetRequest = true;
+}
+
+const char* pdsp::helper::LoadMonitor::getStageName( int stage ){
+    switch( stage ){
+        case Sequencer: return "sequencer";
+        case Midi:      return "midi";
+        case Osc:       return "osc";
+        case Outputs:   return "outputs";
+        case DSP:       return "dsp";
+        default:        return "none";
+    }
+}
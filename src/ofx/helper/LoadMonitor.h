@@ -0,0 +1,147 @@
+
+// LoadMonitor.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef OFXPDSP_LOADMONITOR_H_INCLUDED
+#define OFXPDSP_LOADMONITOR_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include "../../DSP/core/Preparable.h"
+
+#define OFXPDSP_LOADMONITOR_BINS 21
+
+/*!
+@brief measures the time taken by each stage of the audio callback against the time of the buffer. All the meters are thread-safe.
+*/
+
+namespace pdsp{
+
+namespace helper {
+
+class LoadMonitor : public pdsp::Preparable {
+
+public:
+    /*!
+    @brief the measured stages of the audio callback
+    */
+    enum Stage { Sequencer = 0, Midi, Osc, Outputs, DSP, StagesNumber };
+
+    LoadMonitor();
+
+    /*!
+    @brief returns the mean time taken by the whole callback, as a fraction of the buffer time. 1.0 means that the callback took all the time available.
+    */
+    float meter_load() const;
+
+    /*!
+    @brief returns the worst time taken by the callback since the last reset(), as a fraction of the buffer time.
+    */
+    float meter_peak() const;
+
+    /*!
+    @brief returns the mean time taken by the given stage, as a fraction of the buffer time.
+    @param[in] stage stage to measure, Sequencer, Midi, Osc, Outputs or DSP
+    */
+    float meter_stage( Stage stage ) const;
+
+    /*!
+    @brief returns the worst time taken by the given stage since the last reset(), as a fraction of the buffer time.
+    @param[in] stage stage to measure, Sequencer, Midi, Osc, Outputs or DSP
+    */
+    float meter_stage_peak( Stage stage ) const;
+
+    /*!
+    @brief returns the number of callbacks that took more than the near miss threshold of the buffer time, since the last reset().
+    */
+    int meter_near_misses() const;
+
+    /*!
+    @brief returns the number of callbacks that took more than all the buffer time, since the last reset(). Each of them is probably a dropout.
+    */
+    int meter_misses() const;
+
+    /*!
+    @brief returns the stage that took most of the time in the last near miss, or -1 if there were no near misses.
+    */
+    int meter_near_miss_stage() const;
+
+    /*!
+    @brief returns the number of measured callbacks since the last reset().
+    */
+    int meter_callbacks() const;
+
+    /*!
+    @brief returns the number of callbacks with the load in the given histogram bin. Each bin is 5% of the buffer time wide, the last bin counts the callbacks over 100%.
+    @param[in] bin index of the bin, from 0 to getHistogramBins()-1
+    */
+    int meter_histogram( int bin ) const;
+
+    /*!
+    @brief returns the number of bins of the histogram.
+    */
+    int getHistogramBins() const;
+
+    /*!
+    @brief sets the fraction of buffer time over which a callback is counted as near miss. Default is 0.8.
+    @param[in] fraction threshold, from 0.0f to 1.0f
+    */
+    void setNearMissThreshold( float fraction );
+
+    /*!
+    @brief resets the peaks, the counters and the histogram. The reset is done at the next callback.
+    */
+    void reset();
+
+    /*!
+    @brief returns the name of the given stage.
+    @param[in] stage stage
+    */
+    static const char* getStageName( int stage );
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+    // audio thread methods
+    void begin( int bufferSize ) noexcept;
+    void stamp( Stage stage ) noexcept;
+    void end() noexcept;
+/*!
+    @endcond
+*/
+
+private:
+    void prepareToPlay( int expectedBufferSize, double sampleRate ) override;
+    void releaseResources() override;
+
+    void resetMeters() noexcept;
+
+    std::chrono::steady_clock::time_point   start;
+    std::chrono::steady_clock::time_point   last;
+    double  stageTimes[StagesNumber];
+    double  bufferTime;
+    double  sampleRate;
+    double  smoothing;
+    double  meanLoad;
+    double  meanStages[StagesNumber];
+
+    std::atomic<float>  load;
+    std::atomic<float>  peak;
+    std::atomic<float>  stages[StagesNumber];
+    std::atomic<float>  stagePeaks[StagesNumber];
+    std::atomic<int>    histogram[OFXPDSP_LOADMONITOR_BINS];
+    std::atomic<int>    nearMisses;
+    std::atomic<int>    misses;
+    std::atomic<int>    nearMissStage;
+    std::atomic<int>    callbacks;
+
+    std::atomic<float>  nearMissThreshold;
+    std::atomic<bool>   resetRequest;
+
+};
+
+}}
+
+
+#endif // OFXPDSP_LOADMONITOR_H_INCLUDED
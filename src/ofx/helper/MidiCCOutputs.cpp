@@ -0,0 +1,230 @@
+
+#include "MidiCCOutputs.h"
+#include <cstdio>
+#include <cmath>
+
+// stride of each lane inside the block, in floats, keeps every lane aligned
+#define OFXPDSP_MIDICCOUTPUTS_ALIGN 8
+// distance from the target at which a lane jumps to it and goes back to control rate, far below the 1/128 steps of the CCs
+#define OFXPDSP_MIDICCOUTPUTS_SETTLED 1.0e-4f
+
+namespace pdsp{ namespace helper {
+
+MidiCCOutputs::LaneOutputNode::LaneOutputNode(){
+    if( buffer != nullptr ){ // allocated by OutputNode on dynamic construction
+        ofx_deallocate_aligned( buffer );
+    }
+    buffer = nullptr;
+}
+
+MidiCCOutputs::LaneOutputNode::~LaneOutputNode(){
+    buffer = nullptr; // the block is deallocated by MidiCCOutputs
+}
+
+
+MidiCCOutputs::MidiCCOutputs(){
+
+    for( int i=0; i<OFXPDSP_MIDICCOUTPUTS_LANES; ++i ){
+        addOutput( laneTag(i), laneOutputs[i] );
+        values[i] = 0.0f;
+        targets[i] = 0.0f;
+        settling[i] = 0;
+        started[i] = false;
+        meters[i] = 0.0f;
+    }
+    resetOutputToDefault();
+    // updateOutputNodes() is not called, the lanes are rendered by render() and not by the patching
+
+    block = nullptr;
+    stride = 0;
+    messages = nullptr;
+
+    sampleRate = 44100.0;
+    setSlewTime( 50.0f );
+
+    lanes = OFXPDSP_MIDICCOUTPUTS_LANES;
+
+    if(dynamicConstruction){
+        prepareToPlay(globalBufferSize, globalSampleRate);
+    }
+}
+
+MidiCCOutputs::~MidiCCOutputs(){
+    releaseResources();
+}
+
+const char* MidiCCOutputs::laneTag( int lane ){
+    static char tags[OFXPDSP_MIDICCOUTPUTS_LANES][8];
+    static bool initialized = false;
+    if( !initialized ){
+        for( int i=0; i<OFXPDSP_MIDICCOUTPUTS_LANES; ++i ){
+            snprintf( tags[i], 8, "%d", i );
+        }
+        initialized = true;
+    }
+    return tags[lane];
+}
+
+void MidiCCOutputs::setLanes( int lanes ){
+    if( lanes < 0 ){ lanes = 0; }
+    if( lanes > OFXPDSP_MIDICCOUTPUTS_LANES ){ lanes = OFXPDSP_MIDICCOUTPUTS_LANES; }
+    this->lanes = lanes;
+}
+
+void MidiCCOutputs::setSlewTime( float slewTimeMs ){
+    this->slewTimeMs = slewTimeMs;
+    updateCoefficient();
+}
+
+void MidiCCOutputs::updateCoefficient(){
+    // y[n] = target + ( y[n-1] - target ) * coefficient, after slewTimeMs 1% of the change is left
+    float samples = (float) sampleRate * slewTimeMs * 0.001f;
+    if( samples >= 1.0f ){
+        coefficient = expf( logf( 0.01f ) / samples );
+        logCoefficient = logf( coefficient );
+    }else{
+        coefficient = 0.0f;
+        logCoefficient = 0.0f;
+    }
+}
+
+Patchable& MidiCCOutputs::out_lane( int lane ){
+    if( lane < 0 || lane >= OFXPDSP_MIDICCOUTPUTS_LANES ){
+        std::cout<<"[pdsp] warning! CC output "<<lane<<" out of range, returning CC 0\n";
+        pdsp_trace();
+        lane = 0;
+    }
+    return out( laneTag( lane ) );
+}
+
+float MidiCCOutputs::meter_lane( int lane ) const{
+    if( lane < 0 || lane >= OFXPDSP_MIDICCOUTPUTS_LANES ){ return 0.0f; }
+    return meters[lane].load( std::memory_order_relaxed );
+}
+
+void MidiCCOutputs::prepareUnit( int expectedBufferSize, double sampleRate ){
+    releaseResources();
+
+    int size = ( expectedBufferSize * PDSP_BUFFERS_EXTRA_DIM)/(PDSP_BUFFERS_EXTRA_DIM-1);
+    stride = ( ( size + OFXPDSP_MIDICCOUTPUTS_ALIGN - 1 ) / OFXPDSP_MIDICCOUTPUTS_ALIGN ) * OFXPDSP_MIDICCOUTPUTS_ALIGN;
+    ofx_allocate_aligned( block, stride * OFXPDSP_MIDICCOUTPUTS_LANES );
+
+    this->sampleRate = sampleRate;
+    updateCoefficient();
+
+    for( int i=0; i<OFXPDSP_MIDICCOUTPUTS_LANES; ++i ){
+        float* laneBuffer = block + i*stride;
+        ofx_Aeq_S( laneBuffer, values[i], stride );
+        laneOutputs[i].setBuffer( laneBuffer );
+    }
+}
+
+void MidiCCOutputs::releaseResources(){
+    if( block != nullptr ){
+        for( int i=0; i<OFXPDSP_MIDICCOUTPUTS_LANES; ++i ){
+            laneOutputs[i].setBuffer( nullptr );
+        }
+        ofx_deallocate_aligned( block );
+        block = nullptr;
+    }
+}
+
+void MidiCCOutputs::render( const std::vector<MessageBuffer> & laneMessages, int bufferSize ) noexcept{
+    messages = &laneMessages;
+    process( bufferSize );
+}
+
+void MidiCCOutputs::process( int bufferSize ) noexcept{
+
+    if( block == nullptr || messages == nullptr ){ return; }
+
+    int active = lanes;
+    if( active > (int) messages->size() ){ active = messages->size(); }
+
+    for( int i=0; i<active; ++i ){
+        renderLane( i, (*messages)[i], bufferSize );
+    }
+    for( int i=active; i<OFXPDSP_MIDICCOUTPUTS_LANES; ++i ){
+        setControlRateOutput( laneOutputs[i], values[i] );
+    }
+}
+
+void MidiCCOutputs::renderLane( int lane, const MessageBuffer & messageBuffer, int bufferSize ) noexcept{
+
+    if( messageBuffer.messages.empty() ){
+        if( settling[lane] > 0 ){
+            runLane( lane, getOutputBufferToFill( laneOutputs[lane] ), 0, bufferSize );
+        }else{
+            setControlRateOutput( laneOutputs[lane], values[lane] ); // idle lanes stay at control rate
+        }
+    }else if( settling[lane] == 0 && started[lane] && !valueChanges( lane, messageBuffer ) ){
+        setControlRateOutput( laneOutputs[lane], values[lane] ); // repeated values
+    }else{
+        float* buffer = getOutputBufferToFill( laneOutputs[lane] );
+        int n = 0;
+        for( const ControlMessage & msg : messageBuffer.messages ){
+            if( !started[lane] ){
+                values[lane] = msg.value;
+                targets[lane] = msg.value;
+                started[lane] = true;
+            }
+            runLane( lane, buffer, n, msg.sample );
+            setTarget( lane, msg.value );
+            n = msg.sample;
+        }
+        runLane( lane, buffer, n, bufferSize );
+    }
+
+    meters[lane].store( values[lane], std::memory_order_relaxed );
+}
+
+// the one-pole is memoryless, so each segment restarts the ramp from the last value
+void MidiCCOutputs::runLane( int lane, float* buffer, int start, int stop ) noexcept{
+
+    if( start >= stop ){ return; }
+
+    if( settling[lane] == 0 ){
+        ofx_Aeq_S_range( buffer, values[lane], start, stop );
+        return;
+    }
+
+    float target = targets[lane];
+    float distance = ( target - values[lane] ) * coefficient;
+
+    if( settling[lane] <= stop - start ){
+        int stopRamp = start + settling[lane];
+        genExpRamp( buffer, start, stopRamp, target, distance, coefficient );
+        ofx_Aeq_S_range( buffer, target, stopRamp, stop );
+        values[lane] = target;
+        settling[lane] = 0;
+    }else{
+        genExpRamp( buffer, start, stop, target, distance, coefficient );
+        values[lane] = buffer[stop-1];
+        settling[lane] -= stop - start;
+    }
+}
+
+void MidiCCOutputs::setTarget( int lane, float target ) noexcept{
+
+    targets[lane] = target;
+
+    float distance = std::abs( target - values[lane] );
+    if( coefficient <= 0.0f || distance <= OFXPDSP_MIDICCOUTPUTS_SETTLED ){
+        values[lane] = target;
+        settling[lane] = 0;
+        return;
+    }
+
+    // samples before the distance is under the settled threshold
+    int samples = (int) std::ceil( logf( OFXPDSP_MIDICCOUTPUTS_SETTLED / distance ) / logCoefficient );
+    settling[lane] = ( samples < 1 ) ? 1 : samples;
+}
+
+bool MidiCCOutputs::valueChanges( int lane, const MessageBuffer & messageBuffer ) const noexcept{
+    for( const ControlMessage & msg : messageBuffer.messages ){
+        if( msg.value != values[lane] ){ return true; }
+    }
+    return false;
+}
+
+}} // end namespaces
@@ -0,0 +1,97 @@
+
+// MidiCCOutputs.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef OFXPDSPMIDI_MIDICCOUTPUTS_H_INCLUDED
+#define OFXPDSPMIDI_MIDICCOUTPUTS_H_INCLUDED
+
+#include "../DSP/pdspCore.h"
+#include <atomic>
+
+#define OFXPDSP_MIDICCOUTPUTS_LANES 128
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+
+namespace pdsp{ namespace helper {
+
+// renders all the CC lanes in one Unit, each lane is an output with its buffer in a single aligned block
+class MidiCCOutputs : public Unit {
+
+    // output that uses a buffer owned by the MidiCCOutputs
+    class LaneOutputNode : public OutputNode {
+    public:
+        LaneOutputNode();
+        ~LaneOutputNode();
+        void setBuffer( float* buffer ){ this->buffer = buffer; };
+
+        void prepareToPlay( int expectedBufferSize, double sampleRate ) override {};
+        void releaseResources() override {};
+        void setOversampleLevel( int newOversample ) override { oversampleLevel = newOversample; };
+    };
+
+public:
+    MidiCCOutputs();
+    ~MidiCCOutputs();
+    MidiCCOutputs( const MidiCCOutputs & other ) = delete;
+    MidiCCOutputs& operator= ( const MidiCCOutputs & other ) = delete;
+
+    // lanes over this number are not processed
+    void setLanes( int lanes );
+
+    // all the lanes share one one-pole slew, in slewTimeMs a lane covers 99% of a change
+    void setSlewTime( float slewTimeMs );
+
+    // selects the output of the given lane and returns this Unit ready to be patched
+    Patchable& out_lane( int lane );
+
+    // last value of the lane, thread-safe
+    float meter_lane( int lane ) const;
+
+    // renders all the lanes with the given messages, one MessageBuffer for each lane
+    void render( const std::vector<MessageBuffer> & laneMessages, int bufferSize ) noexcept;
+
+private:
+    void prepareUnit( int expectedBufferSize, double sampleRate ) override;
+    void releaseResources() override;
+    void process( int bufferSize ) noexcept override;
+
+    void renderLane( int lane, const MessageBuffer & messageBuffer, int bufferSize ) noexcept;
+    void runLane( int lane, float* buffer, int start, int stop ) noexcept;
+    void setTarget( int lane, float target ) noexcept;
+    bool valueChanges( int lane, const MessageBuffer & messageBuffer ) const noexcept;
+    void updateCoefficient();
+
+    static const char* laneTag( int lane );
+
+    LaneOutputNode  laneOutputs[OFXPDSP_MIDICCOUTPUTS_LANES];
+    float*  block;
+    int     stride;
+
+    // state of the lanes as structure of arrays
+    float   values[OFXPDSP_MIDICCOUTPUTS_LANES];       // last output value
+    float   targets[OFXPDSP_MIDICCOUTPUTS_LANES];
+    int     settling[OFXPDSP_MIDICCOUTPUTS_LANES];     // samples before reaching the target, 0 when the lane is still
+    bool    started[OFXPDSP_MIDICCOUTPUTS_LANES];      // the first value is never slewed
+    std::atomic<float>  meters[OFXPDSP_MIDICCOUTPUTS_LANES];
+
+    float   slewTimeMs;
+    double  sampleRate;
+    float   coefficient;        // shared by all the lanes
+    float   logCoefficient;
+
+    std::atomic<int>    lanes;
+
+    const std::vector<MessageBuffer>* messages;
+
+};
+
+}}
+
+/*!
+    @endcond
+*/
+
+#endif // OFXPDSPMIDI_MIDICCOUTPUTS_H_INCLUDED
@@ -1,6 +1,79 @@
 
 #include "MidiKeysBuffers.h"
 
+#if defined(_MSC_VER) && defined(_WIN64)
+#include <intrin.h>
+#endif
+
+namespace pdsp{ namespace helper {
+
+void VoiceLists::resize( int voices, int lists ){
+        prevVoice.resize( voices );
+        nextVoice.resize( voices );
+        head.resize( lists );
+        tail.resize( lists );
+        clear();
+}
+
+void VoiceLists::clear(){
+        for( size_t i=0; i<prevVoice.size(); ++i ){
+                prevVoice[i] = nextVoice[i] = -1;
+        }
+        for( size_t i=0; i<head.size(); ++i ){
+                head[i] = tail[i] = -1;
+        }
+}
+
+void VoiceLists::pushBack( int list, int voice ) noexcept{
+        prevVoice[voice] = tail[list];
+        nextVoice[voice] = -1;
+        if( tail[list] != -1 ){
+                nextVoice[tail[list]] = voice;
+        }else{
+                head[list] = voice;
+        }
+        tail[list] = voice;
+}
+
+void VoiceLists::remove( int list, int voice ) noexcept{
+        if( prevVoice[voice] != -1 ){
+                nextVoice[prevVoice[voice]] = nextVoice[voice];
+        }else{
+                head[list] = nextVoice[voice];
+        }
+        if( nextVoice[voice] != -1 ){
+                prevVoice[nextVoice[voice]] = prevVoice[voice];
+        }else{
+                tail[list] = prevVoice[voice];
+        }
+        prevVoice[voice] = nextVoice[voice] = -1;
+}
+
+#if defined(_MSC_VER) && defined(_WIN64)
+static inline int lowestBit( uint64_t word ){ unsigned long index; _BitScanForward64( &index, word ); return (int) index; }
+static inline int highestBit( uint64_t word ){ unsigned long index; _BitScanReverse64( &index, word ); return (int) index; }
+#elif defined(__GNUC__) || defined(__clang__)
+static inline int lowestBit( uint64_t word ){ return __builtin_ctzll( word ); }
+static inline int highestBit( uint64_t word ){ return 63 - __builtin_clzll( word ); }
+#else
+static inline int lowestBit( uint64_t word ){ int i = 0; while( !(word & 1) ){ word >>= 1; ++i; } return i; }
+static inline int highestBit( uint64_t word ){ int i = -1; while( word ){ word >>= 1; ++i; } return i; }
+#endif
+
+int Mask128::lowest() const noexcept{
+        if( words[0] ){ return lowestBit( words[0] ); }
+        if( words[1] ){ return 64 + lowestBit( words[1] ); }
+        return -1;
+}
+
+int Mask128::highest() const noexcept{
+        if( words[1] ){ return 64 + highestBit( words[1] ); }
+        if( words[0] ){ return highestBit( words[0] ); }
+        return -1;
+}
+
+}} // end namespace
+
 #ifndef __ANDROID__
 
 #define MIDINOTEPROCESSORMESSAGERESERVE 32
@@ -9,8 +82,12 @@ namespace pdsp{ namespace helper {
 
 MidiKeysBuffers::MidiKeysBuffers(){
     
-        eventIdGenerator = 0;
         monoNoteIndex = -1;
+        roundRobinIndex = 0;
+        stealMode = Oldest;
+        for( int i=0; i<voiceMaskWords; ++i ){
+                voiceMask[i] = 0;
+        }
         activeNotes = 0;
         sendClearMessages = true;
         gateMessages.reserve( MIDINOTEPROCESSORMESSAGERESERVE );
@@ -66,6 +143,24 @@ void MidiKeysBuffers::setMidiChannel( int channel ){
     }
 }
 
+void MidiKeysBuffers::setVoiceSteal( VoiceSteal mode ){
+        stealMode = mode;
+}
+
+bool MidiKeysBuffers::meter_voice_active( int voice ) const{
+        if( voice < 0 || voice >= voiceMaskWords * 64 ){ return false; }
+        return ( voiceMask[voice>>6].load( std::memory_order_relaxed ) >> (voice & 63) ) & 1;
+}
+
+uint64_t MidiKeysBuffers::meter_voice_mask( int offset ) const{
+        if( offset < 0 || offset >= voiceMaskWords * 64 ){ return 0; }
+        uint64_t mask = voiceMask[offset>>6].load( std::memory_order_relaxed ) >> (offset & 63);
+        if( (offset & 63) && (offset>>6) + 1 < voiceMaskWords ){
+                mask |= voiceMask[(offset>>6) + 1].load( std::memory_order_relaxed ) << (64 - (offset & 63));
+        }
+        return mask;
+}
+
 void MidiKeysBuffers::processMidi (const std::vector<_PositionedMidiMessage> & readVector, const int &bufferSize ) noexcept{
 
         //clear buffers
@@ -197,14 +292,6 @@ void MidiKeysBuffers::processMidi (const std::vector<_PositionedMidiMessage> & r
         pitchBendMessages.processDestination(bufferSize);
         pressureMessages.processDestination(bufferSize);
         singleGateMessages.processDestination(bufferSize);
-        
-        // for checking overflow of note generation, it will fail only there are more than 2000 events generated between calls, unlikely
-        if (eventIdGenerator>30000) {
-                eventIdGenerator = 0;
-                for(int i=0; i<static_cast<int>(notes.size()); ++i){
-                        notes[i].eventNumber = notes[i].eventNumber - 30000;
-                }
-        }
 }
 
 
@@ -225,94 +312,135 @@ void MidiKeysBuffers::setMaxNotes(int notes){
 }
 
 void MidiKeysBuffers::clearNotes(){
+        voices.resize( notes.size(), 2 );
+        velocities.resize( notes.size(), 128 );
+        
         for(int i=0; i<static_cast<int>(notes.size()); ++i){
                 notes[i].gate = 0.0f;
                 notes[i].note = -1;
-                notes[i].eventNumber = eventIdGenerator++;
+                notes[i].eventNumber = 0;
+                voices.pushBack( FreeList, i );
         }
+        for(int i=0; i<128; ++i){
+                noteToVoice[i] = -1;
+        }
+        for( int i=0; i<voiceMaskWords; ++i ){
+                voiceMask[i] = 0;
+        }
+        activeKeys.clear();
+        activeVelocities.clear();
+        roundRobinIndex = 0;
+        monoNoteIndex = -1;
         sendClearMessages = true;
         activeNotes = 0;
 }
 
-void MidiKeysBuffers::checkIdGeneration(){
-    // for checking overflow of note generation, it will fail only there are more than 2000 events generated between calls, unlikely
-    if (eventIdGenerator>30000) {
-        eventIdGenerator = 0;
-        for(int i=0; i<static_cast<int>(notes.size()); ++i){
-            notes[i].eventNumber = notes[i].eventNumber - 30000;
-        }
-    }
+int MidiKeysBuffers::velocityBucket( float gateValue ) noexcept{
+        int bucket = static_cast<int>( gateValue * 128.0f ) - 1;
+        return (bucket < 0) ? 0 : ( (bucket > 127) ? 127 : bucket );
 }
 
+void MidiKeysBuffers::assignNote( int voice, int noteNumber ) noexcept{
+        int oldNote = notes[voice].note;
+        if( oldNote != -1 ){
+                noteToVoice[oldNote] = -1;
+                if( notes[voice].gate > 0 ){
+                        activeKeys.reset( oldNote );
+                        activeKeys.set( noteNumber ); 
+                }
+        }
+        notes[voice].note = noteNumber;
+        noteToVoice[noteNumber] = voice;
+}
 
-int MidiKeysBuffers::noteSteal(){
+void MidiKeysBuffers::gateOn( int voice, float gateValue ) noexcept{
+        if( notes[voice].gate > 0 ){ // already active, it becomes the newest one
+                voices.remove( ActiveList, voice );
+                int bucket = velocityBucket( notes[voice].gate );
+                velocities.remove( bucket, voice );
+                if( velocities.empty( bucket ) ){ activeVelocities.reset( bucket ); }
+        }else{
+                voices.remove( FreeList, voice );
+                activeKeys.set( notes[voice].note );
+                if( voice < voiceMaskWords * 64 ){
+                        voiceMask[voice>>6].fetch_or( uint64_t(1) << (voice & 63), std::memory_order_relaxed );
+                }
+                activeNotes++;
+        }
+        
+        voices.pushBack( ActiveList, voice );
+        int bucket = velocityBucket( gateValue );
+        velocities.pushBack( bucket, voice );
+        activeVelocities.set( bucket );
+        notes[voice].gate = gateValue;
+}
 
-        int dummyVoiceEventNum = 32000;
-        int foundIndex=-1;
+void MidiKeysBuffers::gateOff( int voice ) noexcept{
+        if( !(notes[voice].gate > 0) ){ return; }
+        
+        voices.remove( ActiveList, voice );
+        int bucket = velocityBucket( notes[voice].gate );
+        velocities.remove( bucket, voice );
+        if( velocities.empty( bucket ) ){ activeVelocities.reset( bucket ); }
+        
+        voices.pushBack( FreeList, voice );
+        activeKeys.reset( notes[voice].note );
+        if( voice < voiceMaskWords * 64 ){
+                voiceMask[voice>>6].fetch_and( ~(uint64_t(1) << (voice & 63)), std::memory_order_relaxed );
+        }
+        notes[voice].gate = 0.0f;
+        activeNotes--;
+}
 
-        if(activeNotes!=static_cast<int>(notes.size())){ //there is at least 1 inactive note to steal
-                for(int i=0; i<static_cast<int>(notes.size()); ++i){
-                        if ( !(notes[i].gate>0) ) {
-                                if(notes[i].eventNumber<dummyVoiceEventNum){
-                                        dummyVoiceEventNum=notes[i].eventNumber;
-                                        foundIndex=i;
-                                }
-                        }
-                }
-        }else{ // if there are no inactive note we steal an active note
-                //we steal the oldest note that is not the highest or lowest
-                int indexHighest = -1;
-                int indexLowest = -1;
-                int highest = -4000;
-                int lowest = 4000;
-
-                //blacklist highest and lowest
-                for(int i=0; i<static_cast<int>(notes.size()); ++i){
-                        if(notes[i].note<lowest){
-                                lowest = notes[i].note;
-                                indexLowest = i;
-                        }else if(notes[i].note>highest){
-                                highest = notes[i].note;
-                                indexHighest = i;
-                        }
+int MidiKeysBuffers::allocateVoice() noexcept{
+        
+        if( stealMode == RoundRobin ){
+                // takes the next voice in cyclic order if free, otherwise the least recently released
+                int voice = roundRobinIndex;
+                if( notes[voice].gate > 0 && !voices.empty( FreeList ) ){
+                        voice = voices.front( FreeList );
                 }
-
-                for(int i=0; i<static_cast<int>(notes.size()); ++i){
-                        if(i!=indexLowest && i!=indexHighest){
-                                if(notes[i].eventNumber<dummyVoiceEventNum){
-                                        dummyVoiceEventNum=notes[i].eventNumber;
-                                        foundIndex=i;
-                                }
-                        }
+                roundRobinIndex = voice + 1;
+                if( roundRobinIndex >= static_cast<int>(notes.size()) ){ roundRobinIndex = 0; }
+                return voice;
+        }
+        
+        if( !voices.empty( FreeList ) ){ // there is at least 1 inactive note, the least recently released
+                return voices.front( FreeList );
+        }
+        
+        if( stealMode == Quietest ){ // the oldest of the voices with the lowest velocity
+                return velocities.front( activeVelocities.lowest() );
+        }
+        
+        // we steal the oldest note that is not the highest or lowest
+        int lowest = activeKeys.lowest();
+        int highest = activeKeys.highest();
+        for( int voice = voices.front( ActiveList ); voice != -1; voice = voices.next( voice ) ){
+                if( notes[voice].note != lowest && notes[voice].note != highest ){
+                        return voice; // found in at most 3 steps
                 }
-                activeNotes--; //to counterbalance activeNotes++ on the noteOn, as we are stealing active notes
         }
-        return foundIndex;
+        return voices.front( ActiveList );
 }
 
 
 
-
 void MidiKeysBuffers::processPolyMidiNoteOn(const _PositionedMidiMessage& midi ) noexcept{
         
-        bool retrigger = false;
         int noteNumber = midi.message.pitch;
-        int noteIndex=-1;
+        if( noteNumber < 0 || noteNumber > 127 ){ return; }
 
         float gateValue = static_cast<float>(midi.message.velocity+1)*0.0078125f;  // add 1 and divide by 128, 
                                                                                 //so range is 0.0078125f-1.0f
         //search a note with the same note number, gated or not
-        for(int i=0; i<static_cast<int>(notes.size()); ++i){
-                if(notes[i].note == noteNumber){
-                        //retrigger note
-                        noteIndex = i;
-                        retrigger= true;
-                }
-        }
+        int noteIndex = noteToVoice[noteNumber];
+        bool retrigger = (noteIndex != -1);
 
         if(!retrigger){
                 //steal note
-                noteIndex = noteSteal();
+                noteIndex = allocateVoice();
+                assignNote( noteIndex, noteNumber );
         }
 
         gateMessages[noteIndex].addMessage(gateValue, midi.sample);
@@ -332,110 +460,63 @@ void MidiKeysBuffers::processPolyMidiNoteOn(const _PositionedMidiMessage& midi )
         }
 
         //update the note state
-        notes[noteIndex].note = noteNumber;
-        notes[noteIndex].gate = gateValue;
-        notes[noteIndex].eventNumber = ++eventIdGenerator;
+        gateOn( noteIndex, gateValue );
 
         singleGateMessages.addMessage(gateValue, midi.sample);
-     
-        activeNotes++;
 }
 
 
 void MidiKeysBuffers::processPolyMidiNoteOff(const _PositionedMidiMessage& midi ) noexcept{
 
-        //std::cout<<"poly note off\n";
         int noteNumber = midi.message.pitch;
-        int noteIndex = -1;
-
-        //1 - search a note with the same note number, gated or not, update and call retrigger on the priorityArray
-        for(int i=0; i<static_cast<int>(notes.size()); ++i){
-                if(notes[i].note == noteNumber){
-                        //retrigger note
-                        noteIndex = i;
-                }
-        }
-
-        if(noteIndex!=-1){
-                // do the necessary calculations on the outputs
-                //gateMessages[noteIndex].addMessage(0.0f, sample);
-                notes[noteIndex].gate = 0.0f;
-                notes[noteIndex].eventNumber = ++eventIdGenerator;
+        if( noteNumber < 0 || noteNumber > 127 ){ return; }
+        
+        int noteIndex = noteToVoice[noteNumber];
 
+        if( noteIndex!=-1 && notes[noteIndex].gate > 0 ){
                 gateMessages[noteIndex].addMessage(0.0f, midi.sample);
                 if(activeNotes==1){
                         //single trigger note off
                         singleGateMessages.addMessage(0.0f, midi.sample);
                         
                 }
-                activeNotes--;
+                gateOff( noteIndex );
         }                
 }
 
 
 
-
-
-
-int MidiKeysBuffers::getHighestPriorityMono(){
-    int indexToReturn = -1;
-
-    if(monoMode==Last){
-        int event = -4000;
-        for(int i=0; i<static_cast<int>(notes.size()); ++i){
-            if( (notes[i].gate>0) && notes[i].eventNumber>event){
-                event = notes[i].eventNumber;
-                indexToReturn = i;
-            }
-        }
-    }else if(monoMode==Low){
-        int lowest = 4000;
-        for(int i=0; i<static_cast<int>(notes.size()); ++i){
-            if((notes[i].gate>0) && notes[i].note<lowest){
-                lowest = notes[i].note;
-                indexToReturn = i;
-            }
-        }
-    }else if(monoMode==High){
-        int highest = -4000;
-        for(int i=0; i<static_cast<int>(notes.size()); ++i){
-            if( (notes[i].gate>0) && notes[i].note>highest){
-                highest = notes[i].note;
-                indexToReturn = i;
-            }
-        }
+int MidiKeysBuffers::getHighestPriorityMono() noexcept{
+    int note = -1;
+    switch( monoMode ){
+        case Last: return voices.back( ActiveList );
+        case Low:  note = activeKeys.lowest(); break;
+        case High: note = activeKeys.highest(); break;
+        default: break;
     }
-    return indexToReturn;
+    return (note == -1) ? -1 : noteToVoice[note];
 }
 
 
 
 void MidiKeysBuffers::processMonoMidiNoteOn(const _PositionedMidiMessage& midi ) noexcept{
         
-        bool retrigger = false;
         int noteNumber = midi.message.pitch;
-        int noteIndex  = -1;
+        if( noteNumber < 0 || noteNumber > 127 ){ return; }
 
         float gateValue = static_cast<float>(midi.message.velocity+1)*0.0078125f;  // add 1 and divide by 128, 
                                                                                 //so range is 0.0078125f-1.0f
         
-        for(int i=0; i<static_cast<int>(notes.size()); ++i){
-                if(notes[i].note == noteNumber){
-                        //retrigger note
-                        noteIndex = i;
-                        retrigger= true;
-                }
-        }
-
-        if(!retrigger){
+        int noteIndex = noteToVoice[noteNumber];
+        if( noteIndex == -1 ){
                 //steal note
-                noteIndex = noteSteal();
+                noteIndex = allocateVoice();
+                assignNote( noteIndex, noteNumber );
         }
         
         //update the note state
-        notes[noteIndex].note = noteNumber;
-        notes[noteIndex].gate = gateValue;
-        notes[noteIndex].eventNumber = ++eventIdGenerator;
+        int lastActiveNotes = activeNotes;
+        gateOn( noteIndex, gateValue );
         
         //now we must check if the new note is suitable to become a the new monophonic note
         int lastMonoNoteIndex = monoNoteIndex;
@@ -456,7 +537,7 @@ void MidiKeysBuffers::processMonoMidiNoteOn(const _PositionedMidiMessage& midi )
                         portaMessages[0].addMessage(1.0f, midi.sample); 
                         break;
                 case Legato:
-                        if(activeNotes==0){
+                        if(lastActiveNotes==0){
                                 portaMessages[0].addMessage(0.0f, midi.sample);    
                         }else{
                                 portaMessages[0].addMessage(1.0f, midi.sample); 
@@ -466,33 +547,25 @@ void MidiKeysBuffers::processMonoMidiNoteOn(const _PositionedMidiMessage& midi )
                 }
         } 
         
-        if(monoNoteIndex!=lastMonoNoteIndex || activeNotes==0){
+        if(monoNoteIndex!=lastMonoNoteIndex || lastActiveNotes==0){
                 gateMessages[0].addMessage(notes[monoNoteIndex].gate, midi.sample);
         }
-
-        activeNotes++;        
 }
 
 
 void MidiKeysBuffers::processMonoMidiNoteOff(const _PositionedMidiMessage& midi ) noexcept {
        
         int noteNumber = midi.message.pitch;
-        int noteIndex = -1;
-
-        //search a note with the same note number, gated or not, update and call retrigger on the priorityArray
-        for(int i=0; i<static_cast<int>(notes.size()); ++i){
-                if(notes[i].note == noteNumber){
-                        //retrigger note
-                        noteIndex = i;
-                }
-        }
+        if( noteNumber < 0 || noteNumber > 127 ){ return; }
+        
+        int noteIndex = noteToVoice[noteNumber];
 
-        if(noteIndex!=-1){
-                           
-                notes[noteIndex].gate = 0.0f;
-                notes[noteIndex].eventNumber = ++eventIdGenerator;
+        if( noteIndex!=-1 && notes[noteIndex].gate > 0 ){
+                
+                int lastActiveNotes = activeNotes;
+                gateOff( noteIndex );
 
-                if(activeNotes==1){
+                if(lastActiveNotes==1){
                         //single trigger note off
                         gateMessages[0].addMessage(0.0f, midi.sample);
                 }else{
@@ -507,16 +580,9 @@ void MidiKeysBuffers::processMonoMidiNoteOff(const _PositionedMidiMessage& midi
                                 case Off:
                                         portaMessages[0].addMessage(0.0f, midi.sample);  
                                         break;
-                                case On:
+                                case On: case Legato:
                                         portaMessages[0].addMessage(1.0f, midi.sample); 
                                         break;
-                                case Legato:
-                                        if(activeNotes==0){
-                                                portaMessages[0].addMessage(0.0f, midi.sample);    
-                                        }else{
-                                                portaMessages[0].addMessage(1.0f, midi.sample); 
-                                        }
-                                        break;
                                 default: break;
                                 }
                                                                 
@@ -524,7 +590,6 @@ void MidiKeysBuffers::processMonoMidiNoteOff(const _PositionedMidiMessage& midi
 
                         }
                 }
-                activeNotes--;
         }        
 }
 
@@ -12,12 +12,15 @@
 #endif
 
 #include "../messages/header.h"
+#include <atomic>
+#include <cstdint>
 
 namespace pdsp{ 
 
 enum VoiceMode {Poly, Mono};
 enum PortamentoMode {Off, On, Legato};
 enum MonoPriority {Last, Low, High};
+enum VoiceSteal {Oldest, RoundRobin, Quietest};
 
 namespace helper {
 
@@ -31,6 +34,43 @@ public:
 
 };
 
+// doubly linked lists of voices, a voice is in at most one list at time, all the operations are O(1)
+class VoiceLists {
+public:
+        void resize( int voices, int lists );
+        void clear();
+        
+        void pushBack( int list, int voice ) noexcept;
+        void remove( int list, int voice ) noexcept;
+        
+        int front( int list ) const noexcept { return head[list]; };
+        int back( int list ) const noexcept { return tail[list]; };
+        int next( int voice ) const noexcept { return nextVoice[voice]; };
+        bool empty( int list ) const noexcept { return head[list] == -1; };
+        
+private:
+        std::vector<int> prevVoice;
+        std::vector<int> nextVoice;
+        std::vector<int> head;
+        std::vector<int> tail;
+};
+
+// set of values from 0 to 127 with O(1) lowest and highest
+class Mask128 {
+public:
+        Mask128(){ clear(); };
+        
+        void clear() noexcept { words[0] = words[1] = 0; };
+        void set( int bit ) noexcept { words[bit>>6] |= (uint64_t(1) << (bit & 63)); };
+        void reset( int bit ) noexcept { words[bit>>6] &= ~(uint64_t(1) << (bit & 63)); };
+        bool empty() const noexcept { return (words[0] | words[1]) == 0; };
+        int lowest() const noexcept;
+        int highest() const noexcept;
+        
+private:
+        uint64_t words[2];
+};
+
 #ifndef __ANDROID__
 class MidiKeysBuffers {
 public:
@@ -45,6 +85,10 @@ public:
         void setPitchBend( float down, float up);
         void setNoteRange( int lowNote, int highNote );
         void setMidiChannel( int channel );
+        void setVoiceSteal( VoiceSteal mode );
+        
+        bool meter_voice_active( int voice ) const;
+        uint64_t meter_voice_mask( int offset ) const;
         
         
         std::vector<pdsp::MessageBuffer>    gateMessages;
@@ -62,15 +106,18 @@ private:
         void processMonoMidiNoteOn( const _PositionedMidiMessage& midi) noexcept;
         void processMonoMidiNoteOff( const _PositionedMidiMessage& midi) noexcept;
         
-        int noteSteal();
-        int getHighestPriorityMono();
+        int allocateVoice() noexcept;
+        int getHighestPriorityMono() noexcept;
+        
+        void assignNote( int voice, int noteNumber ) noexcept;
+        void gateOn( int voice, float gateValue ) noexcept;
+        void gateOff( int voice ) noexcept;
+        static int velocityBucket( float gateValue ) noexcept;
 
-        void checkIdGeneration();
         void clearNotes();
         
 
         bool    sendClearMessages;
-        int     eventIdGenerator;
         int     activeNotes;
         int     maxNotes;
         int     monoNoteIndex;
@@ -81,6 +128,19 @@ private:
         
         std::vector<NoteState_t>             notes;
         
+        // free voices are ordered by release time, active voices by note on time
+        enum { FreeList = 0, ActiveList = 1 };
+        VoiceLists      voices;
+        VoiceLists      velocities; // active voices for each velocity
+        Mask128         activeKeys;
+        Mask128         activeVelocities;
+        int             noteToVoice[128];
+        int             roundRobinIndex;
+        VoiceSteal      stealMode;
+        
+        static const int voiceMaskWords = 4;
+        std::atomic<uint64_t>   voiceMask[voiceMaskWords];
+        
         float   pitchBendUpAmount;
         float   pitchBendDownAmount;    
            
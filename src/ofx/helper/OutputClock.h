@@ -0,0 +1,79 @@
+// OutputClock.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef OFXPDSP_OUTPUTCLOCK_H_INCLUDED
+#define OFXPDSP_OUTPUTCLOCK_H_INCLUDED
+
+#include <chrono>
+#include <atomic>
+
+// the clock is set again to the playback time if it drifts away more than this number of buffers
+#define OFXPDSP_OUTPUTCLOCK_RESYNC_BUFFERS 4
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+
+namespace pdsp{
+
+// schedules the messages of the MIDI, OSC and serial outputs at the time their buffer is played
+// it advances one buffer for each processed buffer, so the messages have no jitter from the callbacks timing
+// when the buffers are rendered ahead of the device the playback delay is set by the engine
+class OutputClock{
+public:
+    typedef std::chrono::high_resolution_clock clock;
+
+    OutputClock() : started(false), nsecPerSample( 1000000000.0 / 44100.0 ) {};
+
+    void prepare( double sampleRate ){
+        nsecPerSample = 1000000000.0 / sampleRate;
+        started = false;
+    }
+
+    // call it once for each processed buffer, before scheduling its messages
+    void advance( int bufferSize ) noexcept {
+        clock::time_point playback = clock::now() + std::chrono::nanoseconds( playbackDelay().load( std::memory_order_relaxed ) );
+        std::chrono::nanoseconds duration( static_cast<long long>( bufferSize * nsecPerSample ) );
+
+        if( started ){
+            bufferTime += duration;
+            // checks the clock against the playback position, it drifts away if the callbacks stopped for a while
+            std::chrono::nanoseconds drift = ( bufferTime > playback ) ? bufferTime - playback : playback - bufferTime;
+            if( drift > duration * OFXPDSP_OUTPUTCLOCK_RESYNC_BUFFERS ){
+                bufferTime = playback;
+            }
+        }else{
+            bufferTime = playback;
+            started = true;
+        }
+    }
+
+    // time of the given sample of the last processed buffer
+    clock::time_point at( int sample ) const noexcept {
+        return bufferTime + std::chrono::nanoseconds( static_cast<long long>( sample * nsecPerSample ) );
+    }
+
+    // time between the processing of a buffer and its playback, set by the engine for all the outputs
+    static void setPlaybackDelay( double seconds ) noexcept {
+        playbackDelay().store( static_cast<long long>( seconds * 1000000000.0 ), std::memory_order_relaxed );
+    }
+
+private:
+    static std::atomic<long long> & playbackDelay(){
+        static std::atomic<long long> nanoseconds( 0 );
+        return nanoseconds;
+    }
+
+    bool                started;
+    double              nsecPerSample;
+    clock::time_point   bufferTime;
+};
+
+}
+
+/*!
+    @endcond
+*/
+
+#endif // OFXPDSP_OUTPUTCLOCK_H_INCLUDED
@@ -0,0 +1,110 @@
+// OutputDaemon.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef OFXPDSP_OUTPUTDAEMON_H_INCLUDED
+#define OFXPDSP_OUTPUTDAEMON_H_INCLUDED
+
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include "SpscRing.h"
+#include "Semaphore.h"
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+
+namespace pdsp{
+
+// thread sending the scheduled messages of the MIDI, OSC and serial outputs at their time
+// the audio thread pushes the messages sorted by time and calls wake(), it never waits on the daemon
+// T is plain data with a scheduledTime member
+template<typename T>
+class OutputDaemon{
+public:
+    typedef std::chrono::high_resolution_clock clock;
+
+    OutputDaemon() : running(false) {};
+    ~OutputDaemon(){ stop(); }
+
+    // not thread-safe, call it when the daemon is stopped
+    void resize( size_t capacity ){
+        queue.resize( capacity );
+    }
+
+    // starts the thread, dispatch() is called from it when the first message is due, with the current time
+    // it has to send the due messages taking them with popDue()
+    void start( std::function<void( clock::time_point now )> dispatch ){
+        stop();
+        queue.clear();
+        this->dispatch = dispatch;
+        running = true;
+        thread = std::thread( &OutputDaemon::run, this );
+    }
+
+    void stop(){
+        if( thread.joinable() ){
+            running = false;
+            wake();
+            thread.join();
+        }
+    }
+
+    // audio thread, returns false if the queue is full and the message is dropped
+    bool push( const T & message ) noexcept {
+        return queue.push( message );
+    }
+
+    // audio thread, wakes up the daemon without locking, call it after pushing the messages
+    void wake() noexcept {
+        semaphore.post();
+    }
+
+    // daemon thread, copies the next message if it is scheduled before the limit, without taking it
+    bool peekDue( T & message, clock::time_point limit ) const noexcept {
+        return queue.peek( message ) && message.scheduledTime <= limit;
+    }
+
+    // daemon thread, takes the next message if it is scheduled before the limit
+    bool popDue( T & message, clock::time_point limit ) noexcept {
+        if( !peekDue( message, limit ) ){ return false; }
+        queue.pop( message );
+        return true;
+    }
+
+private:
+    // sleeps until the next message is due or until a push, the posts made while running are counted so no wake up is lost
+    void run() noexcept {
+        while( running ){
+            clock::time_point now = clock::now();
+
+            T next;
+            if( queue.peek( next ) ){
+                if( next.scheduledTime <= now ){
+                    dispatch( now );
+                    continue;
+                }
+                semaphore.waitUntil( next.scheduledTime );
+            }else{
+                semaphore.wait();
+            }
+        }
+    }
+
+    SpscRing<T>                 queue;
+    std::function<void( clock::time_point )> dispatch;
+
+    std::thread                 thread;
+    std::atomic<bool>           running;
+    Semaphore                   semaphore;
+};
+
+}
+
+/*!
+    @endcond
+*/
+
+#endif // OFXPDSP_OUTPUTDAEMON_H_INCLUDED
@@ -0,0 +1,247 @@
+
+#include "RenderAhead.h"
+#include "../Engine.h"
+#include "OutputClock.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+pdsp::helper::RenderAhead::RenderAhead(){
+    engine = nullptr;
+    buffers = 0;
+    active = false;
+    blockSize = 0;
+    sampleRate = 44100.0;
+    outCapacity = inCapacity = 0;
+    outWrite = outRead = inWrite = inRead = 0;
+    underruns = 0;
+    runWorker = false;
+}
+
+pdsp::helper::RenderAhead::~RenderAhead(){
+    stop();
+}
+
+void pdsp::helper::RenderAhead::setBuffers( int buffers ){
+    if( buffers < 0 ){ buffers = 0; }
+    this->buffers = buffers;
+}
+
+int pdsp::helper::RenderAhead::getBuffers() const {
+    return buffers;
+}
+
+bool pdsp::helper::RenderAhead::isActive() const {
+    return active;
+}
+
+void pdsp::helper::RenderAhead::start( Engine* engine, int blockSize, int inputs, int outputs, double sampleRate ){
+    stop();
+    if( buffers == 0 ){ return; }
+
+    this->engine = engine;
+    this->blockSize = blockSize;
+    this->sampleRate = sampleRate;
+
+    // the output fifo holds the blocks rendered ahead, the input one has also room for the block being rendered
+    outCapacity = buffers * blockSize;
+    inCapacity = ( buffers + 2 ) * blockSize;
+    outFifo.assign( outputs, std::vector<float>( outCapacity, 0.0f ) );
+    inFifo.assign( inputs, std::vector<float>( inCapacity, 0.0f ) );
+    outPointers.resize( outputs );
+    inPointers.resize( inputs );
+    inScratch.assign( inputs, std::vector<float>( blockSize, 0.0f ) );
+
+    // the latency is filled with silence, so the first block is rendered when the device starts
+    // and each block is played the same time after it is rendered
+    outWrite = outCapacity;
+    outRead = 0;
+    inWrite = 0;
+    inRead = 0;
+    underruns = 0;
+
+    active = true;
+    runWorker = true;
+    worker = std::thread( workerFunctionWrapper, this );
+}
+
+void pdsp::helper::RenderAhead::stop(){
+    if( worker.joinable() ){
+        {
+            std::lock_guard<std::mutex> lock( workerMutex );
+            runWorker = false;
+        }
+        workerCondition.notify_one();
+        worker.join();
+    }
+    active = false;
+    OutputClock::setPlaybackDelay( 0.0 );
+}
+
+void pdsp::helper::RenderAhead::workerFunctionWrapper( RenderAhead* parent ){
+    parent->workerFunction();
+}
+
+void pdsp::helper::RenderAhead::setWorkerPriority(){
+#if defined(__linux__) || defined(__APPLE__)
+    sched_param param;
+    param.sched_priority = sched_get_priority_max( SCHED_FIFO ) - 10;
+    if( pthread_setschedparam( pthread_self(), SCHED_FIFO, &param ) != 0 ){
+        std::cout<<"[pdsp] warning! render ahead thread running without realtime priority\n";
+    }
+#endif
+}
+
+void pdsp::helper::RenderAhead::workerFunction() noexcept{
+
+    setWorkerPriority();
+
+    // the device callback doesn't lock the mutex, so the wait has a timeout for the missed notifications
+    std::chrono::microseconds timeout( static_cast<long long>( 250000.0 * blockSize / sampleRate ) + 1 );
+
+    std::unique_lock<std::mutex> lock( workerMutex );
+    while( runWorker ){
+        lock.unlock();
+        bool rendered = renderNext();
+        lock.lock();
+        if( !rendered && runWorker ){
+            workerCondition.wait_for( lock, timeout );
+        }
+    }
+}
+
+bool pdsp::helper::RenderAhead::renderNext() noexcept{
+
+    size_t written = outWrite.load( std::memory_order_relaxed );
+    if( written - outRead.load( std::memory_order_acquire ) + blockSize > outCapacity ){
+        return false; // fifo full
+    }
+
+    size_t consumed = inRead.load( std::memory_order_relaxed );
+    if( !inFifo.empty() && inWrite.load( std::memory_order_acquire ) - consumed < (size_t) blockSize ){
+        return false; // waiting for the input
+    }
+
+    // output blocks are always written whole and the capacity is a multiple of the block, so they are contiguous
+    for( size_t c=0; c<outFifo.size(); ++c ){
+        outPointers[c] = outFifo[c].data() + ( written % outCapacity );
+    }
+    // input blocks wrapping around the end of the fifo are copied in two segments
+    size_t start = consumed % inCapacity;
+    for( size_t c=0; c<inFifo.size(); ++c ){
+        if( start + blockSize <= inCapacity ){
+            inPointers[c] = inFifo[c].data() + start;
+        }else{
+            size_t first = inCapacity - start;
+            std::memcpy( inScratch[c].data(), inFifo[c].data() + start, first * sizeof(float) );
+            std::memcpy( inScratch[c].data() + first, inFifo[c].data(), ( blockSize - first ) * sizeof(float) );
+            inPointers[c] = inScratch[c].data();
+        }
+    }
+
+    // the block is played after the frames already in the fifo, the outputs schedule their messages at that time
+    size_t queued = written - outRead.load( std::memory_order_acquire );
+    OutputClock::setPlaybackDelay( static_cast<double>( queued ) / sampleRate );
+
+    engine->renderBlock( inPointers.data(), outPointers.data(), blockSize );
+
+    inRead.store( consumed + blockSize, std::memory_order_release );
+    outWrite.store( written + blockSize, std::memory_order_release );
+    return true;
+}
+
+void pdsp::helper::RenderAhead::pushInterleaved( const float* input, int channels, int frames ) noexcept{
+    size_t write = inWrite.load( std::memory_order_relaxed );
+    size_t space = inCapacity - ( write - inRead.load( std::memory_order_acquire ) );
+    if( (size_t) frames > space ){ frames = space; } // the worker is late, the exceeding input is dropped
+
+    int copied = ( channels < (int) inFifo.size() ) ? channels : inFifo.size();
+    for( int n=0; n<frames; ++n ){
+        size_t index = ( write + n ) % inCapacity;
+        for( int c=0; c<copied; ++c ){
+            inFifo[c][index] = input[n*channels + c];
+        }
+    }
+    inWrite.store( write + frames, std::memory_order_release );
+}
+
+void pdsp::helper::RenderAhead::pushInput( float** input, int channels, int frames ) noexcept{
+    size_t write = inWrite.load( std::memory_order_relaxed );
+    size_t space = inCapacity - ( write - inRead.load( std::memory_order_acquire ) );
+    if( (size_t) frames > space ){ frames = space; }
+
+    int copied = ( channels < (int) inFifo.size() ) ? channels : inFifo.size();
+    size_t start = write % inCapacity;
+    size_t first = ( start + frames > inCapacity ) ? inCapacity - start : frames;
+    for( int c=0; c<copied; ++c ){
+        std::memcpy( inFifo[c].data() + start, input[c], first * sizeof(float) );
+        std::memcpy( inFifo[c].data(), input[c] + first, ( frames - first ) * sizeof(float) );
+    }
+    inWrite.store( write + frames, std::memory_order_release );
+}
+
+void pdsp::helper::RenderAhead::pullInterleaved( float* output, int channels, int frames ) noexcept{
+    size_t read = outRead.load( std::memory_order_relaxed );
+    size_t available = outWrite.load( std::memory_order_acquire ) - read;
+    int ready = ( (size_t) frames > available ) ? available : frames;
+
+    int copied = ( channels < (int) outFifo.size() ) ? channels : outFifo.size();
+    for( int n=0; n<ready; ++n ){
+        size_t index = ( read + n ) % outCapacity;
+        for( int c=0; c<copied; ++c ){
+            output[n*channels + c] = outFifo[c][index];
+        }
+        for( int c=copied; c<channels; ++c ){
+            output[n*channels + c] = 0.0f;
+        }
+    }
+    for( int n=ready*channels; n<frames*channels; ++n ){
+        output[n] = 0.0f;
+    }
+    if( ready < frames ){ underruns++; }
+
+    outRead.store( read + ready, std::memory_order_release );
+    workerCondition.notify_one();
+}
+
+void pdsp::helper::RenderAhead::pullOutput( float** output, int channels, int frames ) noexcept{
+    size_t read = outRead.load( std::memory_order_relaxed );
+    size_t available = outWrite.load( std::memory_order_acquire ) - read;
+    int ready = ( (size_t) frames > available ) ? available : frames;
+
+    int copied = ( channels < (int) outFifo.size() ) ? channels : outFifo.size();
+    size_t start = read % outCapacity;
+    size_t first = ( start + ready > outCapacity ) ? outCapacity - start : ready;
+    for( int c=0; c<copied; ++c ){
+        std::memcpy( output[c], outFifo[c].data() + start, first * sizeof(float) );
+        std::memcpy( output[c] + first, outFifo[c].data(), ( ready - first ) * sizeof(float) );
+        std::fill( output[c] + ready, output[c] + frames, 0.0f );
+    }
+    for( int c=copied; c<channels; ++c ){
+        std::fill( output[c], output[c] + frames, 0.0f );
+    }
+    if( ready < frames ){ underruns++; }
+
+    outRead.store( read + ready, std::memory_order_release );
+    workerCondition.notify_one();
+}
+
+float pdsp::helper::RenderAhead::meter_fill() const {
+    if( !active || blockSize == 0 ){ return 0.0f; }
+    size_t read = outRead.load( std::memory_order_acquire );
+    size_t fill = outWrite.load( std::memory_order_acquire ) - read;
+    return static_cast<float>( fill ) / static_cast<float>( blockSize );
+}
+
+int pdsp::helper::RenderAhead::meter_underruns() const {
+    return underruns.load();
+}
+
+float pdsp::helper::RenderAhead::getLatencyMs() const {
+    if( !active ){ return 0.0f; }
+    return static_cast<float>( 1000.0 * outCapacity / sampleRate );
+}
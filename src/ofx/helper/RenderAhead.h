@@ -0,0 +1,95 @@
+
+// RenderAhead.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef OFXPDSP_RENDERAHEAD_H_INCLUDED
+#define OFXPDSP_RENDERAHEAD_H_INCLUDED
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "../../DSP/pdspCore.h"
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+
+namespace pdsp{
+
+class Engine;
+
+namespace helper{
+
+// renders the Engine blocks ahead of the device callback from a worker thread
+// the rendered audio and the device input are passed through single producer single consumer fifos
+class RenderAhead {
+
+public:
+    RenderAhead();
+    ~RenderAhead();
+
+    // buffers rendered ahead, 0 disables, it takes effect on the next start()
+    void setBuffers( int buffers );
+    int getBuffers() const;
+    bool isActive() const;
+
+    // starts the worker thread, the output fifo is primed with silence
+    void start( Engine* engine, int blockSize, int inputs, int outputs, double sampleRate );
+    void stop();
+
+    // device callback methods
+    void pushInterleaved( const float* input, int channels, int frames ) noexcept;
+    void pushInput( float** input, int channels, int frames ) noexcept;
+    void pullInterleaved( float* output, int channels, int frames ) noexcept;
+    void pullOutput( float** output, int channels, int frames ) noexcept;
+
+    float meter_fill() const;
+    int meter_underruns() const;
+    float getLatencyMs() const;
+
+private:
+    static void workerFunctionWrapper( RenderAhead* parent );
+    void workerFunction() noexcept;
+    bool renderNext() noexcept;
+    void setWorkerPriority();
+
+    Engine*                 engine;
+    int                     buffers;
+    std::atomic<bool>       active;
+
+    int                     blockSize;
+    double                  sampleRate;
+
+    std::vector<std::vector<float>> outFifo;
+    std::vector<std::vector<float>> inFifo;
+    size_t                  outCapacity;
+    size_t                  inCapacity;
+    std::vector<float*>     outPointers;
+    std::vector<float*>     inPointers;
+    std::vector<std::vector<float>> inScratch;     // input blocks wrapping around the end of the fifo
+
+    // monotonic frame counters, the fifo index is counter % capacity
+    std::atomic<size_t>     outWrite;
+    std::atomic<size_t>     outRead;
+    std::atomic<size_t>     inWrite;
+    std::atomic<size_t>     inRead;
+
+    std::atomic<int>        underruns;
+
+    std::thread             worker;
+    std::atomic<bool>       runWorker;
+    std::mutex              workerMutex;
+    std::condition_variable workerCondition;
+
+};
+
+}}
+
+/*!
+    @endcond
+*/
+
+#endif // OFXPDSP_RENDERAHEAD_H_INCLUDED
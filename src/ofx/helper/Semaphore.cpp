@@ -0,0 +1,95 @@
+#include "Semaphore.h"
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <cerrno>
+    #include <ctime>
+#endif
+
+#if defined(_WIN32)
+
+pdsp::Semaphore::Semaphore(){
+    handle = CreateSemaphore( nullptr, 0, 0x7fffffff, nullptr );
+}
+
+pdsp::Semaphore::~Semaphore(){
+    CloseHandle( handle );
+}
+
+void pdsp::Semaphore::post() noexcept{
+    ReleaseSemaphore( handle, 1, nullptr );
+}
+
+void pdsp::Semaphore::wait() noexcept{
+    WaitForSingleObject( handle, INFINITE );
+}
+
+bool pdsp::Semaphore::waitUntil( clock::time_point deadline ) noexcept{
+    // the timeout is in milliseconds, rounded up so it doesn't wake before the deadline
+    auto remaining = std::chrono::duration_cast<std::chrono::microseconds>( deadline - clock::now() ).count();
+    DWORD timeout = ( remaining > 0 ) ? (DWORD)( ( remaining + 999 ) / 1000 ) : 0;
+    return WaitForSingleObject( handle, timeout ) == WAIT_OBJECT_0;
+}
+
+#elif defined(__APPLE__)
+
+pdsp::Semaphore::Semaphore(){
+    handle = dispatch_semaphore_create( 0 );
+}
+
+pdsp::Semaphore::~Semaphore(){
+    dispatch_release( handle );
+}
+
+void pdsp::Semaphore::post() noexcept{
+    dispatch_semaphore_signal( handle );
+}
+
+void pdsp::Semaphore::wait() noexcept{
+    dispatch_semaphore_wait( handle, DISPATCH_TIME_FOREVER );
+}
+
+bool pdsp::Semaphore::waitUntil( clock::time_point deadline ) noexcept{
+    auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>( deadline - clock::now() ).count();
+    if( remaining < 0 ){ remaining = 0; }
+    return dispatch_semaphore_wait( handle, dispatch_time( DISPATCH_TIME_NOW, remaining ) ) == 0;
+}
+
+#else
+
+pdsp::Semaphore::Semaphore(){
+    sem_init( &handle, 0, 0 );
+}
+
+pdsp::Semaphore::~Semaphore(){
+    sem_destroy( &handle );
+}
+
+void pdsp::Semaphore::post() noexcept{
+    sem_post( &handle );
+}
+
+void pdsp::Semaphore::wait() noexcept{
+    while( sem_wait( &handle ) != 0 && errno == EINTR ){}
+}
+
+bool pdsp::Semaphore::waitUntil( clock::time_point deadline ) noexcept{
+    // sem_timedwait takes an absolute time of the realtime clock
+    auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>( deadline - clock::now() ).count();
+    if( remaining < 0 ){ remaining = 0; }
+    timespec until;
+    clock_gettime( CLOCK_REALTIME, &until );
+    long long nanoseconds = until.tv_nsec + remaining;
+    until.tv_sec += (time_t)( nanoseconds / 1000000000LL );
+    until.tv_nsec = (long)( nanoseconds % 1000000000LL );
+
+    int result;
+    while( ( result = sem_timedwait( &handle, &until ) ) != 0 && errno == EINTR ){}
+    return result == 0;
+}
+
+#endif
@@ -0,0 +1,56 @@
+// Semaphore.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef OFXPDSP_SEMAPHORE_H_INCLUDED
+#define OFXPDSP_SEMAPHORE_H_INCLUDED
+
+#include <chrono>
+
+#if defined(__APPLE__)
+    #include <dispatch/dispatch.h>
+#elif !defined(_WIN32)
+    #include <semaphore.h>
+#endif
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+
+namespace pdsp{
+
+// counting semaphore, post() never locks so it can be called from the audio thread
+class Semaphore{
+public:
+    typedef std::chrono::high_resolution_clock clock;
+
+    Semaphore();
+    ~Semaphore();
+    Semaphore( const Semaphore & other ) = delete;
+    Semaphore& operator= ( const Semaphore & other ) = delete;
+
+    void post() noexcept;
+
+    // waits for a post
+    void wait() noexcept;
+
+    // waits for a post until the deadline, returns false if the deadline passed
+    bool waitUntil( clock::time_point deadline ) noexcept;
+
+private:
+#if defined(_WIN32)
+    void*                   handle;
+#elif defined(__APPLE__)
+    dispatch_semaphore_t    handle;
+#else
+    sem_t                   handle;
+#endif
+};
+
+}
+
+/*!
+    @endcond
+*/
+
+#endif // OFXPDSP_SEMAPHORE_H_INCLUDED
@@ -0,0 +1,85 @@
+// SpscRing.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef OFXPDSP_SPSCRING_H_INCLUDED
+#define OFXPDSP_SPSCRING_H_INCLUDED
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+
+namespace pdsp{
+
+// lock-free ring for one producer thread and one consumer thread, push() and pop() never allocate
+template<typename T>
+class SpscRing{
+public:
+    SpscRing() : mask(0), writeIndex(0), readIndex(0) {};
+
+    // not thread-safe, call it before starting the producer and the consumer
+    void resize( size_t capacity ){
+        size_t size = 1;
+        while( size < capacity ){ size <<= 1; }
+        buffer.resize( size );
+        mask = size - 1;
+        writeIndex.store( 0 );
+        readIndex.store( 0 );
+    }
+
+    // producer side, returns false if the ring is full
+    bool push( const T & value ) noexcept {
+        size_t write = writeIndex.load( std::memory_order_relaxed );
+        if( write - readIndex.load( std::memory_order_acquire ) >= buffer.size() ){ return false; }
+        buffer[ write & mask ] = value;
+        writeIndex.store( write + 1, std::memory_order_release );
+        return true;
+    }
+
+    // consumer side, returns false if the ring is empty
+    bool pop( T & value ) noexcept {
+        size_t read = readIndex.load( std::memory_order_relaxed );
+        if( read == writeIndex.load( std::memory_order_acquire ) ){ return false; }
+        value = buffer[ read & mask ];
+        readIndex.store( read + 1, std::memory_order_release );
+        return true;
+    }
+
+    // consumer side, copies the next element without removing it, returns false if the ring is empty
+    bool peek( T & value ) const noexcept {
+        size_t read = readIndex.load( std::memory_order_relaxed );
+        if( read == writeIndex.load( std::memory_order_acquire ) ){ return false; }
+        value = buffer[ read & mask ];
+        return true;
+    }
+
+    // consumer side, elements ready to be popped
+    size_t available() const noexcept {
+        return writeIndex.load( std::memory_order_acquire ) - readIndex.load( std::memory_order_relaxed );
+    }
+
+    // consumer side, discards all the elements
+    void clear() noexcept {
+        readIndex.store( writeIndex.load( std::memory_order_acquire ), std::memory_order_release );
+    }
+
+    size_t capacity() const { return buffer.size(); }
+
+private:
+    std::vector<T>      buffer;
+    size_t              mask;
+    std::atomic<size_t> writeIndex;
+    std::atomic<size_t> readIndex;
+};
+
+}
+
+/*!
+    @endcond
+*/
+
+#endif // OFXPDSP_SPSCRING_H_INCLUDED
@@ -0,0 +1,492 @@
+
+#include "MidiFile.h"
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+pdsp::MidiFile::MidiFile(){
+    verbose = false;
+    fileFormat = 0;
+    division = 96;
+    lastTick = 0;
+    eventsCount = 0;
+    scanning = false;
+    tempoMapped = false;
+    tempo = 120.0;
+    streamed = nullptr;
+    windowSteps = 0.0;
+    windowStart = 0.0;
+    finished = true;
+}
+
+pdsp::MidiFile::~MidiFile(){
+    close();
+}
+
+void pdsp::MidiFile::setVerbose( bool verbose ){
+    this->verbose = verbose;
+}
+
+static uint32_t pdspReadBigEndian( std::ifstream & file, int bytes ){
+    uint32_t value = 0;
+    for( int i=0; i<bytes; ++i ){
+        value = (value << 8) | static_cast<uint8_t>( file.get() );
+    }
+    return value;
+}
+
+bool pdsp::MidiFile::open( std::string path ){
+
+    close();
+
+    file.open( path, std::ios::in | std::ios::binary );
+    if( !file.is_open() ){
+        std::cout<<"[pdsp] error opening midi file "<<path<<"\n";
+        pdsp_trace();
+        return false;
+    }
+
+    char id[4];
+    file.read( id, 4 );
+    uint32_t headerLength = pdspReadBigEndian( file, 4 );
+    if( !file.good() || std::strncmp( id, "MThd", 4 )!=0 || headerLength < 6 ){
+        std::cout<<"[pdsp] "<<path<<" is not a standard midi file\n";
+        pdsp_trace();
+        file.close();
+        return false;
+    }
+
+    fileFormat = pdspReadBigEndian( file, 2 );
+    int numTracks = pdspReadBigEndian( file, 2 );
+    division = pdspReadBigEndian( file, 2 );
+    file.seekg( headerLength - 6, std::ios::cur );
+
+    if( fileFormat > 1 || (division & 0x8000) || division == 0 ){
+        std::cout<<"[pdsp] midi file "<<path<<" not supported, only type 0 and 1 files with ticks per quarter timing can be loaded\n";
+        pdsp_trace();
+        file.close();
+        return false;
+    }
+
+    trackList.clear();
+    trackList.reserve( numTracks );
+
+    // registers the track chunks, unknown chunks are skipped
+    while( (int)trackList.size() < numTracks ){
+        file.read( id, 4 );
+        uint32_t chunkLength = pdspReadBigEndian( file, 4 );
+        if( !file.good() ){ break; }
+
+        std::streamoff start = file.tellg();
+        if( std::strncmp( id, "MTrk", 4 )==0 ){
+            Track track;
+            track.start = start;
+            track.end = start + chunkLength;
+            trackList.push_back( track );
+        }
+        file.seekg( start + chunkLength );
+    }
+
+    if( (int)trackList.size() != numTracks ){
+        std::cout<<"[pdsp] warning! midi file "<<path<<" is truncated, "<<trackList.size()<<" of "<<numTracks<<" tracks found\n";
+    }
+
+    this->path = path;
+
+    if( !scan() ){
+        std::cout<<"[pdsp] error reading midi file "<<path<<"\n";
+        pdsp_trace();
+        close();
+        return false;
+    }
+
+    if(verbose) std::cout<<"[pdsp] opened midi file "<<path<<" | format: "<<fileFormat<<" | tracks: "<<trackList.size()<<" | ticks per quarter: "<<division<<" | length: "<<lengthBars()<<" bars\n";
+
+    return true;
+}
+
+void pdsp::MidiFile::close(){
+    if( file.is_open() ){ file.close(); }
+    trackList.clear();
+    tempoMap.clear();
+    lastTick = 0;
+    eventsCount = 0;
+    streamed = nullptr;
+    finished = true;
+}
+
+bool pdsp::MidiFile::isOpen() const {
+    return file.is_open();
+}
+
+// reads all the tracks once without storing events, for building the tempo map and getting the file length
+bool pdsp::MidiFile::scan(){
+
+    tempoMap.clear();
+    lastTick = 0;
+    eventsCount = 0;
+
+    scanning = true;
+    rewind();
+    for( int t=0; t<(int)trackList.size(); ++t ){
+        file.clear();
+        file.seekg( trackList[t].pos );
+        while( nextEvent(t) ){
+            eventsCount++;
+        }
+        if( trackList[t].tick > lastTick ){ lastTick = trackList[t].tick; }
+    }
+    scanning = false;
+
+    std::stable_sort( tempoMap.begin(), tempoMap.end(), []( const TempoPoint & lhs, const TempoPoint & rhs ) noexcept {
+        return lhs.tick < rhs.tick;
+    });
+
+    if( tempoMap.empty() || tempoMap[0].tick != 0 ){
+        TempoPoint first;
+        first.tick = 0;
+        first.usecPerQuarter = 500000.0; // 120 bpm, SMF default
+        tempoMap.insert( tempoMap.begin(), first );
+    }
+
+    tempoMap[0].usec = 0.0;
+    for( size_t i=1; i<tempoMap.size(); ++i ){
+        double ticks = static_cast<double>( tempoMap[i].tick - tempoMap[i-1].tick );
+        tempoMap[i].usec = tempoMap[i-1].usec + ticks * tempoMap[i-1].usecPerQuarter / division;
+    }
+
+    rewind();
+
+    return !file.bad();
+}
+
+void pdsp::MidiFile::rewind(){
+    for( Track & track : trackList ){
+        track.pos = track.start;
+        track.tick = 0;
+        track.running = 0;
+        track.done = false;
+        track.hasEvent = false;
+    }
+    for( Mapping & mapping : mappings ){
+        for( size_t v=0; v<mapping.notes.size(); ++v ){
+            mapping.notes[v] = -1;
+            mapping.ages[v] = 0;
+        }
+        mapping.counter = 0;
+    }
+}
+
+bool pdsp::MidiFile::readVarLen( uint32_t & value ){
+    value = 0;
+    for( int i=0; i<4; ++i ){
+        int byte = file.get();
+        if( byte == std::char_traits<char>::eof() ){ return false; }
+        value = (value << 7) | (byte & 0x7F);
+        if( !(byte & 0x80) ){ return true; }
+    }
+    return false;
+}
+
+// reads the next channel event of the track into the peeked event, the file should already be at the track position
+bool pdsp::MidiFile::nextEvent( int t ){
+
+    Track & track = trackList[t];
+
+    while( !track.done ){
+
+        if( track.pos >= track.end ){
+            track.done = true;
+            break;
+        }
+
+        uint32_t delta;
+        if( !readVarLen( delta ) ){
+            track.done = true;
+            break;
+        }
+        track.tick += delta;
+
+        int byte = file.get();
+        if( byte == std::char_traits<char>::eof() ){
+            track.done = true;
+            break;
+        }
+        uint8_t status;
+        int data1 = -1;
+        if( byte & 0x80 ){
+            status = byte;
+        }else{
+            status = track.running; // running status
+            data1 = byte;
+        }
+
+        if( status == 0xFF ){ // meta event
+            int type = file.get();
+            uint32_t length;
+            if( !readVarLen( length ) ){
+                track.done = true;
+                break;
+            }
+            if( type == 0x51 && length == 3 && scanning ){
+                TempoPoint point;
+                point.tick = track.tick;
+                point.usecPerQuarter = pdspReadBigEndian( file, 3 );
+                point.usec = 0.0;
+                tempoMap.push_back( point );
+            }else{
+                file.seekg( length, std::ios::cur );
+            }
+            if( type == 0x2F ){ track.done = true; }
+            track.running = 0; // meta events cancel the running status
+            track.pos = file.tellg();
+
+        }else if( status == 0xF0 || status == 0xF7 ){ // sysex
+            uint32_t length;
+            if( !readVarLen( length ) ){
+                track.done = true;
+                break;
+            }
+            file.seekg( length, std::ios::cur );
+            track.running = 0; // sysex events cancel the running status
+            track.pos = file.tellg();
+
+        }else if( status & 0x80 ){ // channel event
+            track.running = status;
+            if( data1 < 0 ){ data1 = file.get(); }
+            int type = status & 0xF0;
+            int data2 = ( type == 0xC0 || type == 0xD0 ) ? 0 : file.get();
+
+            if( !file.good() ){
+                track.done = true;
+                break;
+            }
+
+            track.pos = file.tellg();
+            track.hasEvent = true;
+            track.status = status;
+            track.data1 = data1;
+            track.data2 = data2;
+            if( !scanning ){ track.step = tickToStep( track.tick ); }
+            return true;
+
+        }else{ // data byte without running status, corrupted track
+            if(verbose) std::cout<<"[pdsp] corrupted data in midi file track "<<t<<"\n";
+            track.done = true;
+        }
+    }
+
+    track.hasEvent = false;
+    return false;
+}
+
+double pdsp::MidiFile::tickToStep( uint64_t tick ) const {
+
+    if( !tempoMapped ){
+        return static_cast<double>( tick );
+    }
+
+    // last tempo point before the tick
+    size_t lo = 0;
+    size_t hi = tempoMap.size();
+    while( hi - lo > 1 ){
+        size_t mid = (lo + hi) / 2;
+        if( tempoMap[mid].tick <= tick ){ lo = mid; }else{ hi = mid; }
+    }
+    const TempoPoint & point = tempoMap[lo];
+
+    double usec = point.usec + static_cast<double>( tick - point.tick ) * point.usecPerQuarter / division;
+
+    // ticks at the given tempo
+    return usec * 0.000001 * ( tempo / 60.0 ) * division;
+}
+
+void pdsp::MidiFile::fillWindow( Sequence & sequence, double windowStart, double windowEnd ){
+
+    for( int t=0; t<(int)trackList.size(); ++t ){
+        Track & track = trackList[t];
+        if( track.done && !track.hasEvent ){ continue; }
+
+        file.clear();
+        file.seekg( track.pos );
+
+        while( true ){
+            if( !track.hasEvent && !nextEvent(t) ){ break; }
+            if( track.step >= windowEnd ){ break; }
+            processEvent( sequence, t, track.step - windowStart );
+            track.hasEvent = false;
+        }
+    }
+}
+
+void pdsp::MidiFile::processEvent( Sequence & sequence, int t, double time ){
+
+    const Track & track = trackList[t];
+    int type = track.status & 0xF0;
+    int channel = ( track.status & 0x0F ) + 1;
+
+    for( Mapping & mapping : mappings ){
+
+        if( mapping.track != t || ( mapping.channel >= 0 && mapping.channel != channel ) ){ continue; }
+
+        if( mapping.cc >= 0 ){
+            if( type == 0xB0 && track.data1 == mapping.cc ){
+                sequence.message( time, track.data2 * (1.0f/127.0f), mapping.lane );
+            }
+
+        }else if( type == 0x90 && track.data2 > 0 ){ // note on
+            int voice = 0;
+            for( int v=0; v<(int)mapping.notes.size(); ++v ){
+                if( mapping.notes[v] == -1 ){ voice = v; break; }
+                if( mapping.ages[v] < mapping.ages[voice] ){ voice = v; } // steal oldest
+            }
+            mapping.notes[voice] = track.data1;
+            mapping.ages[voice] = ++mapping.counter;
+            int lane = mapping.lane + voice*2;
+            sequence.message( time, track.data2 * (1.0f/127.0f), lane );
+            sequence.message( time, static_cast<float>( track.data1 ), lane+1 );
+
+        }else if( type == 0x80 || type == 0x90 ){ // note off
+            for( int v=0; v<(int)mapping.notes.size(); ++v ){
+                if( mapping.notes[v] == track.data1 ){
+                    mapping.notes[v] = -1;
+                    sequence.message( time, 0.0f, mapping.lane + v*2 );
+                    break;
+                }
+            }
+        }
+    }
+}
+
+bool pdsp::MidiFile::allTracksDone() const {
+    for( const Track & track : trackList ){
+        if( !track.done || track.hasEvent ){ return false; }
+    }
+    return true;
+}
+
+void pdsp::MidiFile::map( int track, int channel, int lane, int voices ){
+    if( voices < 1 ){ voices = 1; }
+    Mapping mapping;
+    mapping.track = track;
+    mapping.channel = channel;
+    mapping.cc = -1;
+    mapping.lane = lane;
+    mapping.notes.assign( voices, -1 );
+    mapping.ages.assign( voices, 0 );
+    mapping.counter = 0;
+    mappings.push_back( mapping );
+}
+
+void pdsp::MidiFile::mapCC( int track, int channel, int cc, int lane ){
+    Mapping mapping;
+    mapping.track = track;
+    mapping.channel = channel;
+    mapping.cc = cc;
+    mapping.lane = lane;
+    mapping.counter = 0;
+    mappings.push_back( mapping );
+}
+
+void pdsp::MidiFile::clearMappings(){
+    mappings.clear();
+}
+
+void pdsp::MidiFile::useTempoMap( float tempo ){
+    this->tempo = tempo;
+    tempoMapped = true;
+}
+
+void pdsp::MidiFile::useMusicalTime(){
+    tempoMapped = false;
+}
+
+bool pdsp::MidiFile::load( Sequence & sequence ){
+
+    if( !isOpen() ){
+        std::cout<<"[pdsp] warning! loading midi file into sequence but no file is opened\n";
+        pdsp_trace();
+        return false;
+    }
+
+    streamed = nullptr;
+    rewind();
+
+    double bars = std::ceil( lengthBars() );
+    sequence.steplen = 1.0 / ( 4.0 * division );
+    sequence.bars = ( bars > 1.0 ) ? bars : 1.0;
+
+    sequence.begin();
+    sequence.nextScore.reserve( eventsCount ); // one message for each channel event, only an estimate: note ons and multiple mappings add more
+    fillWindow( sequence, 0.0, std::numeric_limits<double>::infinity() );
+    sequence.end();
+
+    if(verbose) std::cout<<"[pdsp] loaded "<<sequence.nextScore.size()<<" messages from midi file "<<path<<"\n";
+
+    return true;
+}
+
+bool pdsp::MidiFile::stream( Sequence & sequence, double windowBars ){
+
+    if( !isOpen() ){
+        std::cout<<"[pdsp] warning! streaming midi file into sequence but no file is opened\n";
+        pdsp_trace();
+        return false;
+    }
+
+    rewind();
+
+    double steplen = 1.0 / ( 4.0 * division );
+    streamed = &sequence;
+    windowSteps = windowBars / steplen;
+    windowStart = 0.0;
+    finished = false;
+
+    sequence.steplen = steplen;
+    sequence.bars = windowBars;
+
+    sequence.begin();
+    fillWindow( sequence, windowStart, windowStart + windowSteps );
+    sequence.end();
+    windowStart += windowSteps;
+
+    return true;
+}
+
+void pdsp::MidiFile::update(){
+
+    // the window is written only when the previous one has been swapped in by the audio thread
+    if( streamed == nullptr || finished || streamed->modified.load() ){ return; }
+
+    streamed->begin();
+    if( allTracksDone() ){
+        finished = true; // an empty window, so the last one is not looped
+        if(verbose) std::cout<<"[pdsp] midi file "<<path<<" streaming completed\n";
+    }else{
+        fillWindow( *streamed, windowStart, windowStart + windowSteps );
+        windowStart += windowSteps;
+    }
+    streamed->end();
+}
+
+bool pdsp::MidiFile::streaming() const {
+    return ( streamed != nullptr && !finished );
+}
+
+int pdsp::MidiFile::format() const {
+    return fileFormat;
+}
+
+int pdsp::MidiFile::tracks() const {
+    return (int) trackList.size();
+}
+
+int pdsp::MidiFile::ticksPerQuarter() const {
+    return division;
+}
+
+double pdsp::MidiFile::lengthBars() const {
+    if( tempoMap.empty() ){ return 0.0; }
+    return tickToStep( lastTick ) / ( 4.0 * division );
+}
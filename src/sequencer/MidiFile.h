@@ -0,0 +1,206 @@
+
+// MidiFile.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_MIDIFILE_H_INCLUDED
+#define PDSP_MIDIFILE_H_INCLUDED
+
+#include "Sequence.h"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdint.h>
+
+namespace pdsp{
+
+    /*!
+    @brief Reads Standard MIDI Files (type 0 and 1) into a Sequence
+
+    MidiFile maps the notes and cc of the tracks/channels of a Standard MIDI File to the lanes of a Sequence. Notes are mapped to a couple of lanes for each voice, the first one is the gate (velocity scaled to 0.0f-1.0f, 0.0f for note off) and the second one is the pitch, so they can be directly patched with SequencerSection::out_trig() and SequencerSection::out_value() or to midi::Output::gate() and midi::Output::note(). The file ticks are directly used as steps of the Sequence.
+
+    The file can be loaded all at once with load() or streamed with stream(): in streaming mode only a window of bars is kept into the Sequence, and the next window is read from disk each time the Sequence restarts, so the memory used is bounded also for very long performances. When streaming you have to call update() regularly from the main thread (for example in the ofApp update() method).
+    */
+    class MidiFile {
+
+    private:
+        /*!
+            @cond HIDDEN_SYMBOLS
+        */
+        class Track {
+        public:
+            std::streamoff  start;
+            std::streamoff  end;
+            std::streamoff  pos;
+            uint64_t        tick;
+            uint8_t         running;
+            bool            done;
+
+            // peeked event
+            bool            hasEvent;
+            double          step;
+            uint8_t         status;
+            uint8_t         data1;
+            uint8_t         data2;
+        };
+
+        class TempoPoint {
+        public:
+            uint64_t    tick;
+            double      usecPerQuarter;
+            double      usec;
+        };
+
+        class Mapping {
+        public:
+            int track;
+            int channel;
+            int cc; // -1 for notes
+            int lane;
+            std::vector<int>        notes;
+            std::vector<uint64_t>   ages;
+            uint64_t                counter;
+        };
+        /*!
+            @endcond
+        */
+
+    public:
+        MidiFile();
+        ~MidiFile();
+
+        /*!
+        @brief opens the file, reads the header and the tempo map. Events are not loaded into memory. Returns true on success.
+        @param[in] path absolute or relative path to the .mid file
+        */
+        bool open( std::string path );
+
+        /*!
+        @brief closes the file and stops streaming.
+        */
+        void close();
+
+        /*!
+        @brief returns true if a file is opened
+        */
+        bool isOpen() const;
+
+        /*!
+        @brief maps the notes of the given track and channel to the lanes starting from the given one. For each voice two lanes are used, gate and pitch, so voice v is at lanes lane+2*v and lane+2*v+1.
+        @param[in] track index of the track in the file, for type 0 files it is always 0
+        @param[in] channel midi channel (1-16), a negative value maps all the channels of the track
+        @param[in] lane index of the first lane used
+        @param[in] voices number of voices, when a note is received and all the voices are busy the oldest voice is stolen. 1 if not given.
+        */
+        void map( int track, int channel, int lane, int voices=1 );
+
+        /*!
+        @brief maps a cc of the given track and channel to a lane, values are scaled to 0.0f-1.0f
+        @param[in] track index of the track in the file
+        @param[in] channel midi channel (1-16), a negative value maps all the channels of the track
+        @param[in] cc cc number
+        @param[in] lane lane for the cc values
+        */
+        void mapCC( int track, int channel, int cc, int lane );
+
+        /*!
+        @brief removes all the mappings
+        */
+        void clearMappings();
+
+        /*!
+        @brief by default the file ticks are mapped to steps with 4 quarters for each bar, ignoring the file tempo. After calling this method the ticks are converted with the file's tempo map, so that playing the sequence at the given tempo reproduces the original timing.
+        @param[in] tempo the tempo of the SequencerProcessor that will play the Sequence
+        */
+        void useTempoMap( float tempo );
+
+        /*!
+        @brief ticks are mapped to steps with 4 quarters for each bar, ignoring the file tempo. This is the default.
+        */
+        void useMusicalTime();
+
+        /*!
+        @brief loads all the mapped events into the Sequence, setting its steplen and length in bars. Returns false if no file is opened.
+        @param[in] sequence Sequence to fill
+        */
+        bool load( Sequence & sequence );
+
+        /*!
+        @brief starts streaming the file into the Sequence, setting its steplen and length. Only a window of the file is kept into the Sequence, the next window is loaded by update() when the Sequence restarts. The Sequence should be set to loop. Returns false if no file is opened.
+        @param[in] sequence Sequence to fill
+        @param[in] windowBars length of each window in bars, 4.0 if not given. Each window is loaded while the previous is playing, so it should be longer than the main thread refresh time.
+        */
+        bool stream( Sequence & sequence, double windowBars=4.0 );
+
+        /*!
+        @brief loads the next window of the file when streaming, you have to call it regularly from the main thread.
+        */
+        void update();
+
+        /*!
+        @brief returns true if the file is streaming and the end of the file hasn't been reached yet.
+        */
+        bool streaming() const;
+
+        /*!
+        @brief returns the file format, 0 or 1
+        */
+        int format() const;
+
+        /*!
+        @brief returns the number of tracks of the file
+        */
+        int tracks() const;
+
+        /*!
+        @brief returns the ticks per quarter note of the file
+        */
+        int ticksPerQuarter() const;
+
+        /*!
+        @brief returns the length of the file in bars, using the selected time conversion
+        */
+        double lengthBars() const;
+
+        /*!
+        @brief activate logging of file operations
+        @param[in] verbose
+        */
+        void setVerbose( bool verbose );
+
+    private:
+        bool    scan();
+        void    rewind();
+        bool    readVarLen( uint32_t & value );
+        bool    nextEvent( int t );
+        double  tickToStep( uint64_t tick ) const;
+        void    fillWindow( Sequence & sequence, double windowStart, double windowEnd );
+        void    processEvent( Sequence & sequence, int t, double time );
+        bool    allTracksDone() const;
+
+        std::ifstream           file;
+        std::string             path;
+        bool                    verbose;
+
+        int                     fileFormat;
+        int                     division;
+        uint64_t                lastTick;
+        size_t                  eventsCount;
+        bool                    scanning;
+
+        std::vector<Track>      trackList;
+        std::vector<TempoPoint> tempoMap;
+        std::vector<Mapping>    mappings;
+
+        bool                    tempoMapped;
+        double                  tempo;
+
+        Sequence*               streamed;
+        double                  windowSteps;
+        double                  windowStart;
+        bool                    finished;
+    };
+
+}
+
+#endif // PDSP_MIDIFILE_H_INCLUDED
@@ -0,0 +1,46 @@
+
+// PackedScore.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_PACKEDSCORE_H_INCLUDED
+#define PDSP_PACKEDSCORE_H_INCLUDED
+
+#include <stdint.h>
+
+namespace pdsp{
+
+    /*!
+    @brief compact score message, as stored into a ScoreLibrary file.
+
+    Each message is 8 bytes: the time distance from the previous message in ticks is stored into the upper 24 bits of timeLane and the lane into the lower 8 bits. The lane PDSP_PACKED_SKIP_LANE is reserved for messages that only advance the time.
+    */
+    class PackedMessage {
+    public:
+        uint32_t    timeLane;
+        float       value;
+
+        inline uint32_t delta() const { return timeLane >> 8; }
+        inline int      lane() const { return static_cast<int>( timeLane & 0xFF ); }
+    };
+
+    /*!
+    @brief read-only view of a packed score, it doesn't own the messages. You get it from ScoreLibrary and play it with Sequence::set( const PackedScore & score ).
+    */
+    class PackedScore {
+    public:
+        PackedScore() : messages(nullptr), size(0), bars(1.0), barsPerTick(0.0), label(nullptr) {};
+
+        const PackedMessage*    messages;
+        int                     size;
+        double                  bars;
+        double                  barsPerTick;
+        const char*             label;
+    };
+
+}
+
+#define PDSP_PACKED_SKIP_LANE 0xFF
+#define PDSP_PACKED_MAX_DELTA 0xFFFFFF
+
+#endif // PDSP_PACKEDSCORE_H_INCLUDED
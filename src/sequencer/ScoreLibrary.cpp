@@ -0,0 +1,246 @@
+
+#include "ScoreLibrary.h"
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cmath>
+
+#define PDSP_SCORELIBRARY_VERSION 1
+#define PDSP_SCORELIBRARY_BYTEORDER 0x01020304
+
+namespace pdsp{
+    // file layout: header, index entries, then labels and messages of each score (8 bytes aligned)
+    struct ScoreLibraryHeader {
+        char        magic[8];
+        uint32_t    version;
+        uint32_t    byteOrder;
+        uint32_t    count;
+        uint32_t    ticksPerBar;
+        uint64_t    reserved;
+    };
+
+    struct ScoreLibraryEntry {
+        uint64_t    messagesOffset;
+        uint64_t    labelOffset;
+        uint32_t    messages;
+        uint32_t    reserved;
+        double      bars;
+    };
+}
+
+static const char pdspScoreLibraryMagic[8] = { 'P', 'D', 'S', 'P', 'S', 'C', 'O', 'R' };
+
+pdsp::ScoreLibrary::ScoreLibrary(){
+    data = nullptr;
+    length = 0;
+    verbose = false;
+}
+
+pdsp::ScoreLibrary::~ScoreLibrary(){
+    close();
+}
+
+void pdsp::ScoreLibrary::setVerbose( bool verbose ){
+    this->verbose = verbose;
+}
+
+static void pdspPad8( std::ofstream & file ){
+    static const char zeros[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    std::streamoff pos = file.tellp();
+    if( pos % 8 ){ file.write( zeros, 8 - pos % 8 ); }
+}
+
+bool pdsp::ScoreLibrary::save( std::string path, const std::vector<Sequence*> & sequences, int ticksPerBar ){
+
+    std::ofstream file( path, std::ios::out | std::ios::binary | std::ios::trunc );
+    if( !file.is_open() ){
+        std::cout<<"[pdsp] error opening "<<path<<" for writing score library\n";
+        pdsp_trace();
+        return false;
+    }
+
+    ScoreLibraryHeader header;
+    std::memcpy( header.magic, pdspScoreLibraryMagic, 8 );
+    header.version = PDSP_SCORELIBRARY_VERSION;
+    header.byteOrder = PDSP_SCORELIBRARY_BYTEORDER;
+    header.count = (uint32_t) sequences.size();
+    header.ticksPerBar = ticksPerBar;
+    header.reserved = 0;
+    file.write( reinterpret_cast<const char*>( &header ), sizeof(ScoreLibraryHeader) );
+
+    std::vector<ScoreLibraryEntry> index( sequences.size() );
+    file.write( reinterpret_cast<const char*>( index.data() ), sizeof(ScoreLibraryEntry) * index.size() ); // rewritten at the end
+
+    std::vector<SequencerMessage> messages;
+    bool lanesWarning = false;
+
+    for( size_t i=0; i<sequences.size(); ++i ){
+        const Sequence & seq = *sequences[i];
+
+        // messages in bars, taken from the score that will be played next
+        messages.clear();
+        if( seq.modified ){
+            if( seq.nextPacked.messages != nullptr ){
+                uint64_t ticks = 0;
+                for( int m=0; m<seq.nextPacked.size; ++m ){
+                    ticks += seq.nextPacked.messages[m].delta();
+                    if( seq.nextPacked.messages[m].lane() != PDSP_PACKED_SKIP_LANE ){
+                        messages.push_back( SequencerMessage( ticks * seq.nextPacked.barsPerTick, seq.nextPacked.messages[m].value, seq.nextPacked.messages[m].lane() ) );
+                    }
+                }
+            }else{
+                messages = seq.nextScore;
+                for( SequencerMessage & msg : messages ){ msg.time *= seq.steplen; }
+            }
+        }else{
+            if( seq.packed.messages != nullptr ){
+                uint64_t ticks = 0;
+                for( int m=0; m<seq.packed.size; ++m ){
+                    ticks += seq.packed.messages[m].delta();
+                    if( seq.packed.messages[m].lane() != PDSP_PACKED_SKIP_LANE ){
+                        messages.push_back( SequencerMessage( ticks * seq.packed.barsPerTick, seq.packed.messages[m].value, seq.packed.messages[m].lane() ) );
+                    }
+                }
+            }else{
+                messages = seq.score;
+            }
+        }
+        std::stable_sort( messages.begin(), messages.end(), messageSort );
+
+        index[i].labelOffset = file.tellp();
+        file.write( seq.label.c_str(), seq.label.size()+1 );
+        pdspPad8( file );
+
+        index[i].messagesOffset = file.tellp();
+        index[i].bars = seq.bars.load();
+        index[i].reserved = 0;
+
+        uint32_t count = 0;
+        uint64_t lastTick = 0;
+        for( const SequencerMessage & msg : messages ){
+            if( msg.lane < 0 || msg.lane >= PDSP_PACKED_SKIP_LANE ){
+                lanesWarning = true;
+                continue;
+            }
+            double time = ( msg.time > 0.0 ) ? msg.time : 0.0;
+            uint64_t tick = static_cast<uint64_t>( std::llround( time * ticksPerBar ) );
+            if( tick < lastTick ){ tick = lastTick; }
+            uint64_t delta = tick - lastTick;
+
+            PackedMessage packed;
+            while( delta > PDSP_PACKED_MAX_DELTA ){ // time only messages for long distances
+                packed.timeLane = ( PDSP_PACKED_MAX_DELTA << 8 ) | PDSP_PACKED_SKIP_LANE;
+                packed.value = 0.0f;
+                file.write( reinterpret_cast<const char*>( &packed ), sizeof(PackedMessage) );
+                delta -= PDSP_PACKED_MAX_DELTA;
+                count++;
+            }
+            packed.timeLane = ( static_cast<uint32_t>( delta ) << 8 ) | static_cast<uint32_t>( msg.lane );
+            packed.value = msg.value;
+            file.write( reinterpret_cast<const char*>( &packed ), sizeof(PackedMessage) );
+            count++;
+            lastTick = tick;
+        }
+        index[i].messages = count;
+    }
+
+    if( lanesWarning ){
+        std::cout<<"[pdsp] warning! score library supports lanes from 0 to "<<PDSP_PACKED_SKIP_LANE-1<<", messages outside this range were not saved\n";
+    }
+
+    file.seekp( sizeof(ScoreLibraryHeader) );
+    file.write( reinterpret_cast<const char*>( index.data() ), sizeof(ScoreLibraryEntry) * index.size() );
+
+    bool success = file.good();
+    file.close();
+    if( !success ){
+        std::cout<<"[pdsp] error writing score library "<<path<<"\n";
+        pdsp_trace();
+    }
+    return success;
+}
+
+bool pdsp::ScoreLibrary::open( std::string path ){
+
+    close();
+
+    if( !file.open( path ) ){
+        std::cout<<"[pdsp] error mapping score library "<<path<<"\n";
+        pdsp_trace();
+        return false;
+    }
+    data = file.data();
+    length = file.size();
+
+    const ScoreLibraryHeader* header = reinterpret_cast<const ScoreLibraryHeader*>( data );
+
+    if( length < sizeof(ScoreLibraryHeader)
+        || std::memcmp( header->magic, pdspScoreLibraryMagic, 8 )!=0
+        || header->byteOrder != PDSP_SCORELIBRARY_BYTEORDER
+        || sizeof(ScoreLibraryHeader) + header->count * sizeof(ScoreLibraryEntry) > length ){
+        std::cout<<"[pdsp] "<<path<<" is not a valid score library\n";
+        pdsp_trace();
+        close();
+        return false;
+    }
+
+    if( header->version != PDSP_SCORELIBRARY_VERSION ){
+        std::cout<<"[pdsp] score library "<<path<<" has version "<<header->version<<", only version "<<PDSP_SCORELIBRARY_VERSION<<" is supported\n";
+        pdsp_trace();
+        close();
+        return false;
+    }
+
+    if(verbose) std::cout<<"[pdsp] opened score library "<<path<<" | scores: "<<header->count<<" | ticks per bar: "<<header->ticksPerBar<<"\n";
+
+    return true;
+}
+
+void pdsp::ScoreLibrary::close(){
+    file.close();
+    data = nullptr;
+    length = 0;
+}
+
+bool pdsp::ScoreLibrary::isOpen() const {
+    return data != nullptr;
+}
+
+int pdsp::ScoreLibrary::size() const {
+    if( data == nullptr ){ return 0; }
+    return (int) reinterpret_cast<const ScoreLibraryHeader*>( data )->count;
+}
+
+pdsp::PackedScore pdsp::ScoreLibrary::score( int index ) const {
+
+    PackedScore result;
+
+    if( index < 0 || index >= size() ){
+        std::cout<<"[pdsp] wrong index for getting score from library, returning empty score\n";
+        pdsp_trace();
+        return result;
+    }
+
+    const ScoreLibraryHeader* header = reinterpret_cast<const ScoreLibraryHeader*>( data );
+    const ScoreLibraryEntry* entry = reinterpret_cast<const ScoreLibraryEntry*>( data + sizeof(ScoreLibraryHeader) ) + index;
+
+    if( entry->messagesOffset + (uint64_t) entry->messages * sizeof(PackedMessage) > length || entry->labelOffset >= length ){
+        std::cout<<"[pdsp] score "<<index<<" of library is corrupted, returning empty score\n";
+        pdsp_trace();
+        return result;
+    }
+
+    result.messages = reinterpret_cast<const PackedMessage*>( data + entry->messagesOffset );
+    result.size = entry->messages;
+    result.bars = entry->bars;
+    result.barsPerTick = 1.0 / header->ticksPerBar;
+    result.label = reinterpret_cast<const char*>( data + entry->labelOffset );
+    return result;
+}
+
+std::string pdsp::ScoreLibrary::label( int index ) const {
+    PackedScore s = score( index );
+    if( s.label == nullptr ){ return ""; }
+    return std::string( s.label );
+}
@@ -0,0 +1,86 @@
+
+// ScoreLibrary.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_SCORELIBRARY_H_INCLUDED
+#define PDSP_SCORELIBRARY_H_INCLUDED
+
+#include "PackedScore.h"
+#include "Sequence.h"
+#include "../DSP/helpers/MappedFile.h"
+#include <vector>
+#include <string>
+
+namespace pdsp{
+
+    /*!
+    @brief Read-only, memory-mapped library of compact scores
+
+    A ScoreLibrary is a binary file containing many scores (for example all the songs of a set list) in a compact format: 8 bytes for each message, with times delta-encoded as ticks and lanes quantized to 8 bits. The file is memory-mapped when opened, so opening doesn't depend on the library size and the scores are played directly from the mapped memory with Sequence::set( const PackedScore & score ), without any parsing or allocation. Changing song is just setting a different PackedScore. You create the library files with save().
+    */
+    class ScoreLibrary {
+
+    public:
+        ScoreLibrary();
+        ~ScoreLibrary();
+        ScoreLibrary( const ScoreLibrary & other ) = delete;
+        ScoreLibrary& operator= ( const ScoreLibrary & other ) = delete;
+
+        /*!
+        @brief saves the scores of the given sequences to a library file. The sequences labels are saved as score labels. Returns true on success.
+        @param[in] path path of the file to write
+        @param[in] sequences sequences to save, each one becomes a score of the library
+        @param[in] ticksPerBar time resolution of the saved scores, 3840 if not given
+        */
+        static bool save( std::string path, const std::vector<Sequence*> & sequences, int ticksPerBar = 3840 );
+
+        /*!
+        @brief maps the library file into memory, returns true on success.
+        @param[in] path path of the library file
+        */
+        bool open( std::string path );
+
+        /*!
+        @brief unmaps the library file. Sequences that are still playing scores of this library should be stopped or set to something else before closing it.
+        */
+        void close();
+
+        /*!
+        @brief returns true if a library file is opened
+        */
+        bool isOpen() const;
+
+        /*!
+        @brief returns the number of scores of the library
+        */
+        int size() const;
+
+        /*!
+        @brief returns the score with the given index, the returned score is empty for invalid indices. Constant time.
+        @param[in] index index of the score
+        */
+        PackedScore score( int index ) const;
+
+        /*!
+        @brief returns the label of the score with the given index
+        @param[in] index index of the score
+        */
+        std::string label( int index ) const;
+
+        /*!
+        @brief activate logging of file operations
+        @param[in] verbose
+        */
+        void setVerbose( bool verbose );
+
+    private:
+        MappedFile      file;
+        const uint8_t*  data;
+        size_t          length;
+        bool            verbose;
+    };
+
+}
+
+#endif // PDSP_SCORELIBRARY_H_INCLUDED
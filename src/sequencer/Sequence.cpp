@@ -45,6 +45,8 @@ pdsp::Sequence::Sequence(const Sequence & other) {
     score = other.score;
     nextScore.reserve(PDSP_PATTERN_MESSAGE_RESERVE_DEFAULT);
     nextScore = other.nextScore;
+    packed = other.packed;
+    nextPacked = other.nextPacked;
     code = other.code;
     label = other.label;
     bars.store( other.bars.load() );
@@ -56,6 +58,8 @@ pdsp::Sequence::Sequence(Sequence && other) {
     score = other.score;
     nextScore.reserve(PDSP_PATTERN_MESSAGE_RESERVE_DEFAULT);
     nextScore = other.nextScore;
+    packed = other.packed;
+    nextPacked = other.nextPacked;
     code = other.code;
     label = other.label;
     bars.store( other.bars.load() );
@@ -67,6 +71,8 @@ pdsp::Sequence& pdsp::Sequence::operator= (const Sequence & other) {
     score = other.score;
     nextScore.reserve(PDSP_PATTERN_MESSAGE_RESERVE_DEFAULT);
     nextScore = other.nextScore;
+    packed = other.packed;
+    nextPacked = other.nextPacked;
     code = other.code;
     label = other.label;
     bars.store( other.bars.load() );
@@ -79,6 +85,8 @@ pdsp::Sequence& pdsp::Sequence::operator= (Sequence && other) {
     score = other.score;
     nextScore.reserve(PDSP_PATTERN_MESSAGE_RESERVE_DEFAULT);
     nextScore = other.nextScore;
+    packed = other.packed;
+    nextPacked = other.nextPacked;
     code = other.code;
     label = other.label;
     bars.store( other.bars.load() );
@@ -94,6 +102,7 @@ void pdsp::Sequence::set( std::initializer_list<float> init ) noexcept {
     }
     
     nextScore.clear();
+    nextPacked = PackedScore();
     
     double time=0.0;
     for (const float & value : init){
@@ -114,6 +123,7 @@ void pdsp::Sequence::set( std::initializer_list<std::initializer_list<float> >
     }
 
     nextScore.clear();
+    nextPacked = PackedScore();
 
     int out = 0;
     for(const std::initializer_list<float> & list : init){
@@ -143,14 +153,29 @@ void pdsp::Sequence::set(  std::initializer_list<std::initializer_list<float> >
 }
 
 
+void pdsp::Sequence::set( const PackedScore & score ) noexcept{
+    if(modified==true){
+        std::cout<<"[pdsp] warning! you have already set this Sequence, but it hasn't been processed yet, please set it once and wait for the changes to be effective before setting it again to avoid race conditions!\n";
+        pdsp_trace();
+    }
+    
+    nextScore.clear();
+    nextPacked = score;
+    setLength(score.bars);
+    
+    modified = true;
+}
+
 void pdsp::Sequence::begin() noexcept{
     nextScore.clear();
+    nextPacked = PackedScore();
 }
 
 void pdsp::Sequence::begin( double division, double length ) noexcept{
     setDivision(division);
     setLength(length);
     nextScore.clear();
+    nextPacked = PackedScore();
 }
 
 void pdsp::Sequence::message(double step, float value, int outputIndex) noexcept {
@@ -230,6 +255,7 @@ void pdsp::Sequence::executeGenerateScore() noexcept {
     code();
     if(modified){
         score.swap( nextScore ); // swap score in a thread-safe section
+        packed = nextPacked;
         std::sort (score.begin(), score.end(), messageSort); //sort the messages
         for( size_t i=0; i<score.size(); ++i){
             score[i].time *= steplen;
@@ -7,6 +7,7 @@
 #define PDSP_SEQUENCE_H_INCLUDED
 
 #include "SequencerMessage.h"
+#include "PackedScore.h"
 #include <functional>
 #include <atomic>
 #include <iostream>
@@ -21,6 +22,8 @@ namespace pdsp{
     class Sequence {
         friend class SequencerSection;
         friend class SequencerProcessor;
+        friend class MidiFile;
+        friend class ScoreLibrary;
     public:
         Sequence( double stepDivision );
         Sequence();
@@ -93,6 +96,12 @@ namespace pdsp{
         
         */
         void set( std::initializer_list<std::initializer_list<float> >  init , double division, double length  ) noexcept;
+
+        /*!
+        @brief sets the sequence to play a packed score, usually taken from a ScoreLibrary. The messages are not copied, so the ScoreLibrary should stay opened while the Sequence is playing. The length of the Sequence is set to the length of the score.
+        @param[in] score packed score to play
+        */
+        void set( const PackedScore & score ) noexcept;
    
         
         
@@ -232,6 +241,8 @@ namespace pdsp{
         
         std::vector<SequencerMessage> score;   
         std::vector<SequencerMessage> nextScore;
+        PackedScore packed;
+        PackedScore nextPacked;
         std::atomic<bool> modified;
 
         int id;
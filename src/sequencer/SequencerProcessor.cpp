@@ -16,6 +16,8 @@ pdsp::SequencerProcessor::SequencerProcessor(){
     clearToken = 0;
     
     playhead_meter.store(0.0f);
+    tempo_meter.store(120.0f);
+    tempoMapped = false;
     
     sections.clear();
     sections.reserve(16);
@@ -42,6 +44,8 @@ void pdsp::SequencerProcessor::setMaxBars(double maxBars){
 
 void pdsp::SequencerProcessor::process(int const &bufferSize) noexcept{
    
+    tempoMap.update();
+
     if( playing.load() ){
         
         if(newPlayHead >= 0.0f){
@@ -51,14 +55,35 @@ void pdsp::SequencerProcessor::process(int const &bufferSize) noexcept{
     
         playHead = playHeadEnd;
         if( playHead > maxBars ) { playHead -= maxBars; } //wrap score
-        double playHeadDifference = bufferSize * barsPerSample;
+
+        double playHeadDifference;
+        double blockBarsPerSample;
+        
+        if( !tempoMap.empty() ){
+            // the block range is taken from the tempo map, inside the block the mean tempo is used
+            playHeadDifference = tempoMap.advance( playHead, bufferSize );
+            blockBarsPerSample = playHeadDifference / bufferSize;
+            Clockable::globalTempo = tempoMap.currentTempo();
+            Clockable::barTimeMs = (60000.0f * 4.0f) / Clockable::globalTempo;
+            Clockable::masterInc = blockBarsPerSample;
+            tempoMapped = true;
+        }else{
+            if( tempoMapped ){ // map cleared, back to the set tempo
+                Clockable::setTempo(tempo);
+                tempoMapped = false;
+            }
+            playHeadDifference = bufferSize * barsPerSample;
+            blockBarsPerSample = barsPerSample;
+        }
+        
         playHeadEnd = playHead + playHeadDifference;
 
         playhead_meter.store(playHead);
+        tempo_meter.store(Clockable::globalTempo);
         
         //now process sections-----------------
         for(SequencerSection &sect : sections){
-            sect.processSection(playHead, playHeadEnd, playHeadDifference, maxBars, barsPerSample, bufferSize);
+            sect.processSection(playHead, playHeadEnd, playHeadDifference, maxBars, blockBarsPerSample, bufferSize);
         }
         //---------------------------------
 
@@ -79,6 +104,7 @@ void pdsp::SequencerProcessor::process(int const &bufferSize) noexcept{
 
 void pdsp::SequencerProcessor::prepareToPlay( int expectedBufferSize, double sampleRate ){
     this->sampleRate = sampleRate;
+    tempoMap.setSampleRate(sampleRate);
     setTempo(tempo);
 }
 
@@ -116,6 +142,7 @@ void pdsp::SequencerProcessor::stop(){
 
     for(SequencerSection &sect : sections){
         sect.scoreIndex = 0;
+        sect.packedTicks = 0;
         //double oldPlayhead = sect.scorePlayHead ;
         sect.scorePlayHead = 0.0;
         //sect.scheduledTime -= oldPlayhead;
@@ -135,6 +162,10 @@ float pdsp::SequencerProcessor::meter_playhead(){
     return playhead_meter.load();
 }
 
+float pdsp::SequencerProcessor::meter_tempo() const {
+    return tempo_meter.load();
+}
+
 double pdsp::SequencerProcessor::getMaxBars() const{
     return maxBars;
 }
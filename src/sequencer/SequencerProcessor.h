@@ -9,6 +9,7 @@
 #include "../messages/header.h"
 #include "../DSP/pdspCore.h"
 #include "SequencerSection.h"
+#include "TempoMap.h"
 #include <vector>
 
 
@@ -20,6 +21,8 @@ namespace pdsp{
     */ 
     
 class SequencerProcessor : public Preparable {
+    friend class StemRenderer;
+    
 public:    
     SequencerProcessor();
     
@@ -28,6 +31,16 @@ public:
     @param tempo tempo to set
     */ 
     void setTempo( float tempo );
+
+    /*!
+    @brief tempo changes and ramps, when the map has points it is used instead of the tempo given with setTempo(). The Clockable units follow the tempo of the map at each buffer.
+    */
+    TempoMap tempoMap;
+
+    /*!
+    @brief returns the tempo used for the last processed buffer. Thread-safe.
+    */
+    float meter_tempo() const;
     
     
 /*!
@@ -149,6 +162,8 @@ private:
     std::mutex playheadMutex;
     
     std::atomic<float> playhead_meter;
+    std::atomic<float> tempo_meter;
+    bool tempoMapped;
     int clearToken;
     
 };
@@ -20,6 +20,7 @@ pdsp::SequencerSection::SequencerSection() {
     patternIndex = -1;
     scorePlayHead = 0.0;
     scoreIndex = 0;
+    packedTicks = 0;
     clearOnChangeFlag = true;
     run = false; //change to false in definitive version
     clear = true;
@@ -274,6 +275,11 @@ void pdsp::SequencerSection::playScore(double const &range, double const &offset
         
     double patternMax = scorePlayHead + range - offset;
     
+    if( patternToProcess->packed.messages != nullptr ){ 
+        playPackedScore( patternToProcess->packed, patternMax, offset, oneSlashBarsPerSample );
+        return;
+    }
+    
     while( (scoreIndex < patternToProcess->score.size()) && (patternToProcess->score[scoreIndex].time < patternMax) ){
         
         if( (patternToProcess->score[scoreIndex].time >= scorePlayHead) && (patternToProcess->score[scoreIndex].lane < (int)outputs.size() )   ){ //check if we are inside the outputs boundaries and inside the processed time
@@ -289,11 +295,36 @@ void pdsp::SequencerSection::playScore(double const &range, double const &offset
     scorePlayHead = patternMax;
 }
 
+// packed scores are decoded sequentially, packedTicks is the time of the last decoded message
+void pdsp::SequencerSection::playPackedScore(const PackedScore &score, double const &patternMax, double const &offset, const double &oneSlashBarsPerSample) noexcept{
+
+    while( scoreIndex < score.size ){
+        
+        const PackedMessage & msg = score.messages[scoreIndex];
+        uint64_t ticks = packedTicks + msg.delta();
+        double time = ticks * score.barsPerTick;
+        
+        if( time >= patternMax ) break;
+        
+        int lane = msg.lane();
+        if( time >= scorePlayHead && lane != PDSP_PACKED_SKIP_LANE && lane < (int)outputs.size() ){
+            int sample = static_cast<int>( (time - scorePlayHead + offset) * oneSlashBarsPerSample);
+            outputs[lane]->addMessage(msg.value, sample);
+        }
+        
+        packedTicks = ticks;
+        scoreIndex++;
+    }
+    
+    scorePlayHead = patternMax;
+}
+
 void pdsp::SequencerSection::onSchedule() noexcept{
     
     //clear score--------------------------------------------------------------------------
     //score.clear(); //clear score buffer
     scoreIndex = 0;
+    packedTicks = 0;
     
     //clip change routines--------------------------------------------------------------------------
     bool reset = ( patternIndex != scheduledPattern ) ? true : false;
@@ -330,6 +330,7 @@ private:
     
 
     void playScore(double const &range, double const &offset, const double &oneSlashBarsPerSample) noexcept;
+    void playPackedScore(const PackedScore &score, double const &patternMax, double const &offset, const double &oneSlashBarsPerSample) noexcept;
     void allNoteOff(double const &offset, const double &oneSlashBarsPerSample) noexcept;
     void onSchedule() noexcept;
     void clearBuffers() noexcept;
@@ -353,6 +354,7 @@ private:
     
     double                      scorePlayHead; //position inside the actual clip
     int                         scoreIndex;
+    uint64_t                    packedTicks;
   
     bool                        run;
     bool                        clear;
@@ -0,0 +1,201 @@
+
+#include "StemRenderer.h"
+#include <iostream>
+#include <cmath>
+
+pdsp::StemRenderer::StemRenderer(){
+    channelsNum = 2;
+    samples = 0;
+    blockPosition = 0;
+    blockSize = 0;
+    nextStem = 0;
+    generation = 0;
+    pending = 0;
+    running = false;
+}
+
+pdsp::StemRenderer::~StemRenderer(){
+    stopWorkers();
+}
+
+void pdsp::StemRenderer::resize( int stems, int channels ){
+    this->stems.resize( stems );
+    for( Processor & stem : this->stems ){
+        stem.resize( channels );
+    }
+    channelsNum = channels;
+    buffers.clear();
+    pointers.clear();
+    samples = 0;
+}
+
+bool pdsp::StemRenderer::render( SequencerProcessor & sequencer, double bars, double sampleRate, int bufferSize, int threads ){
+
+    if( stems.empty() ){
+        std::cout<<"[pdsp] warning! no stems to render, call resize() and patch the stems before rendering\n";
+        pdsp_trace();
+        return false;
+    }
+    if( bars <= 0.0 || bufferSize <= 0 ){
+        std::cout<<"[pdsp] warning! wrong bars or buffer size for rendering stems\n";
+        pdsp_trace();
+        return false;
+    }
+
+    if( threads <= 0 ){
+        threads = std::thread::hardware_concurrency();
+        if( threads <= 0 ){ threads = 1; }
+    }
+    if( threads > (int) stems.size() ){ threads = stems.size(); }
+
+    prepareAllToPlay( bufferSize, sampleRate );
+
+    buffers.resize( stems.size() );
+    pointers.resize( stems.size() );
+    size_t expected = static_cast<size_t>( bars / sequencer.barsPerSample ) + bufferSize;
+    for( size_t i=0; i<stems.size(); ++i ){
+        buffers[i].resize( channelsNum );
+        pointers[i].resize( channelsNum );
+        for( std::vector<float> & channel : buffers[i] ){
+            channel.clear();
+            channel.reserve( expected );
+        }
+    }
+    samples = 0;
+
+    sequencer.stop();
+    sequencer.play();
+
+    startWorkers( threads - 1 );
+
+    double rendered = 0.0;
+    int last = bufferSize;
+
+    while( rendered < bars ){
+
+        for( auto & stem : buffers ){
+            for( std::vector<float> & channel : stem ){
+                channel.resize( samples + bufferSize );
+            }
+        }
+
+        // the transport is advanced once for all the stems
+        Processor::nextTurn( bufferSize );
+        sequencer.process( bufferSize );
+        double blockBars = sequencer.playHeadEnd - sequencer.playHead;
+
+        if( rendered + blockBars > bars && blockBars > 0.0 ){
+            last = static_cast<int>( std::ceil( ( bars - rendered ) * bufferSize / blockBars ) );
+        }
+        rendered += blockBars;
+
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            blockPosition = samples;
+            blockSize = bufferSize;
+            nextStem = 0;
+            pending = workers.size();
+            generation++;
+        }
+        startCondition.notify_all();
+
+        renderStems(); // this thread renders stems too
+
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            doneCondition.wait( lock, [&]{ return pending == 0; } );
+        }
+
+        samples += bufferSize;
+    }
+
+    stopWorkers();
+    sequencer.stop();
+
+    samples -= bufferSize - last;
+    for( auto & stem : buffers ){
+        for( std::vector<float> & channel : stem ){
+            channel.resize( samples );
+        }
+    }
+
+    return true;
+}
+
+void pdsp::StemRenderer::renderStems() noexcept {
+    int i;
+    while( ( i = nextStem.fetch_add( 1 ) ) < (int) stems.size() ){
+        for( int c=0; c<channelsNum; ++c ){
+            pointers[i][c] = buffers[i][c].data() + blockPosition;
+        }
+        stems[i].processTurnAndCopyOutput( pointers[i].data(), channelsNum, blockSize );
+    }
+}
+
+void pdsp::StemRenderer::worker(){
+#ifndef PDSP_AUDIO_PLUGIN    
+    ofx_activate_denormal_flush();
+#endif
+    int done = 0;
+    while( true ){
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            startCondition.wait( lock, [&]{ return generation != done || !running; } );
+            if( !running ){ return; }
+            done = generation;
+        }
+
+        renderStems();
+
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            pending--;
+            if( pending == 0 ){ doneCondition.notify_one(); }
+        }
+    }
+}
+
+void pdsp::StemRenderer::startWorkers( int threads ){
+    stopWorkers();
+    running = true;
+    generation = 0;
+    for( int i=0; i<threads; ++i ){
+        workers.push_back( std::thread( &StemRenderer::worker, this ) );
+    }
+}
+
+void pdsp::StemRenderer::stopWorkers(){
+    {
+        std::unique_lock<std::mutex> lock( mutex );
+        running = false;
+    }
+    startCondition.notify_all();
+    for( std::thread & thread : workers ){
+        thread.join();
+    }
+    workers.clear();
+}
+
+const std::vector<float> & pdsp::StemRenderer::stem( int stem, int channel ) const {
+    if( stem < 0 || stem >= (int) buffers.size() || channel < 0 || channel >= (int) buffers[stem].size() ){
+        std::cout<<"[pdsp] warning! wrong stem or channel index, returning empty buffer\n";
+        pdsp_trace();
+        return empty;
+    }
+    return buffers[stem][channel];
+}
+
+std::vector<float> pdsp::StemRenderer::mix( int channel ) const {
+    std::vector<float> result( samples, 0.0f );
+    for( const auto & stem : buffers ){
+        if( channel >= 0 && channel < (int) stem.size() ){
+            const float* source = stem[channel].data();
+            for( int n=0; n<samples; ++n ){ result[n] += source[n]; }
+        }
+    }
+    return result;
+}
+
+int pdsp::StemRenderer::size() const {
+    return samples;
+}
@@ -0,0 +1,102 @@
+
+// StemRenderer.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_STEMRENDERER_H_INCLUDED
+#define PDSP_STEMRENDERER_H_INCLUDED
+
+#include "SequencerProcessor.h"
+#include "../DSP/core/Processor.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace pdsp{
+
+    /*!
+    @brief Offline bounce of a SequencerProcessor, with the stems rendered in parallel
+
+    Each stem is a Processor, you patch to its channels the Units driven by one SequencerSection (usually one instrument). When you call render() the sequencer is advanced once for each buffer, then the stems are processed by a pool of threads and recorded into separate buffers. You can read each stem and mix them at the end. The stems are processed at the same time, so they shouldn't share any Unit: keep master effects out of the stems and process them on the mix. Rendering uses the global transport and the same Units of the audio engine, so the engine shouldn't be running while rendering.
+    */
+    class StemRenderer {
+
+    public:
+        StemRenderer();
+        ~StemRenderer();
+        StemRenderer( const StemRenderer & other ) = delete;
+        StemRenderer& operator= ( const StemRenderer & other ) = delete;
+
+        /*!
+        @brief sets the number of stems and their channels, call it before patching the stems as it reallocates the Processors.
+        @param[in] stems number of stems, usually the number of sections of the sequencer
+        @param[in] channels number of channels of each stem, 2 if not given
+        */
+        void resize( int stems, int channels = 2 );
+
+        /*!
+        @brief you patch the Units of each stem to the channels of its Processor
+        */
+        std::vector<Processor> stems;
+
+        /*!
+        @brief restarts the sequencer from the start and renders the given bars, returns true on success. All the Units are prepared again with the given sample rate and buffer size.
+        @param[in] sequencer sequencer to bounce
+        @param[in] bars bars to render
+        @param[in] sampleRate sample rate of the render
+        @param[in] bufferSize buffer size used for processing, 1024 if not given
+        @param[in] threads threads for rendering the stems, if 0 or not given the hardware concurrency is used
+        */
+        bool render( SequencerProcessor & sequencer, double bars, double sampleRate, int bufferSize = 1024, int threads = 0 );
+
+        /*!
+        @brief returns the rendered samples of a channel of a stem
+        @param[in] stem index of the stem
+        @param[in] channel channel of the stem
+        */
+        const std::vector<float> & stem( int stem, int channel ) const;
+
+        /*!
+        @brief sums a channel of all the stems and returns the result
+        @param[in] channel channel to mix
+        */
+        std::vector<float> mix( int channel ) const;
+
+        /*!
+        @brief returns the number of rendered samples
+        */
+        int size() const;
+
+    private:
+        void    renderStems() noexcept;
+        void    worker();
+        void    startWorkers( int threads );
+        void    stopWorkers();
+
+        std::vector<std::vector<std::vector<float>>> buffers;
+        std::vector<std::vector<float*>> pointers;
+        std::vector<float> empty;
+
+        int     channelsNum;
+        int     samples;
+
+        // block shared with the workers
+        int     blockPosition;
+        int     blockSize;
+        std::atomic<int> nextStem;
+
+        std::vector<std::thread>    workers;
+        std::mutex                  mutex;
+        std::condition_variable     startCondition;
+        std::condition_variable     doneCondition;
+        int     generation;
+        int     pending;
+        bool    running;
+
+    };
+
+}
+
+#endif // PDSP_STEMRENDERER_H_INCLUDED
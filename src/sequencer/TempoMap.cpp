@@ -0,0 +1,152 @@
+
+#include "TempoMap.h"
+#include <iostream>
+#include <algorithm>
+
+pdsp::TempoMap::TempoMap(){
+    modified = false;
+    sampleRate = 44100.0;
+    cursor = 0;
+    tempo = 120.0;
+    points.reserve( PDSP_PATTERN_MESSAGE_RESERVE_DEFAULT );
+    nextPoints.reserve( PDSP_PATTERN_MESSAGE_RESERVE_DEFAULT );
+}
+
+void pdsp::TempoMap::begin(){
+    if(modified==true){
+        std::cout<<"[pdsp] warning! you have already set this TempoMap, but it hasn't been processed yet, please set it once and wait for the changes to be effective before setting it again to avoid race conditions!\n";
+        pdsp_trace();
+    }
+    nextPoints.clear();
+}
+
+void pdsp::TempoMap::set( double bar, float tempo ){
+    if( tempo <= 0.0f ){
+        std::cout<<"[pdsp] warning! tempo map values should be greater than 0.0f, point ignored\n";
+        pdsp_trace();
+        return;
+    }
+    nextPoints.push_back( TempoPoint( bar, tempo, false ) );
+}
+
+void pdsp::TempoMap::ramp( double bar, float tempo ){
+    if( tempo <= 0.0f ){
+        std::cout<<"[pdsp] warning! tempo map values should be greater than 0.0f, point ignored\n";
+        pdsp_trace();
+        return;
+    }
+    nextPoints.push_back( TempoPoint( bar, tempo, true ) );
+}
+
+void pdsp::TempoMap::end(){
+    prepare( nextPoints, sampleRate );
+    modified = true;
+}
+
+void pdsp::TempoMap::clear(){
+    begin();
+    end();
+}
+
+void pdsp::TempoMap::setSampleRate( double sampleRate ){
+    this->sampleRate = sampleRate;
+    prepare( points, sampleRate );
+    prepare( nextPoints, sampleRate );
+}
+
+// sorts the points and precomputes slopes and cumulative samples
+void pdsp::TempoMap::prepare( std::vector<TempoPoint> & map, double sampleRate ){
+
+    if( map.empty() ){ return; }
+
+    std::stable_sort( map.begin(), map.end(), []( const TempoPoint & lhs, const TempoPoint & rhs ) noexcept {
+        return lhs.bar < rhs.bar;
+    });
+
+    if( map[0].bar > 0.0 ){
+        map.insert( map.begin(), TempoPoint( 0.0, map[0].tempo, false ) );
+    }
+    map[0].ramp = false;
+
+    double samplesPerBarTempo = 240.0 * sampleRate; // samples for one bar at tempo 1.0
+
+    map[0].sample = 0.0;
+    for( size_t i=0; i<map.size(); ++i ){
+        map[i].slope = 0.0;
+        if( i+1 < map.size() && map[i+1].ramp && map[i+1].bar > map[i].bar ){
+            map[i].slope = ( map[i+1].tempo - map[i].tempo ) / ( map[i+1].bar - map[i].bar );
+        }
+        if( i > 0 ){
+            const TempoPoint & prev = map[i-1];
+            double bars = map[i].bar - prev.bar;
+            if( prev.slope == 0.0 ){
+                map[i].sample = prev.sample + bars * samplesPerBarTempo / prev.tempo;
+            }else{
+                double endTempo = prev.tempo + prev.slope * bars;
+                map[i].sample = prev.sample + samplesPerBarTempo / prev.slope * log( endTempo / prev.tempo );
+            }
+        }
+    }
+}
+
+void pdsp::TempoMap::update() noexcept {
+    if( modified ){
+        points.swap( nextPoints ); // swap map in a thread-safe section
+        cursor = 0;
+        modified = false;
+    }
+}
+
+bool pdsp::TempoMap::empty() const {
+    return points.empty();
+}
+
+int pdsp::TempoMap::segmentForBar( const std::vector<TempoPoint> & map, int index, double bar ) const noexcept {
+    int last = (int) map.size() - 1;
+    while( index < last && map[index+1].bar <= bar ){ index++; }
+    while( index > 0 && map[index].bar > bar ){ index--; }
+    return index;
+}
+
+int pdsp::TempoMap::segmentForSample( const std::vector<TempoPoint> & map, int index, double sample ) const noexcept {
+    int last = (int) map.size() - 1;
+    while( index < last && map[index+1].sample <= sample ){ index++; }
+    while( index > 0 && map[index].sample > sample ){ index--; }
+    return index;
+}
+
+double pdsp::TempoMap::sampleAt( const std::vector<TempoPoint> & map, int index, double bar ) const noexcept {
+    const TempoPoint & p = map[index];
+    double bars = bar - p.bar;
+    double samplesPerBarTempo = 240.0 * sampleRate;
+    if( p.slope == 0.0 ){
+        return p.sample + bars * samplesPerBarTempo / p.tempo;
+    }else{
+        return p.sample + samplesPerBarTempo / p.slope * log( ( p.tempo + p.slope * bars ) / p.tempo );
+    }
+}
+
+double pdsp::TempoMap::barAt( const std::vector<TempoPoint> & map, int index, double sample ) const noexcept {
+    const TempoPoint & p = map[index];
+    double samples = sample - p.sample;
+    double samplesPerBarTempo = 240.0 * sampleRate;
+    if( p.slope == 0.0 ){
+        return p.bar + samples * p.tempo / samplesPerBarTempo;
+    }else{
+        return p.bar + p.tempo / p.slope * ( exp( p.slope * samples / samplesPerBarTempo ) - 1.0 );
+    }
+}
+
+double pdsp::TempoMap::advance( double bar, int samples ) noexcept {
+    cursor = segmentForBar( points, cursor, bar );
+    const TempoPoint & p = points[cursor];
+    tempo = p.tempo + p.slope * ( bar - p.bar );
+
+    double endSample = sampleAt( points, cursor, bar ) + samples;
+    int endCursor = segmentForSample( points, cursor, endSample );
+    return barAt( points, endCursor, endSample ) - bar;
+}
+
+double pdsp::TempoMap::currentTempo() const noexcept {
+    return tempo;
+}
@@ -0,0 +1,108 @@
+
+// TempoMap.h
+// ofxPDSP
+// Nicola Pisanti, MIT License, 2016 - 2018
+
+#ifndef PDSP_TEMPOMAP_H_INCLUDED
+#define PDSP_TEMPOMAP_H_INCLUDED
+
+#include <vector>
+#include <atomic>
+#include "../DSP/pdspCore.h"
+
+namespace pdsp{
+
+    /*!
+    @brief Tempo changes and ramps for the SequencerProcessor
+
+    A TempoMap is a list of tempo points in bars. Each point can be a step change (set) or the end of a linear ramp that starts from the previous point (ramp), the tempo changes linearly with the bars. After the last point the tempo stays constant. The cumulative samples of each point are precomputed when the map is applied, so the audio thread converts block ranges from samples to bars in constant time. The map is edited from the main thread between begin() and end(), the changes are applied at the start of the next buffer.
+    */
+    class TempoMap {
+        friend class SequencerProcessor;
+
+    private:
+        /*!
+            @cond HIDDEN_SYMBOLS
+        */
+        class TempoPoint {
+        public:
+            TempoPoint() : bar(0.0), tempo(120.0), ramp(false), slope(0.0), sample(0.0) {};
+            TempoPoint( double bar, double tempo, bool ramp ) : bar(bar), tempo(tempo), ramp(ramp), slope(0.0), sample(0.0) {};
+
+            double  bar;
+            double  tempo;
+            bool    ramp;
+            double  slope;  // tempo change for each bar of the segment that starts here
+            double  sample; // cumulative samples at this point
+        };
+        /*!
+            @endcond
+        */
+
+    public:
+        TempoMap();
+
+        /*!
+        @brief you call begin() before adding points, the points of the next map are cleared.
+        */
+        void begin();
+
+        /*!
+        @brief adds a step change of tempo. A map always starts from bar 0.0, if the first point is later its tempo is used from the start.
+        @param[in] bar position of the change in bars
+        @param[in] tempo new tempo
+        */
+        void set( double bar, float tempo );
+
+        /*!
+        @brief adds a linear ramp from the previous point, reaching the given tempo at the given bar.
+        @param[in] bar position in bars where the ramp ends
+        @param[in] tempo tempo reached at the end of the ramp
+        */
+        void ramp( double bar, float tempo );
+
+        /*!
+        @brief you call end() when you have finished adding points, the new map is used from the next buffer.
+        */
+        void end();
+
+        /*!
+        @brief removes all the points, the SequencerProcessor goes back to the tempo given with setTempo().
+        */
+        void clear();
+
+/*!
+    @cond HIDDEN_SYMBOLS
+*/
+        bool empty() const;
+
+        // returns the bars advanced in the given samples starting from bar
+        double advance( double bar, int samples ) noexcept;
+
+        // tempo at the start of the last advanced range
+        double currentTempo() const noexcept;
+/*!
+    @endcond
+*/
+
+    private:
+        void    prepare( std::vector<TempoPoint> & map, double sampleRate );
+        void    update() noexcept;
+        int     segmentForBar( const std::vector<TempoPoint> & map, int index, double bar ) const noexcept;
+        int     segmentForSample( const std::vector<TempoPoint> & map, int index, double sample ) const noexcept;
+        double  sampleAt( const std::vector<TempoPoint> & map, int index, double bar ) const noexcept;
+        double  barAt( const std::vector<TempoPoint> & map, int index, double sample ) const noexcept;
+        void    setSampleRate( double sampleRate );
+
+        std::vector<TempoPoint> points;
+        std::vector<TempoPoint> nextPoints;
+        std::atomic<bool>       modified;
+
+        double  sampleRate;
+        int     cursor;
+        double  tempo;
+    };
+
+}
+
+#endif // PDSP_TEMPOMAP_H_INCLUDED
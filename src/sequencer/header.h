@@ -7,9 +7,14 @@
 #define PDSP_SEQUENCERHEADER_H_INCLUDE
 
 #include "SequencerProcessor.h"
+#include "TempoMap.h"
 #include "SequencerSection.h"
 #include "SequencerMessage.h"
 #include "stockBehaviors.h"
 #include "Sequence.h"
+#include "MidiFile.h"
+#include "PackedScore.h"
+#include "ScoreLibrary.h"
+#include "StemRenderer.h"
 
 #endif // PDSP_SEQUENCERHEADER_H_INCLUDE
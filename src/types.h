@@ -16,6 +16,10 @@ enum Interpolator_t {Linear, Smooth};
 
 enum SlewMode_t {Rate, Time};
 
+enum FFTBackend_t { AudioFFTBackend, SimdFFTBackend };
+
+enum FIRMode_t { AutoFIR, DirectFIR, PartitionedFIR };
+
 static const float TriggerOff = - std::numeric_limits<float>::infinity();
 
 } // end namespace